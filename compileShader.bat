@@ -28,5 +28,18 @@ for /r %%f in (*.frag) do (
     glslc !fragFile! -o ./!fragFile!.spv
 )
 
+echo -------------------------------
+
+echo compute shaders to compile =^>
+
+for /r %%f in (*.comp) do (
+    set compFile=%%~f
+    set compFile=!compFile:~54!
+    echo res/shaders/!compFile!
+    echo     compiled: res/shaders/!compFile!.spv
+    rem compile
+    glslc !compFile! -o ./!compFile!.spv
+)
+
 popd
 exit
\ No newline at end of file
@@ -1,10 +1,37 @@
 #version 450
 
+// 8 bit textures: fragCol is (u, v) in texels and the sector light (0..1),
+// the texel's palette index goes through COLORMAP and PLAYPAL like the software renderer.
+layout(constant_id = 0) const bool INDEXED = false;
+
+layout(set = 0, binding = 0) uniform usampler2D indexedTexture; // r8 palette indices
+layout(set = 0, binding = 1) uniform sampler2D palette;         // 256x1 rgba8
+layout(set = 0, binding = 2) uniform usampler2D colormap;       // 256x34, a row per light level
+
+// same as SoftRenderer: 32 levels, brighter for every 1280 / depth
+const int LIGHT_LEVELS = 32;
+const float LIGHT_FALLOFF = 1280.0;
+
 layout(location = 0) in vec3 fragCol;
 
 layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    outColor = vec4(fragCol, 1.0);
-}
\ No newline at end of file
+    if(!INDEXED)
+    {
+        outColor = vec4(fragCol, 1.0);
+        return;
+    }
+
+    ivec2 size = textureSize(indexedTexture, 0);
+    ivec2 texel = ivec2(mod(floor(fragCol.xy), vec2(size)));
+    uint index = texelFetch(indexedTexture, texel, 0).r;
+
+    int lightNum = clamp(int(fragCol.z * 255.0) >> 4, 0, 15);
+    float depth = 1.0 / gl_FragCoord.w; // clip w, the view depth
+    int level = clamp((15 - lightNum) * 4 - int(LIGHT_FALLOFF / depth), 0, LIGHT_LEVELS - 1);
+
+    uint shaded = texelFetch(colormap, ivec2(index, level), 0).r;
+    outColor = texelFetch(palette, ivec2(shaded, 0), 0);
+}
@@ -1,6 +1,19 @@
 #include "app.h"
 
-App::App(i32 width, i32 height) : window{new Window()}
+#include "../game/ticcmd.h"
+
+#include <thread>
+
+// tics simulated at most per frame, a longer stall is skipped instead of caught up on
+#define MAX_TICS_PER_FRAME 10
+
+// longest the main thread waits for events with a render thread, in seconds
+#define INPUT_POLL_TIMEOUT 0.001
+
+App::App(i32 width, i32 height, bool renderThread, const char *recordPath, const char *playbackPath)
+    : window{new Window()}, ticClock{TICRATE, MAX_TICS_PER_FRAME}, lastTime{0.0}, currentTime{0.0}, numFrames{0},
+      frameTime{0.0f}, renderThread{renderThread}, latencySum{0.0}, latencyMax{0.0}, latencyCount{0},
+      recorder{nullptr}, playback{nullptr}
 {
     //_____ WINDOW INIT ______
     window->SetWindowSize(width, height);
@@ -15,6 +28,42 @@ App::App(i32 width, i32 height) : window{new Window()}
 
     //_____ SCENE INIT ______
     scene = new Scene();
+
+    //_____ INPUT RECORDING ______
+    if(playbackPath)
+    {
+        playback = new DEUtil::InputPlayback();
+        if(playback->Open(playbackPath))
+        {
+            if(playback->GetTicRate() != TICRATE)
+            {
+                LWARN(false, "input: " << playbackPath << " was recorded at " << playback->GetTicRate()
+                                       << " tics/s.\n");
+            }
+
+            Input::SetLiveInput(false);
+            window->GetJoystick().SetReplay(&playback->GetJoystick());
+        }
+        else
+        {
+            delete playback;
+            playback = nullptr;
+        }
+    }
+
+    if(recordPath)
+    {
+        recorder = new DEUtil::InputRecorder();
+        if(recorder->Open(recordPath, TICRATE))
+        {
+            Input::SetRecorder(recorder);
+        }
+        else
+        {
+            delete recorder;
+            recorder = nullptr;
+        }
+    }
 }
 
 void App::CalculateFrameRate()
@@ -28,31 +77,148 @@ void App::CalculateFrameRate()
 
         std::stringstream title;
         title << "DOOM Engine -- FPS: " << framerate;
-        window->SetWindowTitle(title.str());
+        if(latencyCount > 0)
+        {
+            title.precision(3);
+            title << " -- input to submit: " << latencySum / latencyCount * 1000.0 << " ms avg, "
+                  << latencyMax * 1000.0 << " ms max";
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(titleMutex);
+            pendingTitle = title.str();
+        }
 
         lastTime = currentTime;
         numFrames = -1;
         frameTime = f32(1000.0 / framerate);
+        latencySum = latencyMax = 0.0;
+        latencyCount = 0;
     }
 
     numFrames++;
 }
 
-void App::Run()
+void App::ApplyTitle()
 {
-    while(!window->WindowShouldClose())
+    std::lock_guard<std::mutex> lock(titleMutex);
+    if(!pendingTitle.empty())
     {
+        window->SetWindowTitle(pendingTitle);
+        pendingTitle.clear();
+    }
+}
+
+void App::Frame()
+{
+    // wait out vsync first, so the input below is sampled right before it's used. a render
+    // thread's input is polled by the main thread as it comes in, without one it's polled here
+    graphicsEngine->WaitForFrame();
+    if(!renderThread)
         window->NewFrame();
 
-        graphicsEngine->Render(scene);
+    // frames between two tics only interpolate, nothing is simulated twice. every tic
+    // takes the input that came in up to its own end, so a burst of catch up tics
+    // doesn't see all of it in the first one
+    u32 tics = ticClock.Advance(window->GetCurrentTime());
+    u32 events = 0;
+    f64 eventTimeSum = 0.0, oldestEvent = 0.0;
+    for(u32 i = 0; i < tics; i++)
+    {
+        f64 ticEnd = ticClock.GetTicEndTime(i, tics);
+        if(playback)
+        {
+            if(!playback->NextTic(Input::GetQueue(), ticEnd))
+            {
+                window->SetWindowShouldClose(true);
+                break;
+            }
+            window->UpdateJoystick();
+        }
+
+        Input::Tick(ticEnd);
+        const InputSnapshot &input = Input::GetSnapshot();
+        if(input.eventCount > 0 && events == 0)
+            oldestEvent = input.oldestEventTime;
+        events += input.eventCount;
+        eventTimeSum += input.eventTimeSum;
+
+        // glfw only polls joysticks on the main thread, with a render thread they aren't recorded
+        if(recorder)
+        {
+            if(!renderThread)
+            {
+                JoystickState joystick;
+                window->UpdateJoystick();
+                window->GetJoystick().GetState(joystick);
+                recorder->RecordJoystick(joystick);
+            }
+            recorder->EndTic();
+        }
+
+        scene->Tick();
+    }
+
+    scene->Interpolate(ticClock.GetAlpha());
+
+    graphicsEngine->Render(scene);
+
+    // every event that made it into this frame, from its callback to the submit
+    if(events > 0 && !playback)
+    {
+        f64 submitTime = graphicsEngine->GetLastSubmitTime();
+        latencySum += submitTime * events - eventTimeSum;
+        latencyCount += events;
+        latencyMax = std::max(latencyMax, submitTime - oldestEvent);
+    }
+
+    CalculateFrameRate();
+}
+
+void App::Run()
+{
+    ticClock.Reset(window->GetCurrentTime());
 
-        CalculateFrameRate();
+    if(!renderThread)
+    {
+        while(!window->WindowShouldClose())
+        {
+            Frame();
+            ApplyTitle();
+        }
+        return;
+    }
+
+    // glfw's events can only be polled on the main thread, so that's where they're polled
+    // (and timestamped) as they come in while frames go on without waiting for them
+    std::atomic<bool> quit{false};
+    std::thread render([this, &quit]() {
+        while(!quit.load(std::memory_order_relaxed))
+            Frame();
+    });
+
+    while(!window->WindowShouldClose())
+    {
+        window->PollEvents(INPUT_POLL_TIMEOUT);
+        ApplyTitle();
     }
+
+    quit.store(true, std::memory_order_relaxed);
+    render.join();
 }
 
 App::~App()
 {
+    if(recorder)
+    {
+        Input::SetRecorder(nullptr);
+        if(recorder->Close())
+            LINFO(false, "input: recorded " << recorder->GetTicCount() << " tics.\n");
+        delete recorder;
+    }
+    delete playback;
+
     delete scene;
     delete graphicsEngine;
     delete window;
-}
\ No newline at end of file
+}
@@ -4,6 +4,10 @@
 #include "../core/window.h"
 #include "../engine/engine.h"
 #include "../engine/scene.h"
+#include "../core/ticClock.h"
+#include "../io/inputRecord.h"
+
+#include <mutex>
 
 class App
 {
@@ -12,17 +16,40 @@ class App
     Window *window;
     Scene *scene;
 
+    // the scene simulates at a fixed TICRATE, frames render as fast as vsync allows
+    TicClock ticClock;
+
     f64 lastTime, currentTime;
     i32 numFrames;
     f32 frameTime;
 
+    // input is polled on the main thread while a render thread simulates and renders, so
+    // events are timestamped when they happen instead of once per frame
+    bool renderThread;
+
+    // only the main thread may set the title, the render thread leaves it here
+    std::mutex titleMutex;
+    std::string pendingTitle;
+
+    // input event to queue submit, in seconds, since the last title update
+    f64 latencySum, latencyMax;
+    u32 latencyCount;
+
+    // every tic's input goes into the recorder, or comes from the playback instead of the window
+    DEUtil::InputRecorder *recorder;
+    DEUtil::InputPlayback *playback;
+
     private:
+    void Frame();
     void CalculateFrameRate();
+    void ApplyTitle();
 
     public:
-    App(i32 width, i32 height);
+    // recordPath and playbackPath can be nullptr, the app closes once a playback is over
+    App(i32 width, i32 height, bool renderThread = false, const char *recordPath = nullptr,
+        const char *playbackPath = nullptr);
 
     void Run();
 
     ~App();
-};
\ No newline at end of file
+};
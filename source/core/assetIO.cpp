@@ -0,0 +1,626 @@
+#include "assetIO.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef IPLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+    #include <fcntl.h>
+    #include <io.h>
+    #include <sys/stat.h>
+#else
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#ifdef IPLATFORM_LINUX
+    #include <linux/io_uring.h>
+    #include <poll.h>
+    #include <sys/eventfd.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+#endif
+
+// preads are cut to this, some systems don't like bigger ones
+#define ASSETIO_MAX_READ (1u << 30)
+
+// the cqe of the eventfd poll, requests use their address
+#define ASSETIO_POLL_TAG 0
+
+#pragma region Files
+
+static i32 OpenReadOnly(const char *path)
+{
+#ifdef IPLATFORM_WINDOWS
+    return _open(path, _O_RDONLY | _O_BINARY);
+#else
+    return open(path, O_RDONLY | O_CLOEXEC);
+#endif
+}
+
+static void CloseFile(i32 fd)
+{
+#ifdef IPLATFORM_WINDOWS
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+static bool FileSize(i32 fd, u64 &size)
+{
+#ifdef IPLATFORM_WINDOWS
+    struct _stat64 info;
+    if(_fstat64(fd, &info) != 0)
+        return false;
+#else
+    struct stat info;
+    if(fstat(fd, &info) != 0)
+        return false;
+#endif
+    size = (u64)info.st_size;
+    return true;
+}
+
+// bytes read, 0 at the end of the file, -1 on an error
+static i64 ReadAt(i32 fd, u8 *out, u64 size, u64 offset)
+{
+    size = std::min<u64>(size, ASSETIO_MAX_READ);
+#ifdef IPLATFORM_WINDOWS
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD read = 0;
+    if(!ReadFile((HANDLE)_get_osfhandle(fd), out, (DWORD)size, &read, &overlapped))
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    return read;
+#else
+    i64 read;
+    do
+        read = pread(fd, out, size, (off_t)offset);
+    while(read < 0 && errno == EINTR);
+    return read;
+#endif
+}
+
+i32 DEUtil::AssetIO::OpenFile(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    auto found = files.find(path);
+    if(found != files.end())
+    {
+        found->second.users++;
+        return found->second.fd;
+    }
+
+    i32 fd = OpenReadOnly(path.c_str());
+    if(fd < 0)
+        return -1;
+
+    // make room by closing a file nobody is reading
+    if(files.size() >= ASSETIO_MAX_OPEN_FILES)
+    {
+        for(auto it = files.begin(); it != files.end(); ++it)
+        {
+            if(it->second.users == 0)
+            {
+                CloseFile(it->second.fd);
+                files.erase(it);
+                break;
+            }
+        }
+    }
+
+    files[path] = {fd, 1};
+    return fd;
+}
+
+void DEUtil::AssetIO::ReleaseFile(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    auto found = files.find(path);
+    if(found != files.end() && found->second.users > 0)
+        found->second.users--;
+}
+
+#pragma endregion
+
+#pragma region Requests
+
+DEUtil::AssetIO::AssetIO(u32 depth, u32 threads, bool allowUring)
+    : depth{std::max(1u, depth)}, uring{false}, nextId{1}, outstanding{0}, inFlight{0}, prefetchInFlight{0},
+      quit{false}, ringFd{-1}, eventFd{-1}, sqRing{nullptr}, cqRing{nullptr}, sqes{nullptr}, sqRingSize{0},
+      cqRingSize{0}, sqesSize{0}, sqHead{nullptr}, sqTail{nullptr}, sqMask{nullptr}, sqArray{nullptr},
+      cqHead{nullptr}, cqTail{nullptr}, cqMask{nullptr}, cqes{nullptr}, sqPending{0}
+{
+#ifdef IPLATFORM_LINUX
+    if(allowUring)
+        uring = SetupUring();
+#endif
+
+    if(uring)
+    {
+        this->threads.emplace_back(&AssetIO::UringLoop, this);
+        return;
+    }
+
+    // a pread thread per read in flight
+    this->depth = std::max(1u, threads);
+    for(u32 i = 0; i < this->depth; i++)
+        this->threads.emplace_back(&AssetIO::PoolLoop, this);
+}
+
+DEUtil::AssetReadId DEUtil::AssetIO::Read(const char *filepath, u64 offset, u64 size, AssetPriority priority,
+                                          AssetReadCallback callback)
+{
+    AssetRequest *request = new AssetRequest;
+    request->path = filepath;
+    request->offset = offset;
+    request->size = size;
+    request->priority = priority;
+    request->callback = std::move(callback);
+    request->result.status = AssetReadStatus::FAILED;
+    request->done = 0;
+    request->fd = -1;
+    request->started = false;
+    request->cancelled = false;
+
+    AssetReadId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextId++;
+        request->id = id;
+        request->result.id = id;
+        requests[id] = request;
+        queues[(u32)priority].push_back(request);
+        outstanding++;
+    }
+
+#ifdef IPLATFORM_LINUX
+    if(uring)
+    {
+        u64 one = 1;
+        if(write(eventFd, &one, sizeof(one)) < 0)
+            LWARN(false, "couldn't wake the asset io thread.\n");
+        return id;
+    }
+#endif
+
+    wake.notify_one();
+    return id;
+}
+
+std::future<DEUtil::AssetReadResult> DEUtil::AssetIO::Read(const char *filepath, u64 offset, u64 size,
+                                                           AssetPriority priority)
+{
+    // std::function has to be copyable, so the promise is shared
+    auto promise = std::make_shared<std::promise<AssetReadResult>>();
+    std::future<AssetReadResult> future = promise->get_future();
+    Read(filepath, offset, size, priority,
+         [promise](AssetReadResult &result) { promise->set_value(std::move(result)); });
+    return future;
+}
+
+bool DEUtil::AssetIO::Cancel(AssetReadId id)
+{
+    AssetRequest *request;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = requests.find(id);
+        if(found == requests.end())
+            return false;
+
+        request = found->second;
+        request->cancelled = true;
+
+        // in flight, Complete() drops the data
+        if(request->started)
+            return true;
+
+        std::deque<AssetRequest *> &queue = queues[(u32)request->priority];
+        queue.erase(std::find(queue.begin(), queue.end(), request));
+    }
+
+    Complete(request, AssetReadStatus::CANCELLED);
+    return true;
+}
+
+void DEUtil::AssetIO::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return outstanding == 0; });
+}
+
+DEUtil::AssetRequest *DEUtil::AssetIO::TakeRequest()
+{
+    // mutex is held. prefetches leave a quarter of the slots to visible reads, and never
+    // take more than a few: the disk works through what was submitted in order, so a visible
+    // read behind a deep queue of prefetches waits for all of them
+    if(inFlight >= depth)
+        return nullptr;
+
+    AssetRequest *request = nullptr;
+    u32 prefetchLimit = std::min<u32>(ASSETIO_PREFETCH_SLOTS, std::max(1u, depth - depth / 4));
+    if(!queues[(u32)AssetPriority::VISIBLE].empty())
+    {
+        request = queues[(u32)AssetPriority::VISIBLE].front();
+        queues[(u32)AssetPriority::VISIBLE].pop_front();
+    }
+    else if(!queues[(u32)AssetPriority::PREFETCH].empty() && prefetchInFlight < prefetchLimit)
+    {
+        request = queues[(u32)AssetPriority::PREFETCH].front();
+        queues[(u32)AssetPriority::PREFETCH].pop_front();
+        prefetchInFlight++;
+    }
+
+    if(request)
+    {
+        request->started = true;
+        inFlight++;
+    }
+    return request;
+}
+
+bool DEUtil::AssetIO::OpenRequest(AssetRequest *request)
+{
+    request->fd = OpenFile(request->path);
+    if(request->fd < 0)
+    {
+        LERROR("couldn't open file with path: " << request->path << "\n");
+        return false;
+    }
+
+    u64 fileSize;
+    if(!FileSize(request->fd, fileSize))
+        return false;
+
+    // never past the end of the file, the result is just shorter
+    u64 available = request->offset < fileSize ? fileSize - request->offset : 0;
+    u64 size = request->size == 0 ? available : std::min(request->size, available);
+    request->result.data.resize(size);
+    return true;
+}
+
+void DEUtil::AssetIO::Complete(AssetRequest *request, AssetReadStatus status)
+{
+    {
+        // after this Cancel() can't find it, so its answer matches the callback's
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.erase(request->id);
+        if(request->cancelled)
+            status = AssetReadStatus::CANCELLED;
+    }
+
+    if(request->fd >= 0)
+        ReleaseFile(request->path);
+
+    request->result.status = status;
+    if(status == AssetReadStatus::DONE)
+        request->result.data.resize(request->done);
+    else
+        request->result.data.clear();
+
+    if(request->callback)
+        request->callback(request->result);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(request->started)
+        {
+            inFlight--;
+            if(request->priority == AssetPriority::PREFETCH)
+                prefetchInFlight--;
+        }
+
+        if(--outstanding == 0)
+            idle.notify_all();
+    }
+
+    // a slot opened up
+    if(request->started && !uring)
+        wake.notify_one();
+    delete request;
+}
+
+#pragma endregion
+
+#pragma region Threads
+
+void DEUtil::AssetIO::PoolLoop()
+{
+    while(true)
+    {
+        AssetRequest *request = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(!quit && !(request = TakeRequest()))
+                wake.wait(lock);
+            if(!request)
+                return;
+        }
+
+        if(!OpenRequest(request))
+        {
+            Complete(request, AssetReadStatus::FAILED);
+            continue;
+        }
+
+        bool ok = true;
+        u64 size = request->result.data.size();
+        while(request->done < size)
+        {
+            i64 read = ReadAt(request->fd, request->result.data.data() + request->done, size - request->done,
+                              request->offset + request->done);
+            if(read <= 0)
+            {
+                ok = read == 0;
+                break;
+            }
+            request->done += (u64)read;
+        }
+
+        Complete(request, ok ? AssetReadStatus::DONE : AssetReadStatus::FAILED);
+    }
+}
+
+#ifdef IPLATFORM_LINUX
+
+bool DEUtil::AssetIO::SetupUring()
+{
+    // one slot more for the eventfd poll
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = (i32)syscall(__NR_io_uring_setup, depth + 1, &params);
+    if(ringFd < 0)
+    {
+        LDEBUG(false, "io_uring isn't available (" << strerror(errno) << "), reading on threads.\n");
+        return false;
+    }
+
+    // IORING_OP_READ is 5.6, fast poll 5.7
+    if(!(params.features & IORING_FEAT_FAST_POLL))
+    {
+        LDEBUG(false, "io_uring is too old, reading on threads.\n");
+        close(ringFd);
+        ringFd = -1;
+        return false;
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(u32);
+    cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if(params.features & IORING_FEAT_SINGLE_MMAP)
+        sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    cqRing = (params.features & IORING_FEAT_SINGLE_MMAP)
+                 ? sqRing
+                 : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+                        IORING_OFF_CQ_RING);
+    sqes = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if(sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED || eventFd < 0)
+    {
+        LDEBUG(false, "couldn't map the io_uring, reading on threads.\n");
+        if(sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if(cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if(sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if(eventFd >= 0)
+            close(eventFd);
+        close(ringFd);
+        sqRing = cqRing = sqes = nullptr;
+        ringFd = eventFd = -1;
+        return false;
+    }
+
+    u8 *sq = (u8 *)sqRing, *cq = (u8 *)cqRing;
+    sqHead = (u32 *)(sq + params.sq_off.head);
+    sqTail = (u32 *)(sq + params.sq_off.tail);
+    sqMask = (u32 *)(sq + params.sq_off.ring_mask);
+    sqArray = (u32 *)(sq + params.sq_off.array);
+    cqHead = (u32 *)(cq + params.cq_off.head);
+    cqTail = (u32 *)(cq + params.cq_off.tail);
+    cqMask = (u32 *)(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+static io_uring_sqe *NextSqe(void *sqes, u32 *sqHead, u32 *sqTail, u32 *sqMask, u32 *sqArray, u32 &tail)
+{
+    // the ring thread is the only producer, the kernel moves head
+    tail = *sqTail;
+    if(tail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) > *sqMask)
+        return nullptr;
+
+    u32 index = tail & *sqMask;
+    io_uring_sqe *sqe = (io_uring_sqe *)sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray[index] = index;
+    return sqe;
+}
+
+bool DEUtil::AssetIO::QueueUringRead(AssetRequest *request)
+{
+    u32 tail;
+    io_uring_sqe *sqe = NextSqe(sqes, sqHead, sqTail, sqMask, sqArray, tail);
+    if(!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = request->fd;
+    sqe->addr = (u64)(uintptr_t)(request->result.data.data() + request->done);
+    sqe->len = (u32)std::min<u64>(request->result.data.size() - request->done, ASSETIO_MAX_READ);
+    sqe->off = request->offset + request->done;
+    sqe->user_data = (u64)(uintptr_t)request;
+
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    sqPending++;
+    return true;
+}
+
+bool DEUtil::AssetIO::QueueUringPoll()
+{
+    u32 tail;
+    io_uring_sqe *sqe = NextSqe(sqes, sqHead, sqTail, sqMask, sqArray, tail);
+    if(!sqe)
+        return false;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = eventFd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = ASSETIO_POLL_TAG;
+
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    sqPending++;
+    return true;
+}
+
+void DEUtil::AssetIO::SubmitUring(u32 waitFor)
+{
+    i32 submitted = (i32)syscall(__NR_io_uring_enter, ringFd, sqPending, waitFor,
+                                 waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if(submitted >= 0)
+        sqPending -= std::min(sqPending, (u32)submitted);
+    else if(errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        LERROR("io_uring_enter failed: " << strerror(errno) << "\n");
+}
+
+void DEUtil::AssetIO::UringLoop()
+{
+    QueueUringPoll();
+
+    std::vector<AssetRequest *> taken;
+    while(true)
+    {
+        // new reads up to depth, the ring has room for all of them and the poll
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while(AssetRequest *request = TakeRequest())
+                taken.push_back(request);
+        }
+
+        for(AssetRequest *request : taken)
+        {
+            if(!OpenRequest(request))
+                Complete(request, AssetReadStatus::FAILED);
+            else if(request->result.data.empty())
+                Complete(request, AssetReadStatus::DONE);
+            else
+                QueueUringRead(request);
+        }
+        taken.clear();
+
+        // everything in flight when quit was set has called back
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(quit && inFlight == 0)
+                break;
+        }
+
+        SubmitUring(1);
+
+        u32 head = *cqHead;
+        u32 tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for(; head != tail; head++)
+        {
+            io_uring_cqe cqe = ((io_uring_cqe *)cqes)[head & *cqMask];
+            __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+            if(cqe.user_data == ASSETIO_POLL_TAG)
+            {
+                u64 count;
+                while(read(eventFd, &count, sizeof(count)) > 0)
+                {
+                }
+                QueueUringPoll();
+                continue;
+            }
+
+            AssetRequest *request = (AssetRequest *)(uintptr_t)cqe.user_data;
+            if(cqe.res == -EINTR || cqe.res == -EAGAIN)
+            {
+                QueueUringRead(request);
+                continue;
+            }
+            if(cqe.res < 0)
+            {
+                Complete(request, AssetReadStatus::FAILED);
+                continue;
+            }
+
+            // a short read goes again from where it stopped, 0 is the end of the file
+            request->done += (u64)cqe.res;
+            if(cqe.res > 0 && request->done < request->result.data.size())
+                QueueUringRead(request);
+            else
+                Complete(request, AssetReadStatus::DONE);
+        }
+    }
+}
+
+#else
+
+bool DEUtil::AssetIO::SetupUring()
+{
+    return false;
+}
+
+void DEUtil::AssetIO::UringLoop() {}
+
+#endif
+
+#pragma endregion
+
+DEUtil::AssetIO::~AssetIO()
+{
+    // reads that haven't started are cancelled, the ones in flight finish
+    std::vector<AssetRequest *> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        for(std::deque<AssetRequest *> &queue : queues)
+        {
+            cancelled.insert(cancelled.end(), queue.begin(), queue.end());
+            queue.clear();
+        }
+    }
+
+    for(AssetRequest *request : cancelled)
+        Complete(request, AssetReadStatus::CANCELLED);
+
+#ifdef IPLATFORM_LINUX
+    if(uring)
+    {
+        u64 one = 1;
+        if(write(eventFd, &one, sizeof(one)) < 0)
+            LWARN(false, "couldn't wake the asset io thread.\n");
+    }
+#endif
+    wake.notify_all();
+
+    for(std::thread &thread : threads)
+        thread.join();
+
+    for(auto &file : files)
+        CloseFile(file.second.fd);
+
+#ifdef IPLATFORM_LINUX
+    if(uring)
+    {
+        munmap(sqes, sqesSize);
+        if(cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        munmap(sqRing, sqRingSize);
+        close(eventFd);
+        close(ringFd);
+    }
+#endif
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "defines.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define ASSETIO_DEFAULT_DEPTH   64 // reads in flight at once
+#define ASSETIO_DEFAULT_THREADS 4  // pread threads when io_uring isn't there
+#define ASSETIO_MAX_OPEN_FILES  64 // files kept open between reads
+#define ASSETIO_PREFETCH_SLOTS  4  // prefetch reads in flight at most, a visible read only queues behind these
+
+namespace DEUtil {
+
+enum class AssetPriority
+{
+    VISIBLE,  // needed for the next frames, goes ahead of every prefetch
+    PREFETCH, // may be needed later, at most ASSETIO_PREFETCH_SLOTS (and 3/4 of depth) in flight
+};
+
+enum class AssetReadStatus
+{
+    DONE,
+    FAILED,
+    CANCELLED,
+};
+
+typedef u64 AssetReadId;
+
+struct AssetReadResult
+{
+    AssetReadId id;
+    AssetReadStatus status;
+    std::vector<u8> data; // what was read, shorter than asked for at the end of the file
+};
+
+typedef std::function<void(AssetReadResult &result)> AssetReadCallback;
+
+struct AssetRequest
+{
+    AssetReadId id;
+    std::string path;
+    u64 offset;
+    u64 size; // 0 reads to the end of the file
+    AssetPriority priority;
+    AssetReadCallback callback;
+
+    AssetReadResult result;
+    u64 done; // bytes read so far
+    i32 fd;
+    bool started; // taken off its queue
+    bool cancelled;
+};
+
+struct AssetFile
+{
+    i32 fd;
+    u32 users; // reads in flight, it's only closed at 0
+};
+
+// reads files off the main thread. on linux the reads go through one io_uring with up to
+// depth of them in flight, fed and reaped by a single thread. without it (an old kernel, a
+// sandbox that blocks it, another os) a few threads call pread. callbacks run on the io
+// threads as reads finish, so they should hand their data off rather than decode it there.
+class AssetIO
+{
+    private:
+    u32 depth;
+    bool uring;
+
+    // requests that haven't started, by priority
+    std::mutex mutex;
+    std::condition_variable wake, idle;
+    std::deque<AssetRequest *> queues[2];
+    std::unordered_map<AssetReadId, AssetRequest *> requests; // every request not done yet
+    AssetReadId nextId;
+    u32 outstanding; // reads that haven't called back
+    u32 inFlight;
+    u32 prefetchInFlight;
+    bool quit;
+
+    // files by path, closed when there are too many
+    std::mutex fileMutex;
+    std::unordered_map<std::string, AssetFile> files;
+
+    std::vector<std::thread> threads;
+
+    // io_uring
+    i32 ringFd;
+    i32 eventFd; // Read() pokes it to wake the ring thread out of its wait
+    void *sqRing, *cqRing, *sqes;
+    usize sqRingSize, cqRingSize, sqesSize;
+    u32 *sqHead, *sqTail, *sqMask, *sqArray;
+    u32 *cqHead, *cqTail, *cqMask;
+    void *cqes;
+    u32 sqPending;
+
+    private:
+    bool SetupUring();
+    void UringLoop();
+    void PoolLoop();
+    bool QueueUringRead(AssetRequest *request);
+    bool QueueUringPoll();
+    void SubmitUring(u32 waitFor);
+
+    AssetRequest *TakeRequest();
+    bool OpenRequest(AssetRequest *request);
+    i32 OpenFile(const std::string &path);
+    void ReleaseFile(const std::string &path);
+    void Complete(AssetRequest *request, AssetReadStatus status);
+
+    public:
+    // depth caps the reads in flight (ring slots or pread threads, threads is used without io_uring)
+    AssetIO(u32 depth = ASSETIO_DEFAULT_DEPTH, u32 threads = ASSETIO_DEFAULT_THREADS, bool allowUring = true);
+    AssetIO(const AssetIO &io) = delete;
+    AssetIO &operator=(const AssetIO &io) = delete;
+
+    // size bytes at offset of the file (size 0 to the end), callback gets the result on an io
+    // thread. a file that can't be opened or read is a FAILED result, not an error here.
+    AssetReadId Read(const char *filepath, u64 offset, u64 size, AssetPriority priority, AssetReadCallback callback);
+
+    // Read() with the result as a future
+    std::future<AssetReadResult> Read(const char *filepath, u64 offset, u64 size, AssetPriority priority);
+
+    // the read's callback gets CANCELLED instead of the data, a read that's already in flight
+    // still finishes but its data is dropped. false if the read is done already.
+    bool Cancel(AssetReadId id);
+
+    // returns once every read so far has called back
+    void WaitIdle();
+
+    inline bool IsUsingUring() const { return uring; }
+
+    ~AssetIO();
+};
+
+} // namespace DEUtil
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+// ---------------------- BINARY LOG FILES ----------------------
+//
+// BinLogHeader, then records back to back until a BINLOG_END byte or the end of the file.
+// every L* call site is a BINLOG_SITE record (level, file, line and its string literals)
+// the first time it logs, its messages after that are a BINLOG_MESSAGE with the site's id
+// and only the arguments: numbers raw, runtime strings with their length and each literal
+// as its index in the site. messages of a site that isn't registered yet are
+// BINLOG_INLINE, with everything spelled out. a file starts with every site registered
+// before it, so each rotated file decodes on its own.
+//
+// site:    BinLogSiteHeader, file name, then literalCount times u16 length + bytes
+// message: BinLogMessageHeader, size bytes of arguments
+// inline:  BinLogInlineHeader, size bytes of arguments, file name
+// argument: a BinLogTag byte, then its value (strings: u16 length + bytes, literals: u8 index)
+
+#define BINLOG_MAGIC   0x474c4244 // "DBLG"
+#define BINLOG_VERSION 1
+
+#define BINLOG_PAYLOAD_SIZE  480 // arguments per message, the rest is cut off
+#define BINLOG_MAX_LITERALS  32  // a site with more stays inline
+#define BINLOG_MAX_FILE_NAME 256 // file names in records are cut to it
+#define BINLOG_MAX_SITE_SIZE 1024 // a site with a bigger record stays inline
+#define BINLOG_MIN_FILE_SIZE 4096 // a new file keeps half of it for messages
+
+enum BinLogRecord : uint8_t
+{
+    BINLOG_END = 0,
+    BINLOG_SITE = 1,
+    BINLOG_MESSAGE = 2,
+    BINLOG_INLINE = 3,
+};
+
+enum BinLogTag : uint8_t
+{
+    BINLOG_LITERAL = 0,
+    BINLOG_STRING = 1,
+    BINLOG_CHAR = 2,
+    BINLOG_BOOL = 3,
+    BINLOG_I32 = 4,
+    BINLOG_U32 = 5,
+    BINLOG_I64 = 6,
+    BINLOG_U64 = 7,
+    BINLOG_F32 = 8,
+    BINLOG_F64 = 9,
+};
+
+#pragma pack(push, 1)
+struct BinLogHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int64_t epochNs;   // system clock at the session's time 0, ns since 1970
+    uint64_t sequence; // file number in the session
+};
+
+struct BinLogSiteHeader
+{
+    uint8_t type;
+    uint8_t level;
+    uint16_t fileLength;
+    uint32_t id;
+    uint32_t line;
+    uint16_t literalCount;
+};
+
+struct BinLogMessageHeader
+{
+    uint8_t type;
+    uint8_t pad;
+    uint16_t size;
+    uint32_t site;
+    uint64_t time; // ns since the session started
+};
+
+struct BinLogInlineHeader
+{
+    uint8_t type;
+    uint8_t level;
+    uint16_t size;
+    uint32_t line;
+    uint64_t time;
+    uint16_t fileLength;
+};
+#pragma pack(pop)
+
+// whatever a file starts with, the biggest record fits in what's left, so a rotation always makes room
+static_assert(BINLOG_MIN_FILE_SIZE / 2 >= BINLOG_MAX_SITE_SIZE &&
+                  BINLOG_MIN_FILE_SIZE / 2 >= sizeof(BinLogInlineHeader) + BINLOG_PAYLOAD_SIZE + BINLOG_MAX_FILE_NAME,
+              "expected the biggest binary log record to fit half of the smallest file.");
+
+// a call site's registration state, it only holds for the session in the top bits
+#define LOG_SITE_NEW         0
+#define LOG_SITE_REGISTERING 1
+#define LOG_SITE_REGISTERED  2
+#define LOG_SITE_INLINE      3 // too many literals
+#define LOG_SITE_PHASE(x)    ((x) & 3)
+#define LOG_SITE_SESSION(x)  ((x) >> 2)
+
+// a static per L* macro expansion, constant initialized so it costs no guard
+struct LogSite
+{
+    std::atomic<uint32_t> state;
+    uint32_t id;
+    uint32_t literalCount;
+    const char *literals[BINLOG_MAX_LITERALS];
+    uint16_t literalLengths[BINLOG_MAX_LITERALS];
+    const char *file;
+    uint32_t line;
+    uint8_t level;
+    LogSite *next; // registered sites, newest first
+
+    constexpr LogSite()
+        : state{0}, id{0}, literalCount{0}, literals{}, literalLengths{}, file{nullptr}, line{0}, level{0},
+          next{nullptr}
+    {
+    }
+};
+
+// a message's record, built on its thread and copied into the file whole
+class BinLogBuffer
+{
+    public:
+    uint8_t data[sizeof(BinLogInlineHeader) + BINLOG_PAYLOAD_SIZE + BINLOG_MAX_FILE_NAME];
+    size_t size; // argument bytes
+
+    void Begin() { size = 0; }
+
+    // after the room a BinLogInlineHeader takes, the header goes in front once it's known
+    uint8_t *GetPayload() { return data + sizeof(BinLogInlineHeader); }
+
+    void PutString(const char *str, size_t length)
+    {
+        if(length > BINLOG_PAYLOAD_SIZE)
+            length = BINLOG_PAYLOAD_SIZE;
+
+        if(size + 3 + length > BINLOG_PAYLOAD_SIZE)
+        {
+            if(size + 3 >= BINLOG_PAYLOAD_SIZE)
+                return;
+            length = BINLOG_PAYLOAD_SIZE - size - 3;
+        }
+
+        uint8_t *out = GetPayload() + size;
+        uint16_t length16 = (uint16_t)length;
+        out[0] = BINLOG_STRING;
+        memcpy(out + 1, &length16, 2);
+        memcpy(out + 3, str, length);
+        size += 3 + length;
+    }
+
+    void PutLiteral(uint32_t index)
+    {
+        if(size + 2 > BINLOG_PAYLOAD_SIZE)
+            return;
+
+        GetPayload()[size] = BINLOG_LITERAL;
+        GetPayload()[size + 1] = (uint8_t)index;
+        size += 2;
+    }
+
+    template<typename T>
+    void PutValue(BinLogTag tag, T value)
+    {
+        if(size + 1 + sizeof(T) > BINLOG_PAYLOAD_SIZE)
+            return;
+
+        GetPayload()[size] = tag;
+        memcpy(GetPayload() + size + 1, &value, sizeof(T));
+        size += 1 + sizeof(T);
+    }
+
+    // numbers keep their bits, chars and bools their ostream look, anything else is
+    // formatted with its operator<< here
+    template<typename T>
+    void Append(const T &value)
+    {
+        if constexpr(std::is_same_v<T, bool>)
+            PutValue<uint8_t>(BINLOG_BOOL, value);
+        else if constexpr(std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                          std::is_same_v<T, unsigned char>)
+            PutValue<char>(BINLOG_CHAR, (char)value);
+        else if constexpr(std::is_integral_v<T>)
+        {
+            // nested, sizeof(T) can't even be asked of the function types manipulators are
+            if constexpr(std::is_signed_v<T> && sizeof(T) <= 4)
+                PutValue<int32_t>(BINLOG_I32, value);
+            else if constexpr(sizeof(T) <= 4)
+                PutValue<uint32_t>(BINLOG_U32, value);
+            else if constexpr(std::is_signed_v<T>)
+                PutValue<int64_t>(BINLOG_I64, value);
+            else
+                PutValue<uint64_t>(BINLOG_U64, value);
+        }
+        else if constexpr(std::is_same_v<T, float>)
+            PutValue<float>(BINLOG_F32, value);
+        else if constexpr(std::is_floating_point_v<T>)
+            PutValue<double>(BINLOG_F64, (double)value);
+        else if constexpr(std::is_convertible_v<const T &, const char *>)
+            PutString(value, strlen(value));
+        else if constexpr(std::is_same_v<T, std::string>)
+            PutString(value.data(), value.size());
+        else
+        {
+            std::ostringstream text;
+            text << value;
+            std::string str = text.str();
+            PutString(str.data(), str.size());
+        }
+    }
+
+    // the arguments as the text they stand for, site is the one the literals are indices into
+    std::string ToText(const LogSite *site) const
+    {
+        std::string out;
+        const uint8_t *in = data + sizeof(BinLogInlineHeader), *end = in + size;
+        while(in < end)
+        {
+            uint8_t tag = *in++;
+            switch(tag)
+            {
+            case BINLOG_LITERAL:
+                if(site && *in < site->literalCount)
+                    out.append(site->literals[*in], site->literalLengths[*in]);
+                in++;
+                break;
+            case BINLOG_STRING:
+            {
+                uint16_t length;
+                memcpy(&length, in, 2);
+                out.append((const char *)in + 2, length);
+                in += 2 + length;
+                break;
+            }
+            case BINLOG_CHAR:
+                out += (char)*in++;
+                break;
+            case BINLOG_BOOL:
+                out += *in++ ? '1' : '0';
+                break;
+            case BINLOG_I32:
+                out += std::to_string(Read<int32_t>(in));
+                break;
+            case BINLOG_U32:
+                out += std::to_string(Read<uint32_t>(in));
+                break;
+            case BINLOG_I64:
+                out += std::to_string(Read<int64_t>(in));
+                break;
+            case BINLOG_U64:
+                out += std::to_string(Read<uint64_t>(in));
+                break;
+            case BINLOG_F32:
+            case BINLOG_F64:
+            {
+                // ostream's default float format
+                char number[64];
+                double value = tag == BINLOG_F32 ? Read<float>(in) : Read<double>(in);
+                snprintf(number, sizeof(number), "%g", value);
+                out += number;
+                break;
+            }
+            default:
+                return out;
+            }
+        }
+
+        return out;
+    }
+
+    private:
+    template<typename T>
+    static T Read(const uint8_t *&in)
+    {
+        T value;
+        memcpy(&value, in, sizeof(T));
+        in += sizeof(T);
+        return value;
+    }
+};
@@ -0,0 +1,110 @@
+#include "bitset.h"
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define BITSET_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define BITSET_SSE2 1
+#endif
+
+void DEUtil::AndBits(u64 *dst, const u64 *src, usize wordCount)
+{
+    usize i = 0;
+
+#if defined(BITSET_AVX2)
+    for(; i + 4 <= wordCount; i += 4)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_and_si256(a, b));
+    }
+#elif defined(BITSET_SSE2)
+    for(; i + 2 <= wordCount; i += 2)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_and_si128(a, b));
+    }
+#endif
+
+    for(; i < wordCount; i++)
+        dst[i] &= src[i];
+}
+
+void DEUtil::OrBits(u64 *dst, const u64 *src, usize wordCount)
+{
+    usize i = 0;
+
+#if defined(BITSET_AVX2)
+    for(; i + 4 <= wordCount; i += 4)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_or_si256(a, b));
+    }
+#elif defined(BITSET_SSE2)
+    for(; i + 2 <= wordCount; i += 2)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(a, b));
+    }
+#endif
+
+    for(; i < wordCount; i++)
+        dst[i] |= src[i];
+}
+
+bool DEUtil::AnyBitsShared(const u64 *a, const u64 *b, usize wordCount)
+{
+    usize i = 0;
+
+#if defined(BITSET_AVX2)
+    for(; i + 4 <= wordCount; i += 4)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(b + i));
+        if(!_mm256_testz_si256(x, y))
+            return true;
+    }
+#elif defined(BITSET_SSE2)
+    for(; i + 2 <= wordCount; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128i both = _mm_and_si128(x, y);
+        if(_mm_movemask_epi8(_mm_cmpeq_epi8(both, _mm_setzero_si128())) != 0xffff)
+            return true;
+    }
+#endif
+
+    for(; i < wordCount; i++)
+    {
+        if(a[i] & b[i])
+            return true;
+    }
+
+    return false;
+}
+
+static inline u32 PopCount(u64 x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (u32)__builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (u32)((x * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+usize DEUtil::CountBits(const u64 *bits, usize wordCount)
+{
+    usize count = 0;
+    for(usize i = 0; i < wordCount; i++)
+        count += PopCount(bits[i]);
+
+    return count;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "defines.h"
+
+// bit rows stored as u64 words, bit i lives in word i / 64 at bit i % 64.
+// the bulk ops below use sse2/avx2 when the compiler targets them.
+
+namespace DEUtil {
+
+inline usize BitWords(usize bitCount)
+{
+    return (bitCount + 63) / 64;
+}
+
+inline bool TestBit(const u64 *bits, usize i)
+{
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+inline void SetBit(u64 *bits, usize i)
+{
+    bits[i >> 6] |= 1ull << (i & 63);
+}
+
+inline void ClearBit(u64 *bits, usize i)
+{
+    bits[i >> 6] &= ~(1ull << (i & 63));
+}
+
+// dst &= src
+void AndBits(u64 *dst, const u64 *src, usize wordCount);
+
+// dst |= src
+void OrBits(u64 *dst, const u64 *src, usize wordCount);
+
+// true if any bit is set in a & b
+bool AnyBitsShared(const u64 *a, const u64 *b, usize wordCount);
+
+usize CountBits(const u64 *bits, usize wordCount);
+
+} // namespace DEUtil
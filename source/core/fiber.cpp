@@ -0,0 +1,248 @@
+#include "fiber.h"
+#include "logger.h"
+
+#ifdef IPLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#include <cstdint>
+
+#if defined(FIBER_ASM)
+
+// DEFiberSwitch(void **fromSp, void *toSp): pushes the callee saved registers, swaps stacks
+// and pops the other fiber's. a new fiber's stack is laid out like a switched out one that
+// returns into DEFiberStart with the func in one saved register and its arg in another.
+extern "C" void DEFiberSwitch(void **fromSp, void *toSp);
+extern "C" void DEFiberStart();
+
+    #if defined(__x86_64__)
+
+// mxcsr and the x87 control word, r15, r14, r13 (func), r12 (arg), rbx, rbp, return address
+        #define FIBER_FRAME_SIZE 64
+
+__asm__(".text\n"
+        ".globl DEFiberSwitch\n"
+        ".hidden DEFiberSwitch\n"
+        ".type DEFiberSwitch, @function\n"
+        "DEFiberSwitch:\n"
+        "    pushq %rbp\n"
+        "    pushq %rbx\n"
+        "    pushq %r12\n"
+        "    pushq %r13\n"
+        "    pushq %r14\n"
+        "    pushq %r15\n"
+        "    subq $8, %rsp\n"
+        "    stmxcsr (%rsp)\n"
+        "    fnstcw 4(%rsp)\n"
+        "    movq %rsp, (%rdi)\n"
+        "    movq %rsi, %rsp\n"
+        "    ldmxcsr (%rsp)\n"
+        "    fldcw 4(%rsp)\n"
+        "    addq $8, %rsp\n"
+        "    popq %r15\n"
+        "    popq %r14\n"
+        "    popq %r13\n"
+        "    popq %r12\n"
+        "    popq %rbx\n"
+        "    popq %rbp\n"
+        "    ret\n"
+        ".size DEFiberSwitch, .-DEFiberSwitch\n"
+        ".globl DEFiberStart\n"
+        ".hidden DEFiberStart\n"
+        ".type DEFiberStart, @function\n"
+        "DEFiberStart:\n"
+        "    movq %r12, %rdi\n"
+        "    callq *%r13\n"
+        "    ud2\n"
+        ".size DEFiberStart, .-DEFiberStart\n");
+
+static void *InitialFrame(u8 *top, DEUtil::FiberFunc func, void *arg)
+{
+    // DEFiberStart runs with rsp 16 byte aligned, so its call leaves func's frame aligned
+    u64 *frame = (u64 *)(top - FIBER_FRAME_SIZE - 16);
+    frame[0] = 0x1f80 | ((u64)0x037f << 32); // default mxcsr and x87 control word
+    frame[1] = 0;                            // r15
+    frame[2] = 0;                            // r14
+    frame[3] = (u64)(uintptr_t)func;         // r13
+    frame[4] = (u64)(uintptr_t)arg;          // r12
+    frame[5] = 0;                            // rbx
+    frame[6] = 0;                            // rbp
+    frame[7] = (u64)(uintptr_t)&DEFiberStart;
+    return frame;
+}
+
+    #else
+
+// x19..x28, x29 (frame), x30 (link), d8..d15. x19 holds the arg and x20 the func at first
+        #define FIBER_FRAME_SIZE 160
+
+__asm__(".text\n"
+        ".globl DEFiberSwitch\n"
+        ".hidden DEFiberSwitch\n"
+        ".type DEFiberSwitch, %function\n"
+        "DEFiberSwitch:\n"
+        "    sub sp, sp, #160\n"
+        "    stp x19, x20, [sp, #0]\n"
+        "    stp x21, x22, [sp, #16]\n"
+        "    stp x23, x24, [sp, #32]\n"
+        "    stp x25, x26, [sp, #48]\n"
+        "    stp x27, x28, [sp, #64]\n"
+        "    stp x29, x30, [sp, #80]\n"
+        "    stp d8, d9, [sp, #96]\n"
+        "    stp d10, d11, [sp, #112]\n"
+        "    stp d12, d13, [sp, #128]\n"
+        "    stp d14, d15, [sp, #144]\n"
+        "    mov x2, sp\n"
+        "    str x2, [x0]\n"
+        "    mov sp, x1\n"
+        "    ldp x19, x20, [sp, #0]\n"
+        "    ldp x21, x22, [sp, #16]\n"
+        "    ldp x23, x24, [sp, #32]\n"
+        "    ldp x25, x26, [sp, #48]\n"
+        "    ldp x27, x28, [sp, #64]\n"
+        "    ldp x29, x30, [sp, #80]\n"
+        "    ldp d8, d9, [sp, #96]\n"
+        "    ldp d10, d11, [sp, #112]\n"
+        "    ldp d12, d13, [sp, #128]\n"
+        "    ldp d14, d15, [sp, #144]\n"
+        "    add sp, sp, #160\n"
+        "    ret\n"
+        ".size DEFiberSwitch, .-DEFiberSwitch\n"
+        ".globl DEFiberStart\n"
+        ".hidden DEFiberStart\n"
+        ".type DEFiberStart, %function\n"
+        "DEFiberStart:\n"
+        "    mov x0, x19\n"
+        "    blr x20\n"
+        "    brk #0\n"
+        ".size DEFiberStart, .-DEFiberStart\n");
+
+static void *InitialFrame(u8 *top, DEUtil::FiberFunc func, void *arg)
+{
+    u64 *frame = (u64 *)(top - FIBER_FRAME_SIZE);
+    for(u32 i = 0; i < FIBER_FRAME_SIZE / 8; i++)
+        frame[i] = 0;
+    frame[0] = (u64)(uintptr_t)arg;            // x19
+    frame[1] = (u64)(uintptr_t)func;           // x20
+    frame[11] = (u64)(uintptr_t)&DEFiberStart; // x30
+    return frame;
+}
+
+    #endif
+
+#elif defined(FIBER_UCONTEXT)
+
+// makecontext() only passes ints, so the pointers come in halves
+static void UContextStart(u32 funcLow, u32 funcHigh, u32 argLow, u32 argHigh)
+{
+    DEUtil::FiberFunc func = (DEUtil::FiberFunc)(uintptr_t)((u64)funcHigh << 32 | funcLow);
+    void *arg = (void *)(uintptr_t)((u64)argHigh << 32 | argLow);
+    func(arg);
+}
+
+#endif
+
+#ifdef IPLATFORM_WINDOWS
+
+DEUtil::Fiber::Fiber() : stack{nullptr}, stackSize{0}, handle{nullptr}, converted{false}, func{nullptr}, arg{nullptr}
+{
+}
+
+void __stdcall DEUtil::Fiber::Start(void *fiber)
+{
+    Fiber *self = (Fiber *)fiber;
+    self->func(self->arg);
+}
+
+bool DEUtil::Fiber::Create(FiberFunc func, void *arg, usize stackSize)
+{
+    this->func = func;
+    this->arg = arg;
+    handle = CreateFiber(stackSize, &Fiber::Start, this);
+    if(!handle)
+    {
+        LERROR("couldn't create a fiber with a " << stackSize << " byte stack.\n");
+        return false;
+    }
+
+    this->stackSize = stackSize;
+    return true;
+}
+
+void DEUtil::Fiber::Switch(Fiber &from, Fiber &to)
+{
+    if(!from.handle)
+    {
+        from.handle = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber(nullptr);
+        from.converted = true;
+    }
+
+    SwitchToFiber(to.handle);
+}
+
+DEUtil::Fiber::~Fiber()
+{
+    if(handle && !converted)
+        DeleteFiber(handle);
+}
+
+#else
+
+DEUtil::Fiber::Fiber() : stack{nullptr}, stackSize{0}
+{
+    #if defined(FIBER_ASM)
+    sp = nullptr;
+    #endif
+}
+
+bool DEUtil::Fiber::Create(FiberFunc func, void *arg, usize stackSize)
+{
+    // whole pages, and a page that faults below them instead of running into the next stack
+    usize page = (usize)sysconf(_SC_PAGESIZE);
+    stackSize = (stackSize + page - 1) / page * page;
+    void *mapping = mmap(nullptr, stackSize + page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(mapping == MAP_FAILED)
+    {
+        LERROR("couldn't map a " << stackSize << " byte fiber stack.\n");
+        return false;
+    }
+    mprotect(mapping, page, PROT_NONE);
+
+    stack = mapping;
+    this->stackSize = stackSize;
+    u8 *bottom = (u8 *)mapping + page;
+
+    #if defined(FIBER_ASM)
+    sp = InitialFrame(bottom + stackSize, func, arg);
+    #else
+    getcontext(&context);
+    context.uc_stack.ss_sp = bottom;
+    context.uc_stack.ss_size = stackSize;
+    context.uc_link = nullptr;
+    u64 funcBits = (u64)(uintptr_t)func, argBits = (u64)(uintptr_t)arg;
+    makecontext(&context, (void (*)())&UContextStart, 4, (u32)funcBits, (u32)(funcBits >> 32), (u32)argBits,
+                (u32)(argBits >> 32));
+    #endif
+    return true;
+}
+
+void DEUtil::Fiber::Switch(Fiber &from, Fiber &to)
+{
+    #if defined(FIBER_ASM)
+    DEFiberSwitch(&from.sp, to.sp);
+    #else
+    swapcontext(&from.context, &to.context);
+    #endif
+}
+
+DEUtil::Fiber::~Fiber()
+{
+    if(stack)
+        munmap(stack, stackSize + (usize)sysconf(_SC_PAGESIZE));
+}
+
+#endif
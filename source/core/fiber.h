@@ -0,0 +1,61 @@
+#pragma once
+
+#include "defines.h"
+
+// linux on x86-64 and aarch64 switches with a few lines of assembly (callee saved registers
+// only, no signal mask syscall like swapcontext), other posix systems use ucontext and
+// windows its own fibers.
+#if defined(IPLATFORM_LINUX) && (defined(__x86_64__) || defined(__aarch64__))
+    #define FIBER_ASM 1
+#elif !defined(IPLATFORM_WINDOWS)
+    #define FIBER_UCONTEXT 1
+    #include <ucontext.h>
+#endif
+
+#define FIBER_DEFAULT_STACK_SIZE (256 * 1024)
+
+namespace DEUtil {
+
+typedef void (*FiberFunc)(void *arg);
+
+// a stack and the registers to resume it with. a default constructed fiber is a place to save
+// the thread's own context the first time it switches away. func must never return, it
+// switches to another fiber once it's done.
+class Fiber
+{
+    private:
+    void *stack; // mapped with a guard page below it
+    usize stackSize;
+
+#if defined(FIBER_ASM)
+    void *sp;
+#elif defined(FIBER_UCONTEXT)
+    ucontext_t context;
+#else
+    void *handle;
+    bool converted; // ConvertThreadToFiber() made handle
+    FiberFunc func;
+    void *arg;
+
+    static void __stdcall Start(void *fiber);
+#endif
+
+    public:
+    Fiber();
+    Fiber(const Fiber &fiber) = delete;
+    Fiber &operator=(const Fiber &fiber) = delete;
+
+    // returns false (and logs) if the stack can't be mapped
+    bool Create(FiberFunc func, void *arg, usize stackSize);
+
+    // saves the running context into from and continues to, returns once something switches
+    // back to from. to can be resumed on any thread, but code that keeps a thread_local's
+    // address across a switch keeps the old thread's.
+    static void Switch(Fiber &from, Fiber &to);
+
+    inline usize GetStackSize() const { return stackSize; }
+
+    ~Fiber();
+};
+
+} // namespace DEUtil
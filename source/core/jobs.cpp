@@ -0,0 +1,660 @@
+#include "jobs.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+// spins before an idle worker yields, then sleeps
+#define JOB_SPIN_COUNT  256
+#define JOB_YIELD_COUNT 16
+
+// Job::state
+#define JOB_FREE   0 // a pool slot that can be handed out
+#define JOB_POOLED 1 // a pool slot in use until the job has run
+#define JOB_HEAP   2 // the pool slot was busy, deleted once it has run
+
+// JobWorker::afterSwitch, done by the fiber switched to once the old one is off its stack
+#define JOB_SWITCH_NONE 0
+#define JOB_SWITCH_FREE 1 // back to the free fibers
+#define JOB_SWITCH_PARK 2 // parked on parkCounter, ready right away if it's already done
+
+// a fiber can move to another thread inside any call that might park, so the thread_local
+// is read through a call the compiler can't see through or cache across a switch
+#if defined(__clang__)
+    #define JOB_NO_INLINE __attribute__((noinline))
+#elif defined(__GNUC__)
+    #define JOB_NO_INLINE __attribute__((noipa))
+#elif defined(_MSC_VER)
+    #define JOB_NO_INLINE __declspec(noinline)
+#else
+    #define JOB_NO_INLINE
+#endif
+
+namespace {
+
+struct CurrentWorkerSlot
+{
+    const DEUtil::JobSystem *system;
+    DEUtil::JobWorker *worker;
+};
+
+thread_local CurrentWorkerSlot currentWorker = {nullptr, nullptr};
+
+inline void Pause()
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+inline void LockCounter(DEUtil::JobCounter *counter)
+{
+    while(counter->lock.exchange(1, std::memory_order_acquire) != 0)
+        Pause();
+}
+
+inline void UnlockCounter(DEUtil::JobCounter *counter)
+{
+    counter->lock.store(0, std::memory_order_release);
+}
+
+} // namespace
+
+#pragma region Deque
+
+DEUtil::JobDeque::JobDeque() : top{0}, bottom{0}, jobs{new std::atomic<Job *>[JOB_DEQUE_SIZE]()}
+{
+    static_assert((JOB_DEQUE_SIZE & (JOB_DEQUE_SIZE - 1)) == 0, "JOB_DEQUE_SIZE has to be a power of 2.");
+}
+
+bool DEUtil::JobDeque::Push(Job *job)
+{
+    i64 b = bottom.load(std::memory_order_relaxed);
+    i64 t = top.load(std::memory_order_acquire);
+    if(b - t >= JOB_DEQUE_SIZE)
+        return false;
+
+    // release so a thief that sees the new bottom sees the job's contents too
+    jobs[b & (JOB_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+DEUtil::Job *DEUtil::JobDeque::Pop()
+{
+    // claim the bottom slot first, a thief that read the old bottom races us for the last job
+    i64 b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 t = top.load(std::memory_order_relaxed);
+
+    if(t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job = jobs[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if(t == b)
+    {
+        // the last one, whoever moves top gets it
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+DEUtil::Job *DEUtil::JobDeque::Steal()
+{
+    i64 t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    i64 b = bottom.load(std::memory_order_acquire);
+    if(t >= b)
+        return nullptr;
+
+    // the slot can't be reused while top is still t, so the job read here is the one claimed
+    Job *job = jobs[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+    if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+DEUtil::JobDeque::~JobDeque()
+{
+    delete[] jobs;
+}
+
+#pragma endregion
+
+#pragma region System
+
+DEUtil::JobSystem::JobSystem(u32 threadCount, u32 fiberCount, usize fiberStackSize)
+    : injectedCount{0}, sleeping{0}, epoch{0}, quit{false}, readyCount{0}, parks{0}
+{
+    static_assert((JOB_POOL_SIZE & (JOB_POOL_SIZE - 1)) == 0, "JOB_POOL_SIZE has to be a power of 2.");
+
+    if(threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    for(u32 i = 0; i < threadCount; i++)
+    {
+        JobWorker *worker = new JobWorker;
+        worker->pool = new Job[JOB_POOL_SIZE]();
+        worker->poolCursor = 0;
+        worker->random = 0x9e3779b9u * (i + 1);
+        worker->index = i;
+        worker->fiber = nullptr;
+        worker->previous = nullptr;
+        worker->afterSwitch = JOB_SWITCH_NONE;
+        worker->parkCounter = nullptr;
+        workers.push_back(worker);
+    }
+
+    // every other worker starts on a fiber of its own, so there's at least one each
+    if(fiberCount > 0)
+    {
+        fiberCount = std::max(fiberCount, threadCount);
+        for(u32 i = 0; i < fiberCount; i++)
+        {
+            JobFiber *fiber = new JobFiber;
+            fiber->system = this;
+            if(!fiber->fiber.Create(&JobSystem::FiberMain, fiber, fiberStackSize))
+            {
+                delete fiber;
+                break;
+            }
+            fibers.push_back(fiber);
+        }
+
+        // not enough stacks for every worker, plain jobs then
+        if(fibers.size() < threadCount)
+        {
+            for(JobFiber *fiber : fibers)
+                delete fiber;
+            fibers.clear();
+        }
+        freeFibers = fibers;
+    }
+
+    currentWorker = {this, workers[0]};
+    for(u32 i = 1; i < threadCount; i++)
+        threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JOB_NO_INLINE DEUtil::JobWorker *DEUtil::JobSystem::CurrentWorker() const
+{
+    return currentWorker.system == this ? currentWorker.worker : nullptr;
+}
+
+DEUtil::Job *DEUtil::JobSystem::AllocateJob(JobWorker *worker)
+{
+    // slots free up as their jobs run, a slot still busy after a lap around the pool means
+    // thousands of jobs are in flight and this one goes to the heap
+    if(worker)
+    {
+        Job *job = &worker->pool[worker->poolCursor++ & (JOB_POOL_SIZE - 1)];
+        if(job->state.load(std::memory_order_acquire) == JOB_FREE)
+        {
+            job->state.store(JOB_POOLED, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    Job *job = new Job;
+    job->state.store(JOB_HEAP, std::memory_order_relaxed);
+    return job;
+}
+
+void DEUtil::JobSystem::Run(JobFunc func, const void *data, usize size, JobCounter *counter)
+{
+    // too big to copy into a job, so it can't be queued
+    if(size > JOB_DATA_SIZE)
+    {
+        func((void *)data);
+        return;
+    }
+
+    JobWorker *worker = CurrentWorker();
+    Job *job = AllocateJob(worker);
+    job->func = func;
+    job->counter = counter;
+    job->next = nullptr;
+    memcpy(job->data, data, size);
+
+    if(counter)
+        counter->pending.fetch_add(1, std::memory_order_acq_rel);
+
+    Submit(worker, job);
+}
+
+void DEUtil::JobSystem::RunAfter(JobCounter *dependency, JobFunc func, const void *data, usize size,
+                                 JobCounter *counter)
+{
+    if(size > JOB_DATA_SIZE)
+    {
+        Wait(dependency);
+        func((void *)data);
+        return;
+    }
+
+    JobWorker *worker = CurrentWorker();
+    Job *job = AllocateJob(worker);
+    job->func = func;
+    job->counter = counter;
+    memcpy(job->data, data, size);
+
+    if(counter)
+        counter->pending.fetch_add(1, std::memory_order_acq_rel);
+
+    // Finish() takes the continuations under the same lock it drops pending to 0 in, so the
+    // job is either in the list it takes or sees 0 here
+    LockCounter(dependency);
+    if(dependency->pending.load(std::memory_order_acquire) != 0)
+    {
+        job->next = dependency->continuations;
+        dependency->continuations = job;
+        UnlockCounter(dependency);
+        return;
+    }
+    UnlockCounter(dependency);
+
+    job->next = nullptr;
+    Submit(worker, job);
+}
+
+void DEUtil::JobSystem::Submit(JobWorker *worker, Job *job)
+{
+    if(worker)
+    {
+        // a full deque means there's plenty to steal already
+        if(!worker->deque.Push(job))
+        {
+            Execute(job);
+            return;
+        }
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        injected.push_back(job);
+        injectedCount.fetch_add(1, std::memory_order_release);
+    }
+
+    WakeSleepers();
+}
+
+void DEUtil::JobSystem::WakeSleepers()
+{
+    // pairs with the fence in WorkerLoop(): either the sleeper sees the job or we see it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleeping.load(std::memory_order_relaxed) == 0)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        epoch++;
+    }
+    wake.notify_one();
+}
+
+DEUtil::Job *DEUtil::JobSystem::FindJob(JobWorker *worker)
+{
+    if(worker)
+    {
+        if(Job *job = worker->deque.Pop())
+            return job;
+    }
+
+    if(injectedCount.load(std::memory_order_acquire) > 0)
+    {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        if(!injected.empty())
+        {
+            Job *job = injected.back();
+            injected.pop_back();
+            injectedCount.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    // start at a random victim so thieves spread out
+    u32 count = (u32)workers.size();
+    u32 start = 0;
+    if(worker)
+    {
+        worker->random ^= worker->random << 13;
+        worker->random ^= worker->random >> 17;
+        worker->random ^= worker->random << 5;
+        start = worker->random % count;
+    }
+
+    for(u32 i = 0; i < count; i++)
+    {
+        JobWorker *victim = workers[(start + i) % count];
+        if(victim == worker)
+            continue;
+
+        if(Job *job = victim->deque.Steal())
+            return job;
+    }
+
+    return nullptr;
+}
+
+void DEUtil::JobSystem::Execute(Job *job)
+{
+    job->func(job->data);
+
+    JobCounter *counter = job->counter;
+    ReleaseJob(job);
+    Finish(counter);
+}
+
+void DEUtil::JobSystem::ReleaseJob(Job *job)
+{
+    if(job->state.load(std::memory_order_relaxed) == JOB_HEAP)
+        delete job;
+    else
+        job->state.store(JOB_FREE, std::memory_order_release);
+}
+
+void DEUtil::JobSystem::Finish(JobCounter *counter)
+{
+    if(!counter)
+        return;
+
+    u32 pending = counter->pending.load(std::memory_order_relaxed);
+    while(true)
+    {
+        if(pending > 1)
+        {
+            if(counter->pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel,
+                                                      std::memory_order_relaxed))
+                return;
+            continue;
+        }
+
+        // the last job of the batch queues its continuations. a waiter only returns once the
+        // lock is free too, after this the counter isn't touched
+        LockCounter(counter);
+        if(counter->pending.compare_exchange_strong(pending, 0, std::memory_order_acq_rel,
+                                                    std::memory_order_relaxed))
+        {
+            Job *continuations = counter->continuations;
+            counter->continuations = nullptr;
+            UnlockCounter(counter);
+
+            // jobs without a func are parked fibers
+            JobWorker *worker = CurrentWorker();
+            while(continuations)
+            {
+                Job *next = continuations->next;
+                continuations->next = nullptr;
+                if(continuations->func)
+                    Submit(worker, continuations);
+                else
+                {
+                    JobFiber *fiber;
+                    memcpy(&fiber, continuations->data, sizeof(fiber));
+                    ReleaseJob(continuations);
+                    MakeReady(fiber);
+                }
+                continuations = next;
+            }
+            return;
+        }
+        UnlockCounter(counter);
+    }
+}
+
+void DEUtil::JobSystem::Expect(JobCounter *counter, u32 count)
+{
+    counter->pending.fetch_add(count, std::memory_order_acq_rel);
+}
+
+void DEUtil::JobSystem::Signal(JobCounter *counter)
+{
+    Finish(counter);
+}
+
+void DEUtil::JobSystem::Wait(JobCounter *counter)
+{
+    if(counter->IsDone())
+        return;
+
+    // park and let this thread run something else, it comes back here once counter is done
+    JobWorker *worker = CurrentWorker();
+    if(worker && worker->fiber)
+    {
+        if(JobFiber *next = TakeFiber(freeFibers))
+        {
+            parks.fetch_add(1, std::memory_order_relaxed);
+            worker->parkCounter = counter;
+            SwitchFiber(worker, next, JOB_SWITCH_PARK);
+            return;
+        }
+    }
+
+    // a job run here can park, so this can come back on another thread
+    u32 idle = 0;
+    while(!counter->IsDone())
+    {
+        worker = CurrentWorker();
+        if(Job *job = FindJob(worker))
+        {
+            Execute(job);
+            idle = 0;
+        }
+        else if(++idle < JOB_SPIN_COUNT)
+            Pause();
+        else
+            std::this_thread::yield();
+    }
+}
+
+#pragma endregion
+
+#pragma region Fibers
+
+DEUtil::JobFiber *DEUtil::JobSystem::TakeFiber(std::vector<JobFiber *> &list)
+{
+    std::lock_guard<std::mutex> lock(fiberMutex);
+    if(list.empty())
+        return nullptr;
+
+    JobFiber *fiber = list.back();
+    list.pop_back();
+    if(&list == &readyFibers)
+        readyCount.fetch_sub(1, std::memory_order_relaxed);
+    return fiber;
+}
+
+void DEUtil::JobSystem::MakeReady(JobFiber *fiber)
+{
+    {
+        std::lock_guard<std::mutex> lock(fiberMutex);
+        readyFibers.push_back(fiber);
+        readyCount.fetch_add(1, std::memory_order_release);
+    }
+
+    WakeSleepers();
+}
+
+void DEUtil::JobSystem::SwitchFiber(JobWorker *worker, JobFiber *to, u32 afterSwitch)
+{
+    JobFiber *from = worker->fiber;
+    worker->previous = from;
+    worker->afterSwitch = afterSwitch;
+    worker->fiber = to;
+    Fiber::Switch(from->fiber, to->fiber);
+
+    // back on from, maybe on another thread
+    AfterSwitch();
+}
+
+void DEUtil::JobSystem::AfterSwitch()
+{
+    // the fiber that switched here is off its stack now, so it's safe to hand out
+    JobWorker *worker = CurrentWorker();
+    JobFiber *previous = worker->previous;
+    u32 afterSwitch = worker->afterSwitch;
+    worker->afterSwitch = JOB_SWITCH_NONE;
+
+    if(afterSwitch == JOB_SWITCH_FREE)
+    {
+        std::lock_guard<std::mutex> lock(fiberMutex);
+        freeFibers.push_back(previous);
+    }
+    else if(afterSwitch == JOB_SWITCH_PARK)
+    {
+        // a job without a func on the counter's continuations, under the lock Finish() takes
+        JobCounter *counter = worker->parkCounter;
+        Job *resume = AllocateJob(worker);
+        resume->func = nullptr;
+        resume->counter = nullptr;
+        memcpy(resume->data, &previous, sizeof(previous));
+
+        LockCounter(counter);
+        if(counter->pending.load(std::memory_order_acquire) != 0)
+        {
+            resume->next = counter->continuations;
+            counter->continuations = resume;
+            UnlockCounter(counter);
+            return;
+        }
+        UnlockCounter(counter);
+
+        ReleaseJob(resume);
+        MakeReady(previous);
+    }
+}
+
+void DEUtil::JobSystem::FiberMain(void *fiber)
+{
+    JobSystem *system = ((JobFiber *)fiber)->system;
+    system->AfterSwitch();
+    system->RunJobs();
+
+    // quitting, back to the thread's own stack for good
+    JobWorker *worker = system->CurrentWorker();
+    Fiber::Switch(((JobFiber *)fiber)->fiber, worker->threadFiber);
+}
+
+#pragma endregion
+
+#pragma region Workers
+
+void DEUtil::JobSystem::WorkerLoop(u32 index)
+{
+    JobWorker *worker = workers[index];
+    currentWorker = {this, worker};
+
+    if(fibers.empty())
+    {
+        RunJobs();
+        return;
+    }
+
+    JobFiber *fiber = TakeFiber(freeFibers);
+    worker->fiber = fiber;
+    Fiber::Switch(worker->threadFiber, fiber->fiber);
+}
+
+void DEUtil::JobSystem::RunJobs()
+{
+    u32 idle = 0;
+    while(!quit.load(std::memory_order_relaxed))
+    {
+        // parked fibers whose counter is done come first, they're older work
+        JobWorker *worker = CurrentWorker();
+        if(worker->fiber && readyCount.load(std::memory_order_acquire) > 0)
+        {
+            if(JobFiber *ready = TakeFiber(readyFibers))
+            {
+                SwitchFiber(worker, ready, JOB_SWITCH_FREE);
+                idle = 0;
+                continue;
+            }
+        }
+
+        if(Job *job = FindJob(worker))
+        {
+            Execute(job);
+            idle = 0;
+            continue;
+        }
+
+        idle++;
+        if(idle < JOB_SPIN_COUNT)
+        {
+            Pause();
+            continue;
+        }
+        if(idle < JOB_SPIN_COUNT + JOB_YIELD_COUNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // nothing to do for a while, sleep until the next push
+        u64 seen;
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            seen = epoch;
+        }
+
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        bool work = injectedCount.load(std::memory_order_relaxed) > 0 ||
+                    readyCount.load(std::memory_order_relaxed) > 0;
+        for(u32 i = 0; i < workers.size() && !work; i++)
+            work = !workers[i]->deque.IsEmpty();
+
+        if(!work)
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [&] { return epoch != seen || quit.load(std::memory_order_relaxed); });
+        }
+
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+DEUtil::JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        quit.store(true, std::memory_order_relaxed);
+        epoch++;
+    }
+    wake.notify_all();
+
+    for(std::thread &thread : threads)
+        thread.join();
+
+    if(currentWorker.system == this)
+        currentWorker = {nullptr, nullptr};
+
+    for(JobWorker *worker : workers)
+    {
+        delete[] worker->pool;
+        delete worker;
+    }
+
+    for(JobFiber *fiber : fibers)
+        delete fiber;
+}
+
+#pragma endregion
@@ -0,0 +1,264 @@
+#pragma once
+
+#include "defines.h"
+#include "fiber.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#define JOB_DEQUE_SIZE 4096 // per worker, a push past it runs the job right away
+#define JOB_POOL_SIZE  4096 // per worker, jobs past it come from the heap
+#define JOB_DATA_SIZE  32   // bytes a job's lambda can capture
+
+#define JOB_FIBER_STACK_SIZE FIBER_DEFAULT_STACK_SIZE
+
+namespace DEUtil {
+
+typedef void (*JobFunc)(void *data);
+
+struct Job;
+
+// jobs left in a batch. Run() counts a job in before it's queued and it's counted out once
+// it has run, so Wait() on it returns when the whole batch is done. a counter can be reused
+// for the next batch once it's back at 0.
+struct JobCounter
+{
+    std::atomic<u32> pending{0};
+    std::atomic<u32> lock{0};
+    Job *continuations{nullptr}; // RunAfter() jobs, queued when pending reaches 0
+
+    // the lock is checked too, the last job still holds it for a moment after pending hits 0
+    inline bool IsDone() const
+    {
+        return pending.load(std::memory_order_acquire) == 0 && lock.load(std::memory_order_acquire) == 0;
+    }
+};
+
+struct alignas(64) Job
+{
+    JobFunc func;
+    JobCounter *counter;
+    Job *next; // in a counter's continuations
+    std::atomic<u32> state;
+    u8 data[JOB_DATA_SIZE];
+};
+
+// chase-lev work stealing deque (le et al. 2013): the owner pushes and pops at the bottom,
+// every other worker steals from the top. fixed size, Push() fails when it's full.
+class JobDeque
+{
+    private:
+    alignas(64) std::atomic<i64> top;
+    alignas(64) std::atomic<i64> bottom;
+    std::atomic<Job *> *jobs;
+
+    public:
+    JobDeque();
+    JobDeque(const JobDeque &deque) = delete;
+    JobDeque &operator=(const JobDeque &deque) = delete;
+
+    // owner only
+    bool Push(Job *job);
+    Job *Pop();
+
+    // any thread, nullptr if it's empty or another thief won
+    Job *Steal();
+
+    inline bool IsEmpty() const
+    {
+        return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+    }
+
+    ~JobDeque();
+};
+
+class JobSystem;
+
+// a pool fiber, it runs the worker loop and jobs on top of it
+struct JobFiber
+{
+    Fiber fiber;
+    JobSystem *system;
+};
+
+struct JobWorker
+{
+    JobDeque deque;
+    Job *pool;
+    u32 poolCursor;
+    u32 random; // xorshift state for picking who to steal from
+    u32 index;
+
+    // fiber mode, what the thread is running and what to do with the fiber it left
+    Fiber threadFiber;
+    JobFiber *fiber;
+    JobFiber *previous;
+    u32 afterSwitch;
+    JobCounter *parkCounter;
+};
+
+// a worker per thread with its own deque, idle workers steal from the others. the thread
+// that creates the system is worker 0 and only runs jobs inside Wait(), the rest run them
+// until the system is destroyed. Run() from a thread outside the system goes through a
+// shared queue.
+//
+// in fiber mode the other workers run on pool fibers, and Wait() from a job on one parks
+// the fiber on the counter and picks up the next job on a fresh fiber instead of helping.
+// the counter's last job hands the parked fiber back to whichever worker is free next, so
+// a job can wait on io or a long dependency without holding its thread. it only keeps
+// helping if every fiber is busy. worker 0 isn't on a fiber and always helps.
+class JobSystem
+{
+    private:
+    std::vector<JobWorker *> workers;
+    std::vector<std::thread> threads;
+
+    // jobs from threads outside the system
+    std::mutex injectMutex;
+    std::vector<Job *> injected;
+    std::atomic<u32> injectedCount;
+
+    // idle workers sleep on wake, every Push() bumps epoch if anyone is asleep
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::atomic<u32> sleeping;
+    u64 epoch;
+    std::atomic<bool> quit;
+
+    // fiber mode
+    std::vector<JobFiber *> fibers;
+    std::mutex fiberMutex;
+    std::vector<JobFiber *> freeFibers;
+    std::vector<JobFiber *> readyFibers; // parked ones whose counter is done
+    std::atomic<u32> readyCount;
+    std::atomic<u64> parks;
+
+    private:
+    void WorkerLoop(u32 index);
+    void RunJobs();
+    static void FiberMain(void *fiber);
+    JobWorker *CurrentWorker() const;
+    Job *AllocateJob(JobWorker *worker);
+    void Submit(JobWorker *worker, Job *job);
+    Job *FindJob(JobWorker *worker);
+    void Execute(Job *job);
+    void ReleaseJob(Job *job);
+    void Finish(JobCounter *counter);
+    void WakeSleepers();
+    JobFiber *TakeFiber(std::vector<JobFiber *> &list);
+    void MakeReady(JobFiber *fiber);
+    void SwitchFiber(JobWorker *worker, JobFiber *to, u32 afterSwitch);
+    void AfterSwitch();
+
+    template<typename F>
+    static void CallJob(void *data)
+    {
+        (*(F *)data)();
+    }
+
+    // what every range of a ParallelFor() shares, on the caller's stack
+    template<typename F>
+    struct ParallelForShared
+    {
+        JobSystem *system;
+        const F *body;
+        u32 grain;
+        JobCounter counter;
+    };
+
+    template<typename F>
+    struct ParallelForRange
+    {
+        ParallelForShared<F> *shared;
+        u32 begin, end;
+
+        void operator()() const;
+    };
+
+    public:
+    // threadCount 0 uses every hardware thread, the calling thread counts as one. fiberCount 0
+    // runs plain jobs, otherwise that many fibers (at least one per thread) are made up front.
+    JobSystem(u32 threadCount, u32 fiberCount = 0, usize fiberStackSize = JOB_FIBER_STACK_SIZE);
+    JobSystem(const JobSystem &system) = delete;
+    JobSystem &operator=(const JobSystem &system) = delete;
+
+    // func gets a copy of size bytes of data (at most JOB_DATA_SIZE), counter can be nullptr
+    void Run(JobFunc func, const void *data, usize size, JobCounter *counter);
+
+    // runs once dependency is done (right away if it already is), counted into counter now
+    void RunAfter(JobCounter *dependency, JobFunc func, const void *data, usize size, JobCounter *counter);
+
+    // runs other jobs until counter is done (parks the fiber in fiber mode), any thread can wait
+    void Wait(JobCounter *counter);
+
+    // count work that isn't a job (an io request, another thread's result) into a counter,
+    // and out of it once it's done. Signal() can come from any thread.
+    void Expect(JobCounter *counter, u32 count);
+    void Signal(JobCounter *counter);
+
+    // f is copied into the job, so it has to be small and trivially copyable
+    // (capture by reference or pointer)
+    template<typename F>
+    void Run(JobCounter *counter, const F &f)
+    {
+        static_assert(sizeof(F) <= JOB_DATA_SIZE, "job lambda captures too much, capture a pointer instead.");
+        static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+                      "job lambdas have to be trivially copyable.");
+        Run(&CallJob<F>, &f, sizeof(F), counter);
+    }
+
+    template<typename F>
+    void RunAfter(JobCounter *dependency, JobCounter *counter, const F &f)
+    {
+        static_assert(sizeof(F) <= JOB_DATA_SIZE, "job lambda captures too much, capture a pointer instead.");
+        static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+                      "job lambdas have to be trivially copyable.");
+        RunAfter(dependency, &CallJob<F>, &f, sizeof(F), counter);
+    }
+
+    // body(begin, end) over [0, count) in ranges of at most grain items, split in halves so
+    // thieves take big ranges. returns once every range has run.
+    template<typename F>
+    void ParallelFor(u32 count, u32 grain, const F &body);
+
+    inline u32 GetThreadCount() const { return (u32)workers.size(); }
+    inline bool IsFiberMode() const { return !fibers.empty(); }
+    inline u32 GetFiberCount() const { return (u32)fibers.size(); }
+
+    // Wait() calls that parked their fiber so far
+    inline u64 GetParkCount() const { return parks.load(std::memory_order_relaxed); }
+
+    ~JobSystem();
+};
+
+template<typename F>
+void JobSystem::ParallelForRange<F>::operator()() const
+{
+    // hand the top half to a thief and keep the bottom half until it's small enough
+    u32 first = begin, last = end;
+    while(last - first > shared->grain)
+    {
+        u32 middle = first + (last - first) / 2;
+        shared->system->Run(&shared->counter, ParallelForRange{shared, middle, last});
+        last = middle;
+    }
+
+    (*shared->body)(first, last);
+}
+
+template<typename F>
+void JobSystem::ParallelFor(u32 count, u32 grain, const F &body)
+{
+    if(count == 0)
+        return;
+
+    ParallelForShared<F> shared{this, &body, grain > 0 ? grain : 1, {}};
+    ParallelForRange<F>{&shared, 0, count}();
+    Wait(&shared.counter);
+}
+
+} // namespace DEUtil
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "defines.h"
+
+#include <ctime>
+
+namespace DEUtil {
+
+// seconds since the epoch as local calendar time. std::localtime() hands every thread
+// the same buffer, and windows and posix each name the reentrant one differently.
+inline void LocalTime(time_t seconds, std::tm &out)
+{
+#ifdef IPLATFORM_WINDOWS
+    localtime_s(&out, &seconds);
+#else
+    localtime_r(&seconds, &out);
+#endif
+}
+
+} // namespace DEUtil
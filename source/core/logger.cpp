@@ -1,4 +1,730 @@
 #include "logger.h"
+#include "defines.h"
+#include "localTime.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#ifndef IPLATFORM_WINDOWS
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+
+    // faulting a new file's pages in up front keeps page faults off the logging threads
+    #ifdef MAP_POPULATE
+        #define BINLOG_MAP_FLAGS (MAP_SHARED | MAP_POPULATE)
+    #else
+        #define BINLOG_MAP_FLAGS MAP_SHARED
+    #endif
+#endif
 
 LogLevel Logger::logLevel = LogLevel::INFO;
-OutputType Logger::outType = OutputType::CONSOLE;
\ No newline at end of file
+OutputType Logger::outType = OutputType::CONSOLE;
+
+std::atomic<bool> Logger::asyncRunning{false};
+std::atomic<bool> Logger::binaryRunning{false};
+std::atomic<uint32_t> Logger::binarySession{0};
+
+// --------------------- ASYNC MODE --------------------
+
+// a slot of the ring, 256 bytes
+struct LogRecord
+{
+    std::atomic<uint64_t> sequence;
+    int64_t time;
+    const char *file;
+    int32_t line;
+    LogLevel level;
+    uint16_t size;
+    char text[LOG_ASYNC_TEXT_SIZE];
+};
+
+// bounded mpsc ring (vyukov's): a slot's sequence says whose turn it is, producers claim
+// a position with a cas on enqueuePos and publish the slot by bumping its sequence,
+// the writer thread is the only consumer. enqueuePos and dequeuePos are a cache line apart,
+// producers only read dequeuePos to see how full the ring is.
+struct LogRing
+{
+    alignas(64) std::atomic<uint64_t> enqueuePos;
+    alignas(64) std::atomic<uint64_t> dequeuePos;
+    LogRecord slots[LOG_ASYNC_SLOTS];
+};
+
+static LogRing *ring = nullptr;
+static std::atomic<uint32_t> asyncProducers{0}; // PushAsync() calls that may touch the ring
+static std::atomic<uint64_t> asyncDropped{0};
+static std::thread writer;
+static std::atomic<bool> writerStop{false};
+static std::atomic<bool> writerSleeping{false}; // waiting on writerWake, under writerMutex
+static std::mutex writerMutex;
+static std::condition_variable writerWake;
+static LogAsyncFull asyncFull = LogAsyncFull::WAIT;
+static FILE *fileSink = nullptr;
+static bool consoleSink = true;
+static bool atExitRegistered = false;
+
+static const char *LevelName(LogLevel ll)
+{
+    switch(ll)
+    {
+    case LogLevel::FATAL:
+        return "FATAL";
+    case LogLevel::ERROR:
+        return "ERROR";
+    case LogLevel::WARN:
+        return "WARN";
+    case LogLevel::DEBUG:
+        return "DEBUG";
+    case LogLevel::TRACE:
+        return "TRACE";
+    case LogLevel::INFO:
+        return "INFO";
+    default:
+        return "";
+    }
+}
+
+static const char *LevelColor(LogLevel ll)
+{
+    switch(ll)
+    {
+    case LogLevel::FATAL:
+    case LogLevel::ERROR:
+        return TEXT_RED;
+    case LogLevel::WARN:
+        return TEXT_YELLOW;
+    case LogLevel::DEBUG:
+        return TEXT_BLUE;
+    case LogLevel::TRACE:
+        return TEXT_CYAN;
+    case LogLevel::INFO:
+        return TEXT_PURPLE;
+    default:
+        return "";
+    }
+}
+
+// formats a record the way the synchronous path does, colored for the console
+static void AppendRecord(std::string &out, const LogRecord &record, const char *clock, bool colored)
+{
+    out += '[';
+    if(colored)
+        out += LevelColor(record.level);
+    out += LevelName(record.level);
+    out += ' ';
+    out += clock;
+    if(record.file)
+    {
+        out += ' ';
+        out += record.file;
+        out += ':';
+        out += std::to_string(record.line);
+    }
+    if(colored)
+        out += TEXT_WHITE;
+    out += "]\t";
+    out.append(record.text, record.size);
+}
+
+// takes everything queued, returns how many messages there were
+static size_t DrainRing(std::string &console, std::string &file)
+{
+    // %X only changes once a second
+    static int64_t clockTime = -1;
+    static char clock[32];
+
+    size_t count = 0;
+    for(;;)
+    {
+        uint64_t pos = ring->dequeuePos.load(std::memory_order_relaxed);
+        LogRecord &record = ring->slots[pos & (LOG_ASYNC_SLOTS - 1)];
+        if(record.sequence.load(std::memory_order_acquire) != pos + 1)
+            break;
+
+        if(record.time != clockTime)
+        {
+            time_t seconds = (time_t)record.time;
+            std::tm local;
+            DEUtil::LocalTime(seconds, local);
+            strftime(clock, sizeof(clock), "%X", &local);
+            clockTime = record.time;
+        }
+
+        if(consoleSink)
+            AppendRecord(console, record, clock, true);
+        if(fileSink)
+            AppendRecord(file, record, clock, false);
+
+        record.sequence.store(pos + LOG_ASYNC_SLOTS, std::memory_order_release);
+        ring->dequeuePos.store(pos + 1, std::memory_order_relaxed);
+        count++;
+    }
+
+    if(!console.empty())
+    {
+        fwrite(console.data(), 1, console.size(), stdout);
+        fflush(stdout);
+        console.clear();
+    }
+
+    if(!file.empty())
+    {
+        fwrite(file.data(), 1, file.size(), fileSink);
+        file.clear();
+    }
+
+    return count;
+}
+
+// only the first of the producers that see the writer sleeping takes the lock
+static void WakeWriter()
+{
+    if(writerSleeping.load() && writerSleeping.exchange(false))
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        writerWake.notify_one();
+    }
+}
+
+static void WriterLoop()
+{
+    std::string console, file;
+    for(;;)
+    {
+        // stop is checked before draining, so whatever was queued before it is written
+        bool stop = writerStop.load(std::memory_order_acquire);
+        if(DrainRing(console, file) != 0)
+            continue;
+        if(stop)
+            break;
+
+        // until the ring passes LOG_ASYNC_WAKE_SLOTS or the wait is up. sleeping is set
+        // before the fill is read, so a producer past the mark either sees it or is seen
+        std::unique_lock<std::mutex> lock(writerMutex);
+        writerSleeping.store(true);
+        uint64_t queued = ring->enqueuePos.load() - ring->dequeuePos.load(std::memory_order_relaxed);
+        if(queued < LOG_ASYNC_WAKE_SLOTS && !writerStop.load())
+        {
+            writerWake.wait_for(lock, std::chrono::milliseconds(LOG_ASYNC_IDLE_MS),
+                                [] { return !writerSleeping.load(); });
+        }
+        writerSleeping.store(false);
+    }
+
+    if(fileSink)
+        fflush(fileSink);
+}
+
+bool Logger::StartAsync(const char *filepath, bool console, LogAsyncFull full)
+{
+    if(IsAsync())
+        return false;
+
+    if(filepath)
+    {
+        fileSink = fopen(filepath, "w");
+        if(!fileSink)
+        {
+            LERROR("couldn't open " << filepath << " for the async log.\n");
+            return false;
+        }
+    }
+    consoleSink = console;
+    asyncFull = full;
+
+    ring = new LogRing;
+    ring->enqueuePos.store(0, std::memory_order_relaxed);
+    ring->dequeuePos.store(0, std::memory_order_relaxed);
+    asyncDropped.store(0, std::memory_order_relaxed);
+    for(uint64_t i = 0; i < LOG_ASYNC_SLOTS; i++)
+        ring->slots[i].sequence.store(i, std::memory_order_relaxed);
+
+    writerStop.store(false, std::memory_order_relaxed);
+    writer = std::thread(WriterLoop);
+
+    if(!atExitRegistered)
+    {
+        atexit(StopAsync);
+        atExitRegistered = true;
+    }
+
+    asyncRunning.store(true, std::memory_order_release);
+    return true;
+}
+
+void Logger::StopAsync()
+{
+    if(!IsAsync())
+        return;
+
+    // producers that saw async mode running finish with the writer still draining, the
+    // ones after this see it stopped and write synchronously, so the ring can go
+    asyncRunning.store(false);
+    while(asyncProducers.load() != 0)
+        std::this_thread::yield();
+
+    writerStop.store(true);
+    WakeWriter();
+    writer.join();
+
+    uint64_t dropped = asyncDropped.load(std::memory_order_relaxed);
+    if(fileSink)
+    {
+        fclose(fileSink);
+        fileSink = nullptr;
+    }
+
+    delete ring;
+    ring = nullptr;
+
+    if(dropped > 0)
+        LWARN(false, "the async log dropped " << dropped << " messages, its ring was full.\n");
+}
+
+uint64_t Logger::GetAsyncDropped()
+{
+    return asyncDropped.load(std::memory_order_relaxed);
+}
+
+bool Logger::PushAsync(LogLevel ll, const char *fileName, int lineNumber, const char *text, size_t size)
+{
+    // counted before the check, StopAsync() waits for the count after clearing asyncRunning
+    asyncProducers.fetch_add(1);
+    if(!asyncRunning.load())
+    {
+        asyncProducers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+    LogRecord *record;
+    uint64_t pos = ring->enqueuePos.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        record = &ring->slots[pos & (LOG_ASYNC_SLOTS - 1)];
+        int64_t diff = (int64_t)record->sequence.load(std::memory_order_acquire) - (int64_t)pos;
+        if(diff == 0)
+        {
+            // seq_cst, it pairs with the writer setting writerSleeping before it reads enqueuePos
+            if(ring->enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_seq_cst,
+                                                      std::memory_order_relaxed))
+                break;
+        }
+        else if(diff < 0)
+        {
+            // full, errors wait for the writer and so does everything else unless it's dropped
+            if(ll > LogLevel::ERROR && asyncFull == LogAsyncFull::DROP)
+            {
+                asyncDropped.fetch_add(1, std::memory_order_relaxed);
+                asyncProducers.fetch_sub(1, std::memory_order_release);
+                return false;
+            }
+
+            WakeWriter();
+            std::this_thread::yield();
+            pos = ring->enqueuePos.load(std::memory_order_relaxed);
+        }
+        else
+        {
+            pos = ring->enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->time = (int64_t)std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    record->file = fileName;
+    record->line = lineNumber;
+    record->level = ll;
+    record->size = (uint16_t)size;
+    memcpy(record->text, text, size);
+    record->sequence.store(pos + 1, std::memory_order_release);
+
+    if(pos + 1 - ring->dequeuePos.load(std::memory_order_relaxed) >= LOG_ASYNC_WAKE_SLOTS)
+        WakeWriter();
+
+    asyncProducers.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+// --------------------- BINARY MODE --------------------
+
+// a mapped log file. writers reserve bytes with a fetch_add on reserved and count them
+// into committed once they're copied, the one whose reservation crosses the end rotates
+// when everything before it is committed. the others wait for current to change.
+struct BinLogFile
+{
+    uint8_t *data;
+    uint64_t capacity;
+    std::atomic<uint64_t> reserved;
+    std::atomic<uint64_t> committed;
+    bool dead;   // couldn't be made, everything written to it is dropped
+    bool closed; // unmapped, the writers that still hold it reserved past its end
+    int fd;
+};
+
+// a rotated out file is unmapped right away, the writers that still hold it only look at
+// its BinLogFile. that's freed once they're gone: a writer counts itself in binWriters
+// under the epoch's parity before it reads binCurrent, and every rotation moves the epoch
+// on once the previous epoch's writers are done. so a file retired before the epoch
+// moved to the current one can't be held by anyone anymore.
+struct BinRetiredFile
+{
+    BinLogFile *file;
+    uint64_t epoch; // the epoch it was retired in
+};
+
+// nothing that holds binSiteMutex or works on a half closed file may log, the message
+// would come back through WriteBinRecord() and RegisterSite(). they say it on stderr.
+static std::atomic<BinLogFile *> binCurrent{nullptr};
+static std::vector<BinRetiredFile> binRetired;
+static std::atomic<uint64_t> binEpoch{0};
+static std::atomic<uint32_t> binWriters[2]; // WriteBinRecord() calls by the epoch's parity
+static std::mutex binSiteMutex;            // sites list, rotation and binRetired
+static LogSite *binSites = nullptr;
+static std::atomic<uint32_t> binNextSite{0};
+static std::atomic<uint64_t> binDropped{0};
+static std::string binPrefix;
+static uint64_t binFileSize = 0;
+static uint32_t binKeepFiles = 0;
+static uint64_t binSequence = 0;
+static int64_t binEpochNs = 0;
+static std::chrono::steady_clock::time_point binStart;
+static bool binAtExitRegistered = false;
+
+static std::string BinFilePath(uint64_t sequence)
+{
+    return binPrefix + std::to_string(sequence) + ".blog";
+}
+
+// header, file name and literals
+static size_t BuildSiteRecord(const LogSite &site, std::vector<uint8_t> &out)
+{
+    uint16_t fileLength = site.file ? (uint16_t)strnlen(site.file, BINLOG_MAX_FILE_NAME) : 0;
+    BinLogSiteHeader header = {BINLOG_SITE, site.level, fileLength, site.id, site.line, (uint16_t)site.literalCount};
+
+    out.resize(sizeof(header) + fileLength);
+    memcpy(out.data(), &header, sizeof(header));
+    if(fileLength > 0)
+        memcpy(out.data() + sizeof(header), site.file, fileLength);
+    for(uint32_t i = 0; i < site.literalCount; i++)
+    {
+        uint16_t length = site.literalLengths[i];
+        size_t offset = out.size();
+        out.resize(offset + 2 + length);
+        memcpy(out.data() + offset, &length, 2);
+        memcpy(out.data() + offset + 2, site.literals[i], length);
+    }
+
+    return out.size();
+}
+
+// makes file sequence with its header and every registered site, a dead file if it can't
+static BinLogFile *OpenBinFile(uint64_t sequence)
+{
+    BinLogFile *file = new BinLogFile;
+    file->data = nullptr;
+    file->capacity = 0;
+    file->reserved.store(1, std::memory_order_relaxed);
+    file->committed.store(0, std::memory_order_relaxed);
+    file->dead = true;
+    file->closed = false;
+    file->fd = -1;
+
+#ifndef IPLATFORM_WINDOWS
+    std::string path = BinFilePath(sequence);
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, (off_t)binFileSize) != 0)
+    {
+        fprintf(stderr, "couldn't make binary log file %s.\n", path.c_str());
+        if(fd >= 0)
+            close(fd);
+        return file;
+    }
+
+    void *data = mmap(nullptr, binFileSize, PROT_READ | PROT_WRITE, BINLOG_MAP_FLAGS, fd, 0);
+    if(data == MAP_FAILED)
+    {
+        fprintf(stderr, "couldn't map binary log file %s.\n", path.c_str());
+        close(fd);
+        return file;
+    }
+
+    file->data = (uint8_t *)data;
+    file->capacity = binFileSize;
+    file->fd = fd;
+
+    BinLogHeader header = {BINLOG_MAGIC, BINLOG_VERSION, binEpochNs, sequence};
+    memcpy(file->data, &header, sizeof(header));
+    uint64_t offset = sizeof(header);
+
+    // a file is at least half messages, the decoder shows the messages of sites that
+    // didn't fit without their literals
+    std::vector<uint8_t> record;
+    for(LogSite *site = binSites; site; site = site->next)
+    {
+        size_t size = BuildSiteRecord(*site, record);
+        if(offset + size > file->capacity / 2)
+            break;
+
+        memcpy(file->data + offset, record.data(), size);
+        offset += size;
+    }
+
+    file->reserved.store(offset, std::memory_order_relaxed);
+    file->committed.store(offset, std::memory_order_relaxed);
+    file->dead = false;
+
+    // the oldest file past keepFiles goes
+    if(sequence >= binKeepFiles)
+        unlink(BinFilePath(sequence - binKeepFiles).c_str());
+#endif
+
+    return file;
+}
+
+// cuts the file to what's committed and unmaps it, the writers have to be done with it
+static void CloseBinFile(BinLogFile *file)
+{
+#ifndef IPLATFORM_WINDOWS
+    if(file->dead || file->closed)
+        return;
+
+    file->closed = true;
+    uint64_t used = file->committed.load(std::memory_order_acquire);
+    munmap(file->data, file->capacity);
+    file->data = nullptr;
+    if(ftruncate(file->fd, (off_t)used) != 0)
+        fputs("couldn't cut a binary log file to its length.\n", stderr);
+    close(file->fd);
+#endif
+}
+
+// frees what's retired before the current epoch if its writers are gone, then moves it on.
+// the caller is a writer of parity slot itself. under binSiteMutex
+static void ReclaimBinFiles(uint32_t slot)
+{
+    uint64_t epoch = binEpoch.load();
+    uint32_t previous = (uint32_t)((epoch - 1) & 1);
+    if(binWriters[previous].load() != (slot == previous ? 1u : 0u))
+        return;
+
+    usize kept = 0;
+    for(BinRetiredFile &retired : binRetired)
+    {
+        if(retired.epoch < epoch)
+        {
+            CloseBinFile(retired.file);
+            delete retired.file;
+        }
+        else
+            binRetired[kept++] = retired;
+    }
+    binRetired.resize(kept);
+    binEpoch.store(epoch + 1);
+}
+
+static void RotateBinFile(BinLogFile *file, uint64_t end, uint32_t slot)
+{
+    // end is where the crossing reservation began, everything below it has to land first
+    while(file->committed.load(std::memory_order_acquire) != end)
+        std::this_thread::yield();
+
+    if(!file->dead && end < file->capacity)
+        file->data[end] = BINLOG_END;
+
+    // StopBinary() may have taken the file meanwhile, it retires that one and the new one
+    // is retired here
+    std::lock_guard<std::mutex> lock(binSiteMutex);
+    BinLogFile *next = OpenBinFile(++binSequence);
+    uint64_t epoch = binEpoch.load();
+    BinLogFile *expected = file;
+    bool published = binCurrent.compare_exchange_strong(expected, next);
+    CloseBinFile(file);
+    binRetired.push_back({published ? file : next, epoch});
+    if(published)
+        ReclaimBinFiles(slot);
+}
+
+// false once binary mode is stopped, a record the dead file drops still counts as written
+static bool WriteBinRecord(const void *record, size_t size)
+{
+    // counted before binCurrent is read, StopBinary() waits for the count after taking it
+    uint32_t slot = (uint32_t)(binEpoch.load() & 1);
+    binWriters[slot].fetch_add(1);
+    bool running = true;
+    for(;;)
+    {
+        BinLogFile *file = binCurrent.load();
+        if(!file)
+        {
+            running = false;
+            break;
+        }
+
+        if(file->dead)
+        {
+            binDropped.fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+
+        uint64_t pos = file->reserved.fetch_add(size, std::memory_order_relaxed);
+        if(pos + size <= file->capacity)
+        {
+            memcpy(file->data + pos, record, size);
+            file->committed.fetch_add(size, std::memory_order_release);
+            break;
+        }
+
+        if(pos <= file->capacity)
+        {
+            RotateBinFile(file, pos, slot);
+            continue;
+        }
+
+        while(binCurrent.load(std::memory_order_acquire) == file)
+            std::this_thread::yield();
+    }
+
+    binWriters[slot].fetch_sub(1, std::memory_order_release);
+    return running;
+}
+
+bool Logger::StartBinary(const char *prefix, uint64_t fileSize, uint32_t keepFiles)
+{
+#ifdef IPLATFORM_WINDOWS
+    LERROR("binary logging isn't supported on windows.\n");
+    return false;
+#else
+    if(IsBinary())
+        return false;
+
+    if(fileSize < BINLOG_MIN_FILE_SIZE || keepFiles == 0)
+    {
+        LERROR("binary log files need at least " << BINLOG_MIN_FILE_SIZE << " bytes and one file kept.\n");
+        return false;
+    }
+
+    binPrefix = prefix;
+    binFileSize = fileSize;
+    binKeepFiles = keepFiles;
+    binSequence = 0;
+    binDropped.store(0, std::memory_order_relaxed);
+    binSites = nullptr;
+    binNextSite.store(0, std::memory_order_relaxed);
+    binStart = std::chrono::steady_clock::now();
+    binEpochNs = std::chrono::duration_cast<std::chrono::nanoseconds>(system_clock::now().time_since_epoch()).count();
+
+    BinLogFile *file = OpenBinFile(0);
+    if(file->dead)
+    {
+        delete file;
+        return false;
+    }
+    binCurrent.store(file, std::memory_order_release);
+
+    if(!binAtExitRegistered)
+    {
+        atexit(StopBinary);
+        binAtExitRegistered = true;
+    }
+
+    // sites registered in an earlier session have to register again
+    binarySession.fetch_add(1, std::memory_order_relaxed);
+    binaryRunning.store(true, std::memory_order_release);
+    return true;
+#endif
+}
+
+void Logger::StopBinary()
+{
+    if(!IsBinary())
+        return;
+
+    binaryRunning.store(false, std::memory_order_release);
+
+    // writers that got a file finish with it (a rotation among them), the ones after see
+    // none and their messages go out as text. then nothing can reach the files
+    BinLogFile *file = binCurrent.exchange(nullptr);
+    while(binWriters[0].load() != 0 || binWriters[1].load() != 0)
+        std::this_thread::yield();
+
+    {
+        std::lock_guard<std::mutex> lock(binSiteMutex);
+        auto taken = [file](const BinRetiredFile &retired) { return retired.file == file; };
+        if(std::find_if(binRetired.begin(), binRetired.end(), taken) == binRetired.end())
+            binRetired.push_back({file, 0});
+        for(BinRetiredFile &retired : binRetired)
+        {
+            CloseBinFile(retired.file);
+            delete retired.file;
+        }
+        binRetired.clear();
+        binSites = nullptr;
+    }
+
+    uint64_t dropped = binDropped.load(std::memory_order_relaxed);
+    if(dropped > 0)
+        LWARN(false, "the binary log dropped " << dropped << " messages, a file couldn't be made.\n");
+}
+
+uint64_t Logger::GetBinaryDropped()
+{
+    return binDropped.load(std::memory_order_relaxed);
+}
+
+bool Logger::WriteBinary(BinLogBuffer &buffer, LogLevel ll, const char *fileName, int lineNumber,
+                         const LogSite *registeredSite)
+{
+    uint64_t time = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - binStart)
+                        .count();
+
+    // the header goes right in front of the arguments
+    uint8_t *payload = buffer.GetPayload();
+    if(registeredSite)
+    {
+        BinLogMessageHeader header = {BINLOG_MESSAGE, 0, (uint16_t)buffer.size, registeredSite->id, time};
+        memcpy(payload - sizeof(header), &header, sizeof(header));
+        return WriteBinRecord(payload - sizeof(header), sizeof(header) + buffer.size);
+    }
+
+    uint16_t fileLength = fileName ? (uint16_t)strnlen(fileName, BINLOG_MAX_FILE_NAME) : 0;
+    BinLogInlineHeader header = {BINLOG_INLINE, (uint8_t)ll, (uint16_t)buffer.size, (uint32_t)lineNumber, time,
+                                 fileLength};
+    memcpy(payload - sizeof(header), &header, sizeof(header));
+    if(fileLength > 0)
+        memcpy(payload + buffer.size, fileName, fileLength);
+    return WriteBinRecord(payload - sizeof(header), sizeof(header) + buffer.size + fileLength);
+}
+
+void Logger::RegisterSite(LogSite *logSite, uint32_t session)
+{
+    if(logSite->literalCount > BINLOG_MAX_LITERALS)
+    {
+        logSite->state.store((session << 2) | LOG_SITE_INLINE, std::memory_order_release);
+        return;
+    }
+
+    // a site too big for BINLOG_MAX_SITE_SIZE stays inline, so every record fits a new file
+    logSite->id = binNextSite.fetch_add(1, std::memory_order_relaxed);
+    std::vector<uint8_t> record;
+    size_t size = BuildSiteRecord(*logSite, record);
+    if(size > BINLOG_MAX_SITE_SIZE)
+    {
+        logSite->state.store((session << 2) | LOG_SITE_INLINE, std::memory_order_release);
+        return;
+    }
+
+    // listed before its record is written, so a file that begins in between repeats it
+    {
+        std::lock_guard<std::mutex> lock(binSiteMutex);
+        logSite->next = binSites;
+        binSites = logSite;
+    }
+
+    WriteBinRecord(record.data(), size);
+
+    logSite->state.store((session << 2) | LOG_SITE_REGISTERED, std::memory_order_release);
+}
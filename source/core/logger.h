@@ -7,10 +7,19 @@
 #include <string>
 #include <sstream>
 #include <mutex>
+#include <iomanip>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include <chrono>
 using std::chrono::system_clock;
 
+#include "binaryLog.h"
+#include "localTime.h"
+
 #define LOCK_MUTEX(x) std::lock_guard<std::mutex> lock(x)
 #define INITLOG()                                                                                                      \
     Logger *Logger::instance = nullptr;                                                                                \
@@ -56,15 +65,58 @@ using std::chrono::system_clock;
 #define LOG_CONSOLE 0
 #define LOG_FILE    1
 
-#include <string.h>
-#define __FILENAME__ (strstr(__FILE__, "src") ? strstr(__FILE__, "src") + 3 : __FILE__)
+// levels that are compiled in, on Logger::logLevel's scale. DEBUG and TRACE are also
+// compiled out of release (NDEBUG) builds unless LOG_COMPILE_DEBUG is defined to 1.
+#ifndef LOG_COMPILE_LEVEL
+    #define LOG_COMPILE_LEVEL LOG_INFO
+#endif
+
+#ifndef LOG_COMPILE_DEBUG
+    #ifdef NDEBUG
+        #define LOG_COMPILE_DEBUG 0
+    #else
+        #define LOG_COMPILE_DEBUG 1
+    #endif
+#endif
+
+#define LOG_COMPILED(ll) ((ll) <= LOG_COMPILE_LEVEL && (LOG_COMPILE_DEBUG || ((ll) != LOG_DEBUG && (ll) != LOG_TRACE)))
+
+// offset of the path past its last src/, source/ or tools/ directory (past its last
+// slash without one), so __FILENAME__ is a constant instead of strstr calls per message
+constexpr size_t LogFileNameOffset(const char *path)
+{
+    const char *dirs[] = {"/src/", "/source/", "/tools/"};
+    size_t dirOffset = 0, slashOffset = 0;
+    for(size_t i = 0; path[i]; i++)
+    {
+        if(path[i] == '/' || path[i] == '\\')
+            slashOffset = i + 1;
+
+        for(const char *dir : dirs)
+        {
+            size_t len = 0;
+            while(dir[len] && path[i + len] == dir[len])
+                len++;
+
+            if(!dir[len])
+                dirOffset = i + len;
+        }
+    }
+
+    return dirOffset ? dirOffset : slashOffset;
+}
+
+#define __FILENAME__ (__FILE__ + std::integral_constant<size_t, LogFileNameOffset(__FILE__)>::value)
 
 // default file for file output if one isn't specified
 #define LOG_DEFAULT_FILE "logger.txt"
 #define FILE_INFO        __FILENAME__, __LINE__
 
-// macro for logging with file info.
-#define LOG(x, y) Log(x, FILE_INFO) << y
+// macro for logging with file info, it skips the arguments like the L* macros do.
+#define LOG(x, y)                                                                                                      \
+    if(!(LOG_COMPILED(x) && Logger::IsEnabled(x))) {}                                                                  \
+    else                                                                                                               \
+        Log(x, FILE_INFO) << y
 
 enum class LogLevel
 {
@@ -85,6 +137,88 @@ enum class OutputType
     FILEONLY = 3
 };
 
+// --------------------- ASYNC MODE --------------------
+// while Logger::StartAsync() runs, a message is formatted into its thread's buffer and
+// queued whole on a lock-free ring, a background thread writes it to the sinks. the
+// logging thread only pays for the formatting, and messages can't interleave.
+#define LOG_ASYNC_SLOTS      8192 // power of two
+#define LOG_ASYNC_TEXT_SIZE  224  // longer messages are cut off
+#define LOG_ASYNC_WAKE_SLOTS 2048 // queued messages that wake the writer before its wait is up
+#define LOG_ASYNC_IDLE_MS    2    // the writer's wait when there's less than that
+
+// what a message below LOG_ERROR does when the ring is full, errors always wait
+enum class LogAsyncFull
+{
+    WAIT = 0, // for the writer to make room, nothing is lost
+    DROP = 1, // counted (Logger::GetAsyncDropped()), the logging thread never waits
+};
+
+// streambuf over a fixed buffer, whatever doesn't fit is dropped
+class LogTextBuffer : public std::streambuf
+{
+    public:
+    char text[LOG_ASYNC_TEXT_SIZE];
+    std::ostream stream;
+
+    LogTextBuffer() : stream{this} { Begin(); }
+
+    void Begin()
+    {
+        setp(text, text + LOG_ASYNC_TEXT_SIZE);
+        stream.clear();
+    }
+
+    size_t GetSize() const { return (size_t)(pptr() - pbase()); }
+
+    // strings and numbers skip the ostream, its sentry and locale lookups (a shared
+    // refcount every thread bumps) cost more than the formatting
+    template<typename T>
+    void Append(const T &value)
+    {
+        char *end = text + LOG_ASYNC_TEXT_SIZE;
+        if constexpr(std::is_same_v<T, bool> || std::is_same_v<T, char> || std::is_same_v<T, signed char> ||
+                     std::is_same_v<T, unsigned char>)
+        {
+            stream << value;
+        }
+        else if constexpr(std::is_integral_v<T> || std::is_floating_point_v<T>)
+        {
+            // floats as ostream's default %g with 6 digits
+            std::to_chars_result result;
+            if constexpr(std::is_floating_point_v<T>)
+                result = std::to_chars(pptr(), end, value, std::chars_format::general, 6);
+            else
+                result = std::to_chars(pptr(), end, value);
+
+            if(result.ec == std::errc())
+                pbump((int)(result.ptr - pptr()));
+            else
+                setp(end, end);
+        }
+        else if constexpr(std::is_convertible_v<const T &, const char *>)
+        {
+            AppendText(value, strlen(value));
+        }
+        else if constexpr(std::is_same_v<T, std::string>)
+        {
+            AppendText(value.data(), value.size());
+        }
+        else
+        {
+            stream << value;
+        }
+    }
+
+    private:
+    void AppendText(const char *str, size_t size)
+    {
+        size_t room = (size_t)(text + LOG_ASYNC_TEXT_SIZE - pptr());
+        size = size < room ? size : room;
+        memcpy(pptr(), str, size);
+        pbump((int)size);
+    }
+};
+
 // --------------------- LOGGER CLASS --------------------
 class Logger
 {
@@ -95,11 +229,31 @@ class Logger
     private:
     LogLevel currentLevel;
 
-    std::ofstream fileStream;
+    // only made by EnableFileOutput(), an ofstream costs more to construct than
+    // the macros' short lived loggers spend on a whole message
+    std::ofstream *fileStream;
     std::string filePath;
 
     std::ostream &outStream;
 
+    // async and binary mode, the message being formatted
+    bool async;
+    bool binary;
+    bool messagePending;
+    LogLevel messageLevel;
+    const char *messageFile;
+    int messageLine;
+
+    // binary mode, the macro's call site
+    LogSite *site;
+    uint32_t siteState; // as the message began, registered or not
+    bool siteRegistering;
+    uint32_t literalIndex;
+
+    static std::atomic<bool> asyncRunning;
+    static std::atomic<bool> binaryRunning;
+    static std::atomic<uint32_t> binarySession;
+
     public:
     static Logger *instance;
     std::mutex mut;
@@ -107,13 +261,65 @@ class Logger
     // clang-format off
     Logger(std::ostream &os)
         :currentLevel{logLevel},
-        outStream{os}
+        fileStream{nullptr},
+        outStream{os},
+        async{IsAsync()},
+        binary{IsBinary()},
+        messagePending{false},
+        messageLevel{LogLevel::NONE},
+        messageFile{nullptr},
+        messageLine{0},
+        site{nullptr},
+        siteState{0},
+        siteRegistering{false},
+        literalIndex{0}
     {
     }
 
+    ~Logger()
+    {
+        FlushMessage();
+        delete fileStream;
+    }
+
     public:
     Logger(const Logger &log) = delete;
 
+    // starts the thread that writes queued messages to the console (if console) and to
+    // filepath (if it isn't null). returns false if the file can't be opened or async
+    // mode is already running. full says what a message does when the ring is full.
+    // StopAsync() runs at exit if nothing called it, and warns if anything was dropped.
+    static bool StartAsync(const char *filepath = nullptr, bool console = true,
+                           LogAsyncFull full = LogAsyncFull::WAIT);
+
+    // writes out what's queued and joins the thread, messages go out synchronously again.
+    // loggers that are mid message when it's called write that message synchronously.
+    static void StopAsync();
+
+    static bool IsAsync() { return asyncRunning.load(std::memory_order_relaxed); }
+
+    // messages the full ring dropped since StartAsync()
+    static uint64_t GetAsyncDropped();
+
+    // writes messages as binary records (binaryLog.h) to memory mapped files of fileSize
+    // bytes, <prefix><n>.blog, instead of formatting them. a full file is cut to its
+    // length and the next one begins, only the newest keepFiles are kept. returns false
+    // (and says why) if the first file can't be made or binary mode is already running.
+    // it takes precedence over async mode, StopBinary() runs at exit if nothing called it.
+    static bool StartBinary(const char *prefix, uint64_t fileSize = 64 << 20, uint32_t keepFiles = 4);
+
+    // cuts the current file to its length and closes it once the records being copied
+    // into it are in, loggers that write after it write text like they would without it.
+    static void StopBinary();
+
+    static bool IsBinary() { return binaryRunning.load(std::memory_order_relaxed); }
+
+    // messages lost because a file couldn't be made since StartBinary()
+    static uint64_t GetBinaryDropped();
+
+    // the L* macros' call site, binary mode writes its literals once
+    void BindSite(LogSite *logSite) { site = logSite; }
+
     static Logger *GetInstance()
     {
         if(instance == nullptr)
@@ -132,10 +338,12 @@ class Logger
 
         Logger::outType = OutputType::FILE;
 
-        if(fileStream.is_open())
-            fileStream.close();
+        if(!fileStream)
+            fileStream = new std::ofstream;
+        else if(fileStream->is_open())
+            fileStream->close();
 
-        fileStream.open(filePath, std::ios::out);
+        fileStream->open(filePath, std::ios::out);
     }
 
     void EnableOnlyFileOutput(std::string filepath = nullptr)
@@ -147,18 +355,20 @@ class Logger
 
         Logger::outType = OutputType::FILEONLY;
 
-        if(fileStream.is_open())
-            fileStream.close();
+        if(!fileStream)
+            fileStream = new std::ofstream;
+        else if(fileStream->is_open())
+            fileStream->close();
 
-        fileStream.open(filePath, std::ios::out);
+        fileStream->open(filePath, std::ios::out);
     }
 
     void DisableFileOutput()
     {
         Logger::outType = OutputType::CONSOLE;
 
-        if(fileStream.is_open())
-            fileStream.close();
+        if(FileOpen())
+            fileStream->close();
     }
 
     template<typename T>
@@ -167,10 +377,28 @@ class Logger
         Logger::logLevel = (LogLevel) ll;
     }
 
+    template<typename T>
+    static bool IsEnabled(T ll)
+    {
+        return (LogLevel) ll <= Logger::logLevel;
+    }
+
     // operator() takes log level and (optional) file data
     template<typename T>
     Logger &operator()(T ll)
     {
+        if(binary)
+        {
+            BeginBinary((LogLevel) ll, nullptr, 0);
+            return *this;
+        }
+
+        if(async)
+        {
+            BeginAsync((LogLevel) ll, nullptr, 0);
+            return *this;
+        }
+
         currentLevel = (LogLevel) ll;
         LOCK_MUTEX(mut);
         if((LogLevel)ll > Logger::logLevel)
@@ -188,15 +416,15 @@ class Logger
             outStream << "]\t";
         }
 
-        if(fileStream.is_open())
+        if(FileOpen())
         {
-            fileStream << "[";
-            fileStream << OutputHeader((LogLevel) ll);
+            *fileStream << "[";
+            *fileStream << OutputHeader((LogLevel) ll);
             
             outStream << " ";
             outStream << CurrentTime();
             
-            fileStream << "]\t";
+            *fileStream << "]\t";
         }
         
         return *this;
@@ -205,6 +433,18 @@ class Logger
     template<typename T, typename F, typename N>
     Logger &operator()(T ll, F fileName, N lineNumber)
     {
+        if(binary)
+        {
+            BeginBinary((LogLevel) ll, fileName, (int) lineNumber);
+            return *this;
+        }
+
+        if(async)
+        {
+            BeginAsync((LogLevel) ll, fileName, (int) lineNumber);
+            return *this;
+        }
+
         currentLevel = (LogLevel) ll;
 
         LOCK_MUTEX(mut);
@@ -227,17 +467,17 @@ class Logger
             outStream << "]\t";
         }
        
-        if(fileStream.is_open())
+        if(FileOpen())
         {
-            fileStream << "[" << OutputHeader((LogLevel) ll);
+            *fileStream << "[" << OutputHeader((LogLevel) ll);
             
-            fileStream << " ";
+            *fileStream << " ";
 
             outStream << CurrentTime();
             outStream << " ";
 
-            fileStream << OutputFileInfo(fileName, lineNumber);
-            fileStream << "]\t";
+            *fileStream << OutputFileInfo(fileName, lineNumber);
+            *fileStream << "]\t";
         }
 
         return *this;
@@ -247,19 +487,213 @@ class Logger
     template<typename T>
     Logger &operator<<(const T &txt)
     {
+        if(binary)
+        {
+            if(messagePending)
+                BinaryRecord().Append(txt);
+
+            return *this;
+        }
+
+        if(async)
+        {
+            if(messagePending)
+                AsyncText().Append(txt);
+
+            return *this;
+        }
+
         LOCK_MUTEX(mut);
         if(currentLevel > Logger::logLevel)
             return *this;
         
         outStream << txt;
 
-        if(fileStream.is_open())
-            fileStream << txt;
+        if(FileOpen())
+            *fileStream << txt;
         
         return *this;
     }
 
+    // string literals, binary mode refers to the site's copy once it's registered. a
+    // const char array that isn't a literal has a different address, which is checked
+    template<size_t N>
+    Logger &operator<<(const char (&txt)[N])
+    {
+        if(binary)
+        {
+            if(messagePending)
+                AppendLiteral(txt, strnlen(txt, N));
+
+            return *this;
+        }
+
+        return *this << (const char *) txt;
+    }
+
+    // char buffers are always runtime text, lump names aren't terminated
+    template<size_t N>
+    Logger &operator<<(char (&txt)[N])
+    {
+        if(binary)
+        {
+            if(messagePending)
+                BinaryRecord().PutString(txt, strnlen(txt, N));
+
+            return *this;
+        }
+
+        return *this << (const char *) txt;
+    }
+
     private:
+    bool FileOpen() const { return fileStream && fileStream->is_open(); }
+
+    static BinLogBuffer &BinaryRecord()
+    {
+        thread_local BinLogBuffer buffer;
+        return buffer;
+    }
+
+    // writes the record, as a BINLOG_MESSAGE of registeredSite or inline if it's null.
+    // false if binary mode isn't running anymore
+    static bool WriteBinary(BinLogBuffer &buffer, LogLevel ll, const char *fileName, int lineNumber,
+                            const LogSite *registeredSite);
+
+    // writes the site's BINLOG_SITE record and publishes it for the session
+    static void RegisterSite(LogSite *logSite, uint32_t session);
+
+    void BeginBinary(LogLevel ll, const char *fileName, int lineNumber)
+    {
+        FlushMessage();
+
+        currentLevel = ll;
+        if(ll > Logger::logLevel)
+            return;
+
+        messagePending = true;
+        messageLevel = ll;
+        messageFile = fileName;
+        messageLine = lineNumber;
+        literalIndex = 0;
+        siteRegistering = false;
+        siteState = 0;
+        BinaryRecord().Begin();
+
+        if(!site)
+            return;
+
+        // a state from an older session counts as new, one thread registers the site
+        // with the message it's writing and messages are inline until that's done
+        uint32_t session = binarySession.load(std::memory_order_relaxed);
+        siteState = site->state.load(std::memory_order_acquire);
+        if(LOG_SITE_SESSION(siteState) == session && LOG_SITE_PHASE(siteState) != LOG_SITE_NEW)
+            return;
+
+        if(site->state.compare_exchange_strong(siteState, (session << 2) | LOG_SITE_REGISTERING,
+                                               std::memory_order_acquire))
+        {
+            siteRegistering = true;
+            site->literalCount = 0;
+        }
+        siteState = 0;
+    }
+
+    void AppendLiteral(const char *txt, size_t length)
+    {
+        BinLogBuffer &buffer = BinaryRecord();
+        uint32_t idx = literalIndex++;
+        if(LOG_SITE_PHASE(siteState) == LOG_SITE_REGISTERED && idx < site->literalCount && site->literals[idx] == txt)
+        {
+            buffer.PutLiteral(idx);
+            return;
+        }
+
+        if(siteRegistering && idx < BINLOG_MAX_LITERALS && length <= BINLOG_PAYLOAD_SIZE)
+        {
+            site->literals[idx] = txt;
+            site->literalLengths[idx] = (uint16_t) length;
+            site->literalCount = idx + 1;
+        }
+        else if(siteRegistering)
+        {
+            site->literalCount = BINLOG_MAX_LITERALS + 1;
+        }
+
+        buffer.PutString(txt, length);
+    }
+
+    void FlushMessage()
+    {
+        if(!messagePending)
+            return;
+
+        messagePending = false;
+        if(binary)
+        {
+            const LogSite *registeredSite = LOG_SITE_PHASE(siteState) == LOG_SITE_REGISTERED ? site : nullptr;
+
+            // binary mode stopped since the message began, it goes out as text
+            if(!WriteBinary(BinaryRecord(), messageLevel, messageFile, messageLine, registeredSite))
+            {
+                FlushSync(BinaryRecord().ToText(registeredSite));
+                return;
+            }
+
+            if(siteRegistering)
+            {
+                site->file = messageFile;
+                site->line = (uint32_t) messageLine;
+                site->level = (uint8_t) messageLevel;
+                RegisterSite(site, binarySession.load(std::memory_order_relaxed));
+            }
+            return;
+        }
+
+        LogTextBuffer &buffer = AsyncText();
+        if(PushAsync(messageLevel, messageFile, messageLine, buffer.text, buffer.GetSize()) || IsAsync())
+            return;
+
+        // async mode stopped since the message began, it goes out synchronously
+        FlushSync(std::string(buffer.text, buffer.GetSize()));
+    }
+
+    // the pending message's text, written the way it would be without async or binary mode
+    void FlushSync(const std::string &text)
+    {
+        binary = false;
+        async = false;
+        if(messageFile)
+            (*this)(messageLevel, messageFile, messageLine);
+        else
+            (*this)(messageLevel);
+        *this << text;
+    }
+
+    static LogTextBuffer &AsyncText()
+    {
+        thread_local LogTextBuffer buffer;
+        return buffer;
+    }
+
+    // queues the message, false if it was dropped or async mode isn't running
+    static bool PushAsync(LogLevel ll, const char *fileName, int lineNumber, const char *text, size_t size);
+
+    void BeginAsync(LogLevel ll, const char *fileName, int lineNumber)
+    {
+        FlushMessage();
+
+        currentLevel = ll;
+        if(ll > Logger::logLevel)
+            return;
+
+        messagePending = true;
+        messageLevel = ll;
+        messageFile = fileName;
+        messageLine = lineNumber;
+        AsyncText().Begin();
+    }
+
     std::string OutputColoredHeader(LogLevel ll)
     {
         std::string output;
@@ -306,7 +740,7 @@ class Logger
     {
         std::string output;
 
-        if(!fileStream.is_open())
+        if(!FileOpen())
             return "";
         
         switch(ll)
@@ -341,8 +775,11 @@ class Logger
         auto now = std::chrono::system_clock::now();
         auto in_time_t = std::chrono::system_clock::to_time_t(now);
 
+        std::tm local;
+        DEUtil::LocalTime(in_time_t, local);
+
         std::stringstream ss;
-        ss << std::put_time(std::localtime(&in_time_t), "%X");
+        ss << std::put_time(&local, "%X");
         return ss.str();
     }
 
@@ -360,68 +797,55 @@ class Logger
 };
 
 // macros for initialzing and running the logger with minimal code.
+// the level is checked before a logger exists or an argument is evaluated, so a message
+// the runtime level filters out costs a compare and one LOG_COMPILED() drops costs nothing.
+#define LOG_MESSAGE(ll, withFile, y)                                                                                   \
+    if constexpr(LOG_COMPILED(ll))                                                                                     \
+    {                                                                                                                  \
+        if(Logger::IsEnabled(ll))                                                                                      \
+        {                                                                                                              \
+            static LogSite logSite;                                                                                    \
+            LOGINIT_COUT();                                                                                            \
+            Log.BindSite(&logSite);                                                                                    \
+            if(withFile)                                                                                               \
+            {                                                                                                          \
+                Log(ll, FILE_INFO) << y;                                                                               \
+            }                                                                                                          \
+            else                                                                                                       \
+            {                                                                                                          \
+                Log(ll) << y;                                                                                          \
+            }                                                                                                          \
+        }                                                                                                              \
+    }
+
 #define LFATAL(x)                                                                                                      \
     {                                                                                                                  \
-        LOGINIT_COUT();                                                                                                \
-        Log(LOG_FATAL, FILE_INFO) << x;                                                                                \
+        LOG_MESSAGE(LOG_FATAL, true, x);                                                                               \
     }
 
 #define LERROR(x)                                                                                                      \
     {                                                                                                                  \
-        LOGINIT_COUT();                                                                                                \
-        Log(LOG_ERROR, FILE_INFO) << x;                                                                                \
+        LOG_MESSAGE(LOG_ERROR, true, x);                                                                               \
     }
 
 #define LWARN(x, y)                                                                                                    \
     {                                                                                                                  \
-        LOGINIT_COUT();                                                                                                \
-        if(x)                                                                                                          \
-        {                                                                                                              \
-            Log(LOG_WARN, FILE_INFO) << y;                                                                             \
-        }                                                                                                              \
-        else                                                                                                           \
-        {                                                                                                              \
-            Log(LOG_WARN) << y;                                                                                        \
-        }                                                                                                              \
+        LOG_MESSAGE(LOG_WARN, x, y);                                                                                   \
     }
 
 #define LDEBUG(x, y)                                                                                                   \
     {                                                                                                                  \
-        LOGINIT_COUT();                                                                                                \
-        if(x)                                                                                                          \
-        {                                                                                                              \
-            Log(LOG_DEBUG, FILE_INFO) << y;                                                                            \
-        }                                                                                                              \
-        else                                                                                                           \
-        {                                                                                                              \
-            Log(LOG_DEBUG) << y;                                                                                       \
-        }                                                                                                              \
+        LOG_MESSAGE(LOG_DEBUG, x, y);                                                                                  \
     }
 
 #define LTRACE(x, y)                                                                                                   \
     {                                                                                                                  \
-        LOGINIT_COUT();                                                                                                \
-        if(x)                                                                                                          \
-        {                                                                                                              \
-            Log(LOG_TRACE, FILE_INFO) << y;                                                                            \
-        }                                                                                                              \
-        else                                                                                                           \
-        {                                                                                                              \
-            Log(LOG_TRACE) << y;                                                                                       \
-        }                                                                                                              \
+        LOG_MESSAGE(LOG_TRACE, x, y);                                                                                  \
     }
 
 #define LINFO(x, y)                                                                                                    \
     {                                                                                                                  \
-        LOGINIT_COUT();                                                                                                \
-        if(x)                                                                                                          \
-        {                                                                                                              \
-            Log(LOG_INFO, FILE_INFO) << y;                                                                             \
-        }                                                                                                              \
-        else                                                                                                           \
-        {                                                                                                              \
-            Log(LOG_INFO) << y;                                                                                        \
-        }                                                                                                              \
+        LOG_MESSAGE(LOG_INFO, x, y);                                                                                   \
     }
 
 #define LOG_SET_PRIORITY(x) Logger::SetLogLevel(x);
\ No newline at end of file
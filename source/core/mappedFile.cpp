@@ -0,0 +1,130 @@
+#include "mappedFile.h"
+#include "logger.h"
+
+#ifdef IPLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#ifdef IPLATFORM_WINDOWS
+
+DEUtil::MappedFile::MappedFile() : data{nullptr}, size{0}, fileHandle{nullptr}, mappingHandle{nullptr} {}
+
+bool DEUtil::MappedFile::Open(const char *filepath)
+{
+    Close();
+
+    HANDLE file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        LERROR("couldn't open file with path: " << filepath << "\n");
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        LERROR("couldn't map empty file with path: " << filepath << "\n");
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if(!view)
+    {
+        LERROR("couldn't map file with path: " << filepath << "\n");
+        if(mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = (const u8 *)view;
+    size = (usize)fileSize.QuadPart;
+
+    return true;
+}
+
+void DEUtil::MappedFile::Close()
+{
+    if(data)
+        UnmapViewOfFile(data);
+    if(mappingHandle)
+        CloseHandle((HANDLE)mappingHandle);
+    if(fileHandle)
+        CloseHandle((HANDLE)fileHandle);
+
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+#else
+
+DEUtil::MappedFile::MappedFile() : data{nullptr}, size{0}, fd{-1} {}
+
+bool DEUtil::MappedFile::Open(const char *filepath)
+{
+    Close();
+
+    i32 file = open(filepath, O_RDONLY);
+    if(file < 0)
+    {
+        LERROR("couldn't open file with path: " << filepath << "\n");
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(file, &info) != 0 || info.st_size == 0)
+    {
+        LERROR("couldn't map empty file with path: " << filepath << "\n");
+        close(file);
+        return false;
+    }
+
+    void *view = mmap(nullptr, (usize)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if(view == MAP_FAILED)
+    {
+        LERROR("couldn't map file with path: " << filepath << "\n");
+        close(file);
+        return false;
+    }
+
+    // start reading ahead, the whole file is needed on load
+    madvise(view, (usize)info.st_size, MADV_WILLNEED);
+
+    fd = file;
+    data = (const u8 *)view;
+    size = (usize)info.st_size;
+
+    return true;
+}
+
+void DEUtil::MappedFile::Close()
+{
+    if(data)
+        munmap((void *)data, size);
+    if(fd >= 0)
+        close(fd);
+
+    data = nullptr;
+    size = 0;
+    fd = -1;
+}
+
+#endif
+
+DEUtil::MappedFile::~MappedFile()
+{
+    Close();
+}
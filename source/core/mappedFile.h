@@ -0,0 +1,37 @@
+#pragma once
+
+#include "defines.h"
+
+namespace DEUtil {
+
+// read-only memory mapping of a whole file.
+class MappedFile
+{
+    private:
+    const u8 *data;
+    usize size;
+
+#ifdef IPLATFORM_WINDOWS
+    void *fileHandle;
+    void *mappingHandle;
+#else
+    i32 fd;
+#endif
+
+    public:
+    MappedFile();
+    MappedFile(const MappedFile &file) = delete;
+    MappedFile &operator=(const MappedFile &file) = delete;
+
+    // returns false (and logs) if the file can't be opened or mapped.
+    bool Open(const char *filepath);
+    void Close();
+
+    inline const u8 *GetData() const { return data; }
+    inline usize GetSize() const { return size; }
+    inline bool IsOpen() const { return data != nullptr; }
+
+    ~MappedFile();
+};
+
+} // namespace DEUtil
@@ -0,0 +1,34 @@
+#include "ticClock.h"
+
+TicClock::TicClock(u32 ticRate, u32 maxTicsPerFrame)
+    : ticLength{1.0 / ticRate}, lastTime{0.0}, accumulator{0.0}, maxTicsPerFrame{maxTicsPerFrame}, tic{0}
+{
+}
+
+void TicClock::Reset(f64 now)
+{
+    lastTime = now;
+    accumulator = 0.0;
+    tic = 0;
+}
+
+u32 TicClock::Advance(f64 now)
+{
+    // the clock can jump backwards across a timer reset
+    accumulator += now > lastTime ? now - lastTime : 0.0;
+    lastTime = now;
+
+    u32 tics = 0;
+    while(accumulator >= ticLength && tics < maxTicsPerFrame)
+    {
+        accumulator -= ticLength;
+        tics++;
+    }
+
+    // a stall past the cap is dropped whole
+    if(accumulator >= ticLength)
+        accumulator = 0.0;
+
+    tic += tics;
+    return tics;
+}
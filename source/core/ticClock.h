@@ -0,0 +1,32 @@
+#pragma once
+
+#include "defines.h"
+
+// turns wall clock time into whole simulation tics at a fixed rate. the time left over
+// is the fraction of the next tic that has passed, renderers interpolate with it.
+class TicClock
+{
+    private:
+    f64 ticLength;
+    f64 lastTime;
+    f64 accumulator;
+    u32 maxTicsPerFrame;
+    u64 tic;
+
+    public:
+    // maxTicsPerFrame caps the catch up after a stall (a dragged window, a breakpoint),
+    // the time beyond it is dropped instead of simulated.
+    TicClock(u32 ticRate, u32 maxTicsPerFrame);
+
+    void Reset(f64 now);
+
+    // tics to simulate before the next frame
+    u32 Advance(f64 now);
+
+    // 0 right after a tic, close to 1 just before the next one
+    inline f32 GetAlpha() const { return (f32)(accumulator / ticLength); }
+    inline u64 GetTic() const { return tic; }
+
+    // when tic i of the tics from the last Advance() ended, input up to then belongs to it
+    inline f64 GetTicEndTime(u32 i, u32 tics) const { return lastTime - accumulator - (tics - 1 - i) * ticLength; }
+};
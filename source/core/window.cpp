@@ -2,8 +2,11 @@
 
 #include "logger.h"
 
+#include <chrono>
+
 i32 Window::width = DEF_WIDTH, Window::height = DEF_HEIGHT;
 Joystick Window::mainJoystick(0);
+std::atomic<i32> Window::framebufferWidth{0}, Window::framebufferHeight{0};
 
 void Window::ErrorCallback(i32 error, const char *description)
 {
@@ -17,6 +20,20 @@ void Window::OnWindowResize(GLFWwindow *window, i32 width, i32 height)
     Window::SetWindowSize(width, height);
 }
 
+void Window::OnFramebufferResize(GLFWwindow *window, i32 width, i32 height)
+{
+    framebufferWidth.store(width, std::memory_order_relaxed);
+    framebufferHeight.store(height, std::memory_order_relaxed);
+}
+
+void Window::WaitEvents()
+{
+    if(IsEventThread())
+        glfwWaitEvents();
+    else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
 void Window::InitializeWindow()
 {
     // initialize glfw.
@@ -74,6 +91,13 @@ void Window::InitializeWindow()
     //     glfwSetFramebufferSizeCallback(window, OnWindowResize);
     // }
 
+    eventThread = std::this_thread::get_id();
+
+    i32 fbWidth, fbHeight;
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    OnFramebufferResize(window, fbWidth, fbHeight);
+    glfwSetFramebufferSizeCallback(window, OnFramebufferResize);
+
     // input callbacks
     glfwSetKeyCallback(window, Keyboard::KeyCallback);
 
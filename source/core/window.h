@@ -7,6 +7,9 @@
 #include "../io/mouse.h"
 #include "../io/joystick.h"
 
+#include <atomic>
+#include <thread>
+
 #define DEF_HEIGHT 480
 #define DEF_WIDTH  640
 
@@ -20,6 +23,12 @@ class Window
 
     static Joystick mainJoystick;
 
+    // kept by a callback, so threads other than the one polling can read it
+    static std::atomic<i32> framebufferWidth, framebufferHeight;
+
+    // the thread that made the window, glfw only lets it poll events
+    std::thread::id eventThread;
+
     protected:
     GLFWwindow *window;
     GLFWmonitor *monitor;
@@ -58,7 +67,7 @@ class Window
     inline GLFWmonitor *GetMonitor() const { return this->monitor; }
 
     inline bool VSyncEnabled() const { return this->vsync; }
-    inline f32 GetCurrentTime() const { return glfwGetTime(); }
+    inline f64 GetCurrentTime() const { return glfwGetTime(); }
 
     // setter methods
     static inline void SetWindowSize(i32 width, i32 height)
@@ -96,13 +105,31 @@ class Window
     inline void SetWindowShouldClose(bool shouldClose) { glfwSetWindowShouldClose(window, shouldClose); }
     inline void NewFrame() { glfwPollEvents(); }
 
+    // polls until an event comes in or timeout seconds have passed, on the event thread only
+    inline void PollEvents(f64 timeout) { glfwWaitEventsTimeout(timeout); }
+
+    // blocks until there are events on the event thread, on any other thread it only
+    // sleeps a little while the event thread keeps polling
+    void WaitEvents();
+
+    inline bool IsEventThread() const { return std::this_thread::get_id() == eventThread; }
+
     // glfw callbacks
     static void ErrorCallback(i32 error, const char *description);
     static void OnWindowResize(GLFWwindow *window, i32 width, i32 height);
+    static void OnFramebufferResize(GLFWwindow *window, i32 width, i32 height);
+
+    // framebuffer size in pixels as of the last poll, any thread can ask
+    static inline void GetFramebufferSize(i32 &width, i32 &height)
+    {
+        width = framebufferWidth.load(std::memory_order_relaxed);
+        height = framebufferHeight.load(std::memory_order_relaxed);
+    }
 
     // joystick input
     inline bool IsJoystickPresent() { return mainJoystick.IsPresent(); }
     inline void UpdateJoystick() { mainJoystick.Update(); }
+    inline Joystick &GetJoystick() { return mainJoystick; }
 
     // extras
     inline void EnableCursor() { glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); }
@@ -4,8 +4,12 @@
 #include "render.h"
 #include "mesh.h"
 
+// 8 bit textures (and descriptor sets) IndexedTextures can hold
+#define MAX_INDEXED_TEXTURES 1024
+
 // constructor
-Engine::Engine(i32 width, i32 height, Window *window) : width{width}, height{height}, window{window}
+Engine::Engine(i32 width, i32 height, Window *window)
+    : width{width}, height{height}, window{window}, lastSubmitTime{0.0}
 {
     //_____ VULKAN INIT _____
     MakeVKInstance(window->GetTitle());
@@ -18,12 +22,15 @@ Engine::Engine(i32 width, i32 height, Window *window) : width{width}, height{hei
     MakeVKLogicalDevice(physicalDevice);
     MakeVKQueues(device, physicalDevice);
 
+    // its set layout is part of the graphics pipeline layout
+    indexedTextures = new IndexedTextures(device, physicalDevice, MAX_INDEXED_TEXTURES);
     MakeVKGraphicsPipeline();
 
     InitializeVKDrawing();
 
     // assets
     MakeAssets();
+    MakeVKClusterResources();
 }
 
 // clang-format off
@@ -398,6 +405,10 @@ void Engine::MakeVKLogicalDevice(vk::PhysicalDevice phyDevice)
 
     vk::PhysicalDeviceFeatures deviceFeat = vk::PhysicalDeviceFeatures();
 
+    // optional: one indirect call per object in the meshlet culling path
+    multiDrawIndirect = phyDevice.getFeatures().multiDrawIndirect;
+    deviceFeat.multiDrawIndirect = multiDrawIndirect;
+
     std::vector<const char *> enabledLayers;
     if(ENGINE_DEBUG)
         enabledLayers.push_back("VK_LAYER_KHRONOS_validation");
@@ -624,10 +635,17 @@ void Engine::RecreateVKSwapchain()
 {
     width = 0;
     height = 0;
+    // minimized, wait until there's something to draw to again. this can run on the render
+    // thread, so the size comes from the window's callback and not from glfw. if the window
+    // is closed meanwhile nothing is recreated, the frame is skipped and the app can quit
     while(width == 0 || height == 0)
     {
-        glfwGetFramebufferSize(window->GetWindow(), &width, &height);
-        glfwWaitEvents();
+        if(window->WindowShouldClose())
+            return;
+
+        Window::GetFramebufferSize(width, height);
+        if(width == 0 || height == 0)
+            window->WaitEvents();
     }
 
     device.waitIdle();
@@ -657,15 +675,26 @@ struct GraphicsPipelineInBundle
 
     std::string vertexFilepath;
     std::string fragmentFilepath;
+
+    // set 0, IndexedTextures
+    vk::DescriptorSetLayout textureSetLayout;
+
+    // basic.frag's INDEXED specialization constant
+    bool indexed;
+
+    // variants of a pipeline reuse its layout and render pass, new ones are made if null
+    vk::PipelineLayout layout;
+    vk::RenderPass renderPass;
 };
 
-vk::PipelineLayout CreateGraphicsPipelineLayout(vk::Device device)
+vk::PipelineLayout CreateGraphicsPipelineLayout(vk::Device device, vk::DescriptorSetLayout textureSetLayout)
 {
     vk::PipelineLayoutCreateInfo layoutInfo{};
     layoutInfo.flags = vk::PipelineLayoutCreateFlags();
     
     // descriptor sets
-    layoutInfo.setLayoutCount = 0;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &textureSetLayout;
     
     // push constants
     layoutInfo.pushConstantRangeCount = 1;
@@ -803,6 +832,11 @@ GraphicsPipelineBundle CreateGraphicsPipeline(GraphicsPipelineInBundle spec)
     fragShaderInfo.stage = vk::ShaderStageFlagBits::eFragment;
     fragShaderInfo.module = fragShader;
     fragShaderInfo.pName = "main"; // NOTE: hardcoded name
+
+    VkBool32 indexed = spec.indexed ? VK_TRUE : VK_FALSE;
+    vk::SpecializationMapEntry indexedEntry{0, 0, sizeof(indexed)};
+    vk::SpecializationInfo specialization{1, &indexedEntry, sizeof(indexed), &indexed};
+    fragShaderInfo.pSpecializationInfo = &specialization;
     shaderStages.push_back(fragShaderInfo);
 
     pipelineInfo.stageCount = shaderStages.size();
@@ -834,11 +868,11 @@ GraphicsPipelineBundle CreateGraphicsPipeline(GraphicsPipelineInBundle spec)
     pipelineInfo.pColorBlendState = &colorBlend;
 
     // pipeline layout
-    vk::PipelineLayout layout = CreateGraphicsPipelineLayout(spec.device);
+    vk::PipelineLayout layout = spec.layout ? spec.layout : CreateGraphicsPipelineLayout(spec.device, spec.textureSetLayout);
     pipelineInfo.layout = layout;
 
     // render pass
-    vk::RenderPass renderPass = CreateGraphicsPipelineRenderPass(spec.device, spec.swapchainImageFormat);
+    vk::RenderPass renderPass = spec.renderPass ? spec.renderPass : CreateGraphicsPipelineRenderPass(spec.device, spec.swapchainImageFormat);
     pipelineInfo.renderPass = renderPass;
 
     // misc
@@ -875,9 +909,106 @@ void Engine::MakeVKGraphicsPipeline()
 
         .vertexFilepath   = RES_PATH"shaders/basic.vert.spv", // NOTE: hardcoded filepath
         .fragmentFilepath = RES_PATH"shaders/basic.frag.spv", // NOTE: hardcoded filepath
+
+        .textureSetLayout = indexedTextures->GetSetLayout(),
+        .indexed          = false,
     };
 
     pipeline = CreateGraphicsPipeline(spec);
+
+    // 8 bit textures lit through the palette and colormap lookups.
+    // NOTE: only created for now, no scene mesh carries texel coordinates and light in
+    // its vertex colors yet, so RecordVKDrawCommands() never binds it
+    spec.indexed    = true;
+    spec.layout     = pipeline.layout;
+    spec.renderPass = pipeline.renderPass;
+    indexedPipeline = CreateGraphicsPipeline(spec);
+}
+
+vk::DescriptorSetLayout CreateCullDescriptorSetLayout(vk::Device device)
+{
+    // binding 0: meshlets, binding 1: indirect draw commands
+    std::array<vk::DescriptorSetLayoutBinding, 2> bindings;
+    for(u32 i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = vk::ShaderStageFlagBits::eCompute;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.flags = vk::DescriptorSetLayoutCreateFlags();
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+
+    try
+    {
+        return device.createDescriptorSetLayout(layoutInfo);
+    }
+    catch(vk::SystemError err)
+    {
+        LERROR("VULKAN ERROR: couldn't create cull descriptor set layout.\n\t" << err.what() << "\n");
+        return nullptr;
+    }
+}
+
+ComputePipelineBundle CreateComputePipeline(vk::Device device, std::string computeFilepath, u32 pushConstantSize)
+{
+    ComputePipelineBundle out;
+    out.descriptorSetLayout = CreateCullDescriptorSetLayout(device);
+
+    vk::PushConstantRange pushConstantInfo{};
+    pushConstantInfo.offset = 0;
+    pushConstantInfo.size = pushConstantSize;
+    pushConstantInfo.stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+    vk::PipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.flags = vk::PipelineLayoutCreateFlags();
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &out.descriptorSetLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushConstantInfo;
+
+    try
+    {
+        out.layout = device.createPipelineLayout(layoutInfo);
+    }
+    catch(vk::SystemError err)
+    {
+        LERROR("VULKAN ERROR: couldn't create compute pipeline layout.\n\t" << err.what() << "\n");
+    }
+
+    vk::ShaderModule compShader = DEUtil::CreateShaderModule(computeFilepath.c_str(), device);
+
+    vk::ComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.flags = vk::PipelineCreateFlags();
+    pipelineInfo.stage.flags = vk::PipelineShaderStageCreateFlags();
+    pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineInfo.stage.module = compShader;
+    pipelineInfo.stage.pName = "main"; // NOTE: hardcoded name
+    pipelineInfo.layout = out.layout;
+
+    try
+    {
+        out.pipeline = device.createComputePipeline(nullptr, pipelineInfo).value;
+    }
+    catch(vk::SystemError err)
+    {
+        LERROR("VULKAN ERROR: failed to create compute pipeline.\n\t" << err.what() << "\n");
+    }
+
+    device.destroyShaderModule(compShader);
+    return out;
+}
+
+void Engine::MakeVKCullPipeline()
+{
+    cullPipeline = CreateComputePipeline(
+        device,
+        RES_PATH"shaders/cull.comp.spv", // NOTE: hardcoded filepath
+        sizeof(DEUtil::CullData)
+    );
 }
 
 #pragma endregion
@@ -1020,10 +1151,118 @@ void Engine::MakeAssets()
         0.05f, 0.05f, 0.0f, 1.0f, 0.0f,
         -0.05f, 0.05f, 0.0f, 0.0f, 1.0f
     };
-    MeshType type = MeshType::TRIANGLE;
-    meshes->Consume(type, vertices);
+    triangleMesh = meshes->Consume(vertices);
+
+    // high-poly disc, split into meshlets for the cluster culling path.
+    // a cooked one (tools/meshCooker.cpp) skips building meshlets and lods at load time.
+    const char *cookedPath = RES_PATH"meshes/polygon.dmc";
+    DEUtil::MeshCache cache;
+    polygonMesh = MESH_HANDLE_NULL;
+    if(std::ifstream(cookedPath).good() && cache.Open(cookedPath))
+        polygonMesh = meshes->Consume(cache, "polygon");
+
+    if(!meshes->IsValid(polygonMesh))
+    {
+        const u32 segments = 512;
+        const f32 radius = 0.1f;
+        std::vector<f32> polyVertices = {0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+        std::vector<u32> polyIndices;
+        for(u32 i = 0; i < segments; i++)
+        {
+            f32 angle = glm::radians(360.0f * i / segments);
+            f32 c = std::cos(angle);
+            f32 s = std::sin(angle);
+
+            polyVertices.insert(polyVertices.end(), {
+                radius * c, radius * s,
+                0.5f + 0.5f * c, 0.5f + 0.5f * s, 0.5f
+            });
+
+            // clockwise on screen (vulkan y points down)
+            polyIndices.insert(polyIndices.end(), {0, 1 + i, 1 + (i + 1) % segments});
+        }
+        polygonMesh = meshes->Consume(polyVertices, polyIndices, MESH_BUILD_MESHLETS | MESH_BUILD_LODS);
+    }
 
     meshes->Finalize(device, physicalDevice);
+
+    // greyscale until a wad's PLAYPAL and COLORMAP are loaded
+    indexedTextures->Finalize(commandPool, graphicsQueue);
+}
+
+// max indirect commands the cull pass can write per frame
+#define MAX_CLUSTER_DRAWS 65536
+
+void Engine::MakeVKClusterResources()
+{
+    if(meshes->GetMeshletCount() == 0)
+        return;
+
+    MakeVKCullPipeline();
+
+    u32 frameCount = (u32)swapchain.frames.size();
+
+    vk::DescriptorPoolSize poolSize{};
+    poolSize.type = vk::DescriptorType::eStorageBuffer;
+    poolSize.descriptorCount = 2 * frameCount;
+
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::DescriptorPoolCreateFlags();
+    poolInfo.maxSets = frameCount;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    try
+    {
+        descriptorPool = device.createDescriptorPool(poolInfo);
+    }
+    catch(vk::SystemError err)
+    {
+        LERROR("VULKAN ERROR: couldn't create a descriptor pool.\n\t" << err.what() << "\n");
+        return;
+    }
+
+    clusterFrames.resize(frameCount);
+    for(ClusterFrame &frame : clusterFrames)
+    {
+        DEUtil::BufferInput buffIn;
+        buffIn.logicalDevice  = device;
+        buffIn.physicalDevice = physicalDevice;
+        buffIn.size           = MAX_CLUSTER_DRAWS * sizeof(vk::DrawIndexedIndirectCommand);
+        buffIn.usage          = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+        frame.indirectBuffer = DEUtil::CreateBuffer(buffIn);
+
+        vk::DescriptorSetAllocateInfo allocInfo{};
+        allocInfo.descriptorPool = descriptorPool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &cullPipeline.descriptorSetLayout;
+        frame.descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+
+        vk::DescriptorBufferInfo meshletInfo{};
+        meshletInfo.buffer = meshes->meshletBuffer.buffer;
+        meshletInfo.offset = 0;
+        meshletInfo.range = VK_WHOLE_SIZE;
+
+        vk::DescriptorBufferInfo drawInfo{};
+        drawInfo.buffer = frame.indirectBuffer.buffer;
+        drawInfo.offset = 0;
+        drawInfo.range = VK_WHOLE_SIZE;
+
+        std::array<vk::WriteDescriptorSet, 2> writes;
+        writes[0].dstSet = frame.descriptorSet;
+        writes[0].dstBinding = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType = vk::DescriptorType::eStorageBuffer;
+        writes[0].pBufferInfo = &meshletInfo;
+
+        writes[1].dstSet = frame.descriptorSet;
+        writes[1].dstBinding = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+        writes[1].pBufferInfo = &drawInfo;
+
+        device.updateDescriptorSets(writes, nullptr);
+    }
 }
 
 void Engine::PrepareScene(vk::CommandBuffer cmdBuff)
@@ -1056,22 +1295,33 @@ void Engine::RecordVKDrawCommands(vk::CommandBuffer commandBuffer, u32 imageIdx,
     passInfo.clearValueCount = 1;
     passInfo.pClearValues = &clearColor;
 
+    SelectInstanceLODs(scene);
+
+    // culling has to finish before the render pass reads the indirect commands
+    RecordVKCullCommands(commandBuffer, scene);
+
     commandBuffer.beginRenderPass(&passInfo, vk::SubpassContents::eInline);
     commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline.pipeline);
 
+    // the layout always has set 0, even if nothing indexed is drawn
+    vk::DescriptorSet textureSet = indexedTextures->GetDescriptorSet(INDEXED_TEXTURE_NULL);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipeline.layout, 0, textureSet, nullptr);
+
     PrepareScene(commandBuffer);
 
-    VertexData vertexData = meshes->vertexAttribData.find(MeshType::TRIANGLE)->second;
+    const VertexData &vertexData = meshes->Get(triangleMesh);
     for(glm::vec3 pos : scene->triPos)
     {
         glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
         DEUtil::ObjectData objData;
-        objData.model = model;
+        objData.model = scene->viewProj * model;
         commandBuffer.pushConstants(pipeline.layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(objData), &objData);
         
         commandBuffer.draw(vertexData.size, 1, vertexData.offset, 0);
     }
 
+    RecordVKClusterDraws(commandBuffer, scene);
+
     commandBuffer.endRenderPass();
 
     try
@@ -1085,6 +1335,121 @@ void Engine::RecordVKDrawCommands(vk::CommandBuffer commandBuffer, u32 imageIdx,
 
 }
 
+void Engine::SelectInstanceLODs(Scene *scene)
+{
+    const VertexData &vertexData = meshes->Get(polygonMesh);
+
+    instanceLODs.resize(scene->polyPos.size());
+    for(usize i = 0; i < scene->polyPos.size(); i++)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), scene->polyPos[i]);
+
+        instanceLODs[i] = DEUtil::SelectLOD(
+            vertexData.lods, vertexData.lodCount,
+            scene->viewProj * model, vertexData.bounds,
+            (f32)swapchain.extent.height
+        );
+    }
+}
+
+void Engine::RecordVKCullCommands(vk::CommandBuffer commandBuffer, Scene *scene)
+{
+    if(clusterFrames.empty())
+        return;
+
+    const VertexData &vertexData = meshes->Get(polygonMesh);
+    ClusterFrame &frame = clusterFrames[frameNum % clusterFrames.size()];
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline.pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipeline.layout, 0, frame.descriptorSet, nullptr);
+
+    u32 drawOffset = 0;
+    for(usize i = 0; i < scene->polyPos.size(); i++)
+    {
+        // coarser lods are drawn whole, meshlets only cover lod 0
+        if(instanceLODs[i] != 0)
+            continue;
+
+        if(drawOffset + vertexData.meshletCount > MAX_CLUSTER_DRAWS)
+            break;
+
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), scene->polyPos[i]);
+
+        // cull in object space, so meshlet bounds never have to be transformed
+        DEUtil::CullData cullData;
+        cullData.clip = scene->viewProj * model;
+        cullData.cameraPos = glm::inverse(model) * glm::vec4(scene->cameraPos, 1.0f);
+        cullData.firstMeshlet = vertexData.firstMeshlet;
+        cullData.meshletCount = vertexData.meshletCount;
+        cullData.vertexOffset = vertexData.offset;
+        cullData.drawOffset = drawOffset;
+        commandBuffer.pushConstants(cullPipeline.layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(cullData), &cullData);
+
+        commandBuffer.dispatch((vertexData.meshletCount + 63) / 64, 1, 1); // NOTE: local size of cull.comp
+
+        drawOffset += vertexData.meshletCount;
+    }
+
+    vk::MemoryBarrier barrier{};
+    barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect,
+        vk::DependencyFlags(), barrier, nullptr, nullptr
+    );
+}
+
+void Engine::RecordVKClusterDraws(vk::CommandBuffer commandBuffer, Scene *scene)
+{
+    if(!meshes->indexBuffer.buffer)
+        return;
+
+    const VertexData &vertexData = meshes->Get(polygonMesh);
+    u32 stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+    commandBuffer.bindIndexBuffer(meshes->indexBuffer.buffer, 0, vk::IndexType::eUint32);
+
+    u32 drawOffset = 0;
+    for(usize i = 0; i < scene->polyPos.size(); i++)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), scene->polyPos[i]);
+        DEUtil::ObjectData objData;
+        objData.model = scene->viewProj * model;
+        commandBuffer.pushConstants(pipeline.layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(objData), &objData);
+
+        u32 lod = instanceLODs[i];
+        if(lod != 0 || clusterFrames.empty())
+        {
+            const DEUtil::MeshLOD &range = vertexData.lods[lod];
+            commandBuffer.drawIndexed(range.indexCount, 1, vertexData.firstIndex + range.firstIndex, vertexData.offset, 0);
+            continue;
+        }
+
+        if(drawOffset + vertexData.meshletCount > MAX_CLUSTER_DRAWS)
+            break;
+
+        ClusterFrame &frame = clusterFrames[frameNum % clusterFrames.size()];
+
+        // culled meshlets were written with instanceCount = 0
+        if(multiDrawIndirect)
+        {
+            commandBuffer.drawIndexedIndirect(frame.indirectBuffer.buffer, drawOffset * stride, vertexData.meshletCount, stride);
+        }
+        else
+        {
+            for(i32 m = 0; m < vertexData.meshletCount; m++)
+                commandBuffer.drawIndexedIndirect(frame.indirectBuffer.buffer, (drawOffset + m) * stride, 1, stride);
+        }
+
+        drawOffset += vertexData.meshletCount;
+    }
+}
+
+void Engine::WaitForFrame()
+{
+    device.waitForFences(1, &swapchain.frames[frameNum].inFlight, VK_TRUE, UINT64_MAX);
+}
+
 void Engine::Render(Scene *scene)
 {
     device.waitForFences(1, &swapchain.frames[frameNum].inFlight, VK_TRUE, UINT64_MAX);
@@ -1126,6 +1491,7 @@ void Engine::Render(Scene *scene)
     try
     {
         graphicsQueue.submit(submitInfo, swapchain.frames[frameNum].inFlight);
+        lastSubmitTime = window->GetCurrentTime();
     }
     catch (vk::SystemError err)
     {
@@ -1185,13 +1551,29 @@ Engine::~Engine()
 
     device.destroyCommandPool(commandPool);
 
+    device.destroyPipeline(indexedPipeline.pipeline);
     device.destroyPipeline(pipeline.pipeline);
     device.destroyPipelineLayout(pipeline.layout);
     device.destroyRenderPass(pipeline.renderPass);
 
+    for(ClusterFrame &frame : clusterFrames)
+    {
+        device.destroyBuffer(frame.indirectBuffer.buffer);
+        device.freeMemory(frame.indirectBuffer.memory);
+    }
+
+    if(descriptorPool)
+    {
+        device.destroyDescriptorPool(descriptorPool);
+        device.destroyPipeline(cullPipeline.pipeline);
+        device.destroyPipelineLayout(cullPipeline.layout);
+        device.destroyDescriptorSetLayout(cullPipeline.descriptorSetLayout);
+    }
+
     CleanupVKSwapchain();
 
     delete meshes;
+    delete indexedTextures;
 
     device.destroy();
 
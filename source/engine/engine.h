@@ -3,6 +3,7 @@
 #include <DEngine.h>
 #include "../core/window.h"
 #include "scene.h"
+#include "indexedTextures.h"
 
 #include "../meshes/vertexMenagerie.h"
 #include "../meshes/triangle.h"
@@ -34,6 +35,20 @@ struct GraphicsPipelineBundle
     vk::Pipeline pipeline;
 };
 
+struct ComputePipelineBundle
+{
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::PipelineLayout layout;
+    vk::Pipeline pipeline;
+};
+
+// per frame in flight resources of the meshlet culling path
+struct ClusterFrame
+{
+    DEUtil::Buffer indirectBuffer;
+    vk::DescriptorSet descriptorSet;
+};
+
 struct CommandBufferIn
 {
     vk::Device device;
@@ -66,8 +81,15 @@ class Engine
     // present (swapchain)
     SwapChainBundle swapchain;
 
-    // pipeline
+    // pipeline, the indexed variant shares its layout and render pass (created, not bound yet)
     GraphicsPipelineBundle pipeline;
+    GraphicsPipelineBundle indexedPipeline;
+
+    // meshlet culling (compute + indirect draws)
+    ComputePipelineBundle cullPipeline;
+    vk::DescriptorPool descriptorPool{nullptr};
+    std::vector<ClusterFrame> clusterFrames;
+    bool multiDrawIndirect;
 
     // commands
     vk::CommandPool commandPool;
@@ -75,9 +97,16 @@ class Engine
 
     // synchronization
     i32 maxFramesInFlight, frameNum;
+    f64 lastSubmitTime; // window time right after the last frame was submitted
 
     // asset ptrs
     VertexMenagerie *meshes;
+    IndexedTextures *indexedTextures;
+    MeshHandle triangleMesh;
+    MeshHandle polygonMesh;
+
+    // per frame lod of every Scene::polyPos instance
+    std::vector<u32> instanceLODs;
 
     private:
     //_____ VK SPECIFIC _____
@@ -95,6 +124,7 @@ class Engine
 
     // pipeline
     void MakeVKGraphicsPipeline();
+    void MakeVKCullPipeline();
 
     // finalizing initialization
     void InitializeVKDrawing();
@@ -104,9 +134,13 @@ class Engine
     // assets
     void MakeAssets();
     void PrepareScene(vk::CommandBuffer buff);
+    void MakeVKClusterResources();
 
     // commands
     void RecordVKDrawCommands(vk::CommandBuffer commandBuffer, u32 imageIdx, Scene *scene);
+    void SelectInstanceLODs(Scene *scene);
+    void RecordVKCullCommands(vk::CommandBuffer commandBuffer, Scene *scene);
+    void RecordVKClusterDraws(vk::CommandBuffer commandBuffer, Scene *scene);
 
     void CleanupVKSwapchain();
 
@@ -114,7 +148,13 @@ class Engine
     // constructor and destructor
     Engine(i32 width, i32 height, Window *window);
 
+    // blocks until the next frame's resources are free (vsync or the gpu being behind). calling
+    // it before simulating means the input sampled after it is as fresh as it can be.
+    void WaitForFrame();
+
     void Render(Scene *scene);
 
+    inline f64 GetLastSubmitTime() const { return lastSubmitTime; }
+
     ~Engine();
 };
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "indexedTextures.h"
+
+// binding 0: indexed texture, binding 1: palette, binding 2: colormap
+#define INDEXED_BINDING_COUNT 3
+
+IndexedTextures::IndexedTextures(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, u32 maxTextures)
+    : device{logicalDevice}, physicalDevice{physicalDevice}, maxTextures{maxTextures}
+{
+    // integer formats can't be filtered, texelFetch doesn't care about the rest
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.magFilter = vk::Filter::eNearest;
+    samplerInfo.minFilter = vk::Filter::eNearest;
+    samplerInfo.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+    samplerInfo.maxLod = 0.0f;
+
+    std::array<vk::DescriptorSetLayoutBinding, INDEXED_BINDING_COUNT> bindings;
+    for(u32 i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = vk::ShaderStageFlagBits::eFragment;
+    }
+
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.flags = vk::DescriptorSetLayoutCreateFlags();
+    layoutInfo.bindingCount = bindings.size();
+    layoutInfo.pBindings = bindings.data();
+
+    vk::DescriptorPoolSize poolSize{};
+    poolSize.type = vk::DescriptorType::eCombinedImageSampler;
+    poolSize.descriptorCount = INDEXED_BINDING_COUNT * maxTextures;
+
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.flags = vk::DescriptorPoolCreateFlags();
+    poolInfo.maxSets = maxTextures;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    try
+    {
+        sampler = device.createSampler(samplerInfo);
+        setLayout = device.createDescriptorSetLayout(layoutInfo);
+        descriptorPool = device.createDescriptorPool(poolInfo);
+    }
+    catch(vk::SystemError err)
+    {
+        LERROR("VULKAN ERROR: couldn't create indexed texture descriptors.\n\t" << err.what() << "\n");
+    }
+}
+
+DEUtil::ImageInput IndexedTextures::MakeImageInput(u32 width, u32 height, vk::Format format) const
+{
+    DEUtil::ImageInput imageIn;
+    imageIn.width          = width;
+    imageIn.height         = height;
+    imageIn.format         = format;
+    imageIn.logicalDevice  = device;
+    imageIn.physicalDevice = physicalDevice;
+    return imageIn;
+}
+
+void IndexedTextures::Finalize(vk::CommandPool commandPool, vk::Queue queue)
+{
+    this->commandPool = commandPool;
+    this->queue = queue;
+
+    palette = DEUtil::CreateImage(MakeImageInput(256, 1, vk::Format::eR8G8B8A8Unorm));
+    colormap = DEUtil::CreateImage(MakeImageInput(256, INDEXED_COLORMAP_COUNT, vk::Format::eR8Uint));
+
+    // greyscale ramp and every colormap the identity, until a real palette is loaded
+    u8 playpal[256 * 3];
+    std::vector<u8> colormaps(256 * INDEXED_COLORMAP_COUNT);
+    for(u32 i = 0; i < 256; i++)
+    {
+        playpal[i * 3 + 0] = (u8)i;
+        playpal[i * 3 + 1] = (u8)i;
+        playpal[i * 3 + 2] = (u8)i;
+
+        for(u32 table = 0; table < INDEXED_COLORMAP_COUNT; table++)
+            colormaps[table * 256 + i] = (u8)i;
+    }
+    SetPalette(playpal, colormaps.data());
+
+    u8 nullTexel = 0;
+    AddTexture(1, 1, &nullTexel);
+}
+
+void IndexedTextures::SetPalette(const u8 *playpal, const u8 *colormaps)
+{
+    u32 rgba[256];
+    for(u32 i = 0; i < 256; i++)
+        rgba[i] = playpal[i * 3] | (playpal[i * 3 + 1] << 8) | (playpal[i * 3 + 2] << 16) | (0xffu << 24);
+
+    DEUtil::UploadImage(palette, MakeImageInput(256, 1, vk::Format::eR8G8B8A8Unorm), commandPool, queue, rgba,
+                        sizeof(rgba));
+    DEUtil::UploadImage(colormap, MakeImageInput(256, INDEXED_COLORMAP_COUNT, vk::Format::eR8Uint), commandPool,
+                        queue, colormaps, 256 * INDEXED_COLORMAP_COUNT);
+}
+
+bool IndexedTextures::LoadPalette(const DEUtil::WadArchive &archive)
+{
+    DEUtil::LumpView playpal = archive.GetLump("PLAYPAL");
+    if(!playpal.data || playpal.size < 256 * 3)
+    {
+        LERROR("indexed textures: no PLAYPAL lump.\n");
+        return false;
+    }
+
+    DEUtil::LumpView colormaps = archive.GetLump("COLORMAP");
+    if(!colormaps.data || colormaps.size < 256 * INDEXED_COLORMAP_COUNT)
+    {
+        LERROR("indexed textures: no COLORMAP lump.\n");
+        return false;
+    }
+
+    SetPalette(playpal.data, colormaps.data);
+    return true;
+}
+
+i32 IndexedTextures::AddTexture(u32 width, u32 height, const u8 *indices)
+{
+    if(textures.size() >= maxTextures)
+    {
+        LERROR("indexed textures: all " << maxTextures << " textures are in use.\n");
+        return -1;
+    }
+
+    DEUtil::ImageInput imageIn = MakeImageInput(width, height, vk::Format::eR8Uint);
+    DEUtil::Image texture = DEUtil::CreateImage(imageIn);
+    DEUtil::UploadImage(texture, imageIn, commandPool, queue, indices, (usize)width * height);
+
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &setLayout;
+    vk::DescriptorSet set = device.allocateDescriptorSets(allocInfo)[0];
+
+    std::array<vk::DescriptorImageInfo, INDEXED_BINDING_COUNT> imageInfos;
+    imageInfos[0].imageView = texture.view;
+    imageInfos[1].imageView = palette.view;
+    imageInfos[2].imageView = colormap.view;
+
+    std::array<vk::WriteDescriptorSet, INDEXED_BINDING_COUNT> writes;
+    for(u32 i = 0; i < writes.size(); i++)
+    {
+        imageInfos[i].sampler = sampler;
+        imageInfos[i].imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+        writes[i].dstSet = set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        writes[i].pImageInfo = &imageInfos[i];
+    }
+    device.updateDescriptorSets(writes, nullptr);
+
+    textures.push_back(texture);
+    descriptorSets.push_back(set);
+    return (i32)textures.size() - 1;
+}
+
+IndexedTextures::~IndexedTextures()
+{
+    for(DEUtil::Image &texture : textures)
+        DEUtil::DestroyImage(device, texture);
+
+    if(palette.image)
+    {
+        DEUtil::DestroyImage(device, palette);
+        DEUtil::DestroyImage(device, colormap);
+    }
+
+    // frees every set
+    device.destroyDescriptorPool(descriptorPool);
+    device.destroyDescriptorSetLayout(setLayout);
+    device.destroySampler(sampler);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <DEngine.h>
+#include "memory.h"
+#include "../wad/wad.h"
+
+// COLORMAP's 32 light levels, the invulnerability map and an all black one
+#define INDEXED_COLORMAP_COUNT 34
+
+// 1x1 texture that's bound while nothing indexed is drawn, the set is part of every graphics pipeline
+#define INDEXED_TEXTURE_NULL 0
+
+// 8 bit palette indexed textures, shaded in basic.frag's INDEXED variant through a PLAYPAL
+// and a COLORMAP lookup texture (sector light and distance pick the colormap row).
+// a texel is 1 byte on the gpu instead of 4 for an rgba8 expansion.
+class IndexedTextures
+{
+    private:
+    vk::Device device;
+    vk::PhysicalDevice physicalDevice;
+    vk::CommandPool commandPool;
+    vk::Queue queue;
+
+    vk::Sampler sampler;
+    vk::DescriptorSetLayout setLayout;
+    vk::DescriptorPool descriptorPool;
+    u32 maxTextures;
+
+    DEUtil::Image palette;  // 256x1 rgba8
+    DEUtil::Image colormap; // 256xINDEXED_COLORMAP_COUNT r8 uint, a row per colormap
+
+    // r8 uint, each with a descriptor set that also holds the palette and colormap
+    std::vector<DEUtil::Image> textures;
+    std::vector<vk::DescriptorSet> descriptorSets;
+
+    private:
+    DEUtil::ImageInput MakeImageInput(u32 width, u32 height, vk::Format format) const;
+
+    public:
+    IndexedTextures(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, u32 maxTextures);
+
+    // creates the lookup textures (greyscale, unlit) and INDEXED_TEXTURE_NULL,
+    // later uploads go through commandPool and queue.
+    void Finalize(vk::CommandPool commandPool, vk::Queue queue);
+
+    // playpal is 256 rgb triplets, colormaps 256 * INDEXED_COLORMAP_COUNT bytes.
+    // textures keep their descriptor sets, the gpu just can't be using them.
+    void SetPalette(const u8 *playpal, const u8 *colormaps);
+
+    // SetPalette() with PLAYPAL's first palette and COLORMAP.
+    bool LoadPalette(const DEUtil::WadArchive &archive);
+
+    // row major palette indices. returns the texture's index, or -1 once maxTextures are in use.
+    i32 AddTexture(u32 width, u32 height, const u8 *indices);
+
+    inline vk::DescriptorSetLayout GetSetLayout() const { return setLayout; }
+    inline vk::DescriptorSet GetDescriptorSet(u32 texture) const { return descriptorSets[texture]; }
+    inline u32 GetTextureCount() const { return (u32)textures.size(); }
+
+    ~IndexedTextures();
+};
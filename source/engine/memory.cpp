@@ -51,4 +51,144 @@ DEUtil::Buffer DEUtil::CreateBuffer(BufferInput buffIn)
     AllocateBufferMemory(buffer, buffIn);
 
     return buffer;
-}
\ No newline at end of file
+}
+
+DEUtil::Image DEUtil::CreateImage(const ImageInput &imageIn)
+{
+    vk::ImageCreateInfo imageInfo{};
+    imageInfo.flags = vk::ImageCreateFlags();
+    imageInfo.imageType = vk::ImageType::e2D;
+    imageInfo.format = imageIn.format;
+    imageInfo.extent = vk::Extent3D(imageIn.width, imageIn.height, 1);
+    imageInfo.mipLevels = imageIn.mipLevels;
+    imageInfo.arrayLayers = imageIn.layers;
+    imageInfo.samples = vk::SampleCountFlagBits::e1;
+    imageInfo.tiling = vk::ImageTiling::eOptimal;
+    imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+    imageInfo.sharingMode = vk::SharingMode::eExclusive;
+    imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+    Image image;
+    image.image = imageIn.logicalDevice.createImage(imageInfo);
+
+    vk::MemoryRequirements memReq = imageIn.logicalDevice.getImageMemoryRequirements(image.image);
+
+    vk::MemoryAllocateInfo allocInfo;
+    allocInfo.allocationSize = memReq.size;
+    allocInfo.memoryTypeIndex = FindMemoryTypeIndex(imageIn.physicalDevice, memReq.memoryTypeBits,
+                                                    vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    image.memory = imageIn.logicalDevice.allocateMemory(allocInfo);
+    imageIn.logicalDevice.bindImageMemory(image.image, image.memory, 0);
+
+    vk::ImageViewCreateInfo viewInfo{};
+    viewInfo.image = image.image;
+    viewInfo.viewType = imageIn.layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D;
+    viewInfo.format = imageIn.format;
+    viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = imageIn.mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = imageIn.layers;
+    image.view = imageIn.logicalDevice.createImageView(viewInfo);
+
+    return image;
+}
+
+// texels of every mip and layer, to get the texel size out of an upload's byte size
+static usize MipChainTexels(const DEUtil::ImageInput &imageIn)
+{
+    usize texels = 0;
+    for(u32 mip = 0; mip < imageIn.mipLevels; mip++)
+        texels += (usize)std::max(imageIn.width >> mip, 1u) * std::max(imageIn.height >> mip, 1u) * imageIn.layers;
+
+    return texels;
+}
+
+void DEUtil::UploadImage(Image &image, const ImageInput &imageIn, vk::CommandPool commandPool, vk::Queue queue,
+                         const void *data, usize size)
+{
+    vk::Device device = imageIn.logicalDevice;
+
+    BufferInput buffIn;
+    buffIn.logicalDevice  = device;
+    buffIn.physicalDevice = imageIn.physicalDevice;
+    buffIn.size           = size;
+    buffIn.usage          = vk::BufferUsageFlagBits::eTransferSrc;
+
+    Buffer staging = CreateBuffer(buffIn);
+
+    void *memLoc = device.mapMemory(staging.memory, 0, size);
+    memcpy(memLoc, data, size);
+    device.unmapMemory(staging.memory);
+
+    vk::CommandBufferAllocateInfo allocInfo{};
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocInfo.commandBufferCount = 1;
+    vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(allocInfo)[0];
+
+    vk::CommandBufferBeginInfo beginInfo{};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    commandBuffer.begin(beginInfo);
+
+    vk::ImageMemoryBarrier barrier{};
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.image;
+    barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, imageIn.mipLevels, 0,
+                                                         imageIn.layers);
+
+    // previous contents (a re-upload) are discarded
+    barrier.oldLayout = vk::ImageLayout::eUndefined;
+    barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.srcAccessMask = vk::AccessFlags();
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlags(), nullptr, nullptr, barrier);
+
+    // a mip's layers are consecutive, so one region per mip
+    std::vector<vk::BufferImageCopy> regions(imageIn.mipLevels);
+    usize texelSize = size / MipChainTexels(imageIn);
+    vk::DeviceSize offset = 0;
+    for(u32 mip = 0; mip < imageIn.mipLevels; mip++)
+    {
+        u32 mipWidth = std::max(imageIn.width >> mip, 1u), mipHeight = std::max(imageIn.height >> mip, 1u);
+
+        regions[mip].bufferOffset = offset;
+        regions[mip].bufferRowLength = 0; // tightly packed
+        regions[mip].bufferImageHeight = 0;
+        regions[mip].imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, mip, 0, imageIn.layers);
+        regions[mip].imageExtent = vk::Extent3D(mipWidth, mipHeight, 1);
+
+        offset += (vk::DeviceSize)mipWidth * mipHeight * imageIn.layers * texelSize;
+    }
+    commandBuffer.copyBufferToImage(staging.buffer, image.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+                                  vk::DependencyFlags(), nullptr, nullptr, barrier);
+
+    commandBuffer.end();
+
+    vk::SubmitInfo submitInfo{};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    queue.submit(submitInfo, nullptr);
+    queue.waitIdle();
+
+    device.freeCommandBuffers(commandPool, commandBuffer);
+    device.destroyBuffer(staging.buffer);
+    device.freeMemory(staging.memory);
+}
+
+void DEUtil::DestroyImage(vk::Device logicalDevice, Image &image)
+{
+    logicalDevice.destroyImageView(image.view);
+    logicalDevice.destroyImage(image.image);
+    logicalDevice.freeMemory(image.memory);
+    image = Image{};
+}
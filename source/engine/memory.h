@@ -25,4 +25,31 @@ void AllocateBufferMemory(Buffer &buff, const BufferInput &buffIn);
 
 Buffer CreateBuffer(BufferInput buffIn);
 
+struct ImageInput
+{
+    u32 width, height;
+    u32 layers = 1;    // a 2d array image if more than 1
+    u32 mipLevels = 1;
+    vk::Format format;
+    vk::Device logicalDevice;
+    vk::PhysicalDevice physicalDevice;
+};
+
+// sampled 2d image in device local memory, with a view of the whole image
+struct Image
+{
+    vk::Image image;
+    vk::DeviceMemory memory;
+    vk::ImageView view;
+};
+
+Image CreateImage(const ImageInput &imageIn);
+
+// copies tightly packed rows into the image through a staging buffer and leaves it
+// shader readable. data holds mip 0 of every layer back to back, then mip 1 and so on. blocks until the copy is done, so it's meant for load time.
+void UploadImage(Image &image, const ImageInput &imageIn, vk::CommandPool commandPool, vk::Queue queue,
+                 const void *data, usize size);
+
+void DestroyImage(vk::Device logicalDevice, Image &image);
+
 } // namespace DEUtil
\ No newline at end of file
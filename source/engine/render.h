@@ -9,4 +9,15 @@ struct ObjectData
     glm::mat4 model;
 };
 
-} // namespace DEUtil
\ No newline at end of file
+// push constants for res/shaders/cull.comp
+struct CullData
+{
+    glm::mat4 clip;      // projection * view * model
+    glm::vec4 cameraPos; // in object space
+    u32 firstMeshlet;
+    u32 meshletCount;
+    i32 vertexOffset;
+    u32 drawOffset; // first indirect command written by this dispatch
+};
+
+} // namespace DEUtil
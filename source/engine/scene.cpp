@@ -1,6 +1,11 @@
 #include "scene.h"
 
-Scene::Scene()
+#include "../game/ticcmd.h"
+
+// seconds per bob of the discs
+#define SCENE_BOB_PERIOD 2.0f
+
+Scene::Scene() : viewProj{1.0f}, cameraPos{0.0f, 0.0f, -1.0f}, tic{0}
 {
     for(f32 x = -1.0f; x < 1.0f; x += 0.2f)
     {
@@ -9,6 +14,34 @@ Scene::Scene()
             triPos.push_back(glm::vec3(x, y, 0.0f));
         }
     }
+
+    for(f32 x = -0.75f; x < 1.0f; x += 0.5f)
+    {
+        polyPos.push_back(glm::vec3(x, 0.5f, 0.0f));
+    }
+
+    polyPrevPos = polyPos;
+    polyTicPos = polyPos;
+}
+
+void Scene::Tick()
+{
+    tic++;
+    polyPrevPos = polyTicPos;
+
+    // a function of the tic count only, so it's the same at any frame rate
+    f32 seconds = (f32)tic / TICRATE;
+    for(usize i = 0; i < polyTicPos.size(); i++)
+    {
+        f32 phase = glm::radians(360.0f) * seconds / SCENE_BOB_PERIOD + i;
+        polyTicPos[i].y = 0.5f + 0.1f * std::sin(phase);
+    }
+}
+
+void Scene::Interpolate(f32 alpha)
+{
+    for(usize i = 0; i < polyPos.size(); i++)
+        polyPos[i] = glm::mix(polyPrevPos[i], polyTicPos[i], alpha);
 }
 
 Scene::~Scene() {}
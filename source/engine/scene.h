@@ -7,8 +7,24 @@ class Scene
     private:
     public:
     std::vector<glm::vec3> triPos;
+    std::vector<glm::vec3> polyPos; // drawn through the meshlet culling path
+
+    // polyPos of the last two tics, polyPos itself is what gets drawn (interpolated between them)
+    std::vector<glm::vec3> polyPrevPos, polyTicPos;
+    u64 tic;
+
+    // camera (identity renders vertex positions straight to clip space)
+    glm::mat4 viewProj;
+    glm::vec3 cameraPos;
 
     public:
     Scene();
+
+    // advances the simulation one fixed tic
+    void Tick();
+
+    // render state alpha of the way from the previous tic to the latest one
+    void Interpolate(f32 alpha);
+
     ~Scene();
 };
@@ -0,0 +1,190 @@
+#include "demo.h"
+#include "../core/logger.h"
+#include "../core/mappedFile.h"
+
+#include <cstdio>
+#include <fstream>
+
+bool DEUtil::ParseDemo(const u8 *data, u32 size, Demo &out)
+{
+    out = Demo{};
+    if(size < 1)
+    {
+        LERROR("demo is empty.\n");
+        return false;
+    }
+
+    u32 offset = 0;
+    if(data[0] <= DEMO_OLD_MAX_SKILL)
+    {
+        if(size < 7)
+        {
+            LERROR("demo header is truncated.\n");
+            return false;
+        }
+
+        out.version = 0;
+        out.skill = data[0];
+        out.episode = data[1];
+        out.map = data[2];
+        for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+            out.playerInGame[i] = data[3 + i] != 0;
+        offset = 7;
+    }
+    else if(data[0] == DEMO_VERSION_19 || data[0] == DEMO_VERSION_LONGTICS)
+    {
+        if(size < 13)
+        {
+            LERROR("demo header is truncated.\n");
+            return false;
+        }
+
+        out.version = data[0];
+        out.skill = data[1];
+        out.episode = data[2];
+        out.map = data[3];
+        out.deathmatch = data[4] != 0;
+        out.respawn = data[5] != 0;
+        out.fast = data[6] != 0;
+        out.noMonsters = data[7] != 0;
+        out.consolePlayer = data[8];
+        for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+            out.playerInGame[i] = data[9 + i] != 0;
+        offset = 13;
+    }
+    else
+    {
+        LERROR("demo version " << (u32)data[0] << " isn't supported.\n");
+        return false;
+    }
+
+    if(out.consolePlayer >= SIM_MAX_PLAYERS || !out.playerInGame[out.consolePlayer])
+    {
+        LERROR("demo's console player " << (u32)out.consolePlayer << " isn't in the game.\n");
+        return false;
+    }
+
+    u32 cmdSize = out.version == DEMO_VERSION_LONGTICS ? 5 : 4;
+    while(offset < size && data[offset] != DEMO_MARKER)
+    {
+        TicCmd tic[SIM_MAX_PLAYERS] = {};
+        bool complete = true;
+        for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+        {
+            if(!out.playerInGame[i])
+                continue;
+
+            if(offset + cmdSize > size)
+            {
+                complete = false;
+                break;
+            }
+
+            const u8 *cmd = data + offset;
+            tic[i].forwardMove = (i8)cmd[0];
+            tic[i].sideMove = (i8)cmd[1];
+            if(cmdSize == 5)
+            {
+                tic[i].angleTurn = (i16)(cmd[2] | (cmd[3] << 8));
+                tic[i].buttons = cmd[4];
+            }
+            else
+            {
+                tic[i].angleTurn = (i16)(cmd[2] << 8);
+                tic[i].buttons = cmd[3];
+            }
+            offset += cmdSize;
+        }
+
+        if(!complete)
+        {
+            LWARN(false, "demo ends mid tic, its last tic is dropped.\n");
+            break;
+        }
+
+        out.cmds.insert(out.cmds.end(), tic, tic + SIM_MAX_PLAYERS);
+    }
+
+    return true;
+}
+
+bool DEUtil::LoadDemo(const char *filepath, const WadArchive &archive, Demo &out)
+{
+    if(std::ifstream(filepath).good())
+    {
+        MappedFile file;
+        if(!file.Open(filepath))
+            return false;
+
+        return ParseDemo(file.GetData(), (u32)file.GetSize(), out);
+    }
+
+    LumpView lump = archive.GetLump(filepath);
+    if(!lump.data)
+    {
+        LERROR("demo " << filepath << " is neither a file nor a lump.\n");
+        return false;
+    }
+
+    return ParseDemo(lump.data, lump.size, out);
+}
+
+void DEUtil::WriteDemo(const Demo &demo, std::vector<u8> &out)
+{
+    u8 version = demo.version == DEMO_VERSION_LONGTICS ? DEMO_VERSION_LONGTICS : DEMO_VERSION_19;
+
+    out.clear();
+    out.insert(out.end(), {version, demo.skill, demo.episode, demo.map, (u8)demo.deathmatch, (u8)demo.respawn,
+                           (u8)demo.fast, (u8)demo.noMonsters, demo.consolePlayer});
+    for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+        out.push_back((u8)demo.playerInGame[i]);
+
+    for(u32 tic = 0; tic < demo.GetTicCount(); tic++)
+    {
+        for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+        {
+            if(!demo.playerInGame[i])
+                continue;
+
+            const TicCmd &cmd = demo.GetTic(tic)[i];
+            out.push_back((u8)cmd.forwardMove);
+            out.push_back((u8)cmd.sideMove);
+            if(version == DEMO_VERSION_LONGTICS)
+            {
+                out.push_back((u8)cmd.angleTurn);
+                out.push_back((u8)(cmd.angleTurn >> 8));
+            }
+            else
+            {
+                // vanilla rounds the turn to its high byte when recording
+                out.push_back((u8)((cmd.angleTurn + 128) >> 8));
+            }
+            out.push_back(cmd.buttons);
+        }
+    }
+
+    out.push_back(DEMO_MARKER);
+}
+
+std::string DEUtil::GetDemoMapName(const Demo &demo, const WadArchive &archive)
+{
+    char name[WAD_NAME_LENGTH + 1];
+    if(archive.FindLump("MAP01") >= 0)
+        snprintf(name, sizeof(name), "MAP%02u", (u32)demo.map);
+    else
+        snprintf(name, sizeof(name), "E%uM%u", (u32)demo.episode, (u32)demo.map);
+
+    return name;
+}
+
+u32 DEUtil::GetDemoPlayerMask(const Demo &demo)
+{
+    u32 mask = 0;
+    for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+    {
+        if(demo.playerInGame[i])
+            mask |= BIT(i);
+    }
+
+    return mask;
+}
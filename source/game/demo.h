@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../wad/wad.h"
+#include "ticcmd.h"
+
+#include <string>
+#include <vector>
+
+// ---------------------- DEMO LUMPS ----------------------
+//
+// v1.9: u8 version (109), skill, episode, map, deathmatch, respawn, fast, noMonsters,
+// consolePlayer, playerInGame[4], then per tic and per player in game:
+// i8 forwardMove, i8 sideMove, u8 angleTurn (its high byte), u8 buttons. 0x80 ends it.
+// longtics demos (111) store the whole i16 angleTurn, low byte first.
+// v1.2 and older start with the skill (0..4): skill, episode, map, playerInGame[4].
+
+#define DEMO_MARKER           0x80
+#define DEMO_VERSION_19       109
+#define DEMO_VERSION_LONGTICS 111
+#define DEMO_OLD_MAX_SKILL    4
+
+namespace DEUtil {
+
+struct Demo
+{
+    u8 version;
+    u8 skill, episode, map;
+    bool deathmatch, respawn, fast, noMonsters;
+    u8 consolePlayer;
+    bool playerInGame[SIM_MAX_PLAYERS];
+
+    // SIM_MAX_PLAYERS per tic, zeros for players that aren't in the game
+    std::vector<TicCmd> cmds;
+
+    inline u32 GetTicCount() const { return (u32)(cmds.size() / SIM_MAX_PLAYERS); }
+    inline const TicCmd *GetTic(u32 tic) const { return cmds.data() + (usize)tic * SIM_MAX_PLAYERS; }
+};
+
+// returns false (and logs) on an unknown version or a truncated header. a demo that's
+// cut off mid tic (a crashed recording) keeps its whole tics.
+bool ParseDemo(const u8 *data, u32 size, Demo &out);
+
+// a .lmp file, or a lump of the archive (DEMO1, ...) if filepath isn't a file.
+bool LoadDemo(const char *filepath, const WadArchive &archive, Demo &out);
+
+// v1.9 (or longtics if the version says so), with the end marker.
+void WriteDemo(const Demo &demo, std::vector<u8> &out);
+
+// MAPxx if the archive has MAP01 (doom 2), ExMy otherwise
+std::string GetDemoMapName(const Demo &demo, const WadArchive &archive);
+
+// bit per player in the game, for GameSim::Start()
+u32 GetDemoPlayerMask(const Demo &demo);
+
+} // namespace DEUtil
@@ -0,0 +1,28 @@
+#include "fixed.h"
+
+#include <cmath>
+#include <vector>
+
+// vanilla ships finesine as a table, this one is built once from sin(). the values are
+// rounded to fixed point, so libm's last bit doesn't leak into the simulation.
+static const std::vector<i32> &GetSineTable()
+{
+    static const std::vector<i32> table = []() {
+        std::vector<i32> sines(FINEANGLES);
+        for(u32 i = 0; i < FINEANGLES; i++)
+            sines[i] = (i32)std::lround(std::sin((i + 0.5) * (6.283185307179586 / FINEANGLES)) * FRACUNIT);
+        return sines;
+    }();
+
+    return table;
+}
+
+i32 DEUtil::FineSine(u32 fineAngle)
+{
+    return GetSineTable()[fineAngle & FINEMASK];
+}
+
+i32 DEUtil::FineCosine(u32 fineAngle)
+{
+    return GetSineTable()[(fineAngle + FINEANGLES / 4) & FINEMASK];
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../core/defines.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+// ---------------------- FIXED POINT ----------------------
+//
+// the simulation runs on vanilla's 16.16 fixed point and 32 bit binary angles (BAM),
+// so a tic gives the same bits on every compiler and cpu, floats only go to the renderer.
+
+#define FRACBITS 16
+#define FRACUNIT (1 << FRACBITS)
+
+// 0 is east, counter-clockwise, wraps at 2^32
+#define ANG45  0x20000000u
+#define ANG90  0x40000000u
+#define ANG180 0x80000000u
+#define ANG270 0xc0000000u
+
+#define FINEANGLES        8192
+#define FINEMASK          (FINEANGLES - 1)
+#define ANGLETOFINESHIFT  19
+
+namespace DEUtil {
+
+inline i32 FixedMul(i32 a, i32 b)
+{
+    return (i32)(((i64)a * b) >> FRACBITS);
+}
+
+inline i32 FixedDiv(i32 a, i32 b)
+{
+    // saturates like vanilla instead of overflowing. abs in 64 bits, INT32_MIN has no 32 bit one
+    if((std::llabs((i64)a) >> 14) >= std::llabs((i64)b))
+        return (a ^ b) < 0 ? INT32_MIN : INT32_MAX;
+
+    return (i32)(((i64)a << FRACBITS) / b);
+}
+
+inline f32 FixedToFloat(i32 value)
+{
+    return value / (f32)FRACUNIT;
+}
+
+inline f32 AngleToRadians(u32 angle)
+{
+    return (f32)(angle * (6.283185307179586 / 4294967296.0));
+}
+
+// sine/cosine of a fine angle (angle >> ANGLETOFINESHIFT) in fixed point
+i32 FineSine(u32 fineAngle);
+i32 FineCosine(u32 fineAngle);
+
+} // namespace DEUtil
@@ -0,0 +1,289 @@
+#include "gameSim.h"
+#include "../core/logger.h"
+
+#include <algorithm>
+
+// which side of the line (v1 -> v2 as dx, dy) the point is on, 0 front (right), 1 back.
+// map coordinates are whole units, so the products fit 64 bits exactly.
+static inline u32 PointOnSide(i32 x, i32 y, i32 lineX, i32 lineY, i32 lineDX, i32 lineDY)
+{
+    i64 dx = (i64)x - ((i64)lineX << FRACBITS);
+    i64 dy = (i64)y - ((i64)lineY << FRACBITS);
+
+    i64 left = lineDY * dx;
+    i64 right = dy * lineDX;
+
+    return right < left ? 0 : 1;
+}
+
+DEUtil::GameSim::GameSim() : map{nullptr}, tic{0}, checkFloor{0}, checkCeiling{0}
+{
+    for(SimPlayer &player : players)
+        player = SimPlayer{};
+}
+
+u16 DEUtil::GameSim::SectorAt(i32 x, i32 y) const
+{
+    if(map->nodes.empty())
+        return GetSubsectorSector(*map, 0);
+
+    u16 child = (u16)(map->nodes.size() - 1);
+    while(!(child & NF_SUBSECTOR))
+    {
+        const MapNode &node = map->nodes[child];
+        child = node.children[PointOnSide(x, y, node.x, node.y, node.dx, node.dy)];
+    }
+
+    return GetSubsectorSector(*map, child & ~NF_SUBSECTOR);
+}
+
+bool DEUtil::GameSim::Start(const MapData &map, u32 playerMask)
+{
+    this->map = &map;
+    blockmap.Build(map);
+    tic = 0;
+
+    for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+    {
+        SimPlayer &player = players[i];
+        player = SimPlayer{};
+        if(!(playerMask & BIT(i)))
+            continue;
+
+        const MapThing *start = nullptr;
+        for(const MapThing &thing : map.things)
+        {
+            if(thing.type == THING_PLAYER1_START + (i16)i)
+                start = &thing;
+        }
+
+        if(!start)
+        {
+            LERROR("sim: the map has no start for player " << i + 1 << ".\n");
+            return false;
+        }
+
+        player.active = true;
+        player.x = start->x << FRACBITS;
+        player.y = start->y << FRACBITS;
+        player.angle = (u32)(ANG45 * (start->angle / 45));
+        player.sector = SectorAt(player.x, player.y);
+        player.z = map.sectors[player.sector].floorHeight << FRACBITS;
+        player.viewZ = player.z + SIM_VIEW_HEIGHT;
+    }
+
+    return true;
+}
+
+bool DEUtil::GameSim::CheckPosition(i32 x, i32 y)
+{
+    u16 sector = SectorAt(x, y);
+    checkFloor = map->sectors[sector].floorHeight << FRACBITS;
+    checkCeiling = map->sectors[sector].ceilingHeight << FRACBITS;
+
+    i32 boxLeft = x - SIM_PLAYER_RADIUS, boxRight = x + SIM_PLAYER_RADIUS;
+    i32 boxBottom = y - SIM_PLAYER_RADIUS, boxTop = y + SIM_PLAYER_RADIUS;
+
+    // the blockmap only narrows things down, a unit of slack keeps float rounding out of it
+    glm::vec2 boxMin = glm::vec2(FixedToFloat(boxLeft) - 1.0f, FixedToFloat(boxBottom) - 1.0f);
+    glm::vec2 boxMax = glm::vec2(FixedToFloat(boxRight) + 1.0f, FixedToFloat(boxTop) + 1.0f);
+    blockmap.LinesInBox(*map, boxMin, boxMax, query);
+
+    for(u16 lineIdx : query.lines)
+    {
+        const MapLinedef &line = map->linedefs[lineIdx];
+        const MapVertex &v1 = map->vertices[line.v1];
+        const MapVertex &v2 = map->vertices[line.v2];
+
+        // bounding boxes first, then whether the box straddles the line
+        if(boxRight <= (std::min(v1.x, v2.x) << FRACBITS) || boxLeft >= (std::max(v1.x, v2.x) << FRACBITS) ||
+           boxTop <= (std::min(v1.y, v2.y) << FRACBITS) || boxBottom >= (std::max(v1.y, v2.y) << FRACBITS))
+            continue;
+
+        i32 dx = v2.x - v1.x, dy = v2.y - v1.y;
+        u32 sides = PointOnSide(boxLeft, boxTop, v1.x, v1.y, dx, dy) + PointOnSide(boxRight, boxTop, v1.x, v1.y, dx, dy) +
+                    PointOnSide(boxLeft, boxBottom, v1.x, v1.y, dx, dy) +
+                    PointOnSide(boxRight, boxBottom, v1.x, v1.y, dx, dy);
+        if(sides == 0 || sides == 4)
+            continue;
+
+        if(line.sides[1] == MAP_NO_SIDEDEF || (line.flags & ML_BLOCKING))
+            return false;
+
+        // the opening between the two sectors limits where the player can stand
+        const MapSector &front = map->sectors[map->sidedefs[line.sides[0]].sector];
+        const MapSector &back = map->sectors[map->sidedefs[line.sides[1]].sector];
+        checkFloor = std::max(checkFloor, std::max(front.floorHeight, back.floorHeight) << FRACBITS);
+        checkCeiling = std::min(checkCeiling, std::min(front.ceilingHeight, back.ceilingHeight) << FRACBITS);
+    }
+
+    return true;
+}
+
+bool DEUtil::GameSim::TryMove(SimPlayer &player, i32 x, i32 y)
+{
+    if(!CheckPosition(x, y))
+        return false;
+
+    // doesn't fit, would hit its head or the step is too high
+    if(checkCeiling - checkFloor < SIM_PLAYER_HEIGHT || checkCeiling - player.z < SIM_PLAYER_HEIGHT ||
+       checkFloor - player.z > SIM_MAX_STEP)
+        return false;
+
+    player.x = x;
+    player.y = y;
+    player.sector = SectorAt(x, y);
+
+    // steps up at once, falls down with gravity
+    player.z = std::max(player.z, checkFloor);
+    return true;
+}
+
+void DEUtil::GameSim::MovePlayer(SimPlayer &player, const TicCmd &cmd)
+{
+    player.angle += (u32)cmd.angleTurn << 16;
+
+    // no air control
+    i32 floorZ = map->sectors[player.sector].floorHeight << FRACBITS;
+    if(player.z > floorZ)
+        return;
+
+    u32 fine = player.angle >> ANGLETOFINESHIFT;
+    if(cmd.forwardMove)
+    {
+        i32 thrust = cmd.forwardMove * 2048;
+        player.momX += FixedMul(thrust, FineCosine(fine));
+        player.momY += FixedMul(thrust, FineSine(fine));
+    }
+
+    if(cmd.sideMove)
+    {
+        u32 side = (player.angle - ANG90) >> ANGLETOFINESHIFT;
+        i32 thrust = cmd.sideMove * 2048;
+        player.momX += FixedMul(thrust, FineCosine(side));
+        player.momY += FixedMul(thrust, FineSine(side));
+    }
+}
+
+void DEUtil::GameSim::XYMovement(SimPlayer &player, const TicCmd &cmd)
+{
+    player.momX = std::clamp(player.momX, -SIM_MAX_MOVE, SIM_MAX_MOVE);
+    player.momY = std::clamp(player.momY, -SIM_MAX_MOVE, SIM_MAX_MOVE);
+
+    // big moves go in halves so they can't skip over thin lines
+    i32 moveX = player.momX, moveY = player.momY;
+    while(moveX || moveY)
+    {
+        i32 stepX = moveX, stepY = moveY;
+        if(stepX > SIM_MAX_MOVE / 2 || stepY > SIM_MAX_MOVE / 2 || stepX < -SIM_MAX_MOVE / 2 ||
+           stepY < -SIM_MAX_MOVE / 2)
+        {
+            stepX >>= 1;
+            stepY >>= 1;
+        }
+        moveX -= stepX;
+        moveY -= stepY;
+
+        if(TryMove(player, player.x + stepX, player.y + stepY))
+            continue;
+
+        // slides along walls one axis at a time, the blocked axis loses its momentum
+        if(stepX && TryMove(player, player.x + stepX, player.y))
+        {
+            player.momY = 0;
+            moveY = 0;
+        }
+        else if(stepY && TryMove(player, player.x, player.y + stepY))
+        {
+            player.momX = 0;
+            moveX = 0;
+        }
+        else
+        {
+            player.momX = 0;
+            player.momY = 0;
+            break;
+        }
+    }
+
+    i32 floorZ = map->sectors[player.sector].floorHeight << FRACBITS;
+    if(player.z > floorZ)
+        return;
+
+    bool idle = cmd.forwardMove == 0 && cmd.sideMove == 0;
+    if(idle && player.momX > -SIM_STOP_SPEED && player.momX < SIM_STOP_SPEED && player.momY > -SIM_STOP_SPEED &&
+       player.momY < SIM_STOP_SPEED)
+    {
+        player.momX = 0;
+        player.momY = 0;
+        return;
+    }
+
+    player.momX = FixedMul(player.momX, SIM_FRICTION);
+    player.momY = FixedMul(player.momY, SIM_FRICTION);
+}
+
+void DEUtil::GameSim::ZMovement(SimPlayer &player)
+{
+    const MapSector &sector = map->sectors[player.sector];
+    i32 floorZ = sector.floorHeight << FRACBITS;
+    i32 ceilingZ = sector.ceilingHeight << FRACBITS;
+
+    player.z += player.momZ;
+    if(player.z <= floorZ)
+    {
+        player.z = floorZ;
+        player.momZ = 0;
+    }
+    else
+    {
+        player.momZ -= SIM_GRAVITY;
+    }
+
+    player.viewZ = std::min(player.z + SIM_VIEW_HEIGHT, ceilingZ - 4 * FRACUNIT);
+}
+
+void DEUtil::GameSim::Tick(const TicCmd *cmds)
+{
+    for(u32 i = 0; i < SIM_MAX_PLAYERS; i++)
+    {
+        SimPlayer &player = players[i];
+        if(!player.active)
+            continue;
+
+        MovePlayer(player, cmds[i]);
+        XYMovement(player, cmds[i]);
+        ZMovement(player);
+    }
+
+    tic++;
+}
+
+u64 DEUtil::GameSim::Hash() const
+{
+    u64 hash = 0xcbf29ce484222325;
+    auto mix = [&hash](u32 value) {
+        for(u32 i = 0; i < 4; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 0x100000001b3;
+        }
+    };
+
+    mix(tic);
+    for(const SimPlayer &player : players)
+    {
+        if(!player.active)
+            continue;
+
+        mix((u32)player.x);
+        mix((u32)player.y);
+        mix((u32)player.z);
+        mix((u32)player.momX);
+        mix((u32)player.momY);
+        mix((u32)player.momZ);
+        mix(player.angle);
+    }
+
+    return hash;
+}
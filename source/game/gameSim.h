@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../wad/mapData.h"
+#include "../wad/blockmap.h"
+#include "fixed.h"
+#include "ticcmd.h"
+
+// vanilla's player constants, fixed point
+#define SIM_PLAYER_RADIUS  (16 * FRACUNIT)
+#define SIM_PLAYER_HEIGHT  (56 * FRACUNIT)
+#define SIM_VIEW_HEIGHT    (41 * FRACUNIT)
+#define SIM_MAX_STEP       (24 * FRACUNIT)
+#define SIM_MAX_MOVE       (30 * FRACUNIT)
+#define SIM_STOP_SPEED     0x1000
+#define SIM_FRICTION       0xe800
+#define SIM_GRAVITY        FRACUNIT
+
+#define THING_PLAYER1_START 1
+
+namespace DEUtil {
+
+struct SimPlayer
+{
+    bool active;
+    i32 x, y, z; // feet
+    i32 momX, momY, momZ;
+    u32 angle;
+    i32 viewZ;
+    u16 sector;
+};
+
+// the deterministic part of the game, advanced a tic at a time from TicCmds.
+// it's vanilla's player movement (thrust, friction, gravity, step and headroom checks
+// against linedefs through the blockmap) on the map's static geometry, there are no
+// monsters or line specials. everything is integer math, so Hash() is a determinism check.
+class GameSim
+{
+    private:
+    const MapData *map;
+    Blockmap blockmap;
+    BlockmapQuery query;
+
+    SimPlayer players[SIM_MAX_PLAYERS];
+    u32 tic;
+
+    // P_CheckPosition's results
+    i32 checkFloor, checkCeiling;
+
+    private:
+    u16 SectorAt(i32 x, i32 y) const;
+    bool CheckPosition(i32 x, i32 y);
+    bool TryMove(SimPlayer &player, i32 x, i32 y);
+    void MovePlayer(SimPlayer &player, const TicCmd &cmd);
+    void XYMovement(SimPlayer &player, const TicCmd &cmd);
+    void ZMovement(SimPlayer &player);
+
+    public:
+    GameSim();
+
+    // spawns a player on each of the map's player starts whose bit is in playerMask.
+    // returns false (and logs) if a player has no start. map has to outlive the sim.
+    bool Start(const MapData &map, u32 playerMask);
+
+    // cmds holds one TicCmd per player, inactive players' are ignored.
+    void Tick(const TicCmd *cmds);
+
+    // fnv-1a of the tic and every active player's state
+    u64 Hash() const;
+
+    inline const SimPlayer &GetPlayer(u32 idx) const { return players[idx]; }
+    inline u32 GetTic() const { return tic; }
+};
+
+} // namespace DEUtil
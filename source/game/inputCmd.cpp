@@ -0,0 +1,102 @@
+#include "inputCmd.h"
+
+#include <algorithm>
+#include <cmath>
+
+// glfw's key codes, so this builds without glfw
+#define KEY_SPACE         32
+#define KEY_A             65
+#define KEY_D             68
+#define KEY_E             69
+#define KEY_S             83
+#define KEY_W             87
+#define KEY_RIGHT         262
+#define KEY_LEFT          263
+#define KEY_DOWN          264
+#define KEY_UP            265
+#define KEY_LEFT_SHIFT    340
+#define KEY_LEFT_CONTROL  341
+#define KEY_RIGHT_SHIFT   344
+#define KEY_RIGHT_CONTROL 345
+
+#define MOUSE_LEFT  0
+#define MOUSE_RIGHT 1
+
+// joystick.h's layout
+#define JOYSTICK_LEFT_X  0
+#define JOYSTICK_LEFT_Y  1
+#define JOYSTICK_RIGHT_X 2
+#define JOYSTICK_FIRE    7 // right trigger
+#define JOYSTICK_USE     1 // bottom face button
+
+// a stick axis past the deadzone, rescaled to [-1, 1]
+static f32 StickAxis(const JoystickState &joystick, u8 axis)
+{
+    if(!joystick.present || axis >= joystick.axisCount)
+        return 0.0f;
+
+    f32 value = joystick.axes[axis];
+    if(std::fabs(value) < CMD_JOYSTICK_DEADZONE)
+        return 0.0f;
+
+    f32 sign = value < 0.0f ? -1.0f : 1.0f;
+    return sign * std::min((std::fabs(value) - CMD_JOYSTICK_DEADZONE) / (1.0f - CMD_JOYSTICK_DEADZONE), 1.0f);
+}
+
+// held at the end of the tic or pressed during it, a tap inside one tic still counts
+static inline bool KeyDown(const InputSnapshot &input, i32 key)
+{
+    return input.IsKeyHeld(key) || input.WasKeyPressed(key);
+}
+
+static inline bool ButtonDown(const InputSnapshot &input, i32 button)
+{
+    return input.IsButtonHeld(button) || input.WasButtonPressed(button);
+}
+
+static bool JoystickButton(const JoystickState &joystick, u8 button)
+{
+    return joystick.present && button < joystick.buttonCount && joystick.buttons[button] != 0;
+}
+
+void DEUtil::BuildTicCmd(const InputSnapshot &input, const JoystickState &joystick, TicCmd &cmd)
+{
+    cmd = TicCmd{};
+
+    bool run = input.IsKeyHeld(KEY_LEFT_SHIFT) || input.IsKeyHeld(KEY_RIGHT_SHIFT);
+    i32 forwardSpeed = run ? CMD_FORWARD_RUN : CMD_FORWARD_WALK;
+    i32 sideSpeed = run ? CMD_SIDE_RUN : CMD_SIDE_WALK;
+    i32 turnSpeed = run ? CMD_TURN_RUN : CMD_TURN_WALK;
+
+    i32 forward = 0, side = 0, turn = 0;
+    if(input.IsKeyHeld(KEY_W) || input.IsKeyHeld(KEY_UP))
+        forward += forwardSpeed;
+    if(input.IsKeyHeld(KEY_S) || input.IsKeyHeld(KEY_DOWN))
+        forward -= forwardSpeed;
+    if(input.IsKeyHeld(KEY_D))
+        side += sideSpeed;
+    if(input.IsKeyHeld(KEY_A))
+        side -= sideSpeed;
+    if(input.IsKeyHeld(KEY_RIGHT))
+        turn -= turnSpeed;
+    if(input.IsKeyHeld(KEY_LEFT))
+        turn += turnSpeed;
+
+    // the sticks' y is down positive like the cursor's
+    forward -= (i32)(StickAxis(joystick, JOYSTICK_LEFT_Y) * CMD_FORWARD_RUN);
+    side += (i32)(StickAxis(joystick, JOYSTICK_LEFT_X) * CMD_SIDE_RUN);
+    turn -= (i32)(StickAxis(joystick, JOYSTICK_RIGHT_X) * CMD_TURN_RUN);
+    turn -= (i32)(input.dx * CMD_MOUSE_TURN);
+
+    cmd.forwardMove = (i8)std::clamp(forward, -CMD_FORWARD_RUN, CMD_FORWARD_RUN);
+    cmd.sideMove = (i8)std::clamp(side, -CMD_FORWARD_RUN, CMD_FORWARD_RUN);
+    cmd.angleTurn = (i16)std::clamp(turn, -32768, 32767);
+
+    if(KeyDown(input, KEY_LEFT_CONTROL) || KeyDown(input, KEY_RIGHT_CONTROL) || ButtonDown(input, MOUSE_LEFT) ||
+       JoystickButton(joystick, JOYSTICK_FIRE))
+        cmd.buttons |= BT_ATTACK;
+
+    if(KeyDown(input, KEY_SPACE) || KeyDown(input, KEY_E) || ButtonDown(input, MOUSE_RIGHT) ||
+       JoystickButton(joystick, JOYSTICK_USE))
+        cmd.buttons |= BT_USE;
+}
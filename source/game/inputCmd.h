@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../io/input.h"
+#include "../io/inputRecord.h"
+#include "ticcmd.h"
+
+// vanilla's movement speeds (forwardmove, sidemove and angleturn in g_game.c), walking and running
+#define CMD_FORWARD_WALK 0x19
+#define CMD_FORWARD_RUN  0x32
+#define CMD_SIDE_WALK    0x18
+#define CMD_SIDE_RUN     0x28
+#define CMD_TURN_WALK    640
+#define CMD_TURN_RUN     1280
+
+#define CMD_MOUSE_TURN        8     // angleTurn per pixel of mouse x, vanilla's at sensitivity 5
+#define CMD_JOYSTICK_DEADZONE 0.25f // stick travel that's ignored
+
+namespace DEUtil {
+
+// one tic's TicCmd from its input, with the default controls: wasd or the arrows, shift runs,
+// the mouse turns, ctrl or the left button fires, space, e or the right button uses. the
+// left stick moves, the right stick turns and the face and trigger buttons fire and use.
+void BuildTicCmd(const InputSnapshot &input, const JoystickState &joystick, TicCmd &cmd);
+
+} // namespace DEUtil
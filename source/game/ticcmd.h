@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../core/defines.h"
+
+// one player's input for one tic, vanilla's ticcmd_t minus the network fields
+struct TicCmd
+{
+    i8 forwardMove; // * 2048 is the thrust, 0x32 runs
+    i8 sideMove;
+    i16 angleTurn; // << 16 is the turn in BAM
+    u8 buttons;
+};
+
+#define BT_ATTACK BIT(0)
+#define BT_USE    BIT(1)
+
+// the sim runs at vanilla's rate, a tic is 1/35 s
+#define TICRATE 35
+
+// up to vanilla's player count, as in demos
+#define SIM_MAX_PLAYERS 4
@@ -0,0 +1,141 @@
+#include "input.h"
+#include "inputRecord.h"
+
+#include <cstring>
+
+InputQueue Input::queue;
+InputSnapshot Input::snapshot{};
+DEUtil::InputRecorder *Input::recorder = nullptr;
+std::atomic<bool> Input::live{true};
+
+#pragma region InputQueue
+
+InputQueue::InputQueue() : head{0}, tail{0}, dropped{0} {}
+
+bool InputQueue::Push(const InputEvent &event)
+{
+    u32 t = tail.load(std::memory_order_relaxed);
+    if(t - head.load(std::memory_order_acquire) == INPUT_QUEUE_SIZE)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    events[t & (INPUT_QUEUE_SIZE - 1)] = event;
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+const InputEvent *InputQueue::Peek() const
+{
+    u32 h = head.load(std::memory_order_relaxed);
+    if(h == tail.load(std::memory_order_acquire))
+        return nullptr;
+
+    return &events[h & (INPUT_QUEUE_SIZE - 1)];
+}
+
+void InputQueue::Pop()
+{
+    // the slot is only reused once the producer sees the new head
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+#pragma endregion
+
+#pragma region InputSnapshot
+
+void InputSnapshot::BeginTic(f64 time)
+{
+    memset(keysPressed, 0, sizeof(keysPressed));
+    memset(keysReleased, 0, sizeof(keysReleased));
+    memset(buttonsPressed, 0, sizeof(buttonsPressed));
+    memset(buttonsReleased, 0, sizeof(buttonsReleased));
+
+    dx = dy = 0.0;
+    scrollDX = scrollDY = 0.0;
+    this->time = time;
+    eventCount = 0;
+    oldestEventTime = time;
+    eventTimeSum = 0.0;
+}
+
+void InputSnapshot::Apply(const InputEvent &event)
+{
+    if(eventCount++ == 0)
+        oldestEventTime = event.time;
+    eventTimeSum += event.time;
+
+    switch(event.type)
+    {
+    case InputEventType::KEY:
+    case InputEventType::MOUSE_BUTTON:
+    {
+        bool key = event.type == InputEventType::KEY;
+        if(event.code >= (key ? INPUT_KEY_COUNT : INPUT_BUTTON_COUNT))
+            break;
+
+        // a repeat is neither edge, the key was down already
+        u64 *held = key ? keys : buttons;
+        if(event.action == InputAction::PRESS && !DEUtil::TestBit(held, event.code))
+        {
+            DEUtil::SetBit(held, event.code);
+            DEUtil::SetBit(key ? keysPressed : buttonsPressed, event.code);
+        }
+        else if(event.action == InputAction::RELEASE && DEUtil::TestBit(held, event.code))
+        {
+            DEUtil::ClearBit(held, event.code);
+            DEUtil::SetBit(key ? keysReleased : buttonsReleased, event.code);
+        }
+        break;
+    }
+    case InputEventType::CURSOR:
+        if(hasCursor)
+        {
+            dx += event.x - x;
+            dy += y - event.y; // inverted
+        }
+        x = event.x;
+        y = event.y;
+        hasCursor = true;
+        break;
+    case InputEventType::SCROLL:
+        scrollDX += event.x;
+        scrollDY += event.y;
+        break;
+    }
+}
+
+#pragma endregion
+
+#pragma region Input
+
+void Input::Push(const InputEvent &event)
+{
+    if(live.load(std::memory_order_relaxed))
+        queue.Push(event);
+}
+
+u32 Input::Tick(f64 until)
+{
+    snapshot.BeginTic(until);
+    for(const InputEvent *event = queue.Peek(); event && event->time <= until; event = queue.Peek())
+    {
+        snapshot.Apply(*event);
+        if(recorder)
+            recorder->RecordEvent(*event);
+        queue.Pop();
+    }
+
+    return snapshot.eventCount;
+}
+
+void Input::Reset()
+{
+    while(queue.Peek())
+        queue.Pop();
+
+    snapshot = InputSnapshot{};
+}
+
+#pragma endregion
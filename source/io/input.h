@@ -0,0 +1,157 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../core/bitset.h"
+
+#include <atomic>
+
+#define INPUT_QUEUE_SIZE   1024 // events between two tics, a power of two
+#define INPUT_KEY_COUNT    512  // glfw key codes go up to GLFW_KEY_LAST (348)
+#define INPUT_BUTTON_COUNT 8    // and mouse buttons up to GLFW_MOUSE_BUTTON_LAST (7)
+#define INPUT_KEY_WORDS    ((INPUT_KEY_COUNT + 63) / 64)
+#define INPUT_BUTTON_WORDS ((INPUT_BUTTON_COUNT + 63) / 64)
+
+enum class InputEventType : u8
+{
+    KEY,
+    MOUSE_BUTTON,
+    CURSOR, // x and y are the new position
+    SCROLL, // x and y are the offsets
+};
+
+// glfw's action values
+enum class InputAction : u8
+{
+    RELEASE,
+    PRESS,
+    REPEAT,
+};
+
+struct InputEvent
+{
+    f64 time; // glfwGetTime() when the callback ran
+    f64 x, y;
+    InputEventType type;
+    InputAction action;
+    u16 code; // key or mouse button
+    u32 pad;
+};
+
+ST_ASSERT(sizeof(InputEvent) == 32, "expected InputEvent to be 32 bytes.");
+
+// single producer, single consumer ring of events. the thread that polls glfw pushes and
+// the thread that runs the simulation pops, neither ever waits on the other.
+class InputQueue
+{
+    private:
+    InputEvent events[INPUT_QUEUE_SIZE];
+
+    // on their own cache lines, each is only written by one side
+    alignas(64) std::atomic<u32> head; // next to pop
+    alignas(64) std::atomic<u32> tail; // next to push
+    std::atomic<u32> dropped;
+
+    public:
+    InputQueue();
+    InputQueue(const InputQueue &queue) = delete;
+    InputQueue &operator=(const InputQueue &queue) = delete;
+
+    // producer. false if the queue is full, the event is dropped (and counted) then
+    bool Push(const InputEvent &event);
+
+    // consumer. the oldest event or nullptr if there's none, it stays valid until Pop()
+    const InputEvent *Peek() const;
+    void Pop();
+
+    inline u32 GetDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+// what the input did during one tic, as packed bitsets so the sim's queries are a bit test.
+// edges are kept apart from the held state, so a key pressed and released inside one tic
+// is still seen as pressed and released.
+struct InputSnapshot
+{
+    u64 keys[INPUT_KEY_WORDS]; // held at the end of the tic
+    u64 keysPressed[INPUT_KEY_WORDS];
+    u64 keysReleased[INPUT_KEY_WORDS];
+
+    u64 buttons[INPUT_BUTTON_WORDS];
+    u64 buttonsPressed[INPUT_BUTTON_WORDS];
+    u64 buttonsReleased[INPUT_BUTTON_WORDS];
+
+    f64 x, y;   // cursor at the end of the tic
+    f64 dx, dy; // cursor movement during the tic, up is positive
+    f64 scrollDX, scrollDY;
+    bool hasCursor; // a position came in, movement is measured from it
+
+    f64 time;       // events up to here are in it
+    u32 eventCount; // events that went into this tic
+
+    // for latency, how long ago the tic's events happened
+    f64 oldestEventTime;
+    f64 eventTimeSum;
+
+    // clears the edges and the movement, the held state carries over
+    void BeginTic(f64 time);
+    void Apply(const InputEvent &event);
+
+    inline bool IsKeyHeld(i32 key) const { return key >= 0 && key < INPUT_KEY_COUNT && DEUtil::TestBit(keys, key); }
+    inline bool WasKeyPressed(i32 key) const
+    {
+        return key >= 0 && key < INPUT_KEY_COUNT && DEUtil::TestBit(keysPressed, key);
+    }
+    inline bool WasKeyReleased(i32 key) const
+    {
+        return key >= 0 && key < INPUT_KEY_COUNT && DEUtil::TestBit(keysReleased, key);
+    }
+
+    inline bool IsButtonHeld(i32 button) const
+    {
+        return button >= 0 && button < INPUT_BUTTON_COUNT && DEUtil::TestBit(buttons, button);
+    }
+    inline bool WasButtonPressed(i32 button) const
+    {
+        return button >= 0 && button < INPUT_BUTTON_COUNT && DEUtil::TestBit(buttonsPressed, button);
+    }
+    inline bool WasButtonReleased(i32 button) const
+    {
+        return button >= 0 && button < INPUT_BUTTON_COUNT && DEUtil::TestBit(buttonsReleased, button);
+    }
+};
+
+namespace DEUtil {
+class InputRecorder;
+}
+
+// the engine's input: glfw's callbacks push into the queue, and every tic the sim takes
+// the events up to that tic's time into the snapshot that Keyboard and Mouse read from.
+class Input
+{
+    private:
+    static InputQueue queue;
+    static InputSnapshot snapshot;
+    static DEUtil::InputRecorder *recorder;
+    static std::atomic<bool> live;
+
+    public:
+    // from the callbacks, dropped while live input is off
+    static void Push(const InputEvent &event);
+
+    // off while a recording plays back, so the window's events don't mix into it. the
+    // playback pushes straight into the queue on the thread that ticks.
+    static inline void SetLiveInput(bool enabled) { live.store(enabled, std::memory_order_relaxed); }
+
+    // every event Tick() takes off the queue is recorded too, nullptr stops recording
+    static inline void SetRecorder(DEUtil::InputRecorder *inputRecorder) { recorder = inputRecorder; }
+
+    // starts a tic with every event up to until, returns how many there were. events after
+    // it stay queued for the next tic.
+    static u32 Tick(f64 until);
+
+    // drops queued events and forgets held keys and the cursor, like no input ever came in.
+    // a playback starts from here, as its recording did.
+    static void Reset();
+
+    static inline const InputSnapshot &GetSnapshot() { return snapshot; }
+    static inline InputQueue &GetQueue() { return queue; }
+};
@@ -0,0 +1,438 @@
+#include "inputRecord.h"
+#include "../core/logger.h"
+
+#include <cmath>
+#include <cstring>
+
+// varints and the rest, for both sides
+
+static void PutVarint(std::vector<u8> &out, u64 value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((u8)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((u8)value);
+}
+
+static void PutSigned(std::vector<u8> &out, i64 value)
+{
+    PutVarint(out, ((u64)value << 1) ^ (u64)(value >> 63));
+}
+
+template<typename T>
+static void PutRaw(std::vector<u8> &out, T value)
+{
+    u8 bytes[sizeof(T)];
+    memcpy(bytes, &value, sizeof(T));
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+static bool GetVarint(const std::vector<u8> &in, usize &pos, u64 &value)
+{
+    value = 0;
+    for(u32 shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        u8 byte = in[pos++];
+        value |= (u64)(byte & 0x7f) << shift;
+        if(!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+static bool GetSigned(const std::vector<u8> &in, usize &pos, i64 &value)
+{
+    u64 zigzag;
+    if(!GetVarint(in, pos, zigzag))
+        return false;
+
+    value = (i64)(zigzag >> 1) ^ -(i64)(zigzag & 1);
+    return true;
+}
+
+template<typename T>
+static bool GetRaw(const std::vector<u8> &in, usize &pos, T &value)
+{
+    if(in.size() - pos < sizeof(T))
+        return false;
+
+    memcpy(&value, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// cursor positions are whole pixels unless the platform scales them, those fit a varint
+static inline bool IsWhole(f64 value)
+{
+    return std::fabs(value) < 4503599627370496.0 && value == std::floor(value);
+}
+
+#pragma region InputRecorder
+
+DEUtil::InputRecorder::InputRecorder()
+    : ticCount{0}, idleTics{0}, ticHasRecords{false}, cursorX{0.0}, cursorY{0.0}, hasCursor{false}, joystick{}
+{
+}
+
+bool DEUtil::InputRecorder::Open(const char *filepath, u32 ticRate)
+{
+    file.open(filepath, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        LERROR("input: couldn't create " << filepath << "\n");
+        return false;
+    }
+
+    // the tic count is filled in by Flush()
+    InputRecordHeader header{INPUT_RECORD_MAGIC, INPUT_RECORD_VERSION, (u16)ticRate, 0, 0};
+    file.write((const char *)&header, sizeof(header));
+
+    buffer.clear();
+    ticCount = idleTics = 0;
+    ticHasRecords = false;
+    hasCursor = false;
+    joystick = JoystickState{};
+    return true;
+}
+
+void DEUtil::InputRecorder::BeginRecord(InputRecordOp op)
+{
+    // the idle run before this tic ends here
+    if(idleTics > 0)
+    {
+        buffer.push_back((u8)InputRecordOp::IDLE);
+        PutVarint(buffer, idleTics);
+        idleTics = 0;
+    }
+
+    buffer.push_back((u8)op);
+    ticHasRecords = true;
+}
+
+void DEUtil::InputRecorder::RecordEvent(const InputEvent &event)
+{
+    switch(event.type)
+    {
+    case InputEventType::KEY:
+    case InputEventType::MOUSE_BUTTON:
+    {
+        // repeats don't change a snapshot, there's no need to keep them
+        if(event.action == InputAction::REPEAT)
+            break;
+
+        bool press = event.action == InputAction::PRESS;
+        if(event.type == InputEventType::KEY)
+        {
+            BeginRecord(press ? InputRecordOp::KEY_PRESS : InputRecordOp::KEY_RELEASE);
+            PutVarint(buffer, event.code);
+        }
+        else
+        {
+            BeginRecord(press ? InputRecordOp::BUTTON_PRESS : InputRecordOp::BUTTON_RELEASE);
+            buffer.push_back((u8)event.code);
+        }
+        break;
+    }
+    case InputEventType::CURSOR:
+    {
+        f64 dx = event.x - cursorX, dy = event.y - cursorY;
+        if(hasCursor && IsWhole(dx) && IsWhole(dy))
+        {
+            BeginRecord(InputRecordOp::CURSOR_MOVE);
+            PutSigned(buffer, (i64)dx);
+            PutSigned(buffer, (i64)dy);
+        }
+        else
+        {
+            BeginRecord(InputRecordOp::CURSOR_AT);
+            PutRaw(buffer, event.x);
+            PutRaw(buffer, event.y);
+        }
+
+        cursorX = event.x;
+        cursorY = event.y;
+        hasCursor = true;
+        break;
+    }
+    case InputEventType::SCROLL:
+        if(IsWhole(event.x) && IsWhole(event.y))
+        {
+            BeginRecord(InputRecordOp::SCROLL);
+            PutSigned(buffer, (i64)event.x);
+            PutSigned(buffer, (i64)event.y);
+        }
+        else
+        {
+            BeginRecord(InputRecordOp::SCROLL_EXACT);
+            PutRaw(buffer, event.x);
+            PutRaw(buffer, event.y);
+        }
+        break;
+    }
+}
+
+void DEUtil::InputRecorder::RecordJoystick(const JoystickState &state)
+{
+    u8 axisCount = state.axisCount < INPUT_MAX_AXES ? state.axisCount : INPUT_MAX_AXES;
+    u8 buttonCount = state.buttonCount < INPUT_MAX_JOYSTICK_BUTTONS ? state.buttonCount : INPUT_MAX_JOYSTICK_BUTTONS;
+    if(state.present != joystick.present || axisCount != joystick.axisCount || buttonCount != joystick.buttonCount)
+    {
+        BeginRecord(InputRecordOp::JOYSTICK);
+        buffer.push_back(state.present);
+        buffer.push_back(axisCount);
+        buffer.push_back(buttonCount);
+
+        joystick.present = state.present;
+        joystick.axisCount = axisCount;
+        joystick.buttonCount = buttonCount;
+    }
+
+    // compared as bits, so the replay gets exactly the same floats
+    for(u8 i = 0; i < axisCount; i++)
+    {
+        if(memcmp(&state.axes[i], &joystick.axes[i], sizeof(f32)) == 0)
+            continue;
+
+        BeginRecord(InputRecordOp::JOYSTICK_AXIS);
+        buffer.push_back(i);
+        PutRaw(buffer, state.axes[i]);
+        joystick.axes[i] = state.axes[i];
+    }
+
+    for(u8 i = 0; i < buttonCount; i++)
+    {
+        if(state.buttons[i] == joystick.buttons[i])
+            continue;
+
+        BeginRecord(InputRecordOp::JOYSTICK_BUTTON);
+        buffer.push_back(i);
+        buffer.push_back(state.buttons[i]);
+        joystick.buttons[i] = state.buttons[i];
+    }
+}
+
+void DEUtil::InputRecorder::EndTic()
+{
+    if(ticHasRecords)
+        buffer.push_back((u8)InputRecordOp::END_TIC);
+    else
+        idleTics++;
+
+    ticHasRecords = false;
+    ticCount++;
+
+    if(buffer.size() >= INPUT_RECORD_FLUSH_SIZE)
+        Flush();
+}
+
+void DEUtil::InputRecorder::Flush()
+{
+    file.write((const char *)buffer.data(), (std::streamsize)buffer.size());
+    buffer.clear();
+
+    // the header counts the tics written so far, so a session that dies replays up to its
+    // last flush. an idle run that's still going isn't written yet
+    u32 writtenTics = ticCount - idleTics;
+    std::streampos end = file.tellp();
+    file.seekp(offsetof(InputRecordHeader, ticCount));
+    file.write((const char *)&writtenTics, sizeof(writtenTics));
+    file.seekp(end);
+    file.flush();
+}
+
+bool DEUtil::InputRecorder::Close()
+{
+    if(!file.is_open())
+        return false;
+
+    if(idleTics > 0)
+    {
+        buffer.push_back((u8)InputRecordOp::IDLE);
+        PutVarint(buffer, idleTics);
+        idleTics = 0;
+    }
+    Flush();
+    file.close();
+    if(!file)
+    {
+        LERROR("input: couldn't write the recording.\n");
+        return false;
+    }
+
+    return true;
+}
+
+DEUtil::InputRecorder::~InputRecorder()
+{
+    if(file.is_open())
+        Close();
+}
+
+#pragma endregion
+
+#pragma region InputPlayback
+
+DEUtil::InputPlayback::InputPlayback()
+    : cursor{0}, ticCount{0}, tic{0}, ticRate{0}, idleLeft{0}, cursorX{0.0}, cursorY{0.0}, joystick{}
+{
+}
+
+bool DEUtil::InputPlayback::Open(const char *filepath)
+{
+    std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+    if(!file.is_open())
+    {
+        LERROR("input: couldn't open " << filepath << "\n");
+        return false;
+    }
+
+    std::vector<u8> recording((usize)file.tellg());
+    file.seekg(0);
+    file.read((char *)recording.data(), (std::streamsize)recording.size());
+    if(!file)
+    {
+        LERROR("input: couldn't read " << filepath << "\n");
+        return false;
+    }
+
+    return Load(std::move(recording));
+}
+
+bool DEUtil::InputPlayback::Load(std::vector<u8> recording)
+{
+    InputRecordHeader header{};
+    if(recording.size() >= sizeof(header))
+        memcpy(&header, recording.data(), sizeof(header));
+
+    if(header.magic != INPUT_RECORD_MAGIC || header.version != INPUT_RECORD_VERSION)
+    {
+        LERROR("input: not a version " << INPUT_RECORD_VERSION << " input recording.\n");
+        return false;
+    }
+
+    data = std::move(recording);
+    ticCount = header.ticCount;
+    ticRate = header.ticRate;
+    Rewind();
+    return true;
+}
+
+void DEUtil::InputPlayback::Rewind()
+{
+    cursor = sizeof(InputRecordHeader);
+    tic = 0;
+    idleLeft = 0;
+    cursorX = cursorY = 0.0;
+    joystick = JoystickState{};
+}
+
+bool DEUtil::InputPlayback::NextTic(InputQueue &queue, f64 time)
+{
+    if(tic >= ticCount)
+        return false;
+
+    if(idleLeft > 0)
+    {
+        idleLeft--;
+        tic++;
+        return true;
+    }
+
+    while(cursor < data.size())
+    {
+        InputRecordOp op = (InputRecordOp)data[cursor++];
+        InputEvent event{time, 0.0, 0.0, InputEventType::KEY, InputAction::PRESS, 0, 0};
+        bool valid = true;
+        u64 code = 0;
+        i64 x = 0, y = 0;
+        u8 bytes[3] = {};
+
+        switch(op)
+        {
+        case InputRecordOp::END_TIC:
+            tic++;
+            return true;
+        case InputRecordOp::IDLE:
+            valid = GetVarint(data, cursor, code) && code > 0 && code <= ticCount - tic;
+            if(!valid)
+                break;
+            idleLeft = (u32)code - 1;
+            tic++;
+            return true;
+        case InputRecordOp::KEY_PRESS:
+        case InputRecordOp::KEY_RELEASE:
+            valid = GetVarint(data, cursor, code) && code < INPUT_KEY_COUNT;
+            event.action = op == InputRecordOp::KEY_PRESS ? InputAction::PRESS : InputAction::RELEASE;
+            event.code = (u16)code;
+            break;
+        case InputRecordOp::BUTTON_PRESS:
+        case InputRecordOp::BUTTON_RELEASE:
+            valid = GetRaw(data, cursor, bytes[0]) && bytes[0] < INPUT_BUTTON_COUNT;
+            event.type = InputEventType::MOUSE_BUTTON;
+            event.action = op == InputRecordOp::BUTTON_PRESS ? InputAction::PRESS : InputAction::RELEASE;
+            event.code = bytes[0];
+            break;
+        case InputRecordOp::CURSOR_MOVE:
+            valid = GetSigned(data, cursor, x) && GetSigned(data, cursor, y);
+            cursorX += (f64)x;
+            cursorY += (f64)y;
+            event.type = InputEventType::CURSOR;
+            event.x = cursorX;
+            event.y = cursorY;
+            break;
+        case InputRecordOp::CURSOR_AT:
+            valid = GetRaw(data, cursor, cursorX) && GetRaw(data, cursor, cursorY);
+            event.type = InputEventType::CURSOR;
+            event.x = cursorX;
+            event.y = cursorY;
+            break;
+        case InputRecordOp::SCROLL:
+            valid = GetSigned(data, cursor, x) && GetSigned(data, cursor, y);
+            event.type = InputEventType::SCROLL;
+            event.x = (f64)x;
+            event.y = (f64)y;
+            break;
+        case InputRecordOp::SCROLL_EXACT:
+            valid = GetRaw(data, cursor, event.x) && GetRaw(data, cursor, event.y);
+            event.type = InputEventType::SCROLL;
+            break;
+        case InputRecordOp::JOYSTICK:
+            valid = GetRaw(data, cursor, bytes) && bytes[1] <= INPUT_MAX_AXES && bytes[2] <= INPUT_MAX_JOYSTICK_BUTTONS;
+            if(!valid)
+                break;
+            joystick.present = bytes[0] != 0;
+            joystick.axisCount = bytes[1];
+            joystick.buttonCount = bytes[2];
+            continue;
+        case InputRecordOp::JOYSTICK_AXIS:
+            valid = GetRaw(data, cursor, bytes[0]) && bytes[0] < INPUT_MAX_AXES &&
+                    GetRaw(data, cursor, joystick.axes[bytes[0]]);
+            if(!valid)
+                break;
+            continue;
+        case InputRecordOp::JOYSTICK_BUTTON:
+            valid = GetRaw(data, cursor, bytes[0]) && bytes[0] < INPUT_MAX_JOYSTICK_BUTTONS &&
+                    GetRaw(data, cursor, joystick.buttons[bytes[0]]);
+            if(!valid)
+                break;
+            continue;
+        default:
+            valid = false;
+            break;
+        }
+
+        if(!valid)
+            break;
+
+        queue.Push(event);
+    }
+
+    LERROR("input: the recording is corrupt at tic " << tic << ".\n");
+    tic = ticCount;
+    return false;
+}
+
+#pragma endregion
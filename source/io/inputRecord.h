@@ -0,0 +1,139 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "input.h"
+
+#include <fstream>
+#include <vector>
+
+// ---------------------- INPUT RECORDINGS ----------------------
+//
+// [header: InputRecordHeader] then the tics, each a run of records that start with an op
+// byte. a tic with records ends with END_TIC, a run of tics without any is a single IDLE.
+// numbers are little endian, varints are 7 bits a byte (low first) and signed ones are
+// zigzagged. the cursor is recorded as its movement from the last position (what
+// Mouse::GetDX/GetDY report), whole pixels as varints and anything else as an exact position.
+// joystick axes and buttons are only recorded when they change.
+
+#define INPUT_RECORD_MAGIC   0x504e4944 // "DINP"
+#define INPUT_RECORD_VERSION 1
+
+#define INPUT_MAX_AXES             8
+#define INPUT_MAX_JOYSTICK_BUTTONS 32
+
+#define INPUT_RECORD_FLUSH_SIZE (64 * 1024) // bytes buffered before they're written out
+
+enum class InputRecordOp : u8
+{
+    END_TIC,
+    IDLE,            // varint n: this and the next n - 1 tics have no input
+    KEY_PRESS,       // varint key
+    KEY_RELEASE,     // varint key
+    BUTTON_PRESS,    // u8 button
+    BUTTON_RELEASE,  // u8 button
+    CURSOR_MOVE,     // svarint dx, svarint dy from the last position (y down like glfw)
+    CURSOR_AT,       // f64 x, f64 y
+    SCROLL,          // svarint x, svarint y
+    SCROLL_EXACT,    // f64 x, f64 y
+    JOYSTICK,        // u8 present, u8 axis count, u8 button count
+    JOYSTICK_AXIS,   // u8 axis, f32 value
+    JOYSTICK_BUTTON, // u8 button, u8 state
+};
+
+struct InputRecordHeader
+{
+    u32 magic;
+    u16 version;
+    u16 ticRate;
+    u32 ticCount; // tics in the data, brought up to date at every flush
+    u32 reserved;
+};
+
+ST_ASSERT(sizeof(InputRecordHeader) == 16, "expected InputRecordHeader to be 16 bytes.");
+
+// a joystick's state for a tic, Joystick fills one from glfw or reads it back in a replay
+struct JoystickState
+{
+    f32 axes[INPUT_MAX_AXES];
+    u8 buttons[INPUT_MAX_JOYSTICK_BUTTONS];
+    u8 axisCount, buttonCount;
+    bool present;
+};
+
+namespace DEUtil {
+
+// writes a recording a tic at a time: the tic's events in the order they were taken off the
+// queue (Input::Tick() does that when a recorder is set), then its joystick state, then EndTic().
+class InputRecorder
+{
+    private:
+    std::ofstream file;
+    std::vector<u8> buffer;
+    u32 ticCount;
+    u32 idleTics; // tics without records since the last one that had some
+    bool ticHasRecords;
+
+    f64 cursorX, cursorY;
+    bool hasCursor;
+    JoystickState joystick;
+
+    private:
+    void BeginRecord(InputRecordOp op);
+    void Flush();
+
+    public:
+    InputRecorder();
+    InputRecorder(const InputRecorder &recorder) = delete;
+    InputRecorder &operator=(const InputRecorder &recorder) = delete;
+
+    // returns false (and logs) if the file can't be created
+    bool Open(const char *filepath, u32 ticRate);
+
+    void RecordEvent(const InputEvent &event);
+    void RecordJoystick(const JoystickState &state);
+    void EndTic();
+
+    // writes what's left, false (and logs) if it couldn't
+    bool Close();
+
+    inline bool IsOpen() const { return file.is_open(); }
+    inline u32 GetTicCount() const { return ticCount; }
+
+    ~InputRecorder();
+};
+
+// plays a recording back a tic at a time by pushing its events into a queue, so the tic
+// that takes them sees the same snapshot the recorded one did.
+class InputPlayback
+{
+    private:
+    std::vector<u8> data;
+    usize cursor;
+    u32 ticCount, tic;
+    u32 ticRate;
+    u32 idleLeft;
+
+    f64 cursorX, cursorY;
+    JoystickState joystick;
+
+    public:
+    InputPlayback();
+
+    // reads the whole recording, returns false (and logs) if it isn't one
+    bool Open(const char *filepath);
+    bool Load(std::vector<u8> recording);
+
+    // pushes the next tic's events into queue stamped with time and updates the joystick
+    // state. false once the recording is over, or (logged) if it's corrupt.
+    bool NextTic(InputQueue &queue, f64 time);
+
+    // starts over from the first tic
+    void Rewind();
+
+    inline const JoystickState &GetJoystick() const { return joystick; }
+    inline u32 GetTicCount() const { return ticCount; }
+    inline u32 GetTic() const { return tic; }
+    inline u32 GetTicRate() const { return ticRate; }
+};
+
+} // namespace DEUtil
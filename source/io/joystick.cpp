@@ -1,6 +1,8 @@
 #include "joystick.h"
 
-Joystick::Joystick(i32 i)
+#include <algorithm>
+
+Joystick::Joystick(i32 i) : present{0}, axesCount{0}, axes{nullptr}, buttonCount{0}, buttons{nullptr}, replay{nullptr}
 {
     ID = GetID(i);
 
@@ -9,6 +11,16 @@ Joystick::Joystick(i32 i)
 
 void Joystick::Update()
 {
+    if(replay)
+    {
+        present = replay->present;
+        axes = replay->axes;
+        axesCount = replay->axisCount;
+        buttons = replay->buttons;
+        buttonCount = replay->buttonCount;
+        return;
+    }
+
     present = glfwJoystickPresent(ID);
 
     if(present)
@@ -19,6 +31,28 @@ void Joystick::Update()
     }
 }
 
+void Joystick::SetReplay(const JoystickState *replay)
+{
+    this->replay = replay;
+    Update();
+}
+
+void Joystick::GetState(JoystickState &state)
+{
+    state = JoystickState{};
+    state.present = present;
+    if(!present)
+        return;
+
+    state.axisCount = (u8)std::min(axesCount, INPUT_MAX_AXES);
+    for(u8 i = 0; i < state.axisCount; i++)
+        state.axes[i] = axes[i];
+
+    state.buttonCount = (u8)std::min(buttonCount, INPUT_MAX_JOYSTICK_BUTTONS);
+    for(u8 i = 0; i < state.buttonCount; i++)
+        state.buttons[i] = buttons[i];
+}
+
 f32 Joystick::GetAxesState(i32 axis)
 {
     if(present)
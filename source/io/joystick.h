@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core/defines.h"
+#include "inputRecord.h"
 
 #include <GLFW/glfw3.h>
 
@@ -51,11 +52,21 @@ class Joystick
     i32 buttonCount;
     const u8 *buttons;
 
+    // a recording's joystick that Update() reads instead of the device
+    const JoystickState *replay;
+
     public:
     Joystick(i32 i);
 
     void Update();
 
+    // replay's state is what Update() reports from now on (it has to outlive the replay),
+    // nullptr goes back to the device
+    void SetReplay(const JoystickState *replay);
+
+    // the state as of the last Update(), for recording
+    void GetState(JoystickState &state);
+
     f32 GetAxesState(i32 axis);
     u8 GetButtonState(i32 button);
 
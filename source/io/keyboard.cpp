@@ -1,42 +1,30 @@
 #include "keyboard.h"
 
-bool Keyboard::keys[GLFW_KEY_LAST] = {false};
-bool Keyboard::keysChanged[GLFW_KEY_LAST] = {false};
-
 void Keyboard::KeyCallback(GLFWwindow *window, i32 key, i32 scancode, i32 action, i32 mods)
 {
-    if(action != GLFW_RELEASE)
-    {
-        if(!keys[key])
-            keys[key] = true;
-    }
-    else
-    {
-        keys[key] = false;
-    }
+    // GLFW_KEY_UNKNOWN is -1
+    if(key < 0 || key >= INPUT_KEY_COUNT)
+        return;
 
-    keysChanged[key] = (action != GLFW_REPEAT);
+    Input::Push(InputEvent{glfwGetTime(), 0.0, 0.0, InputEventType::KEY, (InputAction)action, (u16)key, 0});
 }
 
 bool Keyboard::GetKey(i32 key)
 {
-    return keys[key];
+    return Input::GetSnapshot().IsKeyHeld(key);
 }
 
 bool Keyboard::KeyChanged(i32 key)
 {
-    bool ret = keysChanged[key];
-    keysChanged[key] = false;
-
-    return ret;
+    return Input::GetSnapshot().WasKeyPressed(key) || Input::GetSnapshot().WasKeyReleased(key);
 }
 
 bool Keyboard::GetKeyUp(i32 key)
 {
-    return !keys[key] && KeyChanged(key);
+    return Input::GetSnapshot().WasKeyReleased(key);
 }
 
 bool Keyboard::GetKeyDown(i32 key)
 {
-    return keys[key] && KeyChanged(key);
+    return Input::GetSnapshot().WasKeyPressed(key);
 }
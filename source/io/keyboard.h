@@ -1,34 +1,33 @@
 #pragma once
 
 #include "../core/defines.h"
+#include "input.h"
 
 #include <GLFW/glfw3.h>
 
+// keys as of the current tic (see Input::Tick()), reading them doesn't change anything so
+// any number of places can ask about the same key in a tic.
 class Keyboard
 {
-    private:
-    static bool keys[];
-    static bool keysChanged[];
-
     public:
     Keyboard() {}
 
-    // key state callback
+    // key state callback, queues the event for the next tic
     static void KeyCallback(GLFWwindow *window, i32 key, i32 scancode, i32 action, i32 mods);
 
     // getters
 
-    // true if key is pressed
+    // true if key is pressed at the end of the tic
     static bool GetKey(i32 key);
 
-    // changes state of key (pressed-stopped-etc)
+    // true if key was pressed or released during the tic
     static bool KeyChanged(i32 key);
 
-    // true if the key stopped being pressed
+    // true if the key stopped being pressed during the tic
     static bool GetKeyUp(i32 key);
 
-    //  true if key is being held
+    // true if the key started being pressed during the tic
     static bool GetKeyDown(i32 key);
 
     ~Keyboard() = default;
-};
\ No newline at end of file
+};
@@ -1,26 +1,18 @@
 #pragma once
 
 #include "../core/defines.h"
+#include "input.h"
 
 #include <GLFW/glfw3.h>
 
+// the mouse as of the current tic (see Input::Tick()), like Keyboard reading doesn't
+// change anything.
 class Mouse
 {
-    private:
-    static f64 x, y;
-    static f64 lastX, lastY;
-    static f64 dx, dy;
-    static f64 scrollDX, scrollDY;
-
-    static bool firstMouse;
-
-    static bool buttons[];
-    static bool buttonsChanged[];
-
     public:
     Mouse() {}
 
-    // mouse callbacks
+    // mouse callbacks, they queue the event for the next tic
     static void CursorPosCallback(GLFWwindow *window, f64 x, f64 y);
     static void MouseButtonCallback(GLFWwindow *window, i32 button, i32 action, i32 mods);
     static void MouseWheelCallback(GLFWwindow *window, f64 dx, f64 dy);
@@ -29,6 +21,7 @@ class Mouse
     static f64 GetMouseX();
     static f64 GetMouseY();
 
+    // movement and scrolling during the tic
     static f64 GetDX();
     static f64 GetDY();
 
@@ -42,4 +35,4 @@ class Mouse
     static bool GetButtonDown(i32 button);
 
     ~Mouse() = default;
-};
\ No newline at end of file
+};
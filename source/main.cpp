@@ -1,11 +1,27 @@
 #include "DEngine.h"
 #include "app/app.h"
 
-int main()
+#include <cstring>
+
+int main(int argc, char **argv)
 {
     LINFO(false, "DOOM Engine v0.0.1\n");
 
-    App *app = new App(1920 / 2, 1080 / 2);
+    // -renderthread polls input on this thread and renders on another, -record <file> saves
+    // the session's input and -playback <file> plays one back instead of the window's
+    bool renderThread = false;
+    const char *recordPath = nullptr, *playbackPath = nullptr;
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-renderthread") == 0)
+            renderThread = true;
+        else if(strcmp(argv[i], "-record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if(strcmp(argv[i], "-playback") == 0 && i + 1 < argc)
+            playbackPath = argv[++i];
+    }
+
+    App *app = new App(1920 / 2, 1080 / 2, renderThread, recordPath, playbackPath);
 
     app->Run();
 
@@ -0,0 +1,449 @@
+#include "lod.h"
+#include "meshlet.h"
+
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+
+// symmetric 4x4 matrix of the summed squared plane distances
+struct Quadric
+{
+    f64 a2, ab, ac, ad;
+    f64 b2, bc, bd;
+    f64 c2, cd;
+    f64 d2;
+    f64 weight;
+};
+
+static void AddPlane(Quadric &q, glm::vec3 n, f64 d, f64 w)
+{
+    q.a2 += w * n.x * n.x;
+    q.ab += w * n.x * n.y;
+    q.ac += w * n.x * n.z;
+    q.ad += w * n.x * d;
+    q.b2 += w * n.y * n.y;
+    q.bc += w * n.y * n.z;
+    q.bd += w * n.y * d;
+    q.c2 += w * n.z * n.z;
+    q.cd += w * n.z * d;
+    q.d2 += w * d * d;
+}
+
+static void AddQuadric(Quadric &q, const Quadric &other)
+{
+    q.a2 += other.a2;
+    q.ab += other.ab;
+    q.ac += other.ac;
+    q.ad += other.ad;
+    q.b2 += other.b2;
+    q.bc += other.bc;
+    q.bd += other.bd;
+    q.c2 += other.c2;
+    q.cd += other.cd;
+    q.d2 += other.d2;
+    q.weight += other.weight;
+}
+
+// distance-like error of moving a vertex with quadric q to p
+static f64 QuadricError(const Quadric &q, glm::vec3 p)
+{
+    f64 x = p.x, y = p.y, z = p.z;
+
+    // clang-format off
+    f64 err = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+            + q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+            + q.c2 * z * z + 2.0 * q.cd * z
+            + q.d2;
+    // clang-format on
+
+    err = std::max(err, 0.0);
+    return std::sqrt(q.weight > 0.0 ? err / q.weight : err);
+}
+
+enum class VertexKind : u8
+{
+    INTERIOR,
+    BORDER, // on an edge used by a single triangle, only slides along the border
+    LOCKED, // shares its position with another vertex (attribute seam)
+};
+
+static inline u64 EdgeKey(u32 a, u32 b)
+{
+    return a < b ? ((u64)a << 32) | b : ((u64)b << 32) | a;
+}
+
+struct Collapse
+{
+    u32 v0, v1; // v0 gets removed and snaps onto v1
+    f64 error;
+};
+
+// true if moving v0 onto v1 turns any remaining triangle around v0 inside out
+static bool CollapseFlips(const std::vector<glm::vec3> &positions, const std::vector<u32> &indices,
+                          const std::vector<u32> &adjOffsets, const std::vector<u32> &adjTris, u32 v0, u32 v1)
+{
+    glm::vec3 target = positions[v1];
+
+    for(u32 i = adjOffsets[v0]; i < adjOffsets[v0 + 1]; i++)
+    {
+        const u32 *tri = &indices[(usize)adjTris[i] * 3];
+        if(tri[0] == v1 || tri[1] == v1 || tri[2] == v1)
+            continue; // collapses away
+
+        glm::vec3 p[3];
+        glm::vec3 q[3];
+        for(i32 k = 0; k < 3; k++)
+        {
+            p[k] = positions[tri[k]];
+            q[k] = tri[k] == v0 ? target : p[k];
+        }
+
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+
+        if(glm::dot(before, after) <= 0.0f)
+            return true;
+    }
+
+    return false;
+}
+
+std::vector<u32> DEUtil::SimplifyMesh(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                                      const std::vector<u32> &indices, usize targetIndexCount, f32 maxError,
+                                      f32 *outError)
+{
+    u32 vertexCount = vertexStride ? (u32)(vertexData.size() / vertexStride) : 0;
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for(u32 i = 0; i < vertexCount; i++)
+    {
+        const f32 *v = &vertexData[(usize)i * vertexStride];
+        positions[i] = glm::vec3(v[0], v[1], posComponents > 2 ? v[2] : 0.0f);
+    }
+
+    // drop out of range and degenerate triangles up front
+    std::vector<u32> result;
+    result.reserve(indices.size());
+    for(usize t = 0; t + 2 < indices.size(); t += 3)
+    {
+        u32 a = indices[t], b = indices[t + 1], c = indices[t + 2];
+        if(a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c)
+            continue;
+
+        result.insert(result.end(), {a, b, c});
+    }
+
+    // vertices that share a position (uv/color seams) must stay put, or the seam tears
+    std::vector<VertexKind> seam(vertexCount, VertexKind::INTERIOR);
+    {
+        std::vector<u32> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+            const glm::vec3 &pa = positions[a];
+            const glm::vec3 &pb = positions[b];
+            if(pa.x != pb.x)
+                return pa.x < pb.x;
+            if(pa.y != pb.y)
+                return pa.y < pb.y;
+            return pa.z < pb.z;
+        });
+
+        for(u32 i = 1; i < vertexCount; i++)
+        {
+            if(positions[order[i]] == positions[order[i - 1]])
+            {
+                seam[order[i]] = VertexKind::LOCKED;
+                seam[order[i - 1]] = VertexKind::LOCKED;
+            }
+        }
+    }
+
+    // face quadrics, area weighted
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for(usize t = 0; t < result.size(); t += 3)
+    {
+        glm::vec3 p0 = positions[result[t]];
+        glm::vec3 p1 = positions[result[t + 1]];
+        glm::vec3 p2 = positions[result[t + 2]];
+
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        f32 area = glm::length(n);
+        if(area <= 0.0f)
+            continue;
+
+        n /= area;
+        f64 d = -glm::dot(n, p0);
+        for(i32 k = 0; k < 3; k++)
+        {
+            AddPlane(quadrics[result[t + k]], n, d, area);
+            quadrics[result[t + k]].weight += area;
+        }
+    }
+
+    // border quadrics: planes through every border edge, perpendicular to its face.
+    // they keep open outlines (and flat meshes, which have no face error at all) in shape.
+    {
+        std::unordered_map<u64, u32> edgeUse;
+        for(usize t = 0; t < result.size(); t += 3)
+            for(i32 k = 0; k < 3; k++)
+                edgeUse[EdgeKey(result[t + k], result[t + (k + 1) % 3])]++;
+
+        for(usize t = 0; t < result.size(); t += 3)
+        {
+            glm::vec3 p0 = positions[result[t]];
+            glm::vec3 faceNormal = glm::cross(positions[result[t + 1]] - p0, positions[result[t + 2]] - p0);
+            if(glm::length(faceNormal) <= 0.0f)
+                continue;
+
+            for(i32 k = 0; k < 3; k++)
+            {
+                u32 a = result[t + k], b = result[t + (k + 1) % 3];
+                if(edgeUse[EdgeKey(a, b)] != 1)
+                    continue;
+
+                glm::vec3 edge = positions[b] - positions[a];
+                f32 edgeLength = glm::length(edge);
+                if(edgeLength <= 0.0f)
+                    continue;
+
+                glm::vec3 n = glm::normalize(glm::cross(edge, faceNormal));
+                f64 d = -glm::dot(n, positions[a]);
+                f64 w = (f64)edgeLength * edgeLength;
+
+                AddPlane(quadrics[a], n, d, w);
+                AddPlane(quadrics[b], n, d, w);
+            }
+        }
+    }
+
+    std::vector<u32> remap(vertexCount);
+    std::vector<VertexKind> kind(vertexCount);
+    std::vector<u8> touched(vertexCount);
+    std::vector<u32> adjOffsets(vertexCount + 1);
+    std::vector<u32> adjTris;
+    std::unordered_map<u64, u32> edgeUse;
+    std::vector<Collapse> collapses;
+
+    f64 resultError = 0.0;
+    targetIndexCount = targetIndexCount / 3 * 3;
+
+    // collapse in passes: every pass picks the cheapest independent collapses
+    while(result.size() > targetIndexCount)
+    {
+        u32 triCount = (u32)(result.size() / 3);
+
+        // vertex -> triangle adjacency
+        std::fill(adjOffsets.begin(), adjOffsets.end(), 0);
+        for(u32 v : result)
+            adjOffsets[v + 1]++;
+        for(u32 i = 0; i < vertexCount; i++)
+            adjOffsets[i + 1] += adjOffsets[i];
+
+        adjTris.resize(result.size());
+        {
+            std::vector<u32> fill(adjOffsets.begin(), adjOffsets.end() - 1);
+            for(u32 t = 0; t < triCount; t++)
+                for(i32 k = 0; k < 3; k++)
+                    adjTris[fill[result[t * 3 + k]]++] = t;
+        }
+
+        edgeUse.clear();
+        for(usize i = 0; i < result.size(); i += 3)
+            for(i32 k = 0; k < 3; k++)
+                edgeUse[EdgeKey(result[i + k], result[i + (k + 1) % 3])]++;
+
+        kind = seam;
+        for(const auto &[key, uses] : edgeUse)
+        {
+            if(uses == 1)
+            {
+                for(u32 v : {(u32)(key >> 32), (u32)key})
+                    if(kind[v] == VertexKind::INTERIOR)
+                        kind[v] = VertexKind::BORDER;
+            }
+            else if(uses > 2)
+            {
+                // non-manifold edge
+                kind[(u32)(key >> 32)] = VertexKind::LOCKED;
+                kind[(u32)key] = VertexKind::LOCKED;
+            }
+        }
+
+        auto canCollapse = [&](u32 v0, u32 v1) {
+            if(kind[v0] == VertexKind::LOCKED)
+                return false;
+            if(kind[v0] == VertexKind::BORDER)
+                return edgeUse[EdgeKey(v0, v1)] == 1;
+            return true;
+        };
+
+        collapses.clear();
+        for(const auto &[key, uses] : edgeUse)
+        {
+            u32 a = (u32)(key >> 32), b = (u32)key;
+
+            Collapse best = {0, 0, DBL_MAX};
+            if(canCollapse(a, b))
+                best = {a, b, QuadricError(quadrics[a], positions[b])};
+            if(canCollapse(b, a))
+            {
+                f64 err = QuadricError(quadrics[b], positions[a]);
+                if(err < best.error)
+                    best = {b, a, err};
+            }
+
+            if(best.error <= maxError)
+                collapses.push_back(best);
+        }
+
+        // deterministic order, independent of the hash map's iteration order
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            if(a.error != b.error)
+                return a.error < b.error;
+            if(a.v0 != b.v0)
+                return a.v0 < b.v0;
+            return a.v1 < b.v1;
+        });
+
+        u32 targetTris = (u32)(targetIndexCount / 3);
+        u32 collapsed = 0;
+
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), 0);
+
+        for(const Collapse &c : collapses)
+        {
+            if(triCount <= targetTris)
+                break;
+
+            if(touched[c.v0] || touched[c.v1])
+                continue;
+
+            if(CollapseFlips(positions, result, adjOffsets, adjTris, c.v0, c.v1))
+                continue;
+
+            // lock both 1-rings: their triangles change with this collapse
+            u32 removed = 0;
+            for(u32 v : {c.v0, c.v1})
+            {
+                for(u32 i = adjOffsets[v]; i < adjOffsets[v + 1]; i++)
+                {
+                    const u32 *tri = &result[(usize)adjTris[i] * 3];
+                    touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+
+                    if(v == c.v0 && (tri[0] == c.v1 || tri[1] == c.v1 || tri[2] == c.v1))
+                        removed++;
+                }
+            }
+
+            remap[c.v0] = c.v1;
+            AddQuadric(quadrics[c.v1], quadrics[c.v0]);
+
+            triCount -= removed;
+            resultError = std::max(resultError, c.error);
+            collapsed++;
+        }
+
+        if(collapsed == 0)
+            break;
+
+        // apply the collapses and drop the triangles that became degenerate
+        usize write = 0;
+        for(usize t = 0; t < result.size(); t += 3)
+        {
+            u32 a = remap[result[t]], b = remap[result[t + 1]], c = remap[result[t + 2]];
+            if(a == b || b == c || a == c)
+                continue;
+
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if(outError)
+        *outError = (f32)resultError;
+
+    return result;
+}
+
+std::vector<DEUtil::MeshLOD> DEUtil::BuildLODChain(const std::vector<f32> &vertexData, u32 vertexStride,
+                                                   u32 posComponents, std::vector<u32> &indices, u32 maxLODs,
+                                                   f32 reduction)
+{
+    std::vector<MeshLOD> lods;
+    lods.push_back(MeshLOD{0, (u32)indices.size(), 0.0f});
+
+    // every lod is simplified from lod 0, so errors don't compound
+    std::vector<u32> lod0 = indices;
+    usize target = lod0.size();
+
+    for(u32 i = 1; i < maxLODs; i++)
+    {
+        target = (usize)(target * reduction) / 3 * 3;
+        if(target < 3)
+            break;
+
+        f32 error = 0.0f;
+        std::vector<u32> simplified =
+            SimplifyMesh(vertexData, vertexStride, posComponents, lod0, target, FLT_MAX, &error);
+
+        // stop once simplification stalls (locked/border heavy meshes)
+        const MeshLOD &prev = lods.back();
+        if(simplified.empty() || simplified.size() > prev.indexCount * 0.9f)
+            break;
+
+        lods.push_back(MeshLOD{(u32)indices.size(), (u32)simplified.size(), std::max(error, prev.error)});
+        indices.insert(indices.end(), simplified.begin(), simplified.end());
+
+        target = simplified.size();
+    }
+
+    return lods;
+}
+
+glm::vec4 DEUtil::ComputeMeshBounds(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents)
+{
+    u32 vertexCount = vertexStride ? (u32)(vertexData.size() / vertexStride) : 0;
+
+    std::vector<glm::vec3> points(vertexCount);
+    for(u32 i = 0; i < vertexCount; i++)
+    {
+        const f32 *v = &vertexData[(usize)i * vertexStride];
+        points[i] = glm::vec3(v[0], v[1], posComponents > 2 ? v[2] : 0.0f);
+    }
+
+    return ComputeBoundingSphere(points);
+}
+
+f32 DEUtil::ProjectedSize(const glm::mat4 &clip, glm::vec3 center, f32 length, f32 screenHeight)
+{
+    glm::vec4 p = clip * glm::vec4(center, 1.0f);
+
+    // scale of the clip space y axis (projection y scale times model scale)
+    f32 yScale = glm::length(glm::vec3(clip[0][1], clip[1][1], clip[2][1]));
+    f32 w = std::max(p.w, 1e-4f);
+
+    return length * yScale / w * screenHeight * 0.5f;
+}
+
+u32 DEUtil::SelectLOD(const MeshLOD *lods, u32 lodCount, const glm::mat4 &clip, glm::vec4 bounds, f32 screenHeight,
+                      f32 pixelThreshold)
+{
+    glm::vec3 center = glm::vec3(bounds.x, bounds.y, bounds.z);
+    f32 pixelsPerUnit = ProjectedSize(clip, center, 1.0f, screenHeight);
+
+    u32 lod = 0;
+    for(u32 i = 1; i < lodCount; i++)
+    {
+        if(lods[i].error * pixelsPerUnit > pixelThreshold)
+            break;
+
+        lod = i;
+    }
+
+    return lod;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "../core/defines.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#define MESH_MAX_LODS 8
+
+namespace DEUtil {
+
+struct MeshLOD
+{
+    u32 firstIndex; // relative to the mesh's first index
+    u32 indexCount;
+    f32 error;      // object space deviation from lod 0
+};
+
+// quadric error metric edge collapse down to ~targetIndexCount indices, or until
+// the next collapse would move the surface by more than maxError.
+// collapsed vertices snap onto existing ones, so every lod shares one vertex buffer.
+// positions are read from the first posComponents (2 or 3) floats of every vertex.
+std::vector<u32> SimplifyMesh(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                              const std::vector<u32> &indices, usize targetIndexCount, f32 maxError,
+                              f32 *outError = nullptr);
+
+// appends progressively coarser index lists (each ~reduction times the previous one)
+// after lod 0 in `indices`, and returns the index ranges of every lod (lod 0 included).
+std::vector<MeshLOD> BuildLODChain(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                                   std::vector<u32> &indices, u32 maxLODs = MESH_MAX_LODS, f32 reduction = 0.5f);
+
+// bounding sphere of every vertex as (center, radius).
+glm::vec4 ComputeMeshBounds(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents);
+
+// projected size in pixels of an object space length at `center`.
+// clip is projection * view * model.
+f32 ProjectedSize(const glm::mat4 &clip, glm::vec3 center, f32 length, f32 screenHeight);
+
+// picks the coarsest lod whose error projects to at most pixelThreshold pixels.
+u32 SelectLOD(const MeshLOD *lods, u32 lodCount, const glm::mat4 &clip, glm::vec4 bounds, f32 screenHeight,
+              f32 pixelThreshold = 1.0f);
+
+} // namespace DEUtil
@@ -0,0 +1,25 @@
+#include "meshBuild.h"
+
+DEUtil::MeshBuildOutput DEUtil::BuildMesh(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                                          std::vector<u32> indices, u32 flags)
+{
+    MeshBuildOutput out;
+
+    if(flags & MESH_BUILD_MESHLETS)
+    {
+        MeshletData meshlets = BuildMeshlets(vertexData, vertexStride, posComponents, indices);
+        indices = FlattenMeshletIndices(meshlets);
+        out.meshlets = std::move(meshlets.meshlets);
+    }
+
+    out.indexCount = (u32)indices.size();
+    out.bounds = ComputeMeshBounds(vertexData, vertexStride, posComponents);
+
+    if(flags & MESH_BUILD_LODS)
+        out.lods = BuildLODChain(vertexData, vertexStride, posComponents, indices);
+    else
+        out.lods.push_back(MeshLOD{0, (u32)indices.size(), 0.0f});
+
+    out.indices = std::move(indices);
+    return out;
+}
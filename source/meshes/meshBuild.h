@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "meshlet.h"
+#include "lod.h"
+
+#include <vector>
+
+// flags for BuildMesh / indexed VertexMenagerie::Consume
+#define MESH_BUILD_MESHLETS BIT(0)
+#define MESH_BUILD_LODS     BIT(1)
+
+namespace DEUtil {
+
+struct MeshBuildOutput
+{
+    // lod 0 (in meshlet order with MESH_BUILD_MESHLETS) followed by the coarser lods
+    std::vector<u32> indices;
+    u32 indexCount; // lod 0 only
+
+    // triangleOffsets are relative to the mesh's first index
+    std::vector<Meshlet> meshlets;
+
+    std::vector<MeshLOD> lods; // always has at least lod 0
+    glm::vec4 bounds;
+};
+
+// shared by VertexMenagerie (runtime) and the mesh cooker (offline).
+MeshBuildOutput BuildMesh(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                          std::vector<u32> indices, u32 flags);
+
+} // namespace DEUtil
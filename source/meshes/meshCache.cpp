@@ -0,0 +1,355 @@
+#include "meshCache.h"
+#include "meshBuild.h"
+#include "../core/logger.h"
+
+#include <cstring>
+#include <fstream>
+
+// fnv-1a
+u32 DEUtil::HashMeshName(const char *name)
+{
+    u32 hash = 2166136261u;
+    for(const char *c = name; *c; c++)
+    {
+        hash ^= (u8)*c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static inline const MeshCacheSection &GetSection(const MeshCacheHeader *header, MeshCacheSectionType type)
+{
+    return header->sections[(u32)type];
+}
+
+// every range a record points at lies inside its section, so nothing handed out of the
+// mapping can read past it. the index values themselves aren't scanned.
+static bool ValidateRecord(const MeshCacheHeader *head, const u8 *data, const MeshCacheRecord &record)
+{
+    const MeshCacheSection &names = GetSection(head, MeshCacheSectionType::NAMES);
+    if(record.nameOffset >= names.size ||
+       !memchr(data + names.offset + record.nameOffset, '\0', names.size - record.nameOffset))
+        return false;
+
+    u64 vertexTotal = GetSection(head, MeshCacheSectionType::VERTICES).size / ((u64)head->vertexStride * sizeof(f32));
+    if((u64)record.firstVertex + record.vertexCount > vertexTotal)
+        return false;
+
+    if(record.lodCount > MESH_MAX_LODS)
+        return false;
+
+    // the last lod ends the mesh (GetTotalIndexCount()), every other range has to end before it
+    u64 indexCount = record.indexCount;
+    if(record.lodCount > 0)
+        indexCount = (u64)record.lods[record.lodCount - 1].firstIndex + record.lods[record.lodCount - 1].indexCount;
+    if(record.indexCount > indexCount)
+        return false;
+    for(u32 i = 0; i < record.lodCount; i++)
+    {
+        if((u64)record.lods[i].firstIndex + record.lods[i].indexCount > indexCount)
+            return false;
+    }
+
+    u64 indexTotal = GetSection(head, MeshCacheSectionType::INDICES).size / sizeof(u32);
+    if((u64)record.firstIndex + indexCount > indexTotal)
+        return false;
+
+    // indices are relative to firstVertex, one past vertexCount draws another mesh's vertices
+    // (or reads past the vertex buffer)
+    const u32 *indices = (const u32 *)(data + GetSection(head, MeshCacheSectionType::INDICES).offset) + record.firstIndex;
+    for(u64 i = 0; i < indexCount; i++)
+    {
+        if(indices[i] >= record.vertexCount)
+            return false;
+    }
+
+    u64 meshletTotal = GetSection(head, MeshCacheSectionType::MESHLETS).size / sizeof(DEUtil::Meshlet);
+    if((u64)record.firstMeshlet + record.meshletCount > meshletTotal)
+        return false;
+
+    // meshlets draw triangles out of lod 0
+    const DEUtil::Meshlet *meshlets =
+        (const DEUtil::Meshlet *)(data + GetSection(head, MeshCacheSectionType::MESHLETS).offset) + record.firstMeshlet;
+    for(u32 i = 0; i < record.meshletCount; i++)
+    {
+        if(((u64)meshlets[i].triangleOffset + meshlets[i].triangleCount) * 3 > record.indexCount)
+            return false;
+    }
+
+    return true;
+}
+
+#pragma region MeshCache
+
+DEUtil::MeshCache::MeshCache() : header{nullptr} {}
+
+bool DEUtil::MeshCache::Open(const char *filepath)
+{
+    header = nullptr;
+
+    if(!file.Open(filepath))
+        return false;
+
+    if(file.GetSize() < sizeof(MeshCacheHeader))
+    {
+        LERROR("mesh cache: " << filepath << " is too small to be a mesh cache.\n");
+        return false;
+    }
+
+    const MeshCacheHeader *head = (const MeshCacheHeader *)file.GetData();
+    if(head->magic != MESH_CACHE_MAGIC || head->version != MESH_CACHE_VERSION)
+    {
+        LERROR("mesh cache: " << filepath << " has a bad magic or version (" << head->version << ", expected "
+                              << MESH_CACHE_VERSION << ").\n");
+        return false;
+    }
+
+    if(head->fileSize != file.GetSize())
+    {
+        LERROR("mesh cache: " << filepath << " is truncated.\n");
+        return false;
+    }
+
+    for(u32 i = 0; i < (u32)MeshCacheSectionType::COUNT; i++)
+    {
+        const MeshCacheSection &section = head->sections[i];
+        if(section.offset % MESH_CACHE_ALIGNMENT != 0 || section.offset > head->fileSize ||
+           section.size > head->fileSize - section.offset)
+        {
+            LERROR("mesh cache: " << filepath << " has a corrupt section table.\n");
+            return false;
+        }
+    }
+
+    // the hash table relies on a power of two slot count
+    bool sizesMatch =
+        GetSection(head, MeshCacheSectionType::MESHES).size == (u64)head->meshCount * sizeof(MeshCacheRecord) &&
+        GetSection(head, MeshCacheSectionType::HASHES).size == (u64)head->hashSlots * sizeof(u32) &&
+        head->hashSlots != 0 && (head->hashSlots & (head->hashSlots - 1)) == 0 && head->hashSlots > head->meshCount;
+
+    if(!sizesMatch)
+    {
+        LERROR("mesh cache: " << filepath << " has corrupt mesh or hash tables.\n");
+        return false;
+    }
+
+    if(head->vertexStride == 0 || head->positionComponents > head->vertexStride)
+    {
+        LERROR("mesh cache: " << filepath << " has a bad vertex layout (stride " << head->vertexStride << ").\n");
+        return false;
+    }
+
+    const MeshCacheRecord *records =
+        (const MeshCacheRecord *)(file.GetData() + GetSection(head, MeshCacheSectionType::MESHES).offset);
+    for(u32 i = 0; i < head->meshCount; i++)
+    {
+        if(!ValidateRecord(head, file.GetData(), records[i]))
+        {
+            LERROR("mesh cache: " << filepath << " has a corrupt record for mesh " << i << ".\n");
+            return false;
+        }
+    }
+
+    header = head;
+    return true;
+}
+
+const MeshCacheRecord *DEUtil::MeshCache::GetRecords() const
+{
+    return (const MeshCacheRecord *)(file.GetData() + GetSection(header, MeshCacheSectionType::MESHES).offset);
+}
+
+const MeshCacheRecord *DEUtil::MeshCache::Find(const char *name) const
+{
+    if(!header)
+        return nullptr;
+
+    const u32 *slots = (const u32 *)(file.GetData() + GetSection(header, MeshCacheSectionType::HASHES).offset);
+    const MeshCacheRecord *records = GetRecords();
+
+    u32 hash = HashMeshName(name);
+    u32 mask = header->hashSlots - 1;
+
+    // linear probing, bounded in case of a corrupt (full) table
+    u32 i = hash & mask;
+    for(u32 probe = 0; probe < header->hashSlots; probe++, i = (i + 1) & mask)
+    {
+        u32 slot = slots[i];
+        if(slot == 0 || slot > header->meshCount)
+            return nullptr;
+
+        const MeshCacheRecord &record = records[slot - 1];
+        if(record.nameHash == hash && strcmp(GetName(record), name) == 0)
+            return &record;
+    }
+
+    return nullptr;
+}
+
+const char *DEUtil::MeshCache::GetName(const MeshCacheRecord &record) const
+{
+    const MeshCacheSection &names = GetSection(header, MeshCacheSectionType::NAMES);
+    if(record.nameOffset >= names.size)
+        return "";
+
+    return (const char *)(file.GetData() + names.offset + record.nameOffset);
+}
+
+const f32 *DEUtil::MeshCache::GetVertices(const MeshCacheRecord &record) const
+{
+    const f32 *vertices = (const f32 *)(file.GetData() + GetSection(header, MeshCacheSectionType::VERTICES).offset);
+    return vertices + (usize)record.firstVertex * header->vertexStride;
+}
+
+const u32 *DEUtil::MeshCache::GetIndices(const MeshCacheRecord &record) const
+{
+    const u32 *indices = (const u32 *)(file.GetData() + GetSection(header, MeshCacheSectionType::INDICES).offset);
+    return indices + record.firstIndex;
+}
+
+const DEUtil::Meshlet *DEUtil::MeshCache::GetMeshlets(const MeshCacheRecord &record) const
+{
+    const Meshlet *meshlets = (const Meshlet *)(file.GetData() + GetSection(header, MeshCacheSectionType::MESHLETS).offset);
+    return meshlets + record.firstMeshlet;
+}
+
+u32 DEUtil::MeshCache::GetTotalIndexCount(const MeshCacheRecord &record) const
+{
+    if(record.lodCount == 0)
+        return record.indexCount;
+
+    // lods are stored back to back, the last one ends the mesh
+    const MeshLOD &last = record.lods[record.lodCount - 1];
+    return last.firstIndex + last.indexCount;
+}
+
+#pragma endregion
+
+#pragma region MeshCacheWriter
+
+DEUtil::MeshCacheWriter::MeshCacheWriter(u32 vertexStride, u32 positionComponents)
+    : vertexStride{vertexStride}, positionComponents{positionComponents}
+{
+}
+
+bool DEUtil::MeshCacheWriter::AddMesh(const std::string &name, const std::vector<f32> &vertexData,
+                                      const std::vector<u32> &indexData, u32 flags)
+{
+    if(vertexData.size() % vertexStride != 0)
+    {
+        LERROR("mesh cache: mesh " << name << " doesn't have whole vertices (stride " << vertexStride << ").\n");
+        return false;
+    }
+
+    u32 hash = HashMeshName(name.c_str());
+    for(const MeshCacheRecord &record : records)
+    {
+        if(record.nameHash == hash && name == names.c_str() + record.nameOffset)
+        {
+            LERROR("mesh cache: duplicate mesh name " << name << ".\n");
+            return false;
+        }
+    }
+
+    MeshBuildOutput mesh = BuildMesh(vertexData, vertexStride, positionComponents, indexData, flags);
+
+    MeshCacheRecord record{};
+    record.nameOffset = (u32)names.size();
+    record.nameHash = hash;
+    record.firstVertex = (u32)(vertices.size() / vertexStride);
+    record.vertexCount = (u32)(vertexData.size() / vertexStride);
+    record.firstIndex = (u32)indices.size();
+    record.indexCount = mesh.indexCount;
+    record.firstMeshlet = (u32)meshlets.size();
+    record.meshletCount = (u32)mesh.meshlets.size();
+    record.lodCount = (u32)std::min<usize>(mesh.lods.size(), MESH_MAX_LODS);
+    record.bounds = mesh.bounds;
+    std::copy(mesh.lods.begin(), mesh.lods.begin() + record.lodCount, record.lods);
+
+    names.append(name).push_back('\0');
+    vertices.insert(vertices.end(), vertexData.begin(), vertexData.end());
+    indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+    meshlets.insert(meshlets.end(), mesh.meshlets.begin(), mesh.meshlets.end());
+    records.push_back(record);
+
+    return true;
+}
+
+bool DEUtil::MeshCacheWriter::Write(const char *filepath) const
+{
+    // at most half full, so probes stay short
+    u32 hashSlots = 1;
+    while(hashSlots < records.size() * 2 + 1)
+        hashSlots <<= 1;
+
+    std::vector<u32> slots(hashSlots, 0);
+    for(u32 i = 0; i < records.size(); i++)
+    {
+        u32 mask = hashSlots - 1;
+        u32 slot = records[i].nameHash & mask;
+        while(slots[slot] != 0)
+            slot = (slot + 1) & mask;
+
+        slots[slot] = i + 1;
+    }
+
+    const void *sectionData[(u32)MeshCacheSectionType::COUNT] = {
+        records.data(), slots.data(), names.data(), vertices.data(), indices.data(), meshlets.data(),
+    };
+
+    u64 sectionSizes[(u32)MeshCacheSectionType::COUNT] = {
+        records.size() * sizeof(MeshCacheRecord),
+        slots.size() * sizeof(u32),
+        names.size(),
+        vertices.size() * sizeof(f32),
+        indices.size() * sizeof(u32),
+        meshlets.size() * sizeof(Meshlet),
+    };
+
+    MeshCacheHeader header{};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.vertexStride = vertexStride;
+    header.positionComponents = positionComponents;
+    header.meshCount = (u32)records.size();
+    header.hashSlots = hashSlots;
+
+    u64 offset = sizeof(MeshCacheHeader);
+    for(u32 i = 0; i < (u32)MeshCacheSectionType::COUNT; i++)
+    {
+        offset = (offset + MESH_CACHE_ALIGNMENT - 1) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+        header.sections[i].offset = offset;
+        header.sections[i].size = sectionSizes[i];
+        offset += sectionSizes[i];
+    }
+    header.fileSize = offset;
+
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        LERROR("mesh cache: couldn't open file with path: " << filepath << "\n");
+        return false;
+    }
+
+    static const char padding[MESH_CACHE_ALIGNMENT] = {};
+
+    out.write((const char *)&header, sizeof(header));
+    u64 written = sizeof(header);
+    for(u32 i = 0; i < (u32)MeshCacheSectionType::COUNT; i++)
+    {
+        out.write(padding, header.sections[i].offset - written);
+        out.write((const char *)sectionData[i], sectionSizes[i]);
+        written = header.sections[i].offset + sectionSizes[i];
+    }
+
+    if(!out.good())
+    {
+        LERROR("mesh cache: failed writing " << filepath << "\n");
+        return false;
+    }
+
+    return true;
+}
+
+#pragma endregion
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../core/mappedFile.h"
+#include "meshlet.h"
+#include "lod.h"
+
+#include <string>
+#include <vector>
+
+// ---------------------- MESH CACHE FORMAT (.dmc) ----------------------
+//
+// [header][section]...[section], every section starts MESH_CACHE_ALIGNMENT aligned.
+// everything is little endian and laid out exactly like the structs below,
+// so a mapped file is used in place without parsing.
+
+#define MESH_CACHE_MAGIC     0x48534d44 // "DMSH"
+#define MESH_CACHE_VERSION   1
+#define MESH_CACHE_ALIGNMENT 64
+
+enum class MeshCacheSectionType
+{
+    MESHES = 0,   // MeshCacheRecord[meshCount]
+    HASHES = 1,   // u32[hashSlots], record index + 1, 0 is an empty slot
+    NAMES = 2,    // null terminated mesh names
+    VERTICES = 3, // f32[vertexStride * vertexCount]
+    INDICES = 4,  // u32[], relative to each mesh's first vertex
+    MESHLETS = 5, // DEUtil::Meshlet[], triangleOffset relative to the mesh's first index
+
+    COUNT = 6
+};
+
+struct MeshCacheSection
+{
+    u64 offset; // from the start of the file
+    u64 size;   // in bytes
+};
+
+struct MeshCacheHeader
+{
+    u32 magic;
+    u32 version;
+    u32 vertexStride;       // floats per vertex
+    u32 positionComponents; // leading floats of a vertex that make up its position
+    u32 meshCount;
+    u32 hashSlots; // power of two
+    u64 fileSize;
+
+    MeshCacheSection sections[(u32)MeshCacheSectionType::COUNT];
+};
+
+struct MeshCacheRecord
+{
+    u32 nameOffset; // into the NAMES section
+    u32 nameHash;
+
+    u32 firstVertex; // into the VERTICES section (in vertices)
+    u32 vertexCount;
+    u32 firstIndex; // into the INDICES section
+    u32 indexCount; // lod 0
+    u32 firstMeshlet;
+    u32 meshletCount;
+    u32 lodCount;
+    u32 reserved[3];
+
+    glm::vec4 bounds;
+    DEUtil::MeshLOD lods[MESH_MAX_LODS];
+};
+
+ST_ASSERT(sizeof(MeshCacheHeader) == 128, "expected MeshCacheHeader to be 128 bytes.");
+ST_ASSERT(sizeof(MeshCacheRecord) == 160, "expected MeshCacheRecord to be 160 bytes.");
+
+namespace DEUtil {
+
+u32 HashMeshName(const char *name);
+
+// read side: maps a cooked file and hands out pointers into the mapping.
+class MeshCache
+{
+    private:
+    MappedFile file;
+    const MeshCacheHeader *header;
+
+    public:
+    MeshCache();
+
+    // validates the header and section bounds, returns false (and logs) on failure.
+    bool Open(const char *filepath);
+
+    // O(1) (open addressing) lookup, nullptr if there's no such mesh.
+    const MeshCacheRecord *Find(const char *name) const;
+
+    inline const MeshCacheHeader *GetHeader() const { return header; }
+    inline u32 GetMeshCount() const { return header ? header->meshCount : 0; }
+
+    const MeshCacheRecord *GetRecords() const;
+    const char *GetName(const MeshCacheRecord &record) const;
+    const f32 *GetVertices(const MeshCacheRecord &record) const;
+    const u32 *GetIndices(const MeshCacheRecord &record) const; // every lod of the mesh
+    const Meshlet *GetMeshlets(const MeshCacheRecord &record) const;
+
+    // total index count of the mesh, lod 0 and the coarser lods
+    u32 GetTotalIndexCount(const MeshCacheRecord &record) const;
+
+    ~MeshCache() = default;
+};
+
+// write side, used by the mesh cooker.
+class MeshCacheWriter
+{
+    private:
+    u32 vertexStride, positionComponents;
+
+    std::vector<MeshCacheRecord> records;
+    std::string names;
+    std::vector<f32> vertices;
+    std::vector<u32> indices;
+    std::vector<Meshlet> meshlets;
+
+    public:
+    MeshCacheWriter(u32 vertexStride, u32 positionComponents);
+
+    // flags are MESH_BUILD_* (meshlets and lods are built at cook time).
+    bool AddMesh(const std::string &name, const std::vector<f32> &vertexData, const std::vector<u32> &indexData,
+                 u32 flags);
+
+    bool Write(const char *filepath) const;
+
+    ~MeshCacheWriter() = default;
+};
+
+} // namespace DEUtil
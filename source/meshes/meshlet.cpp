@@ -0,0 +1,320 @@
+#include "meshlet.h"
+
+#include <cmath>
+#include <algorithm>
+
+#define MESHLET_NOT_LOCAL 0xff // local index of a vertex that isn't in the current meshlet
+
+static glm::vec3 ReadPosition(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents, u32 index)
+{
+    const f32 *v = &vertexData[(usize)index * vertexStride];
+    return glm::vec3(v[0], v[1], posComponents > 2 ? v[2] : 0.0f);
+}
+
+// ritter's bounding sphere, or the aabb's sphere if that one is tighter
+glm::vec4 DEUtil::ComputeBoundingSphere(const std::vector<glm::vec3> &points)
+{
+    if(points.empty())
+        return glm::vec4(0.0f);
+
+    // pick the pair of axis-extreme points that are the furthest apart
+    u32 minIdx[3] = {0, 0, 0};
+    u32 maxIdx[3] = {0, 0, 0};
+    for(u32 i = 0; i < points.size(); i++)
+    {
+        for(i32 axis = 0; axis < 3; axis++)
+        {
+            if(points[i][axis] < points[minIdx[axis]][axis])
+                minIdx[axis] = i;
+            if(points[i][axis] > points[maxIdx[axis]][axis])
+                maxIdx[axis] = i;
+        }
+    }
+
+    i32 widest = 0;
+    f32 widestDist = -1.0f;
+    for(i32 axis = 0; axis < 3; axis++)
+    {
+        glm::vec3 d = points[maxIdx[axis]] - points[minIdx[axis]];
+        f32 dist = glm::dot(d, d);
+        if(dist > widestDist)
+        {
+            widestDist = dist;
+            widest = axis;
+        }
+    }
+
+    glm::vec3 center = (points[minIdx[widest]] + points[maxIdx[widest]]) * 0.5f;
+    f32 radius = std::sqrt(widestDist) * 0.5f;
+
+    // grow the sphere until it covers every point
+    for(const glm::vec3 &p : points)
+    {
+        f32 dist = glm::length(p - center);
+        if(dist > radius)
+        {
+            f32 grow = (dist - radius) * 0.5f;
+            center += (p - center) * (grow / dist);
+            radius += grow;
+        }
+    }
+
+    // the aabb's sphere beats ritter on box-like inputs (grids, quads)
+    glm::vec3 boxMin = points[0], boxMax = points[0];
+    for(const glm::vec3 &p : points)
+    {
+        boxMin = glm::min(boxMin, p);
+        boxMax = glm::max(boxMax, p);
+    }
+
+    glm::vec3 boxCenter = (boxMin + boxMax) * 0.5f;
+    f32 boxRadius = 0.0f;
+    for(const glm::vec3 &p : points)
+        boxRadius = std::max(boxRadius, glm::length(p - boxCenter));
+
+    if(boxRadius < radius)
+        return glm::vec4(boxCenter, boxRadius);
+
+    return glm::vec4(center, radius);
+}
+
+static void FinishMeshlet(DEUtil::MeshletData &out, DEUtil::Meshlet &meshlet, const std::vector<f32> &vertexData,
+                          u32 vertexStride, u32 posComponents)
+{
+    if(meshlet.triangleCount == 0)
+        return;
+
+    std::vector<glm::vec3> points(meshlet.vertexCount);
+    for(u32 i = 0; i < meshlet.vertexCount; i++)
+        points[i] = ReadPosition(vertexData, vertexStride, posComponents, out.vertices[meshlet.vertexOffset + i]);
+
+    glm::vec4 sphere = DEUtil::ComputeBoundingSphere(points);
+    glm::vec3 center = glm::vec3(sphere.x, sphere.y, sphere.z);
+
+    // normal cone: average the unit triangle normals, then find the widest deviation.
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec3> corners;
+    normals.reserve(meshlet.triangleCount);
+    corners.reserve(meshlet.triangleCount);
+
+    glm::vec3 axis = glm::vec3(0.0f);
+    for(u32 t = 0; t < meshlet.triangleCount; t++)
+    {
+        const u8 *tri = &out.triangles[(usize)(meshlet.triangleOffset + t) * 3];
+        glm::vec3 p0 = points[tri[0]];
+        glm::vec3 p1 = points[tri[1]];
+        glm::vec3 p2 = points[tri[2]];
+
+        // clockwise front faces
+        glm::vec3 n = glm::cross(p2 - p0, p1 - p0);
+        f32 area = glm::length(n);
+        if(area <= 1e-12f)
+            continue; // degenerate triangles don't constrain the cone
+
+        n /= area;
+        normals.push_back(n);
+        corners.push_back(p0);
+        axis += n;
+    }
+
+    meshlet.boundingSphere = sphere;
+    meshlet.coneApex = glm::vec4(center, 0.0f);
+    meshlet.coneAxis = glm::vec4(0.0f, 0.0f, 0.0f, 2.0f);
+
+    f32 axisLength = glm::length(axis);
+    if(axisLength > 1e-6f)
+    {
+        axis /= axisLength;
+
+        f32 minDot = 1.0f;
+        for(const glm::vec3 &n : normals)
+            minDot = std::min(minDot, glm::dot(n, axis));
+
+        // cones wider than ~84 degrees reject too little to be worth testing
+        if(minDot > 0.1f)
+        {
+            // move the apex back along the axis so every triangle plane is in front of it
+            f32 maxT = 0.0f;
+            for(usize i = 0; i < normals.size(); i++)
+            {
+                f32 dc = glm::dot(center - corners[i], normals[i]);
+                f32 dn = glm::dot(axis, normals[i]);
+                maxT = std::max(maxT, dc / dn);
+            }
+
+            meshlet.coneApex = glm::vec4(center - axis * maxT, 0.0f);
+            meshlet.coneAxis = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+        }
+    }
+
+    out.meshlets.push_back(meshlet);
+}
+
+DEUtil::MeshletData DEUtil::BuildMeshlets(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                                          const std::vector<u32> &indices, u32 maxVertices, u32 maxTriangles)
+{
+    MeshletData out;
+
+    // local indices are stored as u8 and the sentinel takes the last value, so a meshlet
+    // has to stop one vertex short of it or its last vertex reads as "not in this meshlet"
+    maxVertices = std::min<u32>(maxVertices, MESHLET_NOT_LOCAL);
+    if(vertexStride == 0 || maxVertices < 3 || maxTriangles == 0)
+        return out;
+
+    u32 vertexCount = (u32)(vertexData.size() / vertexStride);
+    u32 triangleCount = (u32)(indices.size() / 3);
+
+    out.meshlets.reserve(triangleCount / maxTriangles + 1);
+    out.vertices.reserve(indices.size());
+    out.triangles.reserve((usize)triangleCount * 3);
+
+    // mesh vertex -> local index in the current meshlet
+    std::vector<u8> local(vertexCount, MESHLET_NOT_LOCAL);
+
+    Meshlet meshlet{};
+
+    // greedy scan in index order, which keeps the input's vertex locality.
+    for(u32 t = 0; t < triangleCount; t++)
+    {
+        u32 a = indices[t * 3 + 0];
+        u32 b = indices[t * 3 + 1];
+        u32 c = indices[t * 3 + 2];
+
+        if(a >= vertexCount || b >= vertexCount || c >= vertexCount)
+            continue;
+
+        // degenerate triangles don't rasterize anything
+        if(a == b || b == c || a == c)
+            continue;
+
+        u32 newVertices =
+            (local[a] == MESHLET_NOT_LOCAL) + (local[b] == MESHLET_NOT_LOCAL) + (local[c] == MESHLET_NOT_LOCAL);
+
+        if(meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount + 1 > maxTriangles)
+        {
+            for(u32 i = 0; i < meshlet.vertexCount; i++)
+                local[out.vertices[meshlet.vertexOffset + i]] = MESHLET_NOT_LOCAL;
+
+            FinishMeshlet(out, meshlet, vertexData, vertexStride, posComponents);
+
+            meshlet = Meshlet{};
+            meshlet.vertexOffset = (u32)out.vertices.size();
+            meshlet.triangleOffset = (u32)(out.triangles.size() / 3);
+        }
+
+        for(u32 v : {a, b, c})
+        {
+            if(local[v] == MESHLET_NOT_LOCAL)
+            {
+                local[v] = (u8)meshlet.vertexCount++;
+                out.vertices.push_back(v);
+            }
+
+            out.triangles.push_back(local[v]);
+        }
+
+        meshlet.triangleCount++;
+    }
+
+    FinishMeshlet(out, meshlet, vertexData, vertexStride, posComponents);
+
+    return out;
+}
+
+std::vector<u32> DEUtil::FlattenMeshletIndices(const MeshletData &data)
+{
+    std::vector<u32> indices;
+    indices.reserve(data.triangles.size());
+
+    for(const Meshlet &meshlet : data.meshlets)
+    {
+        for(u32 i = 0; i < meshlet.triangleCount * 3; i++)
+        {
+            u8 localIdx = data.triangles[(usize)meshlet.triangleOffset * 3 + i];
+            indices.push_back(data.vertices[meshlet.vertexOffset + localIdx]);
+        }
+    }
+
+    return indices;
+}
+
+DEUtil::Frustum DEUtil::ExtractFrustum(const glm::mat4 &clip)
+{
+    // rows of the (column major) clip matrix
+    glm::vec4 row[4];
+    for(i32 r = 0; r < 4; r++)
+        row[r] = glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+
+    Frustum frustum;
+    frustum.planes[0] = row[3] + row[0]; // left
+    frustum.planes[1] = row[3] - row[0]; // right
+    frustum.planes[2] = row[3] + row[1]; // top (vulkan y points down)
+    frustum.planes[3] = row[3] - row[1]; // bottom
+    frustum.planes[4] = row[2];          // near (0..1 depth)
+    frustum.planes[5] = row[3] - row[2]; // far
+
+    for(glm::vec4 &plane : frustum.planes)
+    {
+        f32 len = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        if(len > 0.0f)
+            plane /= len;
+    }
+
+    return frustum;
+}
+
+bool DEUtil::SphereInFrustum(const Frustum &frustum, glm::vec3 center, f32 radius)
+{
+    for(const glm::vec4 &plane : frustum.planes)
+    {
+        if(glm::dot(glm::vec3(plane.x, plane.y, plane.z), center) + plane.w < -radius)
+            return false;
+    }
+
+    return true;
+}
+
+bool DEUtil::BoxInFrustum(const Frustum &frustum, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+    for(const glm::vec4 &plane : frustum.planes)
+    {
+        // the corner furthest along the plane's normal
+        glm::vec3 corner = glm::vec3(
+            plane.x >= 0.0f ? boxMax.x : boxMin.x,
+            plane.y >= 0.0f ? boxMax.y : boxMin.y,
+            plane.z >= 0.0f ? boxMax.z : boxMin.z
+        );
+
+        if(glm::dot(glm::vec3(plane.x, plane.y, plane.z), corner) + plane.w < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+bool DEUtil::MeshletBackfacing(const Meshlet &meshlet, glm::vec3 cameraPos)
+{
+    f32 cutoff = meshlet.coneAxis.w;
+    if(cutoff > 1.0f)
+        return false;
+
+    glm::vec3 apex = glm::vec3(meshlet.coneApex.x, meshlet.coneApex.y, meshlet.coneApex.z);
+    glm::vec3 axis = glm::vec3(meshlet.coneAxis.x, meshlet.coneAxis.y, meshlet.coneAxis.z);
+
+    glm::vec3 view = apex - cameraPos;
+    f32 dist = glm::length(view);
+    if(dist <= 0.0f)
+        return false;
+
+    return glm::dot(view, axis) >= cutoff * dist;
+}
+
+bool DEUtil::MeshletVisible(const Meshlet &meshlet, const Frustum &frustum, glm::vec3 cameraPos)
+{
+    glm::vec3 center = glm::vec3(meshlet.boundingSphere.x, meshlet.boundingSphere.y, meshlet.boundingSphere.z);
+
+    if(!SphereInFrustum(frustum, center, meshlet.boundingSphere.w))
+        return false;
+
+    return !MeshletBackfacing(meshlet, cameraPos);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "../core/defines.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// default meshlet limits (fits NV/AMD mesh shader output limits)
+#define MESHLET_MAX_VERTICES  64
+#define MESHLET_MAX_TRIANGLES 124
+
+namespace DEUtil {
+
+// NOTE: layout matches the std430 struct in res/shaders/cull.comp
+struct Meshlet
+{
+    glm::vec4 boundingSphere; // xyz: center, w: radius
+    glm::vec4 coneApex;       // xyz: apex, w: unused
+    glm::vec4 coneAxis;       // xyz: axis, w: cutoff, > 1 means the meshlet is never backface culled
+
+    u32 vertexOffset;   // into MeshletData::vertices
+    u32 triangleOffset; // into MeshletData::triangles (in triangles, not bytes)
+    u32 vertexCount;
+    u32 triangleCount;
+};
+
+ST_ASSERT(sizeof(Meshlet) == 64, "expected Meshlet to be 64 bytes (std430).");
+
+struct MeshletData
+{
+    std::vector<Meshlet> meshlets;
+    std::vector<u32> vertices; // meshlet-local vertex -> mesh vertex index
+    std::vector<u8> triangles; // 3 meshlet-local vertex indices per triangle
+};
+
+// planes are (normal, distance) with normals pointing inside.
+struct Frustum
+{
+    glm::vec4 planes[6];
+};
+
+// splits an indexed triangle list into meshlets.
+// positions are read from the first posComponents (2 or 3) floats of every vertex.
+// front faces wind clockwise, same as the graphics pipeline's rasterizer state.
+MeshletData BuildMeshlets(const std::vector<f32> &vertexData, u32 vertexStride, u32 posComponents,
+                          const std::vector<u32> &indices, u32 maxVertices = MESHLET_MAX_VERTICES,
+                          u32 maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// tight bounding sphere of a point set as (center, radius).
+glm::vec4 ComputeBoundingSphere(const std::vector<glm::vec3> &points);
+
+// expands meshlet triangles back into a mesh index list, meshlet by meshlet.
+// meshlet i then covers indices [triangleOffset * 3, (triangleOffset + triangleCount) * 3).
+std::vector<u32> FlattenMeshletIndices(const MeshletData &data);
+
+// extracts the frustum planes of a (vulkan, 0..1 depth) clip matrix.
+// pass projection * view * model to get the planes in object space.
+Frustum ExtractFrustum(const glm::mat4 &clip);
+
+bool SphereInFrustum(const Frustum &frustum, glm::vec3 center, f32 radius);
+
+// conservative, only rejects boxes fully outside one plane.
+bool BoxInFrustum(const Frustum &frustum, glm::vec3 boxMin, glm::vec3 boxMax);
+
+// true if every triangle in the meshlet faces away from cameraPos.
+bool MeshletBackfacing(const Meshlet &meshlet, glm::vec3 cameraPos);
+
+// cameraPos has to be in the same space as the frustum (object space).
+bool MeshletVisible(const Meshlet &meshlet, const Frustum &frustum, glm::vec3 cameraPos);
+
+} // namespace DEUtil
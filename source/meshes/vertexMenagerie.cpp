@@ -1,44 +1,187 @@
 #include "vertexMenagerie.h"
 
+// floats per vertex (pos.xy, color.rgb), see GetPosColorBindingDescription()
+#define VERTEX_STRIDE 5
+
 VertexMenagerie::VertexMenagerie()
 {
     offset = 0;
 }
 
-void VertexMenagerie::Consume(MeshType type, std::vector<f32> vertexData)
+MeshHandle VertexMenagerie::Register(const VertexData &data)
+{
+    if(!freeSlots.empty())
+    {
+        u32 index = freeSlots.back();
+        freeSlots.pop_back();
+
+        meshTable[index] = data;
+        return MeshHandle{index, generations[index]};
+    }
+
+    meshTable.push_back(data);
+    generations.push_back(1);
+    return MeshHandle{(u32)meshTable.size() - 1, 1};
+}
+
+void VertexMenagerie::Release(MeshHandle handle)
+{
+    if(!IsValid(handle))
+    {
+        LWARN(true, "releasing a stale mesh handle (" << handle.index << ", " << handle.generation << ").\n");
+        return;
+    }
+
+    meshTable[handle.index] = VertexData{};
+
+    // skip 0 on wrap around so MESH_HANDLE_NULL stays invalid
+    u32 &generation = generations[handle.index];
+    generation = generation + 1 == 0 ? 1 : generation + 1;
+    freeSlots.push_back(handle.index);
+}
+
+MeshHandle VertexMenagerie::Consume(std::vector<f32> vertexData)
 {
     for(f32 attrib : vertexData)
     {
         lump.push_back(attrib);
     }
 
-    i32 vertexCount = (i32)vertexData.size() / 5;
+    VertexData data{};
+    data.offset = offset;
+    data.size   = (i32)vertexData.size() / VERTEX_STRIDE;
 
-    vertexAttribData.insert(std::make_pair(type, VertexData{offset, vertexCount}));
+    offset += data.size;
 
-    offset += vertexCount;
+    return Register(data);
 }
 
-void VertexMenagerie::Finalize(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice)
+MeshHandle VertexMenagerie::Consume(std::vector<f32> vertexData, std::vector<u32> indexData, u32 flags)
 {
-    this->device = logicalDevice;
+    DEUtil::MeshBuildOutput mesh = DEUtil::BuildMesh(vertexData, VERTEX_STRIDE, 2, indexData, flags);
+
+    VertexData data{};
+    data.offset       = offset;
+    data.size         = (i32)vertexData.size() / VERTEX_STRIDE;
+    data.firstIndex   = (i32)indexLump.size();
+    data.indexCount   = (i32)mesh.indexCount;
+    data.firstMeshlet = (i32)meshletLump.size();
+    data.meshletCount = (i32)mesh.meshlets.size();
+    data.lodCount     = (i32)mesh.lods.size();
+    data.bounds       = mesh.bounds;
+    std::copy(mesh.lods.begin(), mesh.lods.end(), data.lods);
+
+    // rebase meshlets onto the shared index buffer
+    for(DEUtil::Meshlet meshlet : mesh.meshlets)
+    {
+        meshlet.triangleOffset += (u32)data.firstIndex / 3;
+        meshletLump.push_back(meshlet);
+    }
 
+    lump.insert(lump.end(), vertexData.begin(), vertexData.end());
+    indexLump.insert(indexLump.end(), mesh.indices.begin(), mesh.indices.end());
+
+    offset += data.size;
+
+    return Register(data);
+}
+
+MeshHandle VertexMenagerie::Consume(const DEUtil::MeshCache &cache, const char *name)
+{
+    const MeshCacheRecord *record = cache.Find(name);
+    if(!record)
+    {
+        LERROR("mesh cache has no mesh named: " << name << "\n");
+        return MESH_HANDLE_NULL;
+    }
+
+    const MeshCacheHeader *header = cache.GetHeader();
+    if(header->vertexStride != VERTEX_STRIDE || header->positionComponents != 2)
+    {
+        LERROR("mesh " << name << " was cooked with a different vertex layout (stride " << header->vertexStride
+                       << ", expected " << VERTEX_STRIDE << ").\n");
+        return MESH_HANDLE_NULL;
+    }
+
+    VertexData data{};
+    data.offset       = offset;
+    data.size         = (i32)record->vertexCount;
+    data.firstIndex   = (i32)indexLump.size();
+    data.indexCount   = (i32)record->indexCount;
+    data.firstMeshlet = (i32)meshletLump.size();
+    data.meshletCount = (i32)record->meshletCount;
+    data.lodCount     = (i32)record->lodCount;
+    data.bounds       = record->bounds;
+    std::copy(record->lods, record->lods + record->lodCount, data.lods);
+
+    // straight copies out of the mapping, no per vertex work
+    const f32 *vertices = cache.GetVertices(*record);
+    const u32 *indices = cache.GetIndices(*record);
+    lump.insert(lump.end(), vertices, vertices + (usize)record->vertexCount * VERTEX_STRIDE);
+    indexLump.insert(indexLump.end(), indices, indices + cache.GetTotalIndexCount(*record));
+
+    const DEUtil::Meshlet *meshlets = cache.GetMeshlets(*record);
+    meshletLump.insert(meshletLump.end(), meshlets, meshlets + record->meshletCount);
+
+    // rebase meshlets onto the shared index buffer
+    for(i32 i = data.firstMeshlet; i < data.firstMeshlet + data.meshletCount; i++)
+        meshletLump[i].triangleOffset += (u32)data.firstIndex / 3;
+
+    offset += data.size;
+
+    return Register(data);
+}
+
+static DEUtil::Buffer UploadBuffer(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, const void *data,
+                                   usize size, vk::BufferUsageFlags usage)
+{
     DEUtil::BufferInput buffIn;
     buffIn.logicalDevice  = logicalDevice;
     buffIn.physicalDevice = physicalDevice;
-    buffIn.size           = lump.size() * sizeof(f32);
-    buffIn.usage          = vk::BufferUsageFlagBits::eVertexBuffer;
+    buffIn.size           = size;
+    buffIn.usage          = usage;
+
+    DEUtil::Buffer buffer = DEUtil::CreateBuffer(buffIn);
 
-    vertexBuffer = DEUtil::CreateBuffer(buffIn);
+    void *memLoc = logicalDevice.mapMemory(buffer.memory, 0, buffIn.size);
+    memcpy(memLoc, data, buffIn.size);
 
-    void *memLoc = logicalDevice.mapMemory(vertexBuffer.memory, 0, buffIn.size);
-    memcpy(memLoc, lump.data(), buffIn.size);
+    logicalDevice.unmapMemory(buffer.memory);
 
-    logicalDevice.unmapMemory(vertexBuffer.memory);
+    return buffer;
+}
+
+void VertexMenagerie::Finalize(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice)
+{
+    this->device = logicalDevice;
+
+    vertexBuffer = UploadBuffer(logicalDevice, physicalDevice, lump.data(), lump.size() * sizeof(f32),
+                                vk::BufferUsageFlagBits::eVertexBuffer);
+
+    if(!indexLump.empty())
+        indexBuffer = UploadBuffer(logicalDevice, physicalDevice, indexLump.data(), indexLump.size() * sizeof(u32),
+                                   vk::BufferUsageFlagBits::eIndexBuffer);
+
+    if(!meshletLump.empty())
+        meshletBuffer = UploadBuffer(logicalDevice, physicalDevice, meshletLump.data(),
+                                     meshletLump.size() * sizeof(DEUtil::Meshlet),
+                                     vk::BufferUsageFlagBits::eStorageBuffer);
 }
 
 VertexMenagerie::~VertexMenagerie()
 {
     device.destroyBuffer(vertexBuffer.buffer);
     device.freeMemory(vertexBuffer.memory);
+
+    if(indexBuffer.buffer)
+    {
+        device.destroyBuffer(indexBuffer.buffer);
+        device.freeMemory(indexBuffer.memory);
+    }
+
+    if(meshletBuffer.buffer)
+    {
+        device.destroyBuffer(meshletBuffer.buffer);
+        device.freeMemory(meshletBuffer.memory);
+    }
 }
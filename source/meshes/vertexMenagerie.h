@@ -2,18 +2,40 @@
 
 #include <DEngine.h>
 #include "../engine/memory.h"
+#include "meshBuild.h"
+#include "meshCache.h"
 
-enum class MeshType
+// index into VertexMenagerie's mesh table. the generation goes stale once the
+// mesh is released, so an old handle can't silently alias a newer mesh.
+struct MeshHandle
 {
-    TRIANGLE,
-    QUAD,
-    POLYGON
+    u32 index;
+    u32 generation; // 0 is never handed out
+
+    inline bool operator==(const MeshHandle &other) const { return index == other.index && generation == other.generation; }
+    inline bool operator!=(const MeshHandle &other) const { return !(*this == other); }
 };
 
+#define MESH_HANDLE_NULL MeshHandle{0, 0}
+
 struct VertexData
 {
     i32 offset;
     i32 size;
+
+    // indexed meshes (indexCount is 0 for plain vertex lists)
+    i32 firstIndex;
+    i32 indexCount;
+
+    // meshlets (meshletCount is 0 if the mesh wasn't split), only cover lod 0
+    i32 firstMeshlet;
+    i32 meshletCount;
+
+    // lod chain, stored right after lod 0 in the index buffer
+    i32 lodCount;
+    DEUtil::MeshLOD lods[MESH_MAX_LODS];
+
+    glm::vec4 bounds; // object space bounding sphere (center, radius)
 };
 
 class VertexMenagerie
@@ -21,18 +43,56 @@ class VertexMenagerie
     private:
     i32 offset;
     std::vector<f32> lump;
+    std::vector<u32> indexLump;
+    std::vector<DEUtil::Meshlet> meshletLump;
+
+    // dense mesh table, generations[i] belongs to meshTable[i]
+    std::vector<VertexData> meshTable;
+    std::vector<u32> generations;
+    std::vector<u32> freeSlots;
 
     vk::Device device;
 
+    private:
+    MeshHandle Register(const VertexData &data);
+
     public:
     DEUtil::Buffer vertexBuffer;
-    std::unordered_map<MeshType, VertexData> vertexAttribData;
+    DEUtil::Buffer indexBuffer;   // only created if an indexed mesh was consumed
+    DEUtil::Buffer meshletBuffer; // only created if a mesh was split into meshlets
 
     public:
     VertexMenagerie();
 
-    void Consume(MeshType type, std::vector<f32> vertexData);
+    MeshHandle Consume(std::vector<f32> vertexData);
+
+    // indexed mesh, indices are relative to the mesh's first vertex.
+    // MESH_BUILD_MESHLETS reorders the indices meshlet by meshlet, and every uploaded
+    // meshlet's triangleOffset points into the shared index buffer.
+    // MESH_BUILD_LODS simplifies the mesh into a lod chain sharing its vertices.
+    MeshHandle Consume(std::vector<f32> vertexData, std::vector<u32> indexData, u32 flags = 0);
+
+    // cooked mesh: its sections are copied in as is (meshlets and lods were built by the cooker).
+    // returns MESH_HANDLE_NULL if the cache has no such mesh or a different vertex layout.
+    MeshHandle Consume(const DEUtil::MeshCache &cache, const char *name);
+
+    // frees the handle's slot for reuse. its vertices stay in the lump (and buffers),
+    // the menagerie only ever grows until it's destroyed.
+    void Release(MeshHandle handle);
+
+    inline bool IsValid(MeshHandle handle) const
+    {
+        return handle.index < generations.size() && generations[handle.index] == handle.generation;
+    }
+
+    // no checks, the draw loop only holds handles it got from Consume()
+    inline const VertexData &Get(MeshHandle handle) const { return meshTable[handle.index]; }
+
+    inline u32 GetMeshCount() const { return (u32)(meshTable.size() - freeSlots.size()); }
+
     void Finalize(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice);
 
+    inline u32 GetMeshletCount() const { return (u32)meshletLump.size(); }
+
     ~VertexMenagerie();
-};
\ No newline at end of file
+};
@@ -0,0 +1,194 @@
+#include "lz4.h"
+
+#include <cstring>
+
+static inline u32 Read32(const u8 *p)
+{
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u32 HashSequence(u32 sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// a length that didn't fit in its nibble, as bytes of 255 and the rest
+static inline u8 *WriteLength(u8 *op, usize length)
+{
+    for(; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (u8)length;
+    return op;
+}
+
+static inline bool ReadLength(const u8 *&ip, const u8 *iend, usize &length)
+{
+    u8 byte;
+    do
+    {
+        if(ip >= iend)
+            return false;
+        byte = *ip++;
+        length += byte;
+    } while(byte == 255);
+
+    return true;
+}
+
+#pragma region Compress
+
+usize DEUtil::Lz4Compress(const u8 *src, usize size, u8 *dst, usize capacity)
+{
+    const u8 *ip = src, *anchor = src;
+    const u8 *iend = src + size;
+    u8 *op = dst, *oend = dst + capacity;
+
+    if(size > LZ4_MF_LIMIT)
+    {
+        const u8 *mflimit = iend - LZ4_MF_LIMIT;
+        const u8 *matchlimit = iend - LZ4_LAST_LITERALS;
+
+        // positions relative to src, a stale or zero entry is caught by comparing the bytes
+        u32 table[1 << LZ4_HASH_LOG] = {};
+
+        // every 64 misses in a row the step grows, so incompressible data goes by quickly
+        u32 misses = 1 << 6;
+        while(ip < mflimit)
+        {
+            u32 sequence = Read32(ip);
+            u32 hash = HashSequence(sequence);
+            const u8 *ref = src + table[hash];
+            table[hash] = (u32)(ip - src);
+
+            if(ref >= ip || ip - ref > LZ4_MAX_OFFSET || Read32(ref) != sequence)
+            {
+                ip += misses++ >> 6;
+                continue;
+            }
+
+            // grow the match backwards into the pending literals, then forwards
+            while(ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+
+            const u8 *matchEnd = ip + LZ4_MIN_MATCH;
+            const u8 *refEnd = ref + LZ4_MIN_MATCH;
+            while(matchEnd < matchlimit && *matchEnd == *refEnd)
+            {
+                matchEnd++;
+                refEnd++;
+            }
+
+            usize literals = (usize)(ip - anchor);
+            usize matchLength = (usize)(matchEnd - ip) - LZ4_MIN_MATCH;
+            if((usize)(oend - op) < 1 + literals / 255 + 1 + literals + 2 + matchLength / 255 + 1)
+                return 0;
+
+            u8 *token = op++;
+            *token = (u8)((literals >= 15 ? 15 : literals) << 4);
+            if(literals >= 15)
+                op = WriteLength(op, literals - 15);
+            memcpy(op, anchor, literals);
+            op += literals;
+
+            u16 offset = (u16)(ip - ref);
+            *op++ = (u8)offset;
+            *op++ = (u8)(offset >> 8);
+
+            *token |= (u8)(matchLength >= 15 ? 15 : matchLength);
+            if(matchLength >= 15)
+                op = WriteLength(op, matchLength - 15);
+
+            ip = anchor = matchEnd;
+            misses = 1 << 6;
+
+            // the match skipped these, a later repeat of them is likely
+            if(ip < mflimit)
+                table[HashSequence(Read32(ip - 2))] = (u32)(ip - 2 - src);
+        }
+    }
+
+    // the rest is one literal run
+    usize literals = (usize)(iend - anchor);
+    if((usize)(oend - op) < 1 + literals / 255 + 1 + literals)
+        return 0;
+
+    *op++ = (u8)((literals >= 15 ? 15 : literals) << 4);
+    if(literals >= 15)
+        op = WriteLength(op, literals - 15);
+    memcpy(op, anchor, literals);
+    op += literals;
+
+    return (usize)(op - dst);
+}
+
+#pragma endregion
+
+#pragma region Decompress
+
+bool DEUtil::Lz4Decompress(const u8 *src, usize srcSize, u8 *dst, usize dstSize)
+{
+    const u8 *ip = src, *iend = src + srcSize;
+    u8 *op = dst, *oend = dst + dstSize;
+
+    while(ip < iend)
+    {
+        u8 token = *ip++;
+
+        usize literals = token >> 4;
+        if(literals == 15 && !ReadLength(ip, iend, literals))
+            return false;
+        if(literals > (usize)(iend - ip) || literals > (usize)(oend - op))
+            return false;
+
+        // short runs are most of them, one fixed size copy when both buffers have the room
+        if(literals <= 16 && iend - ip >= 16 && oend - op >= 16)
+            memcpy(op, ip, 16);
+        else
+            memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        // the last sequence has no match
+        if(ip == iend)
+            break;
+
+        if(iend - ip < 2)
+            return false;
+        usize offset = (usize)ip[0] | (usize)ip[1] << 8;
+        ip += 2;
+        if(offset == 0 || offset > (usize)(op - dst))
+            return false;
+
+        usize matchLength = token & 15;
+        if(matchLength == 15 && !ReadLength(ip, iend, matchLength))
+            return false;
+        matchLength += LZ4_MIN_MATCH;
+        if(matchLength > (usize)(oend - op))
+            return false;
+
+        const u8 *match = op - offset;
+        u8 *matchEnd = op + matchLength;
+        if(offset >= 8 && (usize)(oend - op) >= matchLength + 7)
+        {
+            // 8 bytes at a time, at most 7 past the end which the next sequence overwrites
+            for(; op < matchEnd; op += 8, match += 8)
+                memcpy(op, match, 8);
+        }
+        else
+        {
+            // overlapping (a repeating pattern shorter than 8) or right at the end
+            for(; op < matchEnd; op++, match++)
+                *op = *match;
+        }
+        op = matchEnd;
+    }
+
+    return op == oend;
+}
+
+#pragma endregion
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../core/defines.h"
+
+// ---------------------- LZ4 BLOCKS ----------------------
+//
+// the lz4 block format (no frame, no checksums): sequences of
+// [token: literal length << 4 | match length - 4] [more literal length] [literals]
+// [offset: u16] [more match length], the last sequence is literals only. lengths of 15
+// go on in bytes of 255 until one is smaller. the last 5 bytes are always literals and
+// the last match starts at least 12 bytes before the end, like the reference encoder.
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT      12    // no match starts in the last 12 bytes
+#define LZ4_MAX_OFFSET    65535
+#define LZ4_HASH_LOG      14    // 16k entry match table, 64kb on the stack
+
+namespace DEUtil {
+
+// worst case compressed size of size bytes
+inline usize Lz4CompressBound(usize size)
+{
+    return size + size / 255 + 16;
+}
+
+// compresses size bytes into dst, returns the compressed size or 0 if it doesn't fit in
+// capacity (capacity Lz4CompressBound(size) always fits).
+usize Lz4Compress(const u8 *src, usize size, u8 *dst, usize capacity);
+
+// decompresses a whole block, which has to come out at exactly dstSize bytes. false if
+// the block is corrupt, never reads or writes outside the two buffers.
+bool Lz4Decompress(const u8 *src, usize srcSize, u8 *dst, usize dstSize);
+
+} // namespace DEUtil
@@ -0,0 +1,499 @@
+#include "pak.h"
+#include "lz4.h"
+#include "../core/jobs.h"
+#include "../core/logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+
+static inline char NormalizeNameChar(char c)
+{
+    if(c == '\\')
+        return '/';
+    if(c >= 'A' && c <= 'Z')
+        return (char)(c + ('a' - 'A'));
+    return c;
+}
+
+u64 DEUtil::HashPakName(const char *name)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    for(; *name; name++)
+        hash = (hash ^ (u8)NormalizeNameChar(*name)) * 0x100000001b3ull;
+    return hash;
+}
+
+std::string DEUtil::NormalizePakName(const char *name)
+{
+    std::string normalized;
+    for(; *name; name++)
+        normalized.push_back(NormalizeNameChar(*name));
+    return normalized;
+}
+
+// without overflowing, offsets from a corrupt file can be anything
+static inline bool InFile(u64 offset, u64 length, u64 size)
+{
+    return offset <= size && length <= size - offset;
+}
+
+#pragma region PakArchive
+
+DEUtil::PakArchive::PakArchive() : header{nullptr}, entries{nullptr}, chunks{nullptr}, names{nullptr} {}
+
+bool DEUtil::PakArchive::Open(const char *filepath)
+{
+    Close();
+    if(!file.Open(filepath))
+        return false;
+
+    const u8 *data = file.GetData();
+    u64 size = file.GetSize();
+
+    const PakHeader *head = (const PakHeader *)data;
+    if(size < sizeof(PakHeader) || head->magic != PAK_MAGIC)
+    {
+        LERROR("pak: " << filepath << " isn't a pak.\n");
+        file.Close();
+        return false;
+    }
+
+    if(head->version != PAK_VERSION || head->chunkSize < PAK_MIN_CHUNK_SIZE || head->chunkSize > PAK_MAX_CHUNK_SIZE)
+    {
+        LERROR("pak: " << filepath << " is version " << head->version << " with " << head->chunkSize
+                       << " byte chunks, expected version " << PAK_VERSION << ".\n");
+        file.Close();
+        return false;
+    }
+
+    // the tables are read in place, so they have to be aligned too
+    if(head->entryOffset % 8 != 0 || head->chunkOffset % 8 != 0 ||
+       !InFile(head->entryOffset, (u64)head->entryCount * sizeof(PakEntry), size) ||
+       !InFile(head->chunkOffset, (u64)head->chunkCount * sizeof(PakChunk), size) ||
+       !InFile(head->nameOffset, head->nameSize, size) ||
+       (head->nameSize > 0 && data[head->nameOffset + head->nameSize - 1] != 0))
+    {
+        LERROR("pak: " << filepath << " has a corrupt table of contents.\n");
+        file.Close();
+        return false;
+    }
+
+    // validate everything up front, reads trust the tables after this
+    const PakEntry *entryTable = (const PakEntry *)(data + head->entryOffset);
+    const PakChunk *chunkTable = (const PakChunk *)(data + head->chunkOffset);
+    const char *nameBlock = (const char *)(data + head->nameOffset);
+    for(u32 i = 0; i < head->entryCount; i++)
+    {
+        const PakEntry &entry = entryTable[i];
+        bool valid = (u64)entry.nameOffset + entry.nameLength < head->nameSize &&
+                     nameBlock[entry.nameOffset + entry.nameLength] == 0 &&
+                     entry.hash == HashPakName(nameBlock + entry.nameOffset) &&
+                     (i == 0 || entryTable[i - 1].hash <= entry.hash) && InFile(entry.offset, entry.storedSize, size);
+
+        if(valid && (entry.flags & PAK_ENTRY_COMPRESSED))
+        {
+            u64 expected = entry.size / head->chunkSize + (entry.size % head->chunkSize != 0);
+            valid = entry.chunkCount == expected && (u64)entry.firstChunk + entry.chunkCount <= head->chunkCount;
+            for(u32 c = 0; valid && c < entry.chunkCount; c++)
+            {
+                const PakChunk &chunk = chunkTable[entry.firstChunk + c];
+                u64 chunkSize = std::min<u64>(head->chunkSize, entry.size - (u64)c * head->chunkSize);
+                valid = InFile(chunk.offset, chunk.storedSize, size) &&
+                        ((chunk.flags & PAK_CHUNK_RAW) ? chunk.storedSize == chunkSize : chunk.storedSize > 0);
+            }
+        }
+        else if(valid)
+        {
+            valid = entry.storedSize == entry.size;
+        }
+
+        if(!valid)
+        {
+            LERROR("pak: " << filepath << " entry " << i << " is corrupt.\n");
+            file.Close();
+            return false;
+        }
+    }
+
+    header = head;
+    entries = entryTable;
+    chunks = chunkTable;
+    names = nameBlock;
+
+    LINFO(false, "pak: opened " << filepath << " (" << head->entryCount << " entries)\n");
+    return true;
+}
+
+void DEUtil::PakArchive::Close()
+{
+    file.Close();
+    header = nullptr;
+    entries = nullptr;
+    chunks = nullptr;
+    names = nullptr;
+}
+
+i32 DEUtil::PakArchive::Find(const char *name) const
+{
+    if(!header)
+        return -1;
+
+    u64 hash = HashPakName(name);
+    const PakEntry *end = entries + header->entryCount;
+    const PakEntry *entry =
+        std::lower_bound(entries, end, hash, [](const PakEntry &e, u64 value) { return e.hash < value; });
+
+    // names that share a hash sit next to each other
+    for(; entry != end && entry->hash == hash; entry++)
+    {
+        const char *stored = names + entry->nameOffset;
+        const char *query = name;
+        while(*stored && *stored == NormalizeNameChar(*query))
+        {
+            stored++;
+            query++;
+        }
+
+        if(*stored == 0 && *query == 0)
+            return (i32)(entry - entries);
+    }
+
+    return -1;
+}
+
+DEUtil::PakView DEUtil::PakArchive::GetDirect(i32 entryIdx) const
+{
+    if(!header || entryIdx < 0 || entryIdx >= (i32)header->entryCount)
+        return PakView{nullptr, 0};
+
+    const PakEntry &entry = entries[entryIdx];
+    if(entry.flags & PAK_ENTRY_COMPRESSED)
+        return PakView{nullptr, 0};
+
+    return PakView{file.GetData() + entry.offset, entry.size};
+}
+
+bool DEUtil::PakArchive::DecompressChunk(const PakEntry &entry, u32 chunk, u8 *out) const
+{
+    const PakChunk &info = chunks[entry.firstChunk + chunk];
+    u64 size = std::min<u64>(header->chunkSize, entry.size - (u64)chunk * header->chunkSize);
+    const u8 *src = file.GetData() + info.offset;
+
+    if(info.flags & PAK_CHUNK_RAW)
+    {
+        memcpy(out, src, size);
+        return true;
+    }
+
+    return Lz4Decompress(src, info.storedSize, out, size);
+}
+
+bool DEUtil::PakArchive::Read(i32 entryIdx, u8 *out, JobSystem *jobs) const
+{
+    if(!header || entryIdx < 0 || entryIdx >= (i32)header->entryCount)
+        return false;
+
+    const PakEntry &entry = entries[entryIdx];
+    if(!(entry.flags & PAK_ENTRY_COMPRESSED))
+    {
+        memcpy(out, file.GetData() + entry.offset, entry.size);
+        return true;
+    }
+
+    u32 chunkSize = header->chunkSize;
+    if(!jobs || entry.chunkCount < 2)
+    {
+        for(u32 c = 0; c < entry.chunkCount; c++)
+        {
+            if(!DecompressChunk(entry, c, out + (u64)c * chunkSize))
+                return false;
+        }
+        return true;
+    }
+
+    // a chunk per job, they're 64kb by default which is plenty of work for one
+    std::atomic<bool> failed{false};
+    jobs->ParallelFor(entry.chunkCount, 1, [&](u32 begin, u32 end) {
+        for(u32 c = begin; c < end; c++)
+        {
+            if(!DecompressChunk(entry, c, out + (u64)c * chunkSize))
+                failed.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    return !failed.load(std::memory_order_relaxed);
+}
+
+bool DEUtil::PakArchive::Read(const char *name, std::vector<u8> &out, JobSystem *jobs) const
+{
+    i32 entryIdx = Find(name);
+    if(entryIdx < 0)
+        return false;
+
+    out.resize(entries[entryIdx].size);
+    return Read(entryIdx, out.data(), jobs);
+}
+
+bool DEUtil::PakArchive::ReadRange(i32 entryIdx, u64 offset, u64 size, u8 *out) const
+{
+    if(!header || entryIdx < 0 || entryIdx >= (i32)header->entryCount)
+        return false;
+
+    const PakEntry &entry = entries[entryIdx];
+    if(offset > entry.size || size > entry.size - offset)
+        return false;
+    if(size == 0)
+        return true;
+
+    if(!(entry.flags & PAK_ENTRY_COMPRESSED))
+    {
+        memcpy(out, file.GetData() + entry.offset + offset, size);
+        return true;
+    }
+
+    u64 chunkSize = header->chunkSize;
+    std::vector<u8> partial;
+    for(u64 c = offset / chunkSize; c * chunkSize < offset + size; c++)
+    {
+        u64 chunkStart = c * chunkSize;
+        u64 chunkEnd = std::min(chunkStart + chunkSize, entry.size);
+        u64 first = std::max(offset, chunkStart), last = std::min(offset + size, chunkEnd);
+
+        // whole chunks go straight into out, the ends of the range through a scratch chunk
+        if(first == chunkStart && last == chunkEnd)
+        {
+            if(!DecompressChunk(entry, (u32)c, out + (first - offset)))
+                return false;
+            continue;
+        }
+
+        partial.resize(chunkSize);
+        if(!DecompressChunk(entry, (u32)c, partial.data()))
+            return false;
+        memcpy(out + (first - offset), partial.data() + (first - chunkStart), last - first);
+    }
+
+    return true;
+}
+
+DEUtil::PakArchive::~PakArchive() {}
+
+#pragma endregion
+
+#pragma region PakWriter
+
+DEUtil::PakWriter::PakWriter(u32 chunkSize) : chunkSize{chunkSize}
+{
+    if(this->chunkSize < PAK_MIN_CHUNK_SIZE)
+        this->chunkSize = PAK_MIN_CHUNK_SIZE;
+    if(this->chunkSize > PAK_MAX_CHUNK_SIZE)
+        this->chunkSize = PAK_MAX_CHUNK_SIZE;
+}
+
+void DEUtil::PakWriter::Add(const char *name, std::vector<u8> data, bool compress)
+{
+    PakSource source{NormalizePakName(name), std::move(data), compress};
+
+    auto existing = indices.find(source.name);
+    if(existing != indices.end())
+    {
+        sources[existing->second] = std::move(source);
+        return;
+    }
+
+    indices[source.name] = (u32)sources.size();
+    sources.push_back(std::move(source));
+}
+
+bool DEUtil::PakWriter::AddFile(const char *name, const char *filepath, bool compress)
+{
+    std::ifstream file(filepath, std::ios::ate | std::ios::binary);
+    if(!file.is_open())
+    {
+        LERROR("pak: couldn't open " << filepath << "\n");
+        return false;
+    }
+
+    std::vector<u8> data((usize)file.tellg());
+    file.seekg(0);
+    file.read((char *)data.data(), (std::streamsize)data.size());
+    if(!file)
+    {
+        LERROR("pak: couldn't read " << filepath << "\n");
+        return false;
+    }
+
+    Add(name, std::move(data), compress);
+    return true;
+}
+
+static void WritePadding(std::ofstream &out, u64 &position, u64 alignment)
+{
+    static const char zeros[PAK_STORED_ALIGNMENT] = {};
+    u64 padding = (alignment - position % alignment) % alignment;
+    out.write(zeros, (std::streamsize)padding);
+    position += padding;
+}
+
+bool DEUtil::PakWriter::Write(const char *filepath, JobSystem *jobs) const
+{
+    // every chunk of every entry that wants compressing, compressed at once
+    struct PendingChunk
+    {
+        u32 source;
+        u32 chunk;
+    };
+
+    std::vector<PendingChunk> pending;
+    std::vector<u32> firstPending(sources.size(), 0);
+    for(u32 s = 0; s < sources.size(); s++)
+    {
+        firstPending[s] = (u32)pending.size();
+        if(!sources[s].compress)
+            continue;
+
+        u32 count = (u32)((sources[s].data.size() + chunkSize - 1) / chunkSize);
+        for(u32 c = 0; c < count; c++)
+            pending.push_back(PendingChunk{s, c});
+    }
+
+    std::vector<std::vector<u8>> compressed(pending.size());
+    auto compressRange = [&](u32 begin, u32 end) {
+        for(u32 i = begin; i < end; i++)
+        {
+            const std::vector<u8> &data = sources[pending[i].source].data;
+            u64 start = (u64)pending[i].chunk * chunkSize;
+            usize size = (usize)std::min<u64>(chunkSize, data.size() - start);
+
+            // nothing is kept if it didn't get smaller, the chunk is stored raw then
+            std::vector<u8> &block = compressed[i];
+            block.resize(Lz4CompressBound(size));
+            usize compressedSize = Lz4Compress(data.data() + start, size, block.data(), size - 1);
+            block.resize(compressedSize);
+            block.shrink_to_fit();
+        }
+    };
+
+    if(jobs)
+        jobs->ParallelFor((u32)pending.size(), 1, compressRange);
+    else
+        compressRange(0, (u32)pending.size());
+
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        LERROR("pak: couldn't create " << filepath << "\n");
+        return false;
+    }
+
+    PakHeader header{};
+    out.write((const char *)&header, sizeof(header));
+    u64 position = sizeof(header);
+
+    std::vector<PakEntry> entries(sources.size());
+    std::vector<PakChunk> chunks;
+    std::string nameBlock;
+    for(u32 s = 0; s < sources.size(); s++)
+    {
+        const PakSource &source = sources[s];
+        PakEntry &entry = entries[s];
+        entry = PakEntry{};
+        entry.hash = HashPakName(source.name.c_str());
+        entry.size = source.data.size();
+        entry.nameOffset = (u32)nameBlock.size();
+        entry.nameLength = (u32)source.name.size();
+        nameBlock += source.name;
+        nameBlock.push_back('\0');
+
+        u32 chunkCount = source.compress ? (u32)((source.data.size() + chunkSize - 1) / chunkSize) : 0;
+        u64 storedSize = 0;
+        for(u32 c = 0; c < chunkCount; c++)
+        {
+            const std::vector<u8> &block = compressed[firstPending[s] + c];
+            u64 rawSize = std::min<u64>(chunkSize, source.data.size() - (u64)c * chunkSize);
+            storedSize += block.empty() ? rawSize : block.size();
+        }
+
+        if(chunkCount > 0 && storedSize <= source.data.size() - source.data.size() / PAK_MIN_SAVING)
+        {
+            entry.flags = PAK_ENTRY_COMPRESSED;
+            entry.firstChunk = (u32)chunks.size();
+            entry.chunkCount = chunkCount;
+
+            WritePadding(out, position, PAK_CHUNK_ALIGNMENT);
+            entry.offset = position;
+            for(u32 c = 0; c < chunkCount; c++)
+            {
+                const std::vector<u8> &block = compressed[firstPending[s] + c];
+                u64 start = (u64)c * chunkSize;
+
+                PakChunk chunk{position, 0, 0};
+                if(block.empty())
+                {
+                    chunk.storedSize = (u32)std::min<u64>(chunkSize, source.data.size() - start);
+                    chunk.flags = PAK_CHUNK_RAW;
+                    out.write((const char *)source.data.data() + start, chunk.storedSize);
+                }
+                else
+                {
+                    chunk.storedSize = (u32)block.size();
+                    out.write((const char *)block.data(), (std::streamsize)block.size());
+                }
+
+                position += chunk.storedSize;
+                chunks.push_back(chunk);
+            }
+            entry.storedSize = position - entry.offset;
+        }
+        else
+        {
+            WritePadding(out, position, PAK_STORED_ALIGNMENT);
+            entry.offset = position;
+            entry.storedSize = source.data.size();
+            out.write((const char *)source.data.data(), (std::streamsize)source.data.size());
+            position += source.data.size();
+        }
+    }
+
+    // the data stays in the order it was added (a directory's files together), the table is
+    // sorted for the binary search
+    std::sort(entries.begin(), entries.end(), [&](const PakEntry &a, const PakEntry &b) {
+        if(a.hash != b.hash)
+            return a.hash < b.hash;
+        return strcmp(nameBlock.c_str() + a.nameOffset, nameBlock.c_str() + b.nameOffset) < 0;
+    });
+
+    WritePadding(out, position, 8);
+    header.entryOffset = position;
+    out.write((const char *)entries.data(), (std::streamsize)(entries.size() * sizeof(PakEntry)));
+    position += entries.size() * sizeof(PakEntry);
+
+    header.chunkOffset = position;
+    out.write((const char *)chunks.data(), (std::streamsize)(chunks.size() * sizeof(PakChunk)));
+    position += chunks.size() * sizeof(PakChunk);
+
+    header.nameOffset = position;
+    out.write(nameBlock.data(), (std::streamsize)nameBlock.size());
+
+    header.magic = PAK_MAGIC;
+    header.version = PAK_VERSION;
+    header.entryCount = (u32)entries.size();
+    header.chunkCount = (u32)chunks.size();
+    header.chunkSize = chunkSize;
+    header.nameSize = (u32)nameBlock.size();
+    out.seekp(0);
+    out.write((const char *)&header, sizeof(header));
+
+    out.close();
+    if(!out)
+    {
+        LERROR("pak: couldn't write " << filepath << "\n");
+        return false;
+    }
+
+    return true;
+}
+
+#pragma endregion
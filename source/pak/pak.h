@@ -0,0 +1,167 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../core/mappedFile.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// ---------------------- PAK FORMAT ----------------------
+//
+// [header] ... entry data ... [entries: PakEntry[entryCount]] [chunks: PakChunk[chunkCount]] [names]
+// everything is little endian. entries are sorted by the hash of their name (then by name),
+// so a lookup is a binary search. names are paths relative to the packed directory, lower
+// case with '/' separators and zero terminated.
+//
+// a compressed entry is cut into chunkSize pieces that are lz4 blocks of their own, so any
+// range of it can be read without the rest and the chunks decompress in parallel. a chunk
+// that didn't get smaller is kept raw. an entry that doesn't compress well is stored as is,
+// starting on a page boundary so it can be used straight out of the mapping.
+
+#define PAK_MAGIC              0x4b415044 // "DPAK"
+#define PAK_VERSION            1
+#define PAK_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define PAK_MIN_CHUNK_SIZE     4096
+#define PAK_MAX_CHUNK_SIZE     (4 * 1024 * 1024)
+#define PAK_STORED_ALIGNMENT   4096 // stored entries, a page on every platform we run on
+#define PAK_CHUNK_ALIGNMENT    16
+#define PAK_MIN_SAVING         8    // a compressed entry has to save 1/8th of its size, or it's stored
+
+#define PAK_ENTRY_COMPRESSED BIT(0)
+#define PAK_CHUNK_RAW        BIT(0) // the chunk's bytes are the data, it didn't compress
+
+struct PakHeader
+{
+    u32 magic;
+    u32 version;
+    u32 entryCount;
+    u32 chunkCount;
+    u32 chunkSize;
+    u32 nameSize;
+    u64 entryOffset;
+    u64 chunkOffset;
+    u64 nameOffset;
+};
+
+struct PakEntry
+{
+    u64 hash; // see HashPakName()
+    u64 offset;
+    u64 size;       // uncompressed
+    u64 storedSize; // in the file
+    u32 nameOffset; // into the name block
+    u32 nameLength; // without the terminator
+    u32 firstChunk; // compressed entries only
+    u32 chunkCount;
+    u32 flags;
+    u32 pad;
+};
+
+struct PakChunk
+{
+    u64 offset;
+    u32 storedSize;
+    u32 flags;
+};
+
+ST_ASSERT(sizeof(PakHeader) == 48, "expected PakHeader to be 48 bytes.");
+ST_ASSERT(sizeof(PakEntry) == 56, "expected PakEntry to be 56 bytes.");
+ST_ASSERT(sizeof(PakChunk) == 16, "expected PakChunk to be 16 bytes.");
+
+namespace DEUtil {
+
+class JobSystem;
+
+// fnv-1a over the name as it's stored, so "Shaders\\Mesh.vert.spv" and "shaders/mesh.vert.spv"
+// hash (and compare) the same
+u64 HashPakName(const char *name);
+
+// the name as it's stored in a pak
+std::string NormalizePakName(const char *name);
+
+// zero-copy view of a stored entry, stays valid as long as its PakArchive is open.
+struct PakView
+{
+    const u8 *data;
+    u64 size;
+};
+
+// one mapped pak. lookups and reads don't change it, so any number of threads can read
+// from it at once.
+class PakArchive
+{
+    private:
+    MappedFile file;
+    const PakHeader *header;
+    const PakEntry *entries;
+    const PakChunk *chunks;
+    const char *names;
+
+    private:
+    bool DecompressChunk(const PakEntry &entry, u32 chunk, u8 *out) const;
+
+    public:
+    PakArchive();
+    PakArchive(const PakArchive &archive) = delete;
+    PakArchive &operator=(const PakArchive &archive) = delete;
+
+    // maps a pak and checks its tables. returns false (and logs) if it can't be mapped
+    // or isn't a valid pak.
+    bool Open(const char *filepath);
+    void Close();
+
+    // index of the entry with that name, -1 if there's none.
+    i32 Find(const char *name) const;
+
+    // data is nullptr if the entry is compressed (or doesn't exist), Read() it then.
+    PakView GetDirect(i32 entryIdx) const;
+
+    // the whole entry into out (GetEntry().size bytes). with a job system the chunks are
+    // decompressed in parallel and this returns once they're all done. false if a chunk is corrupt.
+    bool Read(i32 entryIdx, u8 *out, JobSystem *jobs = nullptr) const;
+    bool Read(const char *name, std::vector<u8> &out, JobSystem *jobs = nullptr) const;
+
+    // size bytes from offset of the entry, only the chunks that overlap are decompressed.
+    bool ReadRange(i32 entryIdx, u64 offset, u64 size, u8 *out) const;
+
+    inline const PakEntry &GetEntry(i32 entryIdx) const { return entries[entryIdx]; }
+    inline const char *GetName(i32 entryIdx) const { return names + entries[entryIdx].nameOffset; }
+    inline u32 GetEntryCount() const { return header ? header->entryCount : 0; }
+    inline u32 GetChunkSize() const { return header ? header->chunkSize : 0; }
+    inline bool IsOpen() const { return header != nullptr; }
+
+    ~PakArchive();
+};
+
+struct PakSource
+{
+    std::string name; // normalized
+    std::vector<u8> data;
+    bool compress;
+};
+
+// collects entries in memory and writes them out as one pak.
+class PakWriter
+{
+    private:
+    std::vector<PakSource> sources;
+    std::unordered_map<std::string, u32> indices; // by name
+    u32 chunkSize;
+
+    public:
+    PakWriter(u32 chunkSize = PAK_DEFAULT_CHUNK_SIZE);
+
+    // compress false always stores the entry (for data that's already compressed, or that
+    // should be mapped as is). a name that's already in the pak replaces that entry.
+    void Add(const char *name, std::vector<u8> data, bool compress);
+    bool AddFile(const char *name, const char *filepath, bool compress);
+
+    // compresses every entry's chunks (in parallel with a job system) and writes the pak.
+    // returns false (and logs) if it can't be written.
+    bool Write(const char *filepath, JobSystem *jobs = nullptr) const;
+
+    inline u32 GetEntryCount() const { return (u32)sources.size(); }
+};
+
+} // namespace DEUtil
@@ -0,0 +1,49 @@
+#include "softDraw.h"
+
+// a byte lookup per pixel is all these loops do. sse2 and neon have no gathers, and avx2's
+// were slower than the scalar loops (unrolled by the compiler) when measured. the column
+// major framebuffer already makes the wall columns contiguous stores.
+
+void DEUtil::DrawColumn(u8 *dst, u32 count, const u8 *column, u32 columnHeight, u32 v, u32 vStep,
+                        const u8 *colormap)
+{
+    if(columnHeight & (columnHeight - 1))
+    {
+        // tall textures like 72 or 96 texels, vanilla tiled these wrong
+        u32 limit = columnHeight << 16;
+        v %= limit;
+        vStep %= limit;
+
+        for(u32 i = 0; i < count; i++)
+        {
+            dst[i] = colormap[column[v >> 16]];
+
+            v += vStep;
+            if(v >= limit)
+                v -= limit;
+        }
+
+        return;
+    }
+
+    u32 mask = columnHeight - 1;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        dst[i] = colormap[column[(v >> 16) & mask]];
+        v += vStep;
+    }
+}
+
+void DEUtil::DrawSpan(u8 *dst, u32 dstStride, u32 count, const u8 *flat, u32 u, u32 v, u32 uStep, u32 vStep,
+                      const u8 *colormap)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        u32 index = ((v >> 10) & ((SOFT_FLAT_SIZE - 1) * SOFT_FLAT_SIZE)) | ((u >> 16) & (SOFT_FLAT_SIZE - 1));
+        dst[(usize)i * dstStride] = colormap[flat[index]];
+
+        u += uStep;
+        v += vStep;
+    }
+}
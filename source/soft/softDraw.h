@@ -0,0 +1,20 @@
+#pragma once
+
+#include "../core/defines.h"
+
+// flats are 64x64, row major
+#define SOFT_FLAT_SIZE 64
+
+namespace DEUtil {
+
+// count pixels of one texture column into a column major framebuffer (vanilla's R_DrawColumn).
+// v and vStep are 16.16 fixed point texels, column heights that aren't a power of two wrap
+// with a compare instead of a mask.
+void DrawColumn(u8 *dst, u32 count, const u8 *column, u32 columnHeight, u32 v, u32 vStep, const u8 *colormap);
+
+// count pixels of a flat along a framebuffer row (R_DrawSpan), dst pixels are dstStride apart.
+// u, v and their steps are 16.16 fixed point texels and wrap every 64.
+void DrawSpan(u8 *dst, u32 dstStride, u32 count, const u8 *flat, u32 u, u32 v, u32 uStep, u32 vStep,
+              const u8 *colormap);
+
+} // namespace DEUtil
@@ -0,0 +1,722 @@
+#include "softRenderer.h"
+#include "softDraw.h"
+#include "../core/logger.h"
+#include "../wad/wadTextures.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#define SOFT_SKY_FLAT_NAME "F_SKY1"
+#define SOFT_SKY_TEXTURE_NAME "SKY1"
+
+// segs closer than this are clipped, keeps the projection finite
+#define SOFT_NEAR_CLIP 1.0f
+
+// vanilla's scalelight/zlight tables as one formula: the colormap gets one level
+// brighter for every 1280 / depth (a 320 wide screen's scale, halved and in 1/16ths)
+#define SOFT_LIGHT_FALLOFF 1280.0f
+
+// sky texture row at the horizon, and its texels per pixel on a 320 wide screen
+#define SOFT_SKY_TEXTURE_MID 100.0f
+#define SOFT_SKY_COLUMNS     1024.0f // per full turn, vanilla's ANGLETOSKYSHIFT
+
+#define SOFT_TWO_PI 6.28318530718f
+
+static std::vector<u8> MakeCheckerboard(u32 size)
+{
+    std::vector<u8> pixels((usize)size * size, 0);
+    for(u32 y = 0; y < size; y++)
+    {
+        for(u32 x = 0; x < size; x++)
+            pixels[(usize)y * size + x] = ((x / 8) ^ (y / 8)) & 1 ? 0xb0 : 0x00;
+    }
+
+    return pixels;
+}
+
+// light level (0..255) to the brightest colormap it uses, like vanilla's LIGHTSEGSHIFT
+static inline i32 LightStart(i32 lightLevel)
+{
+    i32 lightNum = std::clamp(lightLevel, 0, 15);
+    return (15 - lightNum) * 4;
+}
+
+static inline i32 LightLevel(i32 lightStart, f32 depth)
+{
+    return std::clamp(lightStart - (i32)(SOFT_LIGHT_FALLOFF / depth), 0, SOFT_LIGHT_LEVELS - 1);
+}
+
+// first row whose center is below y
+static inline i32 RowBelow(f32 y, i32 rows)
+{
+    return (i32)std::ceil(std::clamp(y, -1.0f, (f32)rows + 1.0f) - 0.5f);
+}
+
+static inline i32 WrapTexel(f32 texel, u32 size)
+{
+    i32 wrapped = (i32)std::floor(texel) % (i32)size;
+    return wrapped < 0 ? wrapped + (i32)size : wrapped;
+}
+
+// 16.16 fixed point, wrapped to [0, size) first so large map coordinates don't overflow
+static inline u32 ToFixed(f32 texel, f32 size)
+{
+    f32 wrapped = std::fmod(texel, size);
+    if(wrapped < 0.0f)
+        wrapped += size;
+
+    return (u32)(wrapped * 65536.0f);
+}
+
+#pragma region Setup
+
+DEUtil::SoftRenderer::SoftRenderer(u32 width, u32 height, u32 threadCount)
+    : width{width}, height{height}, map{nullptr}, heightRange{0.0f}, skyTexture{SOFT_NO_TEXTURE}, frame{0}, pending{0},
+      quit{false}
+{
+    // 90 degree horizontal fov, square pixels
+    centerX = width * 0.5f;
+    centerY = height * 0.5f;
+    focal = centerX;
+
+    framebuffer.assign((usize)width * height, 0);
+
+    // greyscale and unlit until LoadAssets()
+    for(u32 i = 0; i < 256; i++)
+        palette[i] = i | (i << 8) | (i << 16) | 0xff000000;
+
+    colormaps.assign(SOFT_COLORMAP_COUNT * 256, 0);
+    for(u32 table = 0; table < SOFT_COLORMAP_COUNT; table++)
+    {
+        for(u32 i = 0; i < 256; i++)
+            colormaps[table * 256 + i] = (u8)i;
+    }
+
+    flats.push_back(MakeCheckerboard(SOFT_FLAT_SIZE));
+    textures.push_back(SoftTexture{SOFT_FLAT_SIZE, SOFT_FLAT_SIZE, MakeCheckerboard(SOFT_FLAT_SIZE)});
+
+    if(threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, width);
+
+    strips.resize(threadCount);
+    for(u32 i = 0; i < threadCount; i++)
+    {
+        SoftStrip &strip = strips[i];
+        strip.x0 = (i32)((u64)width * i / threadCount);
+        strip.x1 = (i32)((u64)width * (i + 1) / threadCount);
+        strip.top.resize(strip.x1 - strip.x0);
+        strip.bottom.resize(strip.x1 - strip.x0);
+        strip.spanStart.resize(height);
+    }
+
+    // the calling thread draws strip 0
+    for(u32 i = 1; i < threadCount; i++)
+        workers.emplace_back(&SoftRenderer::WorkerLoop, this, i);
+}
+
+bool DEUtil::SoftRenderer::LoadAssets(const WadArchive &archive)
+{
+    LumpView playpal = archive.GetLump("PLAYPAL");
+    if(!playpal.data || playpal.size < 256 * 3)
+    {
+        LERROR("soft: no PLAYPAL lump.\n");
+        return false;
+    }
+
+    LumpView colormap = archive.GetLump("COLORMAP");
+    if(!colormap.data || colormap.size < SOFT_COLORMAP_COUNT * 256)
+    {
+        LERROR("soft: no COLORMAP lump.\n");
+        return false;
+    }
+
+    // first palette only, the others are damage/pickup tints
+    for(u32 i = 0; i < 256; i++)
+    {
+        const u8 *rgb = playpal.data + i * 3;
+        palette[i] = rgb[0] | (rgb[1] << 8) | (rgb[2] << 16) | 0xff000000;
+    }
+
+    memcpy(colormaps.data(), colormap.data, SOFT_COLORMAP_COUNT * 256);
+
+    // pwads wrap theirs in FF_START/FF_END, later ones override earlier ones
+    u64 flatsStart = PackLumpName("F_START"), flatsEnd = PackLumpName("F_END");
+    u64 pwadStart = PackLumpName("FF_START"), pwadEnd = PackLumpName("FF_END");
+
+    flats.resize(1);
+    flatNames.clear();
+
+    bool inFlats = false;
+    for(u32 i = 0; i < archive.GetLumpCount(); i++)
+    {
+        const WadLump &lump = archive.GetLumpInfo(i);
+        if(lump.name == flatsStart || lump.name == pwadStart)
+        {
+            inFlats = true;
+            continue;
+        }
+
+        if(lump.name == flatsEnd || lump.name == pwadEnd)
+        {
+            inFlats = false;
+            continue;
+        }
+
+        // F1_START and the like are empty markers
+        if(!inFlats || lump.size != SOFT_FLAT_SIZE * SOFT_FLAT_SIZE)
+            continue;
+
+        std::vector<u8> flat(SOFT_FLAT_SIZE * SOFT_FLAT_SIZE, 0);
+        memcpy(flat.data(), lump.data, SOFT_FLAT_SIZE * SOFT_FLAT_SIZE);
+
+        flatNames[lump.name] = (u32)flats.size();
+        flats.push_back(std::move(flat));
+    }
+
+    return true;
+}
+
+void DEUtil::SoftRenderer::AddTexture(u64 name, const SoftTexture &texture)
+{
+    SoftTexture sized = texture;
+    sized.pixels.resize((usize)texture.width * texture.height, 0);
+
+    auto found = textureNames.find(name);
+    if(found != textureNames.end())
+    {
+        textures[found->second] = std::move(sized);
+        return;
+    }
+
+    textureNames[name] = (u32)textures.size();
+    textures.push_back(std::move(sized));
+}
+
+bool DEUtil::SoftRenderer::LoadWallTextures(const WadArchive &archive)
+{
+    std::vector<WadImage> images;
+    if(!DEUtil::LoadWallTextures(archive, images))
+        return false;
+
+    // composites are row major, columns are what the renderer walks
+    for(const WadImage &image : images)
+    {
+        SoftTexture texture = {image.width, image.height, std::vector<u8>((usize)image.width * image.height)};
+        for(u32 x = 0; x < image.width; x++)
+        {
+            for(u32 y = 0; y < image.height; y++)
+                texture.pixels[(usize)x * image.height + y] = image.pixels[(usize)y * image.width + x];
+        }
+
+        AddTexture(image.name, texture);
+    }
+
+    return true;
+}
+
+u32 DEUtil::SoftRenderer::ResolveTexture(const char *name) const
+{
+    u64 packed = PackLumpName(name);
+    if(packed == 0 || packed == PackLumpName("-"))
+        return SOFT_NO_TEXTURE;
+
+    auto found = textureNames.find(packed);
+    return found != textureNames.end() ? found->second : 0;
+}
+
+void DEUtil::SoftRenderer::SetMap(const MapData &map)
+{
+    this->map = &map;
+    heightRange = GetMapHeightRange(map);
+
+    u64 sky = PackLumpName(SOFT_SKY_FLAT_NAME);
+
+    sectorFloors.resize(map.sectors.size());
+    sectorCeilings.resize(map.sectors.size());
+    for(usize i = 0; i < map.sectors.size(); i++)
+    {
+        const MapSector &sector = map.sectors[i];
+        u64 floorName = PackLumpName(sector.floorFlat);
+        u64 ceilingName = PackLumpName(sector.ceilingFlat);
+
+        auto floor = flatNames.find(floorName);
+        auto ceiling = flatNames.find(ceilingName);
+
+        sectorFloors[i] = floor != flatNames.end() ? floor->second : 0;
+        sectorCeilings[i] = ceilingName == sky ? SOFT_SKY_FLAT : (ceiling != flatNames.end() ? ceiling->second : 0);
+    }
+
+    sideTextures.resize(map.sidedefs.size() * 3);
+    for(usize i = 0; i < map.sidedefs.size(); i++)
+    {
+        const MapSidedef &side = map.sidedefs[i];
+        sideTextures[i * 3 + 0] = ResolveTexture(side.upperTexture);
+        sideTextures[i * 3 + 1] = ResolveTexture(side.lowerTexture);
+        sideTextures[i * 3 + 2] = ResolveTexture(side.middleTexture);
+    }
+
+    auto found = textureNames.find(PackLumpName(SOFT_SKY_TEXTURE_NAME));
+    skyTexture = found != textureNames.end() ? found->second : SOFT_NO_TEXTURE;
+}
+
+#pragma endregion
+
+#pragma region Frame
+
+void DEUtil::SoftRenderer::WorkerLoop(u32 stripIdx)
+{
+    u64 drawn = 0;
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || frame != drawn; });
+            if(quit)
+                return;
+
+            drawn = frame;
+        }
+
+        RenderStrip(strips[stripIdx]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--pending == 0)
+            done.notify_one();
+    }
+}
+
+void DEUtil::SoftRenderer::Render(const SoftView &view)
+{
+    if(!map)
+        return;
+
+    this->view = view;
+    forward = glm::vec2(std::cos(view.angle), std::sin(view.angle));
+    right = glm::vec2(forward.y, -forward.x);
+
+    // left, right and near planes through the eye (z up, so they're vertical), the rest pass everything
+    glm::vec2 leftNormal = forward * centerX + right * focal;
+    glm::vec2 rightNormal = forward * centerX - right * focal;
+
+    Frustum frustum;
+    frustum.planes[0] = glm::vec4(leftNormal.x, leftNormal.y, 0.0f, -glm::dot(leftNormal, view.pos));
+    frustum.planes[1] = glm::vec4(rightNormal.x, rightNormal.y, 0.0f, -glm::dot(rightNormal, view.pos));
+    frustum.planes[2] = glm::vec4(forward.x, forward.y, 0.0f, -glm::dot(forward, view.pos));
+    frustum.planes[3] = frustum.planes[4] = frustum.planes[5] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    TraverseBsp(*map, view.pos, frustum, heightRange, visibility);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = (u32)strips.size() - 1;
+        frame++;
+    }
+    wake.notify_all();
+
+    RenderStrip(strips[0]);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return pending == 0; });
+}
+
+void DEUtil::SoftRenderer::RenderStrip(SoftStrip &strip)
+{
+    i32 columns = strip.x1 - strip.x0;
+
+    std::fill(strip.top.begin(), strip.top.end(), 0);
+    std::fill(strip.bottom.begin(), strip.bottom.end(), (i16)height);
+    strip.openColumns = columns;
+    strip.planes.clear();
+
+    // a strip's columns are one contiguous block of the framebuffer
+    memset(framebuffer.data() + (usize)strip.x0 * height, 0, (usize)columns * height);
+
+    for(u16 subsector : visibility.subsectors)
+    {
+        const MapSubsector &sub = map->subsectors[subsector];
+        for(u32 s = sub.firstSeg; s < (u32)sub.firstSeg + sub.segCount; s++)
+            RenderSeg(strip, map->segs[s]);
+
+        if(strip.openColumns == 0)
+            break;
+    }
+
+    DrawPlanes(strip);
+}
+
+#pragma endregion
+
+#pragma region Walls
+
+u32 DEUtil::SoftRenderer::FindPlane(SoftStrip &strip, i32 planeHeight, u32 flat, i32 light, i32 start, i32 stop)
+{
+    // the sky looks the same at every height and light
+    if(flat == SOFT_SKY_FLAT)
+        planeHeight = light = 0;
+
+    i32 columns = strip.x1 - strip.x0;
+    for(u32 i = 0; i < strip.planes.size(); i++)
+    {
+        SoftPlane &plane = strip.planes[i];
+        if(plane.height != planeHeight || plane.flat != flat || plane.light != light)
+            continue;
+
+        // a plane can only grow into columns it doesn't have yet (R_CheckPlane)
+        i32 overlapStart = std::max(start, plane.minX);
+        i32 overlapStop = std::min(stop, plane.maxX);
+
+        i32 x = overlapStart;
+        while(x <= overlapStop && strip.planeTop[plane.columns + x] == SOFT_PLANE_UNUSED)
+            x++;
+
+        if(x <= overlapStop)
+            continue;
+
+        plane.minX = std::min(plane.minX, start);
+        plane.maxX = std::max(plane.maxX, stop);
+        return i;
+    }
+
+    // column storage is kept between frames, only ever grows
+    u32 offset = (u32)strip.planes.size() * columns;
+    if(strip.planeTop.size() < offset + columns)
+    {
+        strip.planeTop.resize(offset + columns);
+        strip.planeBottom.resize(offset + columns);
+    }
+
+    std::fill_n(strip.planeTop.begin() + offset, columns, (i16)SOFT_PLANE_UNUSED);
+    std::fill_n(strip.planeBottom.begin() + offset, columns, (i16)-1);
+
+    strip.planes.push_back(SoftPlane{planeHeight, flat, light, start, stop, offset});
+    return (u32)strip.planes.size() - 1;
+}
+
+void DEUtil::SoftRenderer::DrawWallColumn(i32 x, i32 rowStart, i32 rowEnd, u32 texture, f32 texU, f32 pegTop,
+                                          f32 scale, const u8 *colormap)
+{
+    if(rowStart >= rowEnd || texture == SOFT_NO_TEXTURE)
+        return;
+
+    const SoftTexture &tex = textures[texture];
+    i32 column = WrapTexel(texU, tex.width);
+
+    // texels down from the texture's top at the first row's center
+    f32 step = 1.0f / scale;
+    f32 v = pegTop - view.z + (rowStart + 0.5f - centerY) * step;
+
+    DrawColumn(framebuffer.data() + (usize)x * height + rowStart, rowEnd - rowStart,
+               tex.pixels.data() + (usize)column * tex.height, tex.height, ToFixed(v, (f32)tex.height),
+               (u32)(step * 65536.0f), colormap);
+}
+
+void DEUtil::SoftRenderer::RenderSeg(SoftStrip &strip, const MapSeg &seg)
+{
+    const MapLinedef &line = map->linedefs[seg.linedef];
+    u16 sideIdx = line.sides[seg.side];
+    u16 backSideIdx = line.sides[seg.side ^ 1];
+    const MapSidedef &side = map->sidedefs[sideIdx];
+
+    glm::vec2 v1 = glm::vec2(map->vertices[seg.v1].x, map->vertices[seg.v1].y);
+    glm::vec2 v2 = glm::vec2(map->vertices[seg.v2].x, map->vertices[seg.v2].y);
+
+    // only the side facing the view is drawn, it's on the seg's right
+    glm::vec2 edge = v2 - v1;
+    glm::vec2 toView = view.pos - v1;
+    if(edge.x * toView.y - edge.y * toView.x >= 0.0f)
+        return;
+
+    // view space, x right and y forward (depth)
+    glm::vec2 a = glm::vec2(glm::dot(v1 - view.pos, right), glm::dot(v1 - view.pos, forward));
+    glm::vec2 b = glm::vec2(glm::dot(v2 - view.pos, right), glm::dot(v2 - view.pos, forward));
+    if(a.y < SOFT_NEAR_CLIP && b.y < SOFT_NEAR_CLIP)
+        return;
+
+    f32 t0 = 0.0f, t1 = 1.0f;
+    if(a.y < SOFT_NEAR_CLIP)
+        t0 = (SOFT_NEAR_CLIP - a.y) / (b.y - a.y);
+    if(b.y < SOFT_NEAR_CLIP)
+        t1 = (SOFT_NEAR_CLIP - a.y) / (b.y - a.y);
+
+    glm::vec2 clipA = glm::mix(a, b, t0);
+    glm::vec2 clipB = glm::mix(a, b, t1);
+    f32 screenA = centerX + clipA.x * focal / clipA.y;
+    f32 screenB = centerX + clipB.x * focal / clipB.y;
+
+    // columns whose centers are inside [screenA, screenB)
+    i32 start = std::max((i32)std::ceil(std::max(screenA, -1.0f) - 0.5f), strip.x0);
+    i32 stop = std::min((i32)std::ceil(std::min(screenB, (f32)width + 1.0f) - 0.5f), strip.x1);
+    if(start >= stop)
+        return;
+
+    const MapSector &front = map->sectors[side.sector];
+    const MapSector *back = nullptr;
+    u32 backSector = 0;
+    if(backSideIdx != MAP_NO_SIDEDEF)
+    {
+        backSector = map->sidedefs[backSideIdx].sector;
+        back = &map->sectors[backSector];
+    }
+
+    u32 floorFlat = sectorFloors[side.sector];
+    u32 ceilingFlat = sectorCeilings[side.sector];
+    f32 floorZ = front.floorHeight;
+    f32 ceilingZ = front.ceilingHeight;
+
+    // vanilla's sky hack: no upper wall between two sky ceilings, the sky shows through instead
+    if(back && ceilingFlat == SOFT_SKY_FLAT && sectorCeilings[backSector] == SOFT_SKY_FLAT)
+        ceilingZ = back->ceilingHeight;
+
+    bool markFloor = view.z > floorZ;
+    bool markCeiling = view.z < ceilingZ || ceilingFlat == SOFT_SKY_FLAT;
+
+    // two sided: only mark planes that change across the line, the far side's segs mark the rest
+    if(back)
+    {
+        bool closed = back->ceilingHeight <= front.floorHeight || back->floorHeight >= front.ceilingHeight;
+        bool sameLight = back->light == front.light;
+
+        markFloor &= closed || back->floorHeight != front.floorHeight || sectorFloors[backSector] != floorFlat ||
+                     !sameLight;
+        markCeiling &= closed || back->ceilingHeight != ceilingZ || sectorCeilings[backSector] != ceilingFlat ||
+                       !sameLight;
+    }
+
+    i32 planeLight = LightStart(front.light >> 4);
+    u32 floorPlane = markFloor ? FindPlane(strip, front.floorHeight, floorFlat, planeLight, start - strip.x0,
+                                           stop - 1 - strip.x0)
+                               : 0;
+    u32 ceilingPlane = markCeiling ? FindPlane(strip, (i32)ceilingZ, ceilingFlat, planeLight, start - strip.x0,
+                                               stop - 1 - strip.x0)
+                                   : 0;
+
+    // after both FindPlane() calls, they can grow the column storage
+    i16 *floorTop = markFloor ? strip.planeTop.data() + strip.planes[floorPlane].columns : nullptr;
+    i16 *floorBottom = markFloor ? strip.planeBottom.data() + strip.planes[floorPlane].columns : nullptr;
+    i16 *ceilingTop = markCeiling ? strip.planeTop.data() + strip.planes[ceilingPlane].columns : nullptr;
+    i16 *ceilingBottom = markCeiling ? strip.planeBottom.data() + strip.planes[ceilingPlane].columns : nullptr;
+
+    // fake contrast, axis aligned walls are a level darker/brighter
+    i32 wallLightNum = front.light >> 4;
+    if(v1.y == v2.y)
+        wallLightNum--;
+    else if(v1.x == v2.x)
+        wallLightNum++;
+    i32 wallLight = LightStart(wallLightNum);
+
+    const u32 *textureIdx = &sideTextures[(usize)sideIdx * 3];
+    auto TextureHeight = [&](u32 texture) { return texture == SOFT_NO_TEXTURE ? 0.0f : (f32)textures[texture].height; };
+
+    f32 yOffset = side.yOffset;
+    f32 middlePeg = (line.flags & ML_DONTPEGBOTTOM) ? floorZ + TextureHeight(textureIdx[2]) : ceilingZ;
+    f32 upperPeg = 0.0f, lowerPeg = 0.0f;
+    if(back)
+    {
+        upperPeg = (line.flags & ML_DONTPEGTOP) ? ceilingZ : back->ceilingHeight + TextureHeight(textureIdx[0]);
+        lowerPeg = (line.flags & ML_DONTPEGBOTTOM) ? ceilingZ : back->floorHeight;
+    }
+
+    f32 uOffset = (f32)seg.offset + side.xOffset;
+    f32 segLength = glm::length(edge);
+    glm::vec2 delta = b - a;
+
+    for(i32 x = start; x < stop; x++)
+    {
+        i32 lx = x - strip.x0;
+        i32 top = strip.top[lx];
+        i32 bottom = strip.bottom[lx];
+        if(top >= bottom)
+            continue;
+
+        // where this column's ray crosses the seg, exact instead of stepped across the seg
+        f32 ray = (x + 0.5f - centerX) / focal;
+        f32 denom = delta.x - ray * delta.y;
+        if(denom == 0.0f)
+            continue;
+
+        f32 t = std::clamp((ray * a.y - a.x) / denom, t0, t1);
+        f32 depth = std::max(a.y + t * delta.y, SOFT_NEAR_CLIP);
+        f32 scale = focal / depth;
+        f32 texU = uOffset + t * segLength;
+        const u8 *colormap = colormaps.data() + LightLevel(wallLight, depth) * 256;
+
+        i32 wallTop = std::clamp(RowBelow(centerY - (ceilingZ - view.z) * scale, height), top, bottom);
+        i32 wallBottom = std::clamp(RowBelow(centerY - (floorZ - view.z) * scale, height), wallTop, bottom);
+
+        if(markCeiling && top < wallTop)
+        {
+            ceilingTop[lx] = (i16)top;
+            ceilingBottom[lx] = (i16)(wallTop - 1);
+        }
+
+        if(markFloor && wallBottom < bottom)
+        {
+            floorTop[lx] = (i16)wallBottom;
+            floorBottom[lx] = (i16)(bottom - 1);
+        }
+
+        if(!back)
+        {
+            DrawWallColumn(x, wallTop, wallBottom, textureIdx[2], texU, middlePeg + yOffset, scale, colormap);
+
+            strip.top[lx] = strip.bottom[lx] = (i16)bottom;
+            strip.openColumns--;
+            continue;
+        }
+
+        i32 newTop = markCeiling ? wallTop : top;
+        i32 newBottom = markFloor ? wallBottom : bottom;
+
+        if(back->ceilingHeight < ceilingZ)
+        {
+            i32 upperBottom = std::clamp(RowBelow(centerY - (back->ceilingHeight - view.z) * scale, height), wallTop,
+                                         wallBottom);
+            DrawWallColumn(x, wallTop, upperBottom, textureIdx[0], texU, upperPeg + yOffset, scale, colormap);
+            newTop = upperBottom;
+        }
+
+        if(back->floorHeight > floorZ)
+        {
+            i32 lowerTop = std::clamp(RowBelow(centerY - (back->floorHeight - view.z) * scale, height), newTop,
+                                      wallBottom);
+            DrawWallColumn(x, lowerTop, wallBottom, textureIdx[1], texU, lowerPeg + yOffset, scale, colormap);
+            newBottom = lowerTop;
+        }
+
+        strip.top[lx] = (i16)newTop;
+        strip.bottom[lx] = (i16)std::max(newBottom, newTop);
+        if(newTop >= newBottom)
+            strip.openColumns--;
+    }
+}
+
+#pragma endregion
+
+#pragma region Planes
+
+void DEUtil::SoftRenderer::DrawSkyColumn(i32 x, i32 top, i32 bottom)
+{
+    u8 *dst = framebuffer.data() + (usize)x * height + top;
+    if(skyTexture == SOFT_NO_TEXTURE)
+    {
+        memset(dst, 0, bottom - top);
+        return;
+    }
+
+    const SoftTexture &sky = textures[skyTexture];
+
+    // the sky turns with the view but doesn't move, and is drawn unlit
+    f32 angle = view.angle + std::atan((centerX - (x + 0.5f)) / focal);
+    i32 column = WrapTexel(angle * (SOFT_SKY_COLUMNS / SOFT_TWO_PI), sky.width);
+
+    f32 step = 320.0f / width;
+    f32 v = SOFT_SKY_TEXTURE_MID + (top + 0.5f - centerY) * step;
+
+    DrawColumn(dst, bottom - top, sky.pixels.data() + (usize)column * sky.height, sky.height,
+               ToFixed(v, (f32)sky.height), (u32)(step * 65536.0f), colormaps.data());
+}
+
+void DEUtil::SoftRenderer::DrawPlaneRow(const SoftPlane &plane, i32 y, i32 x1, i32 x2)
+{
+    // distance along the view direction to where this row meets the plane
+    f32 rowOffset = std::max(std::abs(y + 0.5f - centerY), 0.5f);
+    f32 distance = std::abs(plane.height - view.z) * focal / rowOffset;
+
+    // stepped from screen column 0 in fixed point, so a pixel doesn't depend on where its span
+    // (or strip) starts and every thread count draws the same image
+    glm::vec2 pos = view.pos + forward * distance + right * ((0.5f - centerX) * distance / focal);
+    glm::vec2 step = right * (distance / focal);
+
+    // flats are aligned to the map grid and flipped on y, like vanilla
+    const f32 size = (f32)SOFT_FLAT_SIZE;
+    u32 uStep = ToFixed(step.x, size), vStep = ToFixed(-step.y, size);
+    u32 u = ToFixed(pos.x, size) + uStep * (u32)x1;
+    u32 v = ToFixed(-pos.y, size) + vStep * (u32)x1;
+
+    DrawSpan(framebuffer.data() + (usize)x1 * height + y, height, x2 - x1 + 1, flats[plane.flat].data(), u, v,
+             uStep, vStep, colormaps.data() + LightLevel(plane.light, distance) * 256);
+}
+
+void DEUtil::SoftRenderer::DrawPlanes(SoftStrip &strip)
+{
+    for(const SoftPlane &plane : strip.planes)
+    {
+        const i16 *top = strip.planeTop.data() + plane.columns;
+        const i16 *bottom = strip.planeBottom.data() + plane.columns;
+
+        if(plane.flat == SOFT_SKY_FLAT)
+        {
+            for(i32 x = plane.minX; x <= plane.maxX; x++)
+            {
+                if(top[x] <= bottom[x])
+                    DrawSkyColumn(strip.x0 + x, top[x], bottom[x] + 1);
+            }
+
+            continue;
+        }
+
+        // R_MakeSpans: walking the columns, a row's span ends when the row leaves
+        // the plane and a new one starts when it enters
+        i32 prevTop = SOFT_PLANE_UNUSED, prevBottom = -1;
+        for(i32 x = plane.minX; x <= plane.maxX + 1; x++)
+        {
+            i32 t1 = prevTop, b1 = prevBottom;
+            i32 t2 = x <= plane.maxX ? top[x] : SOFT_PLANE_UNUSED;
+            i32 b2 = x <= plane.maxX ? bottom[x] : -1;
+            prevTop = t2;
+            prevBottom = b2;
+
+            for(; t1 < t2 && t1 <= b1; t1++)
+                DrawPlaneRow(plane, t1, strip.x0 + strip.spanStart[t1], strip.x0 + x - 1);
+            for(; b1 > b2 && b1 >= t1; b1--)
+                DrawPlaneRow(plane, b1, strip.x0 + strip.spanStart[b1], strip.x0 + x - 1);
+
+            for(; t2 < t1 && t2 <= b2; t2++)
+                strip.spanStart[t2] = x;
+            for(; b2 > b1 && b2 >= t2; b2--)
+                strip.spanStart[b2] = x;
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region Output
+
+void DEUtil::SoftRenderer::Resolve(u32 *rgba, u32 pitch) const
+{
+    for(u32 y = 0; y < height; y++)
+    {
+        u32 *row = rgba + (usize)y * pitch;
+        for(u32 x = 0; x < width; x++)
+            row[x] = palette[framebuffer[(usize)x * height + y]];
+    }
+}
+
+u64 DEUtil::SoftRenderer::HashFramebuffer() const
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    for(u8 pixel : framebuffer)
+    {
+        hash ^= pixel;
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+#pragma endregion
+
+DEUtil::SoftRenderer::~SoftRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wake.notify_all();
+
+    for(std::thread &worker : workers)
+        worker.join();
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../wad/wad.h"
+#include "../wad/mapData.h"
+#include "../wad/bsp.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// COLORMAP holds 32 light levels, the invulnerability map and an all black one
+#define SOFT_COLORMAP_COUNT 34
+#define SOFT_LIGHT_LEVELS   32
+
+#define SOFT_NO_TEXTURE 0xffffffff // sidedef texture "-"
+#define SOFT_SKY_FLAT   0xfffffffe // sector flat F_SKY1
+
+// planeTop of a column no seg marked yet
+#define SOFT_PLANE_UNUSED 0x7fff
+
+namespace DEUtil {
+
+// 8 bit indexed texture, column major (a wall column is contiguous) like vanilla's composites.
+struct SoftTexture
+{
+    u32 width, height;
+    std::vector<u8> pixels; // width * height
+};
+
+struct SoftView
+{
+    glm::vec2 pos;
+    f32 z;     // eye height
+    f32 angle; // radians, 0 looks along +x, counter-clockwise
+};
+
+// floor/ceiling columns sharing a height, flat and light (vanilla's visplane_t).
+struct SoftPlane
+{
+    i32 height;
+    u32 flat;
+    i32 light;
+    i32 minX, maxX; // strip columns, inclusive
+    u32 columns;    // into SoftStrip::planeTop/planeBottom
+};
+
+// the columns [x0, x1) one thread draws and everything it needs for them.
+// strips never share columns, so they don't share any mutable state either.
+struct SoftStrip
+{
+    i32 x0, x1;
+
+    // rows [top, bottom) of a column are still open, the column is done once top >= bottom
+    std::vector<i16> top, bottom;
+    i32 openColumns;
+
+    std::vector<SoftPlane> planes;
+    std::vector<i16> planeTop, planeBottom; // inclusive rows per plane column
+    std::vector<i32> spanStart;             // per row, first column of the span being built
+};
+
+// cpu renderer in the spirit of vanilla's r_* code: segs front to back as columns,
+// floors and ceilings gathered into planes and drawn as spans. the screen is split into
+// column strips, one per thread. the framebuffer is 8 bit, column major.
+class SoftRenderer
+{
+    private:
+    u32 width, height;
+    f32 centerX, centerY, focal;
+    std::vector<u8> framebuffer;
+
+    u32 palette[256]; // rgba8
+    std::vector<u8> colormaps;
+
+    std::vector<std::vector<u8>> flats;
+    std::unordered_map<u64, u32> flatNames;
+    std::vector<SoftTexture> textures; // [0] is the checkerboard for missing textures
+    std::unordered_map<u64, u32> textureNames;
+
+    // per map, names resolved up front
+    const MapData *map;
+    glm::vec2 heightRange;
+    std::vector<u32> sectorFloors, sectorCeilings;
+    std::vector<u32> sideTextures; // upper, lower, middle per sidedef
+    u32 skyTexture;
+
+    // per frame, read only while the strips draw
+    SoftView view;
+    glm::vec2 forward, right;
+    BspVisibility visibility;
+
+    std::vector<SoftStrip> strips;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    u64 frame;
+    u32 pending;
+    bool quit;
+
+    private:
+    void WorkerLoop(u32 stripIdx);
+    void RenderStrip(SoftStrip &strip);
+    void RenderSeg(SoftStrip &strip, const MapSeg &seg);
+    u32 FindPlane(SoftStrip &strip, i32 planeHeight, u32 flat, i32 light, i32 start, i32 stop);
+    void DrawWallColumn(i32 x, i32 rowStart, i32 rowEnd, u32 texture, f32 texU, f32 pegTop, f32 scale,
+                        const u8 *colormap);
+    void DrawPlanes(SoftStrip &strip);
+    void DrawSkyColumn(i32 x, i32 top, i32 bottom);
+    void DrawPlaneRow(const SoftPlane &plane, i32 y, i32 x1, i32 x2);
+    u32 ResolveTexture(const char *name) const;
+
+    public:
+    // threadCount 0 uses every hardware thread
+    SoftRenderer(u32 width, u32 height, u32 threadCount);
+    SoftRenderer(const SoftRenderer &renderer) = delete;
+    SoftRenderer &operator=(const SoftRenderer &renderer) = delete;
+
+    // PLAYPAL, COLORMAP and every flat between F_START and F_END.
+    bool LoadAssets(const WadArchive &archive);
+
+    // wall textures have to be added before SetMap(), missing ones draw as a checkerboard.
+    void AddTexture(u64 name, const SoftTexture &texture);
+
+    // AddTexture() for every texture of TEXTURE1 and TEXTURE2, composed from their patches.
+    bool LoadWallTextures(const WadArchive &archive);
+
+    // map has to outlive the renderer or the next SetMap().
+    void SetMap(const MapData &map);
+
+    void Render(const SoftView &view);
+
+    // expands the indexed framebuffer through the palette, pitch in pixels.
+    void Resolve(u32 *rgba, u32 pitch) const;
+
+    // fnv-1a of the indexed framebuffer, identical on every run and thread count.
+    u64 HashFramebuffer() const;
+
+    inline const u8 *GetFramebuffer() const { return framebuffer.data(); }
+    inline u32 GetWidth() const { return width; }
+    inline u32 GetHeight() const { return height; }
+    inline u32 GetThreadCount() const { return (u32)strips.size(); }
+
+    ~SoftRenderer();
+};
+
+} // namespace DEUtil
@@ -0,0 +1,177 @@
+#include "spriteBatch.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SPRITEBATCH_SSE2 1
+#endif
+
+#define RADIX_BITS    8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES  (32 / RADIX_BITS)
+
+// float bits that sort as unsigned ints: negatives get every bit flipped, positives the sign bit
+static inline u32 SortableFloat(f32 value)
+{
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits ^ ((u32)((i32)bits >> 31) | 0x80000000);
+}
+
+DEUtil::SpriteBatcher::SpriteBatcher(u32 maxSprites)
+    : maxSprites{maxSprites}, eye{0.0f}, forward{1.0f, 0.0f}, right{0.0f, -1.0f}
+{
+    sprites.reserve(maxSprites);
+    keys.reserve(maxSprites);
+    keysScratch.reserve(maxSprites);
+    order.reserve(maxSprites);
+    orderScratch.reserve(maxSprites);
+    vertices.reserve((usize)maxSprites * 4);
+
+    indices.resize((usize)maxSprites * SPRITE_QUAD_INDICES);
+    for(u32 quad = 0; quad < maxSprites; quad++)
+    {
+        u32 *idx = indices.data() + (usize)quad * SPRITE_QUAD_INDICES;
+        u32 first = quad * 4;
+        idx[0] = first;
+        idx[1] = first + 1;
+        idx[2] = first + 2;
+        idx[3] = first + 2;
+        idx[4] = first + 3;
+        idx[5] = first;
+    }
+}
+
+void DEUtil::SpriteBatcher::Begin(const glm::vec3 &eyePos, f32 angle)
+{
+    eye = eyePos;
+    forward = glm::vec2(std::cos(angle), std::sin(angle));
+    right = glm::vec2(forward.y, -forward.x);
+
+    sprites.clear();
+}
+
+bool DEUtil::SpriteBatcher::Add(const Sprite &sprite)
+{
+    if(sprites.size() >= maxSprites)
+        return false;
+
+    sprites.push_back(sprite);
+    return true;
+}
+
+void DEUtil::SpriteBatcher::SortByDepth()
+{
+    keys.clear();
+    order.clear();
+    for(u32 i = 0; i < sprites.size(); i++)
+    {
+        const Sprite &sprite = sprites[i];
+        f32 depth = (sprite.pos.x - eye.x) * forward.x + (sprite.pos.y - eye.y) * forward.y;
+        if(!(depth >= SPRITE_NEAR_DEPTH))
+            continue;
+
+        // flipped so the farthest sorts first
+        keys.push_back(~SortableFloat(depth));
+        order.push_back(i);
+    }
+
+    // lsd radix sort, every histogram comes from one pass over the keys. a pass whose digit
+    // is the same for every key wouldn't move anything and is skipped
+    usize count = keys.size();
+    u32 histograms[RADIX_PASSES][RADIX_BUCKETS] = {};
+    for(u32 key : keys)
+    {
+        for(u32 pass = 0; pass < RADIX_PASSES; pass++)
+            histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+    }
+
+    keysScratch.resize(count);
+    orderScratch.resize(count);
+    for(u32 pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        u32 *histogram = histograms[pass];
+        u32 shift = pass * RADIX_BITS;
+        if(count == 0 || histogram[(keys[0] >> shift) & (RADIX_BUCKETS - 1)] == count)
+            continue;
+
+        u32 offset = 0;
+        for(u32 bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+        {
+            u32 size = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += size;
+        }
+
+        for(usize i = 0; i < count; i++)
+        {
+            u32 dst = histogram[(keys[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+            keysScratch[dst] = keys[i];
+            orderScratch[dst] = order[i];
+        }
+
+        keys.swap(keysScratch);
+        order.swap(orderScratch);
+    }
+}
+
+void DEUtil::SpriteBatcher::BuildQuads()
+{
+    vertices.resize(order.size() * 4);
+    draws.clear();
+
+#if defined(SPRITEBATCH_SSE2)
+    const __m128 rightDir = _mm_setr_ps(right.x, right.y, 0.0f, 0.0f);
+#endif
+
+    for(u32 quad = 0; quad < order.size(); quad++)
+    {
+        const Sprite &sprite = sprites[order[quad]];
+        SpriteVertex *v = vertices.data() + (usize)quad * 4;
+
+        f32 u0 = sprite.uvRect.x, u1 = sprite.uvRect.x + sprite.uvRect.z;
+        f32 vTop = sprite.uvRect.y, vBottom = sprite.uvRect.y + sprite.uvRect.w;
+        f32 leftEdge = -sprite.left, rightEdge = sprite.width - sprite.left;
+        f32 bottomEdge = sprite.top - sprite.height, topEdge = sprite.top;
+        f32 layer = (f32)sprite.layer;
+
+#if defined(SPRITEBATCH_SSE2)
+        // corners are the origin pushed along the eye's right and up, light rides along in w
+        __m128 origin = _mm_setr_ps(sprite.pos.x, sprite.pos.y, sprite.pos.z, sprite.light);
+        __m128 leftSide = _mm_add_ps(origin, _mm_mul_ps(rightDir, _mm_set1_ps(leftEdge)));
+        __m128 rightSide = _mm_add_ps(origin, _mm_mul_ps(rightDir, _mm_set1_ps(rightEdge)));
+        __m128 bottom = _mm_setr_ps(0.0f, 0.0f, bottomEdge, 0.0f);
+        __m128 top = _mm_setr_ps(0.0f, 0.0f, topEdge, 0.0f);
+
+        _mm_storeu_ps(&v[0].x, _mm_add_ps(leftSide, bottom));
+        _mm_storeu_ps(&v[0].u, _mm_setr_ps(u0, vBottom, layer, 0.0f));
+        _mm_storeu_ps(&v[1].x, _mm_add_ps(rightSide, bottom));
+        _mm_storeu_ps(&v[1].u, _mm_setr_ps(u1, vBottom, layer, 0.0f));
+        _mm_storeu_ps(&v[2].x, _mm_add_ps(rightSide, top));
+        _mm_storeu_ps(&v[2].u, _mm_setr_ps(u1, vTop, layer, 0.0f));
+        _mm_storeu_ps(&v[3].x, _mm_add_ps(leftSide, top));
+        _mm_storeu_ps(&v[3].u, _mm_setr_ps(u0, vTop, layer, 0.0f));
+#else
+        f32 leftX = sprite.pos.x + right.x * leftEdge, leftY = sprite.pos.y + right.y * leftEdge;
+        f32 rightX = sprite.pos.x + right.x * rightEdge, rightY = sprite.pos.y + right.y * rightEdge;
+        f32 bottomZ = sprite.pos.z + bottomEdge, topZ = sprite.pos.z + topEdge;
+
+        v[0] = {leftX, leftY, bottomZ, sprite.light, u0, vBottom, layer, 0.0f};
+        v[1] = {rightX, rightY, bottomZ, sprite.light, u1, vBottom, layer, 0.0f};
+        v[2] = {rightX, rightY, topZ, sprite.light, u1, vTop, layer, 0.0f};
+        v[3] = {leftX, leftY, topZ, sprite.light, u0, vTop, layer, 0.0f};
+#endif
+
+        if(draws.empty() || draws.back().textureArray != sprite.textureArray)
+            draws.push_back({sprite.textureArray, quad, 0});
+        draws.back().quadCount++;
+    }
+}
+
+void DEUtil::SpriteBatcher::End()
+{
+    SortByDepth();
+    BuildQuads();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../core/defines.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// sprites closer to the eye than this (along the view direction) are dropped
+#define SPRITE_NEAR_DEPTH 1.0f
+
+// indices per quad, two triangles: 0 1 2, 2 3 0
+#define SPRITE_QUAD_INDICES 6
+
+namespace DEUtil {
+
+// a thing's frame in map space (x, y on the ground, z up)
+struct Sprite
+{
+    glm::vec3 pos;     // origin, on the thing's floor
+    f32 width, height; // world units, a texel each for vanilla's sprites
+    f32 left, top;     // the picture's offsets, the origin sits left units from its left edge
+                       // and top units below its top
+    glm::vec4 uvRect;  // (u, v, width, height) in its layer, TextureAtlas::GetUVRect()
+    u32 layer;
+    u32 textureArray; // whatever the renderer binds, an atlas per array
+    f32 light;        // 0..1, copied to every vertex
+};
+
+// 32 bytes, two 16 byte stores
+struct SpriteVertex
+{
+    f32 x, y, z, light;
+    f32 u, v, layer, pad;
+};
+
+// a run of back to back quads sampling one texture array, drawn with SPRITE_QUAD_INDICES
+// indices per quad starting at firstQuad * SPRITE_QUAD_INDICES
+struct SpriteDraw
+{
+    u32 textureArray;
+    u32 firstQuad, quadCount;
+};
+
+// batches billboarded sprites into one vertex stream. End() drops the ones behind the eye,
+// radix sorts the rest back to front on view depth (so masked and translucent edges blend
+// over what's behind them) and expands each into a quad that faces the eye and stays
+// upright like vanilla's, 4 vertices a sprite. quads of consecutive sprites that share
+// a texture array are one draw, a single sprite atlas makes the whole frame one draw.
+class SpriteBatcher
+{
+    private:
+    u32 maxSprites;
+    std::vector<Sprite> sprites;
+
+    glm::vec3 eye;
+    glm::vec2 forward, right;
+
+    // radix sort keys and sprite indices, double buffered
+    std::vector<u32> keys, keysScratch;
+    std::vector<u32> order, orderScratch;
+
+    std::vector<SpriteVertex> vertices;
+    std::vector<u32> indices;
+    std::vector<SpriteDraw> draws;
+
+    private:
+    void SortByDepth();
+    void BuildQuads();
+
+    public:
+    SpriteBatcher(u32 maxSprites);
+
+    // angle is the eye's yaw in radians, 0 looks along +x and it turns counter-clockwise
+    void Begin(const glm::vec3 &eyePos, f32 angle);
+
+    // returns false once maxSprites were added this batch, the sprite is dropped then.
+    bool Add(const Sprite &sprite);
+
+    void End();
+
+    // SPRITE_QUAD_INDICES per quad for maxSprites quads, they don't change between batches
+    inline const std::vector<u32> &GetIndices() const { return indices; }
+    inline const std::vector<SpriteVertex> &GetVertices() const { return vertices; }
+    inline const std::vector<SpriteDraw> &GetDraws() const { return draws; }
+
+    // sprites that survived End()'s cull, in drawing order
+    inline u32 GetQuadCount() const { return (u32)(vertices.size() / 4); }
+    inline u32 GetSortedSprite(u32 quad) const { return order[quad]; }
+    inline const Sprite &GetSprite(u32 idx) const { return sprites[idx]; }
+};
+
+} // namespace DEUtil
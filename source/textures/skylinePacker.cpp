@@ -0,0 +1,101 @@
+#include "skylinePacker.h"
+
+#include <algorithm>
+
+DEUtil::SkylinePacker::SkylinePacker(u32 width, u32 height) : width{width}, height{height}
+{
+    Reset();
+}
+
+void DEUtil::SkylinePacker::Reset()
+{
+    skyline.clear();
+    skyline.push_back({0, 0, width});
+    usedArea = 0;
+}
+
+i64 DEUtil::SkylinePacker::FitAt(u32 idx, u32 rectWidth, u32 rectHeight) const
+{
+    u32 x = skyline[idx].x;
+    if(x + rectWidth > width)
+        return -1;
+
+    // the rect rests on the highest segment it spans
+    u32 y = 0;
+    u32 spanned = 0;
+    for(u32 i = idx; spanned < rectWidth; i++)
+    {
+        y = std::max(y, skyline[i].y);
+        if(y + rectHeight > height)
+            return -1;
+
+        spanned += skyline[i].width;
+    }
+
+    return y;
+}
+
+bool DEUtil::SkylinePacker::Insert(u32 rectWidth, u32 rectHeight, u32 &x, u32 &y)
+{
+    if(rectWidth == 0 || rectHeight == 0)
+        return false;
+
+    i64 bestTop = -1;
+    u32 bestWidth = 0;
+    u32 bestIdx = 0;
+    for(u32 i = 0; i < skyline.size(); i++)
+    {
+        i64 fit = FitAt(i, rectWidth, rectHeight);
+        if(fit < 0)
+            continue;
+
+        i64 top = fit + rectHeight;
+        if(bestTop < 0 || top < bestTop || (top == bestTop && skyline[i].width < bestWidth))
+        {
+            bestTop = top;
+            bestWidth = skyline[i].width;
+            bestIdx = i;
+        }
+    }
+
+    if(bestTop < 0)
+        return false;
+
+    x = skyline[bestIdx].x;
+    y = (u32)bestTop - rectHeight;
+
+    // the rect's top replaces every segment under it, the last one may be cut
+    SkylineSegment placed = {x, (u32)bestTop, rectWidth};
+    u32 right = x + rectWidth;
+
+    u32 end = bestIdx;
+    while(end < skyline.size() && skyline[end].x + skyline[end].width <= right)
+        end++;
+
+    if(end < skyline.size() && skyline[end].x < right)
+    {
+        u32 cut = right - skyline[end].x;
+        skyline[end].x = right;
+        skyline[end].width -= cut;
+    }
+
+    skyline.erase(skyline.begin() + bestIdx, skyline.begin() + end);
+    skyline.insert(skyline.begin() + bestIdx, placed);
+
+    // neighbours of the same height are one segment
+    for(u32 i = bestIdx > 0 ? bestIdx - 1 : 0; i + 1 < skyline.size() && i <= bestIdx + 1;)
+    {
+        if(skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    usedArea += (u64)rectWidth * rectHeight;
+    return true;
+}
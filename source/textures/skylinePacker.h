@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../core/defines.h"
+
+#include <vector>
+
+namespace DEUtil {
+
+// top edge of the packed area over [x, x + width)
+struct SkylineSegment
+{
+    u32 x, y;
+    u32 width;
+};
+
+// skyline bottom-left rectangle packer for one fixed size bin. the packed area is kept as
+// a staircase of segments, a rect goes where its top ends lowest (ties go to the tightest
+// fitting segment). gaps under overhangs are lost, which is cheap to track and packs
+// within a few percent of maxrects for rects sorted by height.
+class SkylinePacker
+{
+    private:
+    u32 width, height;
+    std::vector<SkylineSegment> skyline;
+    u64 usedArea;
+
+    private:
+    // lowest y a rect of rectWidth fits at when its left edge is on segment idx, -1 if it doesn't
+    i64 FitAt(u32 idx, u32 rectWidth, u32 rectHeight) const;
+
+    public:
+    SkylinePacker(u32 width, u32 height);
+
+    void Reset();
+
+    // returns false if it doesn't fit anywhere, the bin is unchanged then.
+    bool Insert(u32 rectWidth, u32 rectHeight, u32 &x, u32 &y);
+
+    // packed area over the bin's area
+    inline f32 GetOccupancy() const { return (f32)((f64)usedArea / ((f64)width * height)); }
+    inline u32 GetWidth() const { return width; }
+    inline u32 GetHeight() const { return height; }
+};
+
+} // namespace DEUtil
@@ -0,0 +1,224 @@
+#include "textureAtlas.h"
+#include "../core/logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+static inline u32 AlignUp(u32 value, u32 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+DEUtil::TextureAtlas::TextureAtlas(u32 layerSize, u32 maxLayers, u32 mipLevels)
+    : maxLayers{std::max(maxLayers, 1u)}
+{
+    this->layerSize = 1;
+    while(this->layerSize < layerSize)
+        this->layerSize <<= 1;
+
+    u32 levels = 1;
+    while((this->layerSize >> levels) > 0)
+        levels++;
+
+    this->mipLevels = std::clamp(mipLevels, 1u, levels);
+    border = 1u << (this->mipLevels - 1);
+
+    memset(palette, 0, sizeof(palette));
+}
+
+u8 DEUtil::TextureAtlas::NearestColor(u32 r, u32 g, u32 b)
+{
+    u32 key = ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+    if(nearestColors[key] != 0xffff)
+        return (u8)nearestColors[key];
+
+    // the bucket's center, so the result doesn't depend on which color asked first
+    i32 cr = (i32)((r & ~7u) | 4), cg = (i32)((g & ~7u) | 4), cb = (i32)((b & ~7u) | 4);
+
+    u32 best = 0;
+    i32 bestDist = INT32_MAX;
+    for(u32 i = 0; i < 256; i++)
+    {
+        i32 dr = palette[i * 3] - cr, dg = palette[i * 3 + 1] - cg, db = palette[i * 3 + 2] - cb;
+        i32 dist = dr * dr + dg * dg + db * db;
+        if(dist < bestDist)
+        {
+            bestDist = dist;
+            best = i;
+        }
+    }
+
+    nearestColors[key] = (u16)best;
+    return (u8)best;
+}
+
+void DEUtil::TextureAtlas::BuildMip(u32 mip)
+{
+    u32 srcSize = layerSize >> (mip - 1);
+    u32 dstSize = layerSize >> mip;
+    const std::vector<u8> &src = mips[mip - 1];
+    std::vector<u8> &dst = mips[mip];
+    dst.assign((usize)layers.size() * dstSize * dstSize * ATLAS_TEXEL_SIZE, 0);
+
+    for(u32 layer = 0; layer < layers.size(); layer++)
+    {
+        const u8 *srcLayer = src.data() + (usize)layer * srcSize * srcSize * ATLAS_TEXEL_SIZE;
+        u8 *dstLayer = dst.data() + (usize)layer * dstSize * dstSize * ATLAS_TEXEL_SIZE;
+
+        for(u32 y = 0; y < dstSize; y++)
+        {
+            for(u32 x = 0; x < dstSize; x++)
+            {
+                u32 r = 0, g = 0, b = 0, covered = 0;
+                for(u32 sy = 0; sy < 2; sy++)
+                {
+                    const u8 *row = srcLayer + ((usize)(y * 2 + sy) * srcSize + x * 2) * ATLAS_TEXEL_SIZE;
+                    for(u32 sx = 0; sx < 2; sx++)
+                    {
+                        const u8 *texel = row + sx * ATLAS_TEXEL_SIZE;
+                        if(!texel[1])
+                            continue;
+
+                        r += palette[texel[0] * 3];
+                        g += palette[texel[0] * 3 + 1];
+                        b += palette[texel[0] * 3 + 2];
+                        covered++;
+                    }
+                }
+
+                // mostly see-through blocks stay see-through, so sprite edges don't grow
+                if(covered < 2)
+                    continue;
+
+                u8 *texel = dstLayer + ((usize)y * dstSize + x) * ATLAS_TEXEL_SIZE;
+                texel[0] = NearestColor(r / covered, g / covered, b / covered);
+                texel[1] = 0xff;
+            }
+        }
+    }
+}
+
+bool DEUtil::TextureAtlas::Build(const std::vector<WadImage> &images, const u8 *playpal)
+{
+    regions.assign(images.size(), AtlasRegion{});
+    names.clear();
+    layers.clear();
+    mips.clear();
+
+    memcpy(palette, playpal, sizeof(palette));
+    nearestColors.assign(1 << 15, 0xffff);
+
+    // tallest first keeps the skyline flat, widest breaks ties
+    std::vector<u32> order(images.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&images](u32 a, u32 b) {
+        if(images[a].height != images[b].height)
+            return images[a].height > images[b].height;
+        if(images[a].width != images[b].width)
+            return images[a].width > images[b].width;
+        return a < b;
+    });
+
+    for(u32 idx : order)
+    {
+        const WadImage &image = images[idx];
+        u32 allocWidth = AlignUp(image.width, border) + 2 * border;
+        u32 allocHeight = AlignUp(image.height, border) + 2 * border;
+        if(image.width == 0 || image.height == 0 || allocWidth > layerSize || allocHeight > layerSize)
+        {
+            LERROR("atlas: image " << idx << " (" << image.width << "x" << image.height << ") doesn't fit a "
+                                   << layerSize << "x" << layerSize << " layer.\n");
+            regions.clear();
+            layers.clear();
+            return false;
+        }
+
+        u32 x, y, layer = 0;
+        while(layer < layers.size() && !layers[layer].Insert(allocWidth, allocHeight, x, y))
+            layer++;
+
+        if(layer == layers.size())
+        {
+            if(layers.size() == maxLayers)
+            {
+                LERROR("atlas: all " << maxLayers << " layers are full.\n");
+                regions.clear();
+                layers.clear();
+                return false;
+            }
+
+            layers.emplace_back(layerSize, layerSize);
+            layers.back().Insert(allocWidth, allocHeight, x, y);
+        }
+
+        regions[idx] = {layer, x + border, y + border, image.width, image.height};
+    }
+
+    for(u32 i = 0; i < images.size(); i++)
+        names[images[i].name] = i;
+
+    // wrapped copies fill the border and the alignment padding, so repeating
+    // textures filter (and mip) across their edges like they tile
+    mips.resize(mipLevels);
+    mips[0].assign((usize)layers.size() * layerSize * layerSize * ATLAS_TEXEL_SIZE, 0);
+
+    std::vector<u32> sourceX;
+    for(u32 i = 0; i < images.size(); i++)
+    {
+        const WadImage &image = images[i];
+        const AtlasRegion &region = regions[i];
+        u32 allocX = region.x - border, allocY = region.y - border;
+        u32 allocWidth = AlignUp(image.width, border) + 2 * border;
+        u32 allocHeight = AlignUp(image.height, border) + 2 * border;
+
+        sourceX.resize(allocWidth);
+        for(u32 x = 0; x < allocWidth; x++)
+            sourceX[x] = (x + image.width - border % image.width) % image.width;
+
+        u8 *layer = mips[0].data() + (usize)region.layer * layerSize * layerSize * ATLAS_TEXEL_SIZE;
+        for(u32 y = 0; y < allocHeight; y++)
+        {
+            u32 srcY = (y + image.height - border % image.height) % image.height;
+            const u8 *srcPixels = image.pixels.data() + (usize)srcY * image.width;
+            const u8 *srcCoverage = image.coverage.data() + (usize)srcY * image.width;
+            u8 *dst = layer + ((usize)(allocY + y) * layerSize + allocX) * ATLAS_TEXEL_SIZE;
+
+            for(u32 x = 0; x < allocWidth; x++)
+            {
+                dst[x * ATLAS_TEXEL_SIZE] = srcPixels[sourceX[x]];
+                dst[x * ATLAS_TEXEL_SIZE + 1] = srcCoverage[sourceX[x]] ? 0xff : 0;
+            }
+        }
+    }
+
+    for(u32 mip = 1; mip < mipLevels; mip++)
+        BuildMip(mip);
+
+    return true;
+}
+
+u32 DEUtil::TextureAtlas::Find(u64 name) const
+{
+    auto found = names.find(name);
+    return found != names.end() ? found->second : ATLAS_HANDLE_NULL;
+}
+
+glm::vec4 DEUtil::TextureAtlas::GetUVRect(u32 handle) const
+{
+    const AtlasRegion &region = regions[handle];
+    f32 scale = 1.0f / layerSize;
+    return glm::vec4(region.x * scale, region.y * scale, region.width * scale, region.height * scale);
+}
+
+f32 DEUtil::TextureAtlas::GetOccupancy() const
+{
+    if(layers.empty())
+        return 0.0f;
+
+    f32 sum = 0.0f;
+    for(const SkylinePacker &layer : layers)
+        sum += layer.GetOccupancy();
+
+    return sum / layers.size();
+}
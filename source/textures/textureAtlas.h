@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../wad/wadTextures.h"
+#include "skylinePacker.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#define ATLAS_HANDLE_NULL 0xffffffff
+
+// a texel is (palette index, coverage 0 or 255), r8g8 on the gpu
+#define ATLAS_TEXEL_SIZE 2
+
+namespace DEUtil {
+
+// where an image ended up, in mip 0 texels of its layer
+struct AtlasRegion
+{
+    u32 layer;
+    u32 x, y;
+    u32 width, height;
+};
+
+// packs 8 bit images into the layers of a texture array, so walls, flats and sprites
+// can be drawn without switching textures. every region is surrounded by a wrapped border
+// and starts on a multiple of 2^(mipLevels - 1), so no mip texel mixes two images.
+// mips average through the palette and map back to the nearest palette index.
+//
+// texel data of a mip is every layer back to back, the layout UploadImage() copies.
+class TextureAtlas
+{
+    private:
+    u32 layerSize;
+    u32 maxLayers;
+    u32 mipLevels;
+    u32 border;
+
+    std::vector<AtlasRegion> regions; // handle -> region, in input order
+    std::unordered_map<u64, u32> names;
+    std::vector<SkylinePacker> layers;
+    std::vector<std::vector<u8>> mips;
+
+    u8 palette[256 * 3];
+    std::vector<u16> nearestColors; // rgb555 -> palette index, 0xffff until first used
+
+    private:
+    u8 NearestColor(u32 r, u32 g, u32 b);
+    void BuildMip(u32 mip);
+
+    public:
+    // layerSize is rounded up to a power of two, mipLevels is capped at the layer's mip count.
+    TextureAtlas(u32 layerSize, u32 maxLayers, u32 mipLevels);
+
+    // packs images (tallest first), the handle of images[i] is i. playpal is 256 rgb
+    // triplets for the mips. returns false (and logs) if an image is bigger than a layer
+    // or maxLayers run out, the atlas is empty then.
+    bool Build(const std::vector<WadImage> &images, const u8 *playpal);
+
+    // handle of the last image with that name, ATLAS_HANDLE_NULL if there's none.
+    u32 Find(u64 name) const;
+
+    // (u, v, width, height) of a region, normalized to the layer.
+    glm::vec4 GetUVRect(u32 handle) const;
+
+    // sum of the packed area (borders included) over the area of every used layer
+    f32 GetOccupancy() const;
+
+    inline const AtlasRegion &GetRegion(u32 handle) const { return regions[handle]; }
+    inline u32 GetRegionCount() const { return (u32)regions.size(); }
+    inline const std::vector<u8> &GetMip(u32 mip) const { return mips[mip]; }
+    inline u32 GetMipLevels() const { return mipLevels; }
+    inline u32 GetLayerCount() const { return (u32)layers.size(); }
+    inline u32 GetLayerSize() const { return layerSize; }
+    inline u32 GetBorder() const { return border; }
+};
+
+} // namespace DEUtil
@@ -0,0 +1,379 @@
+#include "blockmap.h"
+#include "../core/logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+DEUtil::Blockmap::Blockmap() : origin{0, 0}, columns{0}, rows{0} {}
+
+#pragma region Building
+
+bool DEUtil::Blockmap::Parse(const MapData &map)
+{
+    const std::vector<i16> &lump = map.blockmap;
+    if(lump.size() < 4)
+        return false;
+
+    glm::ivec2 lumpOrigin = glm::ivec2(lump[0], lump[1]);
+    u32 lumpColumns = (u16)lump[2];
+    u32 lumpRows = (u16)lump[3];
+    u32 cellCount = lumpColumns * lumpRows;
+    if(cellCount == 0 || lump.size() < 4 + (usize)cellCount)
+        return false;
+
+    // vanilla's node builders start every list with a 0 that isn't a line (so vanilla tests
+    // linedef 0 everywhere), some others don't. only a lump whose lists all start with one
+    // has it, otherwise a leading 0 is linedef 0 itself
+    bool leadingZero = true;
+    for(u32 cell = 0; cell < cellCount && leadingZero; cell++)
+    {
+        usize i = (u16)lump[4 + cell];
+        leadingZero = i < lump.size() && lump[i] == 0;
+    }
+
+    std::vector<u32> offsets(cellCount + 1, 0);
+    std::vector<u16> lines;
+    for(u32 cell = 0; cell < cellCount; cell++)
+    {
+        offsets[cell] = (u32)lines.size();
+
+        usize i = (u16)lump[4 + cell];
+        if(leadingZero)
+            i++;
+
+        for(; i < lump.size() && (u16)lump[i] != BLOCKMAP_LIST_END; i++)
+        {
+            if((u16)lump[i] >= map.linedefs.size())
+                return false;
+
+            lines.push_back((u16)lump[i]);
+        }
+
+        // ran off the end of the lump, offsets overflowed (huge maps) or it's corrupt
+        if(i >= lump.size())
+            return false;
+    }
+    offsets[cellCount] = (u32)lines.size();
+
+    origin = lumpOrigin;
+    columns = lumpColumns;
+    rows = lumpRows;
+    cellOffsets = std::move(offsets);
+    cellLines = std::move(lines);
+
+    return true;
+}
+
+// liang-barsky, clips the segment p + t * d (t in [t0, t1]) to the box
+static bool ClipToBox(glm::dvec2 p, glm::dvec2 d, glm::dvec2 boxMin, glm::dvec2 boxMax, f64 &t0, f64 &t1)
+{
+    for(i32 axis = 0; axis < 2; axis++)
+    {
+        if(d[axis] == 0.0)
+        {
+            if(p[axis] < boxMin[axis] || p[axis] > boxMax[axis])
+                return false;
+
+            continue;
+        }
+
+        f64 ta = (boxMin[axis] - p[axis]) / d[axis];
+        f64 tb = (boxMax[axis] - p[axis]) / d[axis];
+        if(ta > tb)
+            std::swap(ta, tb);
+
+        t0 = std::max(t0, ta);
+        t1 = std::min(t1, tb);
+        if(t0 > t1)
+            return false;
+    }
+
+    return true;
+}
+
+void DEUtil::Blockmap::Generate(const MapData &map)
+{
+    if(map.vertices.empty())
+    {
+        origin = glm::ivec2(0, 0);
+        columns = rows = 1;
+        cellOffsets.assign(2, 0);
+        cellLines.clear();
+        return;
+    }
+
+    glm::ivec2 boundsMin = glm::ivec2(map.vertices[0].x, map.vertices[0].y);
+    glm::ivec2 boundsMax = boundsMin;
+    for(const MapVertex &v : map.vertices)
+    {
+        boundsMin = glm::ivec2(std::min<i32>(boundsMin.x, v.x), std::min<i32>(boundsMin.y, v.y));
+        boundsMax = glm::ivec2(std::max<i32>(boundsMax.x, v.x), std::max<i32>(boundsMax.y, v.y));
+    }
+
+    origin = boundsMin;
+    columns = (u32)(boundsMax.x - boundsMin.x) / BLOCKMAP_BLOCK_SIZE + 1;
+    rows = (u32)(boundsMax.y - boundsMin.y) / BLOCKMAP_BLOCK_SIZE + 1;
+
+    std::vector<std::vector<u16>> cells((usize)columns * rows);
+    for(u32 l = 0; l < map.linedefs.size(); l++)
+    {
+        const MapLinedef &line = map.linedefs[l];
+        glm::dvec2 a = glm::dvec2(map.vertices[line.v1].x - origin.x, map.vertices[line.v1].y - origin.y);
+        glm::dvec2 b = glm::dvec2(map.vertices[line.v2].x - origin.x, map.vertices[line.v2].y - origin.y);
+
+        i32 x0 = (i32)std::min(a.x, b.x) / BLOCKMAP_BLOCK_SIZE, x1 = (i32)std::max(a.x, b.x) / BLOCKMAP_BLOCK_SIZE;
+        i32 y0 = (i32)std::min(a.y, b.y) / BLOCKMAP_BLOCK_SIZE, y1 = (i32)std::max(a.y, b.y) / BLOCKMAP_BLOCK_SIZE;
+
+        // every block the segment touches, boundaries included so rays along them still find it
+        for(i32 y = y0; y <= y1; y++)
+        {
+            for(i32 x = x0; x <= x1; x++)
+            {
+                glm::dvec2 boxMin = glm::dvec2(x * BLOCKMAP_BLOCK_SIZE - 1.0, y * BLOCKMAP_BLOCK_SIZE - 1.0);
+                glm::dvec2 boxMax = glm::dvec2((x + 1) * BLOCKMAP_BLOCK_SIZE + 1.0, (y + 1) * BLOCKMAP_BLOCK_SIZE + 1.0);
+
+                f64 t0 = 0.0, t1 = 1.0;
+                if(ClipToBox(a, b - a, boxMin, boxMax, t0, t1))
+                    cells[(usize)y * columns + x].push_back((u16)l);
+            }
+        }
+    }
+
+    cellOffsets.assign(cells.size() + 1, 0);
+    cellLines.clear();
+    for(usize c = 0; c < cells.size(); c++)
+    {
+        cellOffsets[c] = (u32)cellLines.size();
+        cellLines.insert(cellLines.end(), cells[c].begin(), cells[c].end());
+    }
+    cellOffsets[cells.size()] = (u32)cellLines.size();
+}
+
+void DEUtil::Blockmap::Build(const MapData &map)
+{
+    if(Parse(map))
+        return;
+
+    if(!map.blockmap.empty())
+        LWARN(true, "blockmap: the map's BLOCKMAP lump is corrupt or overflowed, generating one.\n");
+
+    Generate(map);
+}
+
+#pragma endregion
+
+#pragma region Queries
+
+void DEUtil::Blockmap::BeginQuery(const MapData &map, BlockmapQuery &query) const
+{
+    query.lines.clear();
+
+    if(query.lineStamps.size() != map.linedefs.size())
+    {
+        query.lineStamps.assign(map.linedefs.size(), 0);
+        query.stamp = 0;
+    }
+
+    // on wrap around, old stamps could match again
+    if(++query.stamp == 0)
+    {
+        std::fill(query.lineStamps.begin(), query.lineStamps.end(), 0);
+        query.stamp = 1;
+    }
+}
+
+bool DEUtil::Blockmap::GetCell(glm::vec2 p, glm::ivec2 &cell) const
+{
+    i32 x = (i32)std::floor((p.x - origin.x) / BLOCKMAP_BLOCK_SIZE);
+    i32 y = (i32)std::floor((p.y - origin.y) / BLOCKMAP_BLOCK_SIZE);
+    if(x < 0 || y < 0 || x >= (i32)columns || y >= (i32)rows)
+        return false;
+
+    cell = glm::ivec2(x, y);
+    return true;
+}
+
+void DEUtil::Blockmap::LinesInBox(const MapData &map, glm::vec2 boxMin, glm::vec2 boxMax, BlockmapQuery &query) const
+{
+    BeginQuery(map, query);
+
+    i32 x0 = std::max((i32)std::floor((boxMin.x - origin.x) / BLOCKMAP_BLOCK_SIZE), 0);
+    i32 y0 = std::max((i32)std::floor((boxMin.y - origin.y) / BLOCKMAP_BLOCK_SIZE), 0);
+    i32 x1 = std::min((i32)std::floor((boxMax.x - origin.x) / BLOCKMAP_BLOCK_SIZE), (i32)columns - 1);
+    i32 y1 = std::min((i32)std::floor((boxMax.y - origin.y) / BLOCKMAP_BLOCK_SIZE), (i32)rows - 1);
+
+    for(i32 y = y0; y <= y1; y++)
+    {
+        for(i32 x = x0; x <= x1; x++)
+        {
+            u32 cell = (u32)y * columns + x;
+            for(u32 i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++)
+            {
+                u16 line = cellLines[i];
+                if(query.lineStamps[line] == query.stamp)
+                    continue;
+
+                query.lineStamps[line] = query.stamp;
+                query.lines.push_back(line);
+            }
+        }
+    }
+}
+
+// one sided lines, closed openings (shut doors) and lines with blockFlags stop a ray
+static inline bool LineBlocks(const DEUtil::MapData &map, const MapLinedef &line, u16 blockFlags)
+{
+    if(line.sides[1] == MAP_NO_SIDEDEF || (line.flags & blockFlags))
+        return true;
+
+    const MapSector &front = map.sectors[map.sidedefs[line.sides[0]].sector];
+    const MapSector &back = map.sectors[map.sidedefs[line.sides[1]].sector];
+
+    return std::max(front.floorHeight, back.floorHeight) >= std::min(front.ceilingHeight, back.ceilingHeight);
+}
+
+bool DEUtil::Blockmap::TraceLine(const MapData &map, glm::vec2 from, glm::vec2 to, u16 blockFlags,
+                                 BlockmapQuery &query, BlockmapHit &hit) const
+{
+    BeginQuery(map, query);
+
+    // everything relative to the grid's origin, in doubles so long rays stay exact
+    glm::dvec2 p = glm::dvec2((f64)from.x - origin.x, (f64)from.y - origin.y);
+    glm::dvec2 d = glm::dvec2((f64)to.x - from.x, (f64)to.y - from.y);
+
+    f64 tEnter = 0.0, tExit = 1.0;
+    glm::dvec2 gridMax = glm::dvec2((f64)columns * BLOCKMAP_BLOCK_SIZE, (f64)rows * BLOCKMAP_BLOCK_SIZE);
+    if(!ClipToBox(p, d, glm::dvec2(0.0, 0.0), gridMax, tEnter, tExit))
+        return false;
+
+    glm::dvec2 start = p + d * tEnter;
+    i32 x = std::min((i32)(start.x / BLOCKMAP_BLOCK_SIZE), (i32)columns - 1);
+    i32 y = std::min((i32)(start.y / BLOCKMAP_BLOCK_SIZE), (i32)rows - 1);
+
+    // amanatides & woo: t of the next block boundary on each axis, and t per block
+    i32 stepX = d.x > 0.0 ? 1 : -1;
+    i32 stepY = d.y > 0.0 ? 1 : -1;
+    f64 tDeltaX = d.x != 0.0 ? BLOCKMAP_BLOCK_SIZE / std::abs(d.x) : INFINITY;
+    f64 tDeltaY = d.y != 0.0 ? BLOCKMAP_BLOCK_SIZE / std::abs(d.y) : INFINITY;
+    f64 tMaxX = d.x != 0.0 ? ((x + (stepX > 0)) * (f64)BLOCKMAP_BLOCK_SIZE - p.x) / d.x : INFINITY;
+    f64 tMaxY = d.y != 0.0 ? ((y + (stepY > 0)) * (f64)BLOCKMAP_BLOCK_SIZE - p.y) / d.y : INFINITY;
+
+    f64 best = INFINITY;
+    u16 bestLine = 0;
+
+    while(true)
+    {
+        u32 cell = (u32)y * columns + x;
+        for(u32 i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++)
+        {
+            u16 l = cellLines[i];
+            if(query.lineStamps[l] == query.stamp)
+                continue;
+
+            query.lineStamps[l] = query.stamp;
+
+            const MapLinedef &line = map.linedefs[l];
+            if(!LineBlocks(map, line, blockFlags))
+                continue;
+
+            glm::dvec2 a = glm::dvec2(map.vertices[line.v1].x - origin.x, map.vertices[line.v1].y - origin.y);
+            glm::dvec2 e = glm::dvec2(map.vertices[line.v2].x - origin.x, map.vertices[line.v2].y - origin.y) - a;
+
+            f64 denom = d.x * e.y - d.y * e.x;
+            if(denom == 0.0)
+                continue; // parallel, a ray sliding along a line doesn't cross it
+
+            glm::dvec2 ap = a - p;
+            f64 t = (ap.x * e.y - ap.y * e.x) / denom;
+            f64 u = (ap.x * d.y - ap.y * d.x) / denom;
+            if(t < 0.0 || t > 1.0 || u < 0.0 || u > 1.0 || t >= best)
+                continue;
+
+            best = t;
+            bestLine = l;
+        }
+
+        // lines span several blocks, a hit is only final once the ray has left through it
+        f64 cellExit = std::min(tMaxX, tMaxY);
+        if(best <= cellExit || cellExit > tExit)
+            break;
+
+        if(tMaxX < tMaxY)
+        {
+            x += stepX;
+            tMaxX += tDeltaX;
+        }
+        else
+        {
+            y += stepY;
+            tMaxY += tDeltaY;
+        }
+
+        if(x < 0 || y < 0 || x >= (i32)columns || y >= (i32)rows)
+            break;
+    }
+
+    if(best > 1.0)
+        return false;
+
+    hit.linedef = bestLine;
+    hit.fraction = (f32)best;
+    return true;
+}
+
+#pragma endregion
+
+#pragma region Things
+
+void DEUtil::Blockmap::ResetThings(u32 thingCapacity)
+{
+    thingHeads.assign((usize)columns * rows, BLOCKMAP_NO_THING);
+    thingNext.assign(thingCapacity, BLOCKMAP_NO_THING);
+    thingPrev.assign(thingCapacity, BLOCKMAP_NO_THING);
+    thingCell.assign(thingCapacity, BLOCKMAP_NO_THING);
+}
+
+void DEUtil::Blockmap::LinkThing(u32 id, glm::vec2 pos)
+{
+    UnlinkThing(id);
+
+    // things outside the grid aren't in any block, like vanilla
+    glm::ivec2 cell;
+    if(!GetCell(pos, cell))
+        return;
+
+    i32 c = cell.y * (i32)columns + cell.x;
+    thingCell[id] = c;
+    thingPrev[id] = BLOCKMAP_NO_THING;
+    thingNext[id] = thingHeads[c];
+    if(thingHeads[c] != BLOCKMAP_NO_THING)
+        thingPrev[thingHeads[c]] = (i32)id;
+    thingHeads[c] = (i32)id;
+}
+
+void DEUtil::Blockmap::UnlinkThing(u32 id)
+{
+    i32 c = thingCell[id];
+    if(c == BLOCKMAP_NO_THING)
+        return;
+
+    if(thingPrev[id] != BLOCKMAP_NO_THING)
+        thingNext[thingPrev[id]] = thingNext[id];
+    else
+        thingHeads[c] = thingNext[id];
+
+    if(thingNext[id] != BLOCKMAP_NO_THING)
+        thingPrev[thingNext[id]] = thingPrev[id];
+
+    thingCell[id] = thingNext[id] = thingPrev[id] = BLOCKMAP_NO_THING;
+}
+
+i32 DEUtil::Blockmap::FirstThing(glm::ivec2 cell) const
+{
+    if(cell.x < 0 || cell.y < 0 || cell.x >= (i32)columns || cell.y >= (i32)rows || thingHeads.empty())
+        return BLOCKMAP_NO_THING;
+
+    return thingHeads[(usize)cell.y * columns + cell.x];
+}
+
+#pragma endregion
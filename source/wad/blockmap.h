@@ -0,0 +1,93 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "mapData.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// ---------------------- BLOCKMAP LUMP ----------------------
+//
+// i16 originX, originY, columns, rows
+// u16 offsets[columns * rows], in 16 bit words from the start of the lump
+// per block: 0x0000, linedef indices..., 0xffff (not every node builder writes the leading 0)
+
+#define BLOCKMAP_BLOCK_SIZE 128
+#define BLOCKMAP_LIST_END   0xffff
+#define BLOCKMAP_NO_THING   -1
+
+namespace DEUtil {
+
+struct BlockmapHit
+{
+    u16 linedef;
+    f32 fraction; // along the ray, 0 at `from` and 1 at `to`
+};
+
+// per caller scratch, so queries from several threads don't share state
+struct BlockmapQuery
+{
+    std::vector<u32> lineStamps; // dedups lines that span several blocks
+    u32 stamp;
+    std::vector<u16> lines;
+};
+
+// linedefs (static) and things (relinked as they move) bucketed into 128 unit blocks.
+class Blockmap
+{
+    private:
+    glm::ivec2 origin;
+    u32 columns, rows;
+
+    // per block linedef lists, block b owns cellLines[cellOffsets[b] .. cellOffsets[b + 1])
+    std::vector<u32> cellOffsets;
+    std::vector<u16> cellLines;
+
+    // things are intrusive lists per block
+    std::vector<i32> thingHeads;
+    std::vector<i32> thingNext;
+    std::vector<i32> thingPrev;
+    std::vector<i32> thingCell;
+
+    private:
+    bool Parse(const MapData &map);
+    void BeginQuery(const MapData &map, BlockmapQuery &query) const;
+
+    public:
+    Blockmap();
+
+    // uses the map's BLOCKMAP lump, or generates one if it's missing or corrupt.
+    void Build(const MapData &map);
+
+    // buckets every linedef into all blocks its segment touches, ignoring the lump.
+    void Generate(const MapData &map);
+
+    // block containing p, false if it's outside the grid.
+    bool GetCell(glm::vec2 p, glm::ivec2 &cell) const;
+
+    // every linedef in the blocks the box overlaps (a superset of the lines inside it).
+    // query.lines is cleared first, and holds each line once.
+    void LinesInBox(const MapData &map, glm::vec2 boxMin, glm::vec2 boxMax, BlockmapQuery &query) const;
+
+    // nearest linedef crossed by the segment from -> to that blocks it: one sided lines
+    // and lines with any of blockFlags set (ML_BLOCKING for movement, 0 for sight/hitscan).
+    // walks the blocks along the ray (dda) and stops at the first block holding a hit.
+    bool TraceLine(const MapData &map, glm::vec2 from, glm::vec2 to, u16 blockFlags, BlockmapQuery &query,
+                   BlockmapHit &hit) const;
+
+    // things are linked by id, ids have to be below thingCapacity.
+    void ResetThings(u32 thingCapacity);
+    void LinkThing(u32 id, glm::vec2 pos);
+    void UnlinkThing(u32 id);
+
+    // first thing in a block, walk the rest with NextThing(). BLOCKMAP_NO_THING ends the list.
+    i32 FirstThing(glm::ivec2 cell) const;
+    inline i32 NextThing(i32 id) const { return thingNext[id]; }
+
+    inline glm::ivec2 GetOrigin() const { return origin; }
+    inline u32 GetColumns() const { return columns; }
+    inline u32 GetRows() const { return rows; }
+};
+
+} // namespace DEUtil
@@ -0,0 +1,113 @@
+#include "bsp.h"
+
+#include <algorithm>
+
+u32 DEUtil::PointOnNodeSide(const MapNode &node, glm::vec2 p)
+{
+    // cross product of the partition line and the point, in doubles so 16 bit products are exact
+    f64 dx = (f64)p.x - node.x;
+    f64 dy = (f64)p.y - node.y;
+
+    f64 left = node.dy * dx;
+    f64 right = dy * node.dx;
+
+    return right < left ? 0 : 1;
+}
+
+u32 DEUtil::PointInSubsector(const MapData &map, glm::vec2 p)
+{
+    // a single subsector map has no nodes
+    if(map.nodes.empty())
+        return 0;
+
+    u16 child = (u16)(map.nodes.size() - 1);
+    while(!(child & NF_SUBSECTOR))
+    {
+        const MapNode &node = map.nodes[child];
+        child = node.children[PointOnNodeSide(node, p)];
+    }
+
+    return child & ~NF_SUBSECTOR;
+}
+
+glm::vec2 DEUtil::GetMapHeightRange(const MapData &map)
+{
+    if(map.sectors.empty())
+        return glm::vec2(0.0f);
+
+    glm::vec2 range = glm::vec2(map.sectors[0].floorHeight, map.sectors[0].ceilingHeight);
+    for(const MapSector &sector : map.sectors)
+    {
+        range.x = std::min(range.x, (f32)sector.floorHeight);
+        range.y = std::max(range.y, (f32)sector.ceilingHeight);
+    }
+
+    return range;
+}
+
+static inline bool NodeBoxVisible(const MapNode &node, u32 child, const DEUtil::Frustum &frustum, glm::vec2 heightRange)
+{
+    const i16 *box = node.bbox[child];
+
+    glm::vec3 boxMin = glm::vec3(box[(u32)BoxSide::LEFT], box[(u32)BoxSide::BOTTOM], heightRange.x);
+    glm::vec3 boxMax = glm::vec3(box[(u32)BoxSide::RIGHT], box[(u32)BoxSide::TOP], heightRange.y);
+
+    return DEUtil::BoxInFrustum(frustum, boxMin, boxMax);
+}
+
+void DEUtil::TraverseBsp(const MapData &map, glm::vec2 viewPos, const Frustum &frustum, glm::vec2 heightRange,
+                         BspVisibility &out, const SectorPVS *pvs)
+{
+    out.subsectors.clear();
+    out.sectors.assign(BitWords(map.sectors.size()), 0);
+    out.stack.clear();
+
+    if(map.nodes.empty())
+    {
+        out.subsectors.push_back(0);
+        SetBit(out.sectors.data(), GetSubsectorSector(map, 0));
+        return;
+    }
+
+    out.stack.push_back((u16)(map.nodes.size() - 1));
+    while(!out.stack.empty())
+    {
+        u16 child = out.stack.back();
+        out.stack.pop_back();
+
+        if(child & NF_SUBSECTOR)
+        {
+            u16 subsector = child & ~NF_SUBSECTOR;
+            out.subsectors.push_back(subsector);
+            SetBit(out.sectors.data(), GetSubsectorSector(map, subsector));
+            continue;
+        }
+
+        const MapNode &node = map.nodes[child];
+        u32 side = PointOnNodeSide(node, viewPos);
+
+        // far side goes on the stack first, so the near side is walked first
+        if(NodeBoxVisible(node, side ^ 1, frustum, heightRange))
+            out.stack.push_back(node.children[side ^ 1]);
+
+        if(NodeBoxVisible(node, side, frustum, heightRange))
+            out.stack.push_back(node.children[side]);
+    }
+
+    if(!pvs || pvs->GetSectorCount() != map.sectors.size())
+        return;
+
+    u32 viewSector = GetSubsectorSector(map, PointInSubsector(map, viewPos));
+
+    out.pvsRow.resize(pvs->GetRowWords());
+    pvs->AndRow(viewSector, out.sectors.data(), out.pvsRow.data());
+
+    // keeps the front to back order
+    usize kept = 0;
+    for(u16 subsector : out.subsectors)
+    {
+        if(TestBit(out.sectors.data(), GetSubsectorSector(map, subsector)))
+            out.subsectors[kept++] = subsector;
+    }
+    out.subsectors.resize(kept);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../core/bitset.h"
+#include "../meshes/meshlet.h"
+#include "mapData.h"
+#include "pvs.h"
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace DEUtil {
+
+struct BspVisibility
+{
+    std::vector<u16> subsectors; // front to back from the view point
+    std::vector<u64> sectors;    // bit per sector, set if any of its subsectors is visible
+
+    // scratch, kept around so walking doesn't allocate
+    std::vector<u16> stack;
+    std::vector<u64> pvsRow;
+};
+
+// 0 if p is on the node's front (right) side, 1 if it's on the back, like vanilla's R_PointOnSide.
+u32 PointOnNodeSide(const MapNode &node, glm::vec2 p);
+
+// subsector containing p.
+u32 PointInSubsector(const MapData &map, glm::vec2 p);
+
+// lowest floor and highest ceiling of the map, node boxes are tested with this z range.
+glm::vec2 GetMapHeightRange(const MapData &map);
+
+// walks the bsp front to back from viewPos, skipping every node whose bounding box
+// is outside the frustum (in map space, z up). out is cleared first.
+// with a pvs, sectors it can't see from the view's sector are dropped afterwards.
+void TraverseBsp(const MapData &map, glm::vec2 viewPos, const Frustum &frustum, glm::vec2 heightRange,
+                 BspVisibility &out, const SectorPVS *pvs = nullptr);
+
+} // namespace DEUtil
@@ -0,0 +1,654 @@
+#include "levelGeometry.h"
+#include "../core/bitset.h"
+#include "../core/logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+
+#pragma region Triangulation
+
+// map coordinates are 16 bit, their products don't fit a float's mantissa
+struct Point
+{
+    f64 x, y;
+};
+
+static inline f64 Cross(Point o, Point a, Point b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static inline bool SamePoint(Point a, Point b)
+{
+    return a.x == b.x && a.y == b.y;
+}
+
+// twice the signed area, positive for counter-clockwise (y up)
+static f64 LoopArea(const std::vector<Point> &points, const std::vector<u32> &loop)
+{
+    f64 area = 0.0;
+    for(usize i = 0; i < loop.size(); i++)
+    {
+        Point a = points[loop[i]];
+        Point b = points[loop[(i + 1) % loop.size()]];
+        area += a.x * b.y - b.x * a.y;
+    }
+
+    return area;
+}
+
+static bool PointInLoop(const std::vector<Point> &points, const std::vector<u32> &loop, Point p)
+{
+    bool inside = false;
+    for(usize i = 0, j = loop.size() - 1; i < loop.size(); j = i++)
+    {
+        Point a = points[loop[i]];
+        Point b = points[loop[j]];
+        if((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+// inclusive, for a clockwise triangle
+static inline bool PointInTriangle(Point a, Point b, Point c, Point p)
+{
+    return Cross(a, b, p) <= 0.0 && Cross(b, c, p) <= 0.0 && Cross(c, a, p) <= 0.0;
+}
+
+// splices a (counter-clockwise) hole into a (clockwise) polygon through a zero width bridge
+// from the hole's rightmost vertex to a vertex of the polygon it can see.
+static bool BridgeHole(const std::vector<Point> &points, std::vector<u32> &polygon, const std::vector<u32> &hole)
+{
+    usize holeStart = 0;
+    for(usize i = 1; i < hole.size(); i++)
+    {
+        Point p = points[hole[i]];
+        Point best = points[hole[holeStart]];
+        if(p.x > best.x || (p.x == best.x && p.y < best.y))
+            holeStart = i;
+    }
+
+    Point m = points[hole[holeStart]];
+
+    // closest polygon edge hit by a ray from m towards +x
+    f64 hitX = INFINITY;
+    usize bridge = polygon.size();
+    for(usize i = 0; i < polygon.size(); i++)
+    {
+        Point a = points[polygon[i]];
+        Point b = points[polygon[(i + 1) % polygon.size()]];
+        if(a.y == b.y || m.y < std::min(a.y, b.y) || m.y > std::max(a.y, b.y))
+            continue;
+
+        f64 x = a.x + (m.y - a.y) * (b.x - a.x) / (b.y - a.y);
+        if(x < m.x || x >= hitX)
+            continue;
+
+        hitX = x;
+        bridge = a.x > b.x ? i : (i + 1) % polygon.size();
+        if(x == a.x && m.y == a.y)
+            bridge = i;
+        else if(x == b.x && m.y == b.y)
+            bridge = (i + 1) % polygon.size();
+    }
+
+    if(bridge == polygon.size())
+        return false;
+
+    // a vertex inside (m, hit, bridge) would block the bridge, take the one closest to the ray instead
+    Point hit = {hitX, m.y};
+    Point p = points[polygon[bridge]];
+    if(!SamePoint(p, hit))
+    {
+        Point a = m, b = hit, c = p;
+        if(Cross(a, b, c) > 0.0)
+            std::swap(b, c); // clockwise for PointInTriangle
+
+        f64 bestTan = INFINITY;
+        for(usize i = 0; i < polygon.size(); i++)
+        {
+            Point q = points[polygon[i]];
+            if(i == bridge || q.x < m.x || SamePoint(q, m) || !PointInTriangle(a, b, c, q))
+                continue;
+
+            f64 tan = std::abs(q.y - m.y) / (q.x - m.x);
+            if(tan < bestTan || (tan == bestTan && q.x < points[polygon[bridge]].x))
+            {
+                bestTan = tan;
+                bridge = i;
+            }
+        }
+    }
+
+    std::vector<u32> spliced;
+    spliced.reserve(polygon.size() + hole.size() + 2);
+    spliced.insert(spliced.end(), polygon.begin(), polygon.begin() + bridge + 1);
+    for(usize i = 0; i <= hole.size(); i++)
+        spliced.push_back(hole[(holeStart + i) % hole.size()]);
+    spliced.insert(spliced.end(), polygon.begin() + bridge, polygon.end());
+
+    polygon = std::move(spliced);
+    return true;
+}
+
+// ear clipping of a clockwise polygon, O(n^2) which is plenty for sector sized inputs.
+static bool ClipEars(const std::vector<Point> &points, const std::vector<u32> &polygon, std::vector<u32> &out)
+{
+    usize count = polygon.size();
+    std::vector<u32> prev(count), next(count);
+    for(usize i = 0; i < count; i++)
+    {
+        prev[i] = (u32)((i + count - 1) % count);
+        next[i] = (u32)((i + 1) % count);
+    }
+
+    bool clean = true;
+    u32 current = 0;
+    usize stalled = 0;
+    while(count > 3)
+    {
+        u32 ip = prev[current], in = next[current];
+        Point a = points[polygon[ip]];
+        Point b = points[polygon[current]];
+        Point c = points[polygon[in]];
+
+        f64 turn = Cross(a, b, c);
+        bool ear = false;
+        bool drop = turn == 0.0; // collinear or a bridge's spike, removing it doesn't change the shape
+
+        if(turn < 0.0)
+        {
+            ear = true;
+            for(u32 i = next[in]; i != ip; i = next[i])
+            {
+                Point q = points[polygon[i]];
+                if(SamePoint(q, a) || SamePoint(q, b) || SamePoint(q, c))
+                    continue;
+
+                if(PointInTriangle(a, b, c, q))
+                {
+                    ear = false;
+                    break;
+                }
+            }
+        }
+
+        // went all the way around without an ear, the polygon is self-intersecting
+        if(!ear && !drop && stalled >= count)
+        {
+            ear = true;
+            clean = false;
+        }
+
+        if(ear || drop)
+        {
+            if(ear)
+                out.insert(out.end(), {polygon[ip], polygon[current], polygon[in]});
+
+            next[ip] = in;
+            prev[in] = ip;
+            count--;
+            stalled = 0;
+            current = in;
+            continue;
+        }
+
+        stalled++;
+        current = in;
+    }
+
+    Point a = points[polygon[prev[current]]];
+    Point b = points[polygon[current]];
+    Point c = points[polygon[next[current]]];
+    if(Cross(a, b, c) < 0.0)
+        out.insert(out.end(), {polygon[prev[current]], polygon[current], polygon[next[current]]});
+
+    return clean;
+}
+
+bool DEUtil::TriangulatePolygon(const std::vector<std::vector<glm::vec2>> &loops, std::vector<u32> &out)
+{
+    std::vector<Point> points;
+    std::vector<std::vector<u32>> indexLoops(loops.size());
+    for(usize l = 0; l < loops.size(); l++)
+    {
+        for(const glm::vec2 &p : loops[l])
+        {
+            indexLoops[l].push_back((u32)points.size());
+            points.push_back(Point{p.x, p.y});
+        }
+    }
+
+    std::vector<u32> outers, holes;
+    std::vector<f64> areas(loops.size());
+    for(u32 l = 0; l < loops.size(); l++)
+    {
+        if(indexLoops[l].size() < 3)
+            continue;
+
+        areas[l] = LoopArea(points, indexLoops[l]);
+        if(areas[l] < 0.0)
+            outers.push_back(l);
+        else if(areas[l] > 0.0)
+            holes.push_back(l);
+    }
+
+    // every hole goes to the smallest outer loop holding most of its vertices
+    std::vector<std::vector<u32>> outerHoles(loops.size());
+    for(u32 h : holes)
+    {
+        i32 owner = -1;
+        for(u32 o : outers)
+        {
+            usize inside = 0;
+            for(u32 v : indexLoops[h])
+                inside += PointInLoop(points, indexLoops[o], points[v]);
+
+            if(inside * 2 >= indexLoops[h].size() && (owner < 0 || -areas[o] < -areas[owner]))
+                owner = (i32)o;
+        }
+
+        if(owner >= 0)
+            outerHoles[owner].push_back(h);
+    }
+
+    bool clean = true;
+    for(u32 o : outers)
+    {
+        // rightmost holes first, so later bridges can't cross earlier ones
+        std::vector<u32> &ownHoles = outerHoles[o];
+        auto maxX = [&](u32 loop) {
+            f64 x = -INFINITY;
+            for(u32 v : indexLoops[loop])
+                x = std::max(x, points[v].x);
+            return x;
+        };
+        std::stable_sort(ownHoles.begin(), ownHoles.end(), [&](u32 a, u32 b) { return maxX(a) > maxX(b); });
+
+        std::vector<u32> polygon = indexLoops[o];
+        for(u32 h : ownHoles)
+            clean &= BridgeHole(points, polygon, indexLoops[h]);
+
+        clean &= ClipEars(points, polygon, out);
+    }
+
+    return clean;
+}
+
+#pragma endregion
+
+#pragma region Level
+
+#define LEVEL_SKY_FLAT "F_SKY1"
+#define LEVEL_PI 3.14159265358979323846
+
+struct BatchBuilder
+{
+    std::vector<f32> vertices;
+    std::vector<u32> indices;
+    std::vector<DEUtil::LevelSurface> surfaces; // in build order, sectors repeat
+};
+
+// (type, texture) -> batch, ordered so the output doesn't depend on hashing
+typedef std::map<std::pair<u32, u64>, BatchBuilder> BatchMap;
+
+static inline u32 PushVertex(BatchBuilder &batch, f32 x, f32 y, f32 z, f32 u, f32 v, f32 light)
+{
+    u32 index = (u32)(batch.vertices.size() / LEVEL_VERTEX_STRIDE);
+    batch.vertices.insert(batch.vertices.end(), {x, y, z, u, v, light});
+    return index;
+}
+
+// tags the indices pushed since the last call with their sector
+static inline void EndSurface(BatchBuilder &batch, u32 sector)
+{
+    u32 end = (u32)batch.indices.size();
+    u32 start = batch.surfaces.empty() ? 0 : batch.surfaces.back().firstIndex + batch.surfaces.back().indexCount;
+
+    if(!batch.surfaces.empty() && batch.surfaces.back().sector == sector)
+        batch.surfaces.back().indexCount += end - start;
+    else
+        batch.surfaces.push_back(DEUtil::LevelSurface{sector, start, end - start});
+}
+
+static u32 TextureHeight(const std::unordered_map<u64, u32> *textureHeights, u64 texture)
+{
+    if(textureHeights)
+    {
+        auto height = textureHeights->find(texture);
+        if(height != textureHeights->end())
+            return height->second;
+    }
+
+    return LEVEL_DEFAULT_TEXTURE_HEIGHT;
+}
+
+struct WallSection
+{
+    glm::vec2 p0, p1;
+    f32 u0, u1;
+    f32 bottom, top;
+    f32 anchor; // height of the texture's first row
+    f32 light;
+    u32 sector;
+};
+
+// quad seen from the right of p0 -> p1
+static void PushWall(BatchMap &batches, LevelBatchType type, u64 texture, const WallSection &wall)
+{
+    if(wall.top <= wall.bottom || texture == DEUtil::PackLumpName("-"))
+        return;
+
+    BatchBuilder &batch = batches[std::make_pair((u32)type, texture)];
+
+    f32 vBottom = wall.anchor - wall.bottom;
+    f32 vTop = wall.anchor - wall.top;
+
+    u32 first = PushVertex(batch, wall.p0.x, wall.p0.y, wall.bottom, wall.u0, vBottom, wall.light);
+    PushVertex(batch, wall.p0.x, wall.p0.y, wall.top, wall.u0, vTop, wall.light);
+    PushVertex(batch, wall.p1.x, wall.p1.y, wall.top, wall.u1, vTop, wall.light);
+    PushVertex(batch, wall.p1.x, wall.p1.y, wall.bottom, wall.u1, vBottom, wall.light);
+
+    batch.indices.insert(batch.indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+    EndSurface(batch, wall.sector);
+}
+
+static void BuildWalls(const DEUtil::MapData &map, const std::unordered_map<u64, u32> *textureHeights, BatchMap &batches)
+{
+    u64 sky = DEUtil::PackLumpName(LEVEL_SKY_FLAT);
+
+    for(const MapLinedef &line : map.linedefs)
+    {
+        for(u32 s = 0; s < 2; s++)
+        {
+            if(line.sides[s] == MAP_NO_SIDEDEF)
+                continue;
+
+            const MapSidedef &side = map.sidedefs[line.sides[s]];
+            const MapSector &front = map.sectors[side.sector];
+            const MapSector *back = line.sides[s ^ 1] != MAP_NO_SIDEDEF ? &map.sectors[map.sidedefs[line.sides[s ^ 1]].sector] : nullptr;
+
+            // the back side runs v2 -> v1, so both sides face away from their line
+            const MapVertex &v0 = map.vertices[s == 0 ? line.v1 : line.v2];
+            const MapVertex &v1 = map.vertices[s == 0 ? line.v2 : line.v1];
+
+            WallSection wall;
+            wall.p0 = glm::vec2(v0.x, v0.y);
+            wall.p1 = glm::vec2(v1.x, v1.y);
+            wall.u0 = side.xOffset;
+            wall.u1 = wall.u0 + glm::length(wall.p1 - wall.p0);
+            wall.light = std::min<i16>(std::max<i16>(front.light, 0), 255) / 255.0f;
+            wall.sector = side.sector;
+
+            // vanilla's pegging rules (r_segs.c): v = anchor - z + row offset
+            f32 rowOffset = side.yOffset;
+
+            if(!back)
+            {
+                u64 middle = DEUtil::PackLumpName(side.middleTexture);
+
+                wall.bottom = front.floorHeight;
+                wall.top = front.ceilingHeight;
+                wall.anchor = (line.flags & ML_DONTPEGBOTTOM ? front.floorHeight + (f32)TextureHeight(textureHeights, middle)
+                                                             : front.ceilingHeight) + rowOffset;
+                PushWall(batches, LevelBatchType::WALL, middle, wall);
+                continue;
+            }
+
+            // upper, unless both sides are sky (the sky hack)
+            bool skyHack = DEUtil::PackLumpName(front.ceilingFlat) == sky && DEUtil::PackLumpName(back->ceilingFlat) == sky;
+            if(back->ceilingHeight < front.ceilingHeight && !skyHack)
+            {
+                u64 upper = DEUtil::PackLumpName(side.upperTexture);
+
+                wall.bottom = back->ceilingHeight;
+                wall.top = front.ceilingHeight;
+                wall.anchor = (line.flags & ML_DONTPEGTOP ? front.ceilingHeight
+                                                          : back->ceilingHeight + (f32)TextureHeight(textureHeights, upper)) + rowOffset;
+                PushWall(batches, LevelBatchType::WALL, upper, wall);
+            }
+
+            if(back->floorHeight > front.floorHeight)
+            {
+                u64 lower = DEUtil::PackLumpName(side.lowerTexture);
+
+                wall.bottom = front.floorHeight;
+                wall.top = back->floorHeight;
+                wall.anchor = (line.flags & ML_DONTPEGBOTTOM ? front.ceilingHeight : back->floorHeight) + rowOffset;
+                PushWall(batches, LevelBatchType::WALL, lower, wall);
+            }
+
+            // masked middles don't tile vertically, they're clipped to one texture height
+            u64 middle = DEUtil::PackLumpName(side.middleTexture);
+            if(middle != DEUtil::PackLumpName("-"))
+            {
+                f32 height = (f32)TextureHeight(textureHeights, middle);
+                f32 openBottom = std::max(front.floorHeight, back->floorHeight);
+                f32 openTop = std::min(front.ceilingHeight, back->ceilingHeight);
+
+                wall.anchor = (line.flags & ML_DONTPEGBOTTOM ? openBottom + height : openTop) + rowOffset;
+                wall.top = std::min(openTop, wall.anchor);
+                wall.bottom = std::max(openBottom, wall.anchor - height);
+                PushWall(batches, LevelBatchType::MASKED, middle, wall);
+            }
+        }
+    }
+}
+
+struct SectorEdge
+{
+    u16 v0, v1;
+};
+
+// chains a sector's edges (sector on their right) into closed loops.
+// where several edges leave a vertex, takes the sharpest right turn, which keeps
+// loops that touch at a vertex apart. returns false if an edge didn't close a loop.
+static bool TraceSectorLoops(const DEUtil::MapData &map, const std::vector<SectorEdge> &edges,
+                             std::vector<std::vector<glm::vec2>> &loops)
+{
+    std::unordered_map<u16, std::vector<u32>> outgoing;
+    for(u32 e = 0; e < edges.size(); e++)
+        outgoing[edges[e].v0].push_back(e);
+
+    bool closed = true;
+    std::vector<bool> used(edges.size(), false);
+    for(u32 start = 0; start < edges.size(); start++)
+    {
+        if(used[start])
+            continue;
+
+        std::vector<glm::vec2> loop;
+        u32 e = start;
+        while(true)
+        {
+            used[e] = true;
+            const MapVertex &from = map.vertices[edges[e].v0];
+            loop.push_back(glm::vec2(from.x, from.y));
+
+            u16 at = edges[e].v1;
+            if(at == edges[start].v0)
+                break;
+
+            // the incoming direction, reversed
+            const MapVertex &to = map.vertices[at];
+            f64 backAngle = std::atan2((f64)from.y - to.y, (f64)from.x - to.x);
+
+            i32 best = -1;
+            f64 bestAngle = INFINITY;
+            for(u32 candidate : outgoing[at])
+            {
+                if(used[candidate])
+                    continue;
+
+                const MapVertex &next = map.vertices[edges[candidate].v1];
+                f64 angle = std::atan2((f64)next.y - to.y, (f64)next.x - to.x) - backAngle;
+                while(angle <= 0.0)
+                    angle += 2.0 * LEVEL_PI;
+
+                // smallest counter-clockwise angle from the way back is the sharpest right turn
+                if(angle < bestAngle)
+                {
+                    bestAngle = angle;
+                    best = (i32)candidate;
+                }
+            }
+
+            if(best < 0)
+            {
+                closed = false;
+                loop.clear();
+                break;
+            }
+
+            e = (u32)best;
+        }
+
+        if(loop.size() >= 3)
+            loops.push_back(std::move(loop));
+    }
+
+    return closed;
+}
+
+static void BuildFlats(const DEUtil::MapData &map, BatchMap &batches, u32 &untriangulated)
+{
+    std::vector<std::vector<SectorEdge>> sectorEdges(map.sectors.size());
+    for(const MapLinedef &line : map.linedefs)
+    {
+        u16 frontSector = map.sidedefs[line.sides[0]].sector;
+        if(line.sides[1] != MAP_NO_SIDEDEF)
+        {
+            // lines inside a sector don't bound it
+            u16 backSector = map.sidedefs[line.sides[1]].sector;
+            if(backSector == frontSector)
+                continue;
+
+            sectorEdges[backSector].push_back(SectorEdge{line.v2, line.v1});
+        }
+
+        sectorEdges[frontSector].push_back(SectorEdge{line.v1, line.v2});
+    }
+
+    for(u32 s = 0; s < map.sectors.size(); s++)
+    {
+        std::vector<std::vector<glm::vec2>> loops;
+        bool closed = TraceSectorLoops(map, sectorEdges[s], loops);
+
+        std::vector<u32> triangles;
+        bool clean = DEUtil::TriangulatePolygon(loops, triangles);
+
+        if(!closed || !clean)
+        {
+            LDEBUG(false, "level: sector " << s << " has unclosed or self-intersecting loops.\n");
+            untriangulated++;
+        }
+
+        if(triangles.empty())
+            continue;
+
+        const MapSector &sector = map.sectors[s];
+        f32 light = std::min<i16>(std::max<i16>(sector.light, 0), 255) / 255.0f;
+
+        // flats are 64x64 and aligned to the map grid
+        for(u32 plane = 0; plane < 2; plane++)
+        {
+            const char *flat = plane == 0 ? sector.floorFlat : sector.ceilingFlat;
+            f32 z = plane == 0 ? sector.floorHeight : sector.ceilingHeight;
+
+            BatchBuilder &batch = batches[std::make_pair((u32)LevelBatchType::FLAT, DEUtil::PackLumpName(flat))];
+
+            u32 first = (u32)(batch.vertices.size() / LEVEL_VERTEX_STRIDE);
+            for(const std::vector<glm::vec2> &loop : loops)
+            {
+                for(const glm::vec2 &p : loop)
+                    PushVertex(batch, p.x, p.y, z, p.x, -p.y, light);
+            }
+
+            // floors face up as triangulated, ceilings are flipped to face down
+            for(usize t = 0; t < triangles.size(); t += 3)
+            {
+                if(plane == 0)
+                    batch.indices.insert(batch.indices.end(), {first + triangles[t], first + triangles[t + 1], first + triangles[t + 2]});
+                else
+                    batch.indices.insert(batch.indices.end(), {first + triangles[t], first + triangles[t + 2], first + triangles[t + 1]});
+            }
+
+            EndSurface(batch, s);
+        }
+    }
+}
+
+DEUtil::LevelGeometry DEUtil::BuildLevelGeometry(const MapData &map, const std::unordered_map<u64, u32> *textureHeights)
+{
+    LevelGeometry level{};
+
+    BatchMap batches;
+    BuildWalls(map, textureHeights, batches);
+    BuildFlats(map, batches, level.untriangulatedSectors);
+
+    for(auto &entry : batches)
+    {
+        BatchBuilder &builder = entry.second;
+        if(builder.indices.empty())
+            continue;
+
+        LevelBatch batch;
+        batch.type = (LevelBatchType)entry.first.first;
+        batch.texture = entry.first.second;
+        batch.firstVertex = (u32)(level.vertices.size() / LEVEL_VERTEX_STRIDE);
+        batch.vertexCount = (u32)(builder.vertices.size() / LEVEL_VERTEX_STRIDE);
+        batch.firstIndex = (u32)level.indices.size();
+        batch.indexCount = (u32)builder.indices.size();
+        batch.firstSurface = (u32)level.surfaces.size();
+
+        level.vertices.insert(level.vertices.end(), builder.vertices.begin(), builder.vertices.end());
+
+        // regroup the indices by sector, so a sector's part of the batch is one range
+        std::stable_sort(builder.surfaces.begin(), builder.surfaces.end(),
+                         [](const LevelSurface &a, const LevelSurface &b) { return a.sector < b.sector; });
+
+        for(const LevelSurface &surface : builder.surfaces)
+        {
+            u32 first = (u32)level.indices.size();
+            level.indices.insert(level.indices.end(), builder.indices.begin() + surface.firstIndex,
+                                 builder.indices.begin() + surface.firstIndex + surface.indexCount);
+
+            if(level.surfaces.size() > batch.firstSurface && level.surfaces.back().sector == surface.sector)
+                level.surfaces.back().indexCount += surface.indexCount;
+            else
+                level.surfaces.push_back(LevelSurface{surface.sector, first, surface.indexCount});
+        }
+
+        batch.surfaceCount = (u32)level.surfaces.size() - batch.firstSurface;
+        level.batches.push_back(batch);
+    }
+
+    return level;
+}
+
+void DEUtil::GatherVisibleDraws(const LevelGeometry &level, const std::vector<u64> &sectorVisible, std::vector<LevelDraw> &out)
+{
+    out.clear();
+
+    for(u32 b = 0; b < level.batches.size(); b++)
+    {
+        const LevelBatch &batch = level.batches[b];
+        for(u32 i = batch.firstSurface; i < batch.firstSurface + batch.surfaceCount; i++)
+        {
+            const LevelSurface &surface = level.surfaces[i];
+            if(surface.sector >= sectorVisible.size() * 64 || !TestBit(sectorVisible.data(), surface.sector))
+                continue;
+
+            if(!out.empty() && out.back().batch == b && out.back().firstIndex + out.back().indexCount == surface.firstIndex)
+                out.back().indexCount += surface.indexCount;
+            else
+                out.push_back(LevelDraw{b, surface.firstIndex, surface.indexCount});
+        }
+    }
+}
+
+#pragma endregion
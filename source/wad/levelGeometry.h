@@ -0,0 +1,88 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "mapData.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// floats per level vertex: pos.xyz (map units, z up), uv (texels), light (0..1)
+#define LEVEL_VERTEX_STRIDE 6
+
+// textures without a known height (see BuildLevelGeometry) are assumed to be this tall
+#define LEVEL_DEFAULT_TEXTURE_HEIGHT 128
+
+enum class LevelBatchType
+{
+    WALL = 0,   // upper, lower and one sided middle textures
+    MASKED = 1, // two sided middle textures, have see-through texels
+    FLAT = 2    // floors and ceilings
+};
+
+namespace DEUtil {
+
+// every surface using one texture, drawn with a single indexed draw.
+struct LevelBatch
+{
+    LevelBatchType type;
+    u64 texture; // packed name, see PackLumpName()
+
+    u32 firstVertex; // in vertices
+    u32 vertexCount;
+    u32 firstIndex;
+    u32 indexCount; // relative to firstVertex
+
+    u32 firstSurface;
+    u32 surfaceCount;
+};
+
+// a batch's triangles from one sector (walls count towards the sector they face).
+// firstIndex is into LevelGeometry::indices, like LevelBatch::firstIndex
+struct LevelSurface
+{
+    u32 sector;
+    u32 firstIndex;
+    u32 indexCount;
+};
+
+// a range of a batch to draw, see GatherVisibleDraws()
+struct LevelDraw
+{
+    u32 batch;
+    u32 firstIndex;
+    u32 indexCount;
+};
+
+struct LevelGeometry
+{
+    std::vector<f32> vertices; // LEVEL_VERTEX_STRIDE floats per vertex
+    std::vector<u32> indices;
+    std::vector<LevelBatch> batches; // sorted by (type, texture)
+
+    // per batch, sorted by sector, one per sector at most
+    std::vector<LevelSurface> surfaces;
+
+    // sectors whose floor/ceiling couldn't be closed into loops (broken map data)
+    u32 untriangulatedSectors;
+};
+
+// triangulates polygon loops with holes into `out` (indices into the flattened loops,
+// loop by loop). outer loops have to be clockwise (y up), holes counter-clockwise.
+// triangles keep the outer loops' winding. returns false if ear clipping had to give up
+// on a degenerate polygon, the triangles it did find are still written.
+bool TriangulatePolygon(const std::vector<std::vector<glm::vec2>> &loops, std::vector<u32> &out);
+
+// builds a level's walls, floors and ceilings, batched by texture.
+// front faces wind clockwise seen from the side they face, like the rest of the engine.
+// wall v coordinates follow vanilla's pegging rules and need texture heights for that,
+// textureHeights maps packed texture names to heights in texels.
+// the output only depends on the map data, so it's identical between runs.
+LevelGeometry BuildLevelGeometry(const MapData &map, const std::unordered_map<u64, u32> *textureHeights = nullptr);
+
+// the index ranges of every batch that belong to visible sectors (a bit per sector, see core/bitset.h),
+// neighbouring surfaces are merged into one draw. out is cleared first.
+void GatherVisibleDraws(const LevelGeometry &level, const std::vector<u64> &sectorVisible, std::vector<LevelDraw> &out);
+
+} // namespace DEUtil
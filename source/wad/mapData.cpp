@@ -0,0 +1,149 @@
+#include "mapData.h"
+#include "../core/logger.h"
+
+#include <cstring>
+
+static const char *mapLumpNames[(u32)MapLump::COUNT] = {
+    "", "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS", "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP",
+};
+
+template<typename T>
+static bool ReadMapLump(const DEUtil::WadArchive &wad, i32 marker, MapLump lump, std::vector<T> &out)
+{
+    i32 lumpIdx = marker + (i32)lump;
+    const char *name = mapLumpNames[(u32)lump];
+
+    if(lumpIdx >= (i32)wad.GetLumpCount() || wad.GetLumpInfo(lumpIdx).name != DEUtil::PackLumpName(name))
+    {
+        LERROR("map: expected a " << name << " lump " << (i32)lump << " lumps after the map marker.\n");
+        return false;
+    }
+
+    DEUtil::LumpView view = wad.GetLump(lumpIdx);
+    if(view.size % sizeof(T) != 0)
+    {
+        LERROR("map: " << name << " lump size " << view.size << " isn't a multiple of " << sizeof(T) << ".\n");
+        return false;
+    }
+
+    out.resize(view.size / sizeof(T));
+    if(view.size)
+        memcpy(out.data(), view.data, view.size);
+
+    return true;
+}
+
+bool DEUtil::LoadMap(const WadArchive &wad, const char *name, MapData &out)
+{
+    out = MapData{};
+
+    i32 marker = wad.FindLump(name);
+    if(marker < 0)
+    {
+        LERROR("map: no map named " << name << "\n");
+        return false;
+    }
+
+    bool read = ReadMapLump(wad, marker, MapLump::THINGS, out.things) &&
+                ReadMapLump(wad, marker, MapLump::LINEDEFS, out.linedefs) &&
+                ReadMapLump(wad, marker, MapLump::SIDEDEFS, out.sidedefs) &&
+                ReadMapLump(wad, marker, MapLump::VERTEXES, out.vertices) &&
+                ReadMapLump(wad, marker, MapLump::SEGS, out.segs) &&
+                ReadMapLump(wad, marker, MapLump::SSECTORS, out.subsectors) &&
+                ReadMapLump(wad, marker, MapLump::NODES, out.nodes) &&
+                ReadMapLump(wad, marker, MapLump::SECTORS, out.sectors) &&
+                ReadMapLump(wad, marker, MapLump::REJECT, out.reject);
+
+    if(!read)
+    {
+        LERROR("map: couldn't read " << name << "\n");
+        return false;
+    }
+
+    // the blockmap can be generated, so maps without one (or with a mangled one) still load
+    i32 blockmapIdx = marker + (i32)MapLump::BLOCKMAP;
+    if(blockmapIdx < (i32)wad.GetLumpCount() && wad.GetLumpInfo(blockmapIdx).name == PackLumpName("BLOCKMAP"))
+        ReadMapLump(wad, marker, MapLump::BLOCKMAP, out.blockmap);
+
+    for(const MapSidedef &side : out.sidedefs)
+    {
+        if(side.sector >= out.sectors.size())
+        {
+            LERROR("map: " << name << " has a sidedef pointing at sector " << side.sector << " (of "
+                           << out.sectors.size() << ").\n");
+            return false;
+        }
+    }
+
+    for(const MapLinedef &line : out.linedefs)
+    {
+        bool valid = line.v1 < out.vertices.size() && line.v2 < out.vertices.size() &&
+                     line.sides[0] != MAP_NO_SIDEDEF && line.sides[0] < out.sidedefs.size() &&
+                     (line.sides[1] == MAP_NO_SIDEDEF || line.sides[1] < out.sidedefs.size());
+
+        if(!valid)
+        {
+            LERROR("map: " << name << " has a linedef with an out of range vertex or sidedef.\n");
+            return false;
+        }
+    }
+
+    for(const MapSeg &seg : out.segs)
+    {
+        bool valid = seg.v1 < out.vertices.size() && seg.v2 < out.vertices.size() && seg.linedef < out.linedefs.size() &&
+                     seg.side < 2 && out.linedefs[seg.linedef].sides[seg.side] != MAP_NO_SIDEDEF;
+
+        if(!valid)
+        {
+            LERROR("map: " << name << " has a seg with an out of range vertex, linedef or side.\n");
+            return false;
+        }
+    }
+
+    if(out.subsectors.empty())
+    {
+        LERROR("map: " << name << " has no subsectors, it wasn't run through a node builder.\n");
+        return false;
+    }
+
+    for(const MapSubsector &subsector : out.subsectors)
+    {
+        if(subsector.segCount == 0 || (u32)subsector.firstSeg + subsector.segCount > out.segs.size())
+        {
+            LERROR("map: " << name << " has a subsector with an out of range seg.\n");
+            return false;
+        }
+    }
+
+    // node indices are 15 bits in the vanilla format, past that the root index would read as a subsector
+    if(out.nodes.size() > NF_SUBSECTOR)
+    {
+        LERROR("map: " << name << " has " << out.nodes.size() << " nodes, more than the " << NF_SUBSECTOR
+                       << " the node format can index.\n");
+        return false;
+    }
+
+    // children always come before their parent, which rules out cycles
+    for(u32 i = 0; i < out.nodes.size(); i++)
+    {
+        for(u16 child : out.nodes[i].children)
+        {
+            bool valid = child & NF_SUBSECTOR ? (u32)(child & ~NF_SUBSECTOR) < out.subsectors.size() : child < i;
+            if(!valid)
+            {
+                LERROR("map: " << name << " has a node with an out of range child.\n");
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+u16 DEUtil::GetSubsectorSector(const MapData &map, u32 subsector)
+{
+    const MapSeg &seg = map.segs[map.subsectors[subsector].firstSeg];
+    const MapLinedef &line = map.linedefs[seg.linedef];
+
+    return map.sidedefs[line.sides[seg.side]].sector;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "wad.h"
+
+#include <vector>
+
+// ---------------------- MAP LUMPS ----------------------
+//
+// a map is a marker lump (E1M1, MAP01, ...) followed by these lumps in this order.
+// doom's map coordinates are x right, y up, heights are z.
+
+enum class MapLump
+{
+    LABEL = 0,
+    THINGS = 1,
+    LINEDEFS = 2,
+    SIDEDEFS = 3,
+    VERTEXES = 4,
+    SEGS = 5,
+    SSECTORS = 6,
+    NODES = 7,
+    SECTORS = 8,
+    REJECT = 9,
+    BLOCKMAP = 10,
+
+    COUNT = 11
+};
+
+// linedef flags
+#define ML_BLOCKING      BIT(0)
+#define ML_BLOCKMONSTERS BIT(1)
+#define ML_TWOSIDED      BIT(2)
+#define ML_DONTPEGTOP    BIT(3)
+#define ML_DONTPEGBOTTOM BIT(4)
+#define ML_SECRET        BIT(5)
+#define ML_SOUNDBLOCK    BIT(6)
+#define ML_DONTDRAW      BIT(7)
+#define ML_MAPPED        BIT(8)
+
+#define MAP_NO_SIDEDEF 0xffff
+
+// set on a node child that is a subsector (the rest is its index)
+#define NF_SUBSECTOR 0x8000
+
+struct MapThing
+{
+    i16 x, y;
+    i16 angle;
+    i16 type;
+    i16 flags;
+};
+
+struct MapVertex
+{
+    i16 x, y;
+};
+
+struct MapLinedef
+{
+    u16 v1, v2;
+    u16 flags;
+    u16 special;
+    u16 tag;
+    u16 sides[2]; // front (right of v1 -> v2), back. MAP_NO_SIDEDEF if missing
+};
+
+struct MapSidedef
+{
+    i16 xOffset, yOffset;
+    char upperTexture[WAD_NAME_LENGTH];
+    char lowerTexture[WAD_NAME_LENGTH];
+    char middleTexture[WAD_NAME_LENGTH];
+    u16 sector;
+};
+
+struct MapSector
+{
+    i16 floorHeight, ceilingHeight;
+    char floorFlat[WAD_NAME_LENGTH];
+    char ceilingFlat[WAD_NAME_LENGTH];
+    i16 light;
+    i16 special;
+    i16 tag;
+};
+
+struct MapSeg
+{
+    u16 v1, v2;
+    i16 angle; // binary angle, 0x4000 is 90 degrees
+    u16 linedef;
+    u16 side;   // 0 front, 1 back
+    i16 offset; // along the linedef to the start of the seg
+};
+
+// a convex piece of a sector, bounded by its segs
+struct MapSubsector
+{
+    u16 segCount;
+    u16 firstSeg;
+};
+
+enum class BoxSide
+{
+    TOP = 0,
+    BOTTOM = 1,
+    LEFT = 2,
+    RIGHT = 3
+};
+
+// partition line (x, y) + t * (dx, dy). child 0 is on its right (front), child 1 on its left
+struct MapNode
+{
+    i16 x, y;
+    i16 dx, dy;
+    i16 bbox[2][4]; // per child, indexed with BoxSide
+    u16 children[2];
+};
+
+ST_ASSERT(sizeof(MapThing) == 10, "expected MapThing to be 10 bytes.");
+ST_ASSERT(sizeof(MapVertex) == 4, "expected MapVertex to be 4 bytes.");
+ST_ASSERT(sizeof(MapLinedef) == 14, "expected MapLinedef to be 14 bytes.");
+ST_ASSERT(sizeof(MapSidedef) == 30, "expected MapSidedef to be 30 bytes.");
+ST_ASSERT(sizeof(MapSector) == 26, "expected MapSector to be 26 bytes.");
+ST_ASSERT(sizeof(MapSeg) == 12, "expected MapSeg to be 12 bytes.");
+ST_ASSERT(sizeof(MapSubsector) == 4, "expected MapSubsector to be 4 bytes.");
+ST_ASSERT(sizeof(MapNode) == 28, "expected MapNode to be 28 bytes.");
+
+namespace DEUtil {
+
+// a map's lumps, copied out of the wad (lumps aren't aligned in the file) and
+// validated, so every index in here is in range.
+struct MapData
+{
+    std::vector<MapThing> things;
+    std::vector<MapVertex> vertices;
+    std::vector<MapLinedef> linedefs;
+    std::vector<MapSidedef> sidedefs;
+    std::vector<MapSector> sectors;
+
+    // bsp, the root is the last node
+    std::vector<MapSeg> segs;
+    std::vector<MapSubsector> subsectors;
+    std::vector<MapNode> nodes;
+
+    // sectorCount^2 bits, bit (from * sectorCount + to) set if `to` can't be seen from `from`.
+    // often shorter than that (or empty), missing bits count as visible.
+    std::vector<u8> reject;
+
+    // raw lump (see wad/blockmap.h), empty if the map doesn't have one
+    std::vector<i16> blockmap;
+};
+
+// sector a subsector belongs to, taken from its first seg.
+u16 GetSubsectorSector(const MapData &map, u32 subsector);
+
+// reads the map after the `name` marker lump. returns false (and logs) if it's
+// missing, a lump is out of order, or an index points out of range.
+bool LoadMap(const WadArchive &wad, const char *name, MapData &out);
+
+} // namespace DEUtil
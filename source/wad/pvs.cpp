@@ -0,0 +1,442 @@
+#include "pvs.h"
+#include "../core/logger.h"
+#include "../core/mappedFile.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+DEUtil::SectorPVS::SectorPVS() : sectorCount{0}, rowWords{0} {}
+
+#pragma region Compression
+
+void DEUtil::SectorPVS::Compress(const std::vector<u64> &matrix)
+{
+    rows.clear();
+    rowOffsets.assign(sectorCount + 1, 0);
+
+    usize rowBytes = (usize)rowWords * sizeof(u64);
+    for(u32 r = 0; r < sectorCount; r++)
+    {
+        rowOffsets[r] = (u32)rows.size();
+
+        const u8 *bytes = (const u8 *)&matrix[(usize)r * rowWords];
+        for(usize i = 0; i < rowBytes;)
+        {
+            u8 b = bytes[i];
+            if(b != 0x00 && b != 0xff)
+            {
+                rows.push_back(b);
+                i++;
+                continue;
+            }
+
+            u32 run = 1;
+            while(i + run < rowBytes && bytes[i + run] == b && run < 255)
+                run++;
+
+            rows.push_back(b);
+            rows.push_back((u8)run);
+            i += run;
+        }
+    }
+
+    rowOffsets[sectorCount] = (u32)rows.size();
+}
+
+void DEUtil::SectorPVS::DecompressRow(u32 sector, u64 *out) const
+{
+    u8 *bytes = (u8 *)out;
+    usize rowBytes = (usize)rowWords * sizeof(u64);
+
+    usize o = 0;
+    for(u32 i = rowOffsets[sector]; i < rowOffsets[sector + 1] && o < rowBytes; i++)
+    {
+        u8 b = rows[i];
+        if(b != 0x00 && b != 0xff)
+        {
+            bytes[o++] = b;
+            continue;
+        }
+
+        usize run = i + 1 < rows.size() ? rows[++i] : 0;
+        if(run > rowBytes - o)
+            run = rowBytes - o;
+
+        memset(bytes + o, b, run);
+        o += run;
+    }
+
+    // a short (corrupt) row shows everything, hiding things would be worse
+    if(o < rowBytes)
+        memset(bytes + o, 0xff, rowBytes - o);
+}
+
+void DEUtil::SectorPVS::AndRow(u32 sector, u64 *mask, u64 *scratch) const
+{
+    if(sector >= sectorCount)
+        return;
+
+    DecompressRow(sector, scratch);
+    AndBits(mask, scratch, rowWords);
+}
+
+bool DEUtil::SectorPVS::IsVisible(u32 from, u32 to) const
+{
+    if(from >= sectorCount || to >= sectorCount)
+        return true;
+
+    std::vector<u64> row(rowWords);
+    DecompressRow(from, row.data());
+    return TestBit(row.data(), to);
+}
+
+#pragma endregion
+
+#pragma region Building
+
+void DEUtil::SectorPVS::BuildFromReject(const MapData &map)
+{
+    sectorCount = (u32)map.sectors.size();
+    rowWords = (u32)BitWords(sectorCount);
+
+    std::vector<u64> matrix((usize)sectorCount * rowWords, 0);
+    for(u32 from = 0; from < sectorCount; from++)
+    {
+        u64 *row = &matrix[(usize)from * rowWords];
+        for(u32 to = 0; to < sectorCount; to++)
+        {
+            usize bit = (usize)from * sectorCount + to;
+            bool rejected = bit / 8 < map.reject.size() && (map.reject[bit / 8] >> (bit % 8)) & 1;
+            if(!rejected)
+                SetBit(row, to);
+        }
+    }
+
+    Compress(matrix);
+}
+
+struct PortalPoint
+{
+    f64 x, y;
+};
+
+// left/right as seen crossing the portal towards `to`
+struct Portal
+{
+    PortalPoint left, right;
+    u32 to;
+};
+
+struct PortalSegment
+{
+    PortalPoint left, right;
+};
+
+static inline f64 Cross(PortalPoint o, PortalPoint a, PortalPoint b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+#define PVS_EPSILON 1e-3    // map units, lines only grazing a portal don't see through it
+#define PVS_MIN_PORTAL 0.01 // clipped portals shorter than this only touch at a point
+
+// keeps the part of seg at least PVS_EPSILON on the sign * cross(o, a, p) > 0 side of o -> a.
+// a degenerate line (o == a) keeps everything, which is the conservative answer.
+static bool ClipSegment(PortalSegment &seg, PortalPoint o, PortalPoint a, f64 sign)
+{
+    f64 length = std::sqrt((a.x - o.x) * (a.x - o.x) + (a.y - o.y) * (a.y - o.y));
+    if(length < PVS_EPSILON)
+        return true;
+
+    f64 dl = sign * Cross(o, a, seg.left) / length - PVS_EPSILON;
+    f64 dr = sign * Cross(o, a, seg.right) / length - PVS_EPSILON;
+
+    if(dl < 0.0 && dr < 0.0)
+        return false;
+
+    if(dl < 0.0 || dr < 0.0)
+    {
+        f64 t = dl / (dl - dr);
+        PortalPoint p = {seg.left.x + (seg.right.x - seg.left.x) * t, seg.left.y + (seg.right.y - seg.left.y) * t};
+        if(dl < 0.0)
+            seg.left = p;
+        else
+            seg.right = p;
+    }
+
+    f64 dx = seg.right.x - seg.left.x;
+    f64 dy = seg.right.y - seg.left.y;
+    return dx * dx + dy * dy > PVS_MIN_PORTAL * PVS_MIN_PORTAL;
+}
+
+// in front of a portal is the left of left -> right (the side it leads into)
+static inline bool ClipToFront(PortalSegment &seg, const PortalSegment &portal)
+{
+    return ClipSegment(seg, portal.left, portal.right, 1.0);
+}
+
+// a sector on the current path, and how far through its portals the walk is
+struct FlowFrame
+{
+    PortalSegment pass; // the portal the path entered through, clipped
+    const Portal *next;
+    const Portal *end;
+    u32 sector;
+};
+
+struct PortalFlow
+{
+    const std::vector<std::vector<Portal>> *sectorPortals;
+    std::vector<u8> onPath;
+    std::vector<FlowFrame> stack; // paths can cross every sector of the map, too deep to recurse
+    u64 *row;
+    u64 steps;
+    u64 budget;
+};
+
+// everything seen from `source` through `pass`, into `sector`. depth first, a step per sector entered
+static void Flow(PortalFlow &flow, const PortalSegment &source, const PortalSegment &pass, u32 sector)
+{
+    if(flow.steps++ >= flow.budget)
+        return;
+
+    flow.onPath[sector] = 1;
+    const std::vector<Portal> &portals = (*flow.sectorPortals)[sector];
+    flow.stack.push_back(FlowFrame{pass, portals.data(), portals.data() + portals.size(), sector});
+
+    while(!flow.stack.empty())
+    {
+        FlowFrame &frame = flow.stack.back();
+        const PortalSegment through = frame.pass;
+        const Portal *next = frame.next;
+
+        bool entered = false;
+        while(!entered && next < frame.end)
+        {
+            const Portal &portal = *next++;
+            if(flow.onPath[portal.to])
+                continue;
+
+            PortalSegment target = {portal.left, portal.right};
+
+            // has to be past both portals, and inside the region lines through both can reach:
+            // right of (source.right -> through.left) and left of (source.left -> through.right)
+            bool visible = ClipToFront(target, source) && ClipToFront(target, through) &&
+                           ClipSegment(target, source.right, through.left, -1.0) &&
+                           ClipSegment(target, source.left, through.right, 1.0);
+
+            if(!visible)
+                continue;
+
+            DEUtil::SetBit(flow.row, portal.to);
+            if(flow.steps++ >= flow.budget)
+                continue;
+
+            // the push can move the stack, frame isn't touched after it
+            frame.next = next;
+            flow.onPath[portal.to] = 1;
+            const std::vector<Portal> &into = (*flow.sectorPortals)[portal.to];
+            flow.stack.push_back(FlowFrame{target, into.data(), into.data() + into.size(), portal.to});
+            entered = true;
+        }
+
+        if(!entered)
+        {
+            flow.onPath[frame.sector] = 0;
+            flow.stack.pop_back();
+        }
+    }
+}
+
+static void FloodFill(const std::vector<std::vector<Portal>> &sectorPortals, u32 source, u64 *row)
+{
+    std::vector<u32> open = {source};
+    DEUtil::SetBit(row, source);
+    while(!open.empty())
+    {
+        u32 sector = open.back();
+        open.pop_back();
+
+        for(const Portal &portal : sectorPortals[sector])
+        {
+            if(DEUtil::TestBit(row, portal.to))
+                continue;
+
+            DEUtil::SetBit(row, portal.to);
+            open.push_back(portal.to);
+        }
+    }
+}
+
+DEUtil::PvsBuildStats DEUtil::SectorPVS::BuildPortalFlow(const MapData &map, u64 stepBudget)
+{
+    PvsBuildStats stats{};
+
+    sectorCount = (u32)map.sectors.size();
+    rowWords = (u32)BitWords(sectorCount);
+
+    std::vector<std::vector<Portal>> sectorPortals(sectorCount);
+    for(const MapLinedef &line : map.linedefs)
+    {
+        if(line.sides[1] == MAP_NO_SIDEDEF)
+            continue;
+
+        u32 front = map.sidedefs[line.sides[0]].sector;
+        u32 back = map.sidedefs[line.sides[1]].sector;
+        if(front == back)
+            continue;
+
+        PortalPoint v1 = {(f64)map.vertices[line.v1].x, (f64)map.vertices[line.v1].y};
+        PortalPoint v2 = {(f64)map.vertices[line.v2].x, (f64)map.vertices[line.v2].y};
+
+        // the front is right of v1 -> v2, so crossing front to back v1 is on the left
+        sectorPortals[front].push_back(Portal{v1, v2, back});
+        sectorPortals[back].push_back(Portal{v2, v1, front});
+        stats.portals++;
+    }
+
+    std::vector<u64> matrix((usize)sectorCount * rowWords, 0);
+
+    PortalFlow flow;
+    flow.sectorPortals = &sectorPortals;
+    flow.onPath.assign(sectorCount, 0);
+
+    for(u32 source = 0; source < sectorCount; source++)
+    {
+        flow.row = &matrix[(usize)source * rowWords];
+        flow.steps = 0;
+        flow.budget = stepBudget;
+
+        SetBit(flow.row, source);
+        flow.onPath[source] = 1;
+
+        for(const Portal &first : sectorPortals[source])
+        {
+            SetBit(flow.row, first.to);
+            flow.onPath[first.to] = 1;
+
+            PortalSegment sourcePortal = {first.left, first.right};
+            for(const Portal &second : sectorPortals[first.to])
+            {
+                if(flow.onPath[second.to])
+                    continue;
+
+                PortalSegment pass = {second.left, second.right};
+                if(!ClipToFront(pass, sourcePortal))
+                    continue;
+
+                SetBit(flow.row, second.to);
+                Flow(flow, sourcePortal, pass, second.to);
+            }
+
+            flow.onPath[first.to] = 0;
+        }
+
+        flow.onPath[source] = 0;
+        stats.flowSteps += flow.steps;
+
+        // ran out of budget, only connectivity is known for sure
+        if(flow.steps >= flow.budget)
+        {
+            FloodFill(sectorPortals, source, flow.row);
+            stats.floodedSectors++;
+        }
+    }
+
+    // seeing is mutual, keep whichever direction found more
+    for(u32 a = 0; a < sectorCount; a++)
+    {
+        for(u32 b = a + 1; b < sectorCount; b++)
+        {
+            u64 *rowA = &matrix[(usize)a * rowWords];
+            u64 *rowB = &matrix[(usize)b * rowWords];
+            if(TestBit(rowA, b) || TestBit(rowB, a))
+            {
+                SetBit(rowA, b);
+                SetBit(rowB, a);
+            }
+        }
+    }
+
+    Compress(matrix);
+    return stats;
+}
+
+#pragma endregion
+
+#pragma region File
+
+bool DEUtil::SectorPVS::Save(const char *filepath) const
+{
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if(!out.is_open())
+    {
+        LERROR("pvs: couldn't open file with path: " << filepath << "\n");
+        return false;
+    }
+
+    PvsHeader header;
+    header.magic = PVS_MAGIC;
+    header.version = PVS_VERSION;
+    header.sectorCount = sectorCount;
+    header.rowWords = rowWords;
+    header.dataSize = (u32)rows.size();
+
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)rowOffsets.data(), rowOffsets.size() * sizeof(u32));
+    out.write((const char *)rows.data(), rows.size());
+
+    if(!out.good())
+    {
+        LERROR("pvs: failed writing " << filepath << "\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool DEUtil::SectorPVS::Load(const char *filepath)
+{
+    MappedFile file;
+    if(!file.Open(filepath))
+        return false;
+
+    PvsHeader header{};
+    if(file.GetSize() >= sizeof(header))
+        memcpy(&header, file.GetData(), sizeof(header));
+
+    if(header.magic != PVS_MAGIC || header.version != PVS_VERSION)
+    {
+        LERROR("pvs: " << filepath << " has a bad magic or version.\n");
+        return false;
+    }
+
+    usize offsetsSize = ((usize)header.sectorCount + 1) * sizeof(u32);
+    if(header.rowWords != BitWords(header.sectorCount) || sizeof(header) + offsetsSize + header.dataSize != file.GetSize())
+    {
+        LERROR("pvs: " << filepath << " is truncated or corrupt.\n");
+        return false;
+    }
+
+    rowOffsets.resize(header.sectorCount + 1);
+    memcpy(rowOffsets.data(), file.GetData() + sizeof(header), offsetsSize);
+
+    for(u32 r = 0; r < header.sectorCount; r++)
+    {
+        if(rowOffsets[r] > rowOffsets[r + 1] || rowOffsets[r + 1] > header.dataSize)
+        {
+            LERROR("pvs: " << filepath << " has a corrupt row table.\n");
+            rowOffsets.clear();
+            return false;
+        }
+    }
+
+    rows.assign(file.GetData() + sizeof(header) + offsetsSize, file.GetData() + file.GetSize());
+    sectorCount = header.sectorCount;
+    rowWords = header.rowWords;
+
+    return true;
+}
+
+#pragma endregion
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../core/bitset.h"
+#include "mapData.h"
+
+#include <vector>
+
+// ---------------------- PVS FORMAT (.pvs) ----------------------
+//
+// [PvsHeader][u32 rowOffsets[sectorCount + 1]][compressed rows]
+// every row is rowWords u64s of sector bits, run length encoded per byte:
+// 0x00 or 0xff followed by a run length (1..255) of that byte, anything else is a literal.
+// little endian, like the rest of the engine's cooked formats.
+
+#define PVS_MAGIC   0x53565044 // "DPVS"
+#define PVS_VERSION 1
+
+struct PvsHeader
+{
+    u32 magic;
+    u32 version;
+    u32 sectorCount;
+    u32 rowWords;
+    u32 dataSize; // compressed bytes after the row offsets
+};
+
+ST_ASSERT(sizeof(PvsHeader) == 20, "expected PvsHeader to be 20 bytes.");
+
+namespace DEUtil {
+
+struct PvsBuildStats
+{
+    u32 portals;
+    u64 flowSteps;
+    u32 floodedSectors; // sources that hit the step budget and fell back to a flood fill
+};
+
+// sector to sector visibility, a compressed bit matrix.
+// rows are only decompressed when queried, which keeps 10k+ sector maps small.
+class SectorPVS
+{
+    private:
+    u32 sectorCount;
+    u32 rowWords;
+    std::vector<u32> rowOffsets; // sectorCount + 1, into rows
+    std::vector<u8> rows;
+
+    private:
+    void Compress(const std::vector<u64> &matrix);
+
+    public:
+    SectorPVS();
+
+    // vanilla's REJECT lump, inverted. missing bits count as visible.
+    void BuildFromReject(const MapData &map);
+
+    // offline: portal flow through two sided linedefs. a sector is visible from another
+    // if some line passes through every portal between them (2d, heights are ignored so
+    // doors and lifts never hide anything). conservative and symmetric.
+    PvsBuildStats BuildPortalFlow(const MapData &map, u64 stepBudget = 1 << 20);
+
+    bool Save(const char *filepath) const;
+    bool Load(const char *filepath);
+
+    // out needs GetRowWords() words.
+    void DecompressRow(u32 sector, u64 *out) const;
+
+    // mask &= row of `sector`. mask and scratch need GetRowWords() words.
+    void AndRow(u32 sector, u64 *mask, u64 *scratch) const;
+
+    // decompresses a whole row, use DecompressRow() for repeated queries.
+    bool IsVisible(u32 from, u32 to) const;
+
+    inline u32 GetSectorCount() const { return sectorCount; }
+    inline u32 GetRowWords() const { return rowWords; }
+    inline usize GetCompressedSize() const { return rows.size() + rowOffsets.size() * sizeof(u32); }
+    inline bool IsEmpty() const { return sectorCount == 0; }
+};
+
+} // namespace DEUtil
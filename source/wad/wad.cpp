@@ -0,0 +1,200 @@
+#include "wad.h"
+#include "../core/logger.h"
+
+#include <cstring>
+
+u64 DEUtil::PackLumpName(const char *name)
+{
+    u64 packed = 0;
+    for(u32 i = 0; i < WAD_NAME_LENGTH && name[i]; i++)
+    {
+        char c = name[i];
+        if(c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+
+        packed |= (u64)(u8)c << (i * 8);
+    }
+
+    return packed;
+}
+
+// splitmix64 finalizer, names share a lot of prefixes (E1M1, E1M2, ...)
+static inline u32 HashLumpName(u64 name)
+{
+    name ^= name >> 30;
+    name *= 0xbf58476d1ce4e5b9ull;
+    name ^= name >> 27;
+    name *= 0x94d049bb133111ebull;
+    name ^= name >> 31;
+
+    return (u32)name;
+}
+
+DEUtil::WadArchive::WadArchive() : uniqueNames{0} {}
+
+void DEUtil::WadArchive::Insert(u32 lumpIdx)
+{
+    u64 name = lumps[lumpIdx].name;
+    u32 mask = (u32)slots.size() - 1;
+
+    u32 i = HashLumpName(name) & mask;
+    while(slots[i] != 0)
+    {
+        // same name, the newer lump overrides it
+        if(lumps[slots[i] - 1].name == name)
+        {
+            slots[i] = lumpIdx + 1;
+            return;
+        }
+
+        i = (i + 1) & mask;
+    }
+
+    slots[i] = lumpIdx + 1;
+    uniqueNames++;
+}
+
+void DEUtil::WadArchive::Rehash(u32 slotCount)
+{
+    slots.assign(slotCount, 0);
+    uniqueNames = 0;
+
+    // in load order, so later lumps still win
+    for(u32 i = 0; i < lumps.size(); i++)
+        Insert(i);
+}
+
+bool DEUtil::WadArchive::AddFile(const char *filepath)
+{
+    MappedFile *file = new MappedFile();
+    if(!file->Open(filepath))
+    {
+        delete file;
+        return false;
+    }
+
+    const u8 *data = file->GetData();
+    usize size = file->GetSize();
+
+    WadHeader header{};
+    if(size >= sizeof(WadHeader))
+        memcpy(&header, data, sizeof(header));
+
+    if(header.magic != WAD_IWAD_MAGIC && header.magic != WAD_PWAD_MAGIC)
+    {
+        LERROR("wad: " << filepath << " isn't an IWAD or PWAD.\n");
+        delete file;
+        return false;
+    }
+
+    if(header.lumpCount < 0 || header.directoryOffset < 0 ||
+       (u64)header.directoryOffset + (u64)header.lumpCount * sizeof(WadDirEntry) > size)
+    {
+        LERROR("wad: " << filepath << " has a corrupt directory.\n");
+        delete file;
+        return false;
+    }
+
+    // validate everything before touching the archive, so a bad pwad can't half load.
+    // the directory offset comes from the file and needn't be aligned, so entries are copied out
+    const u8 *directory = data + header.directoryOffset;
+    for(i32 i = 0; i < header.lumpCount; i++)
+    {
+        WadDirEntry entry;
+        memcpy(&entry, directory + (usize)i * sizeof(WadDirEntry), sizeof(entry));
+        if(entry.offset < 0 || entry.size < 0 || (u64)entry.offset + (u64)entry.size > size)
+        {
+            LERROR("wad: " << filepath << " lump " << i << " points outside of the file.\n");
+            delete file;
+            return false;
+        }
+    }
+
+    u32 fileIdx = (u32)files.size();
+    files.push_back(file);
+
+    lumps.reserve(lumps.size() + header.lumpCount);
+    for(i32 i = 0; i < header.lumpCount; i++)
+    {
+        WadDirEntry entry;
+        memcpy(&entry, directory + (usize)i * sizeof(WadDirEntry), sizeof(entry));
+
+        char name[WAD_NAME_LENGTH + 1] = {};
+        memcpy(name, entry.name, WAD_NAME_LENGTH);
+
+        WadLump lump;
+        lump.name = PackLumpName(name);
+        lump.data = data + entry.offset;
+        lump.size = (u32)entry.size;
+        lump.file = fileIdx;
+        lumps.push_back(lump);
+    }
+
+    // keep the table at most half full
+    u32 slotCount = slots.empty() ? 16 : (u32)slots.size();
+    while(slotCount < lumps.size() * 2)
+        slotCount <<= 1;
+
+    if(slotCount != slots.size())
+    {
+        Rehash(slotCount);
+    }
+    else
+    {
+        for(u32 i = (u32)lumps.size() - header.lumpCount; i < lumps.size(); i++)
+            Insert(i);
+    }
+
+    LINFO(false, "wad: added " << filepath << " (" << header.lumpCount << " lumps, "
+                               << (header.magic == WAD_IWAD_MAGIC ? "IWAD" : "PWAD") << ")\n");
+    return true;
+}
+
+i32 DEUtil::WadArchive::FindLump(const char *name) const
+{
+    if(slots.empty())
+        return -1;
+
+    u64 packed = PackLumpName(name);
+    u32 mask = (u32)slots.size() - 1;
+
+    // the table is never full, so this always hits an empty slot eventually
+    for(u32 i = HashLumpName(packed) & mask; slots[i] != 0; i = (i + 1) & mask)
+    {
+        if(lumps[slots[i] - 1].name == packed)
+            return (i32)slots[i] - 1;
+    }
+
+    return -1;
+}
+
+i32 DEUtil::WadArchive::FindLumpAfter(const char *name, i32 first) const
+{
+    u64 packed = PackLumpName(name);
+    for(i32 i = first < 0 ? 0 : first; i < (i32)lumps.size(); i++)
+    {
+        if(lumps[i].name == packed)
+            return i;
+    }
+
+    return -1;
+}
+
+DEUtil::LumpView DEUtil::WadArchive::GetLump(i32 lumpIdx) const
+{
+    if(lumpIdx < 0 || lumpIdx >= (i32)lumps.size())
+        return LumpView{nullptr, 0};
+
+    return LumpView{lumps[lumpIdx].data, lumps[lumpIdx].size};
+}
+
+DEUtil::LumpView DEUtil::WadArchive::GetLump(const char *name) const
+{
+    return GetLump(FindLump(name));
+}
+
+DEUtil::WadArchive::~WadArchive()
+{
+    for(MappedFile *file : files)
+        delete file;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "../core/mappedFile.h"
+
+#include <vector>
+
+// ---------------------- WAD FORMAT ----------------------
+//
+// [header] ... lump data ... [directory: WadDirEntry[lumpCount]]
+// everything is little endian. lump names are up to 8 characters, padded with
+// zeros (but not necessarily zero terminated).
+
+#define WAD_IWAD_MAGIC 0x44415749 // "IWAD"
+#define WAD_PWAD_MAGIC 0x44415750 // "PWAD"
+#define WAD_NAME_LENGTH 8
+
+struct WadHeader
+{
+    u32 magic;
+    i32 lumpCount;
+    i32 directoryOffset;
+};
+
+struct WadDirEntry
+{
+    i32 offset;
+    i32 size;
+    char name[WAD_NAME_LENGTH];
+};
+
+ST_ASSERT(sizeof(WadHeader) == 12, "expected WadHeader to be 12 bytes.");
+ST_ASSERT(sizeof(WadDirEntry) == 16, "expected WadDirEntry to be 16 bytes.");
+
+namespace DEUtil {
+
+// lump name packed into 8 bytes (upper case, zero padded), so comparing names is one compare.
+// reads at most WAD_NAME_LENGTH characters, so unterminated names from the file are fine.
+u64 PackLumpName(const char *name);
+
+// zero-copy view of a lump's data, stays valid as long as its WadArchive is alive.
+struct LumpView
+{
+    const u8 *data;
+    u32 size;
+};
+
+struct WadLump
+{
+    u64 name; // packed, see PackLumpName()
+    const u8 *data;
+    u32 size;
+    u32 file; // index of the wad it came from, in load order
+};
+
+// every loaded wad's lumps in one directory. wads added later override earlier
+// lumps of the same name (iwad first, then pwads), like vanilla doom.
+class WadArchive
+{
+    private:
+    std::vector<MappedFile *> files;
+    std::vector<WadLump> lumps;
+
+    // open addressing, lump index + 1 (0 is an empty slot), power of two sized
+    std::vector<u32> slots;
+    u32 uniqueNames;
+
+    private:
+    void Insert(u32 lumpIdx);
+    void Rehash(u32 slotCount);
+
+    public:
+    WadArchive();
+    WadArchive(const WadArchive &archive) = delete;
+    WadArchive &operator=(const WadArchive &archive) = delete;
+
+    // maps an iwad or pwad and appends its lumps. returns false (and logs) if it
+    // can't be mapped or isn't a valid wad, the archive is left unchanged then.
+    bool AddFile(const char *filepath);
+
+    // index of the newest lump with that name, -1 if there's none.
+    i32 FindLump(const char *name) const;
+
+    // like FindLump() but only looks at lumps [first, GetLumpCount()), in order.
+    // used for lumps that only make sense relative to a marker (map lumps after E1M1).
+    i32 FindLumpAfter(const char *name, i32 first) const;
+
+    LumpView GetLump(i32 lumpIdx) const;
+    LumpView GetLump(const char *name) const; // data is nullptr if it doesn't exist
+
+    inline const WadLump &GetLumpInfo(i32 lumpIdx) const { return lumps[lumpIdx]; }
+    inline u32 GetLumpCount() const { return (u32)lumps.size(); }
+    inline u32 GetFileCount() const { return (u32)files.size(); }
+
+    ~WadArchive();
+};
+
+} // namespace DEUtil
@@ -0,0 +1,303 @@
+#include "wadTextures.h"
+#include "../core/logger.h"
+
+#include <cstring>
+#include <unordered_map>
+
+template<typename T>
+static inline T ReadValue(const u8 *data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+// appends image, or replaces the earlier one of the same name
+static void AddImage(std::vector<DEUtil::WadImage> &out, std::unordered_map<u64, u32> &names, DEUtil::WadImage &&image)
+{
+    auto found = names.find(image.name);
+    if(found != names.end())
+    {
+        out[found->second] = std::move(image);
+        return;
+    }
+
+    names[image.name] = (u32)out.size();
+    out.push_back(std::move(image));
+}
+
+// lumps between start/end, or the pwad markers. F1_START and the like are empty
+// markers in between, so callers skip lumps that don't decode.
+static std::vector<i32> FindMarkedLumps(const DEUtil::WadArchive &archive, const char *start, const char *end,
+                                        const char *pwadStart, const char *pwadEnd)
+{
+    u64 startName = DEUtil::PackLumpName(start), endName = DEUtil::PackLumpName(end);
+    u64 pwadStartName = DEUtil::PackLumpName(pwadStart), pwadEndName = DEUtil::PackLumpName(pwadEnd);
+
+    std::vector<i32> lumps;
+    bool inside = false;
+    for(u32 i = 0; i < archive.GetLumpCount(); i++)
+    {
+        const DEUtil::WadLump &lump = archive.GetLumpInfo(i);
+        if(lump.name == startName || lump.name == pwadStartName)
+            inside = true;
+        else if(lump.name == endName || lump.name == pwadEndName)
+            inside = false;
+        else if(inside && lump.size > 0)
+            lumps.push_back((i32)i);
+    }
+
+    return lumps;
+}
+
+bool DEUtil::DrawPicture(const u8 *data, u32 size, WadImage &image, i32 originX, i32 originY)
+{
+    if(size < sizeof(WadPictureHeader))
+    {
+        LERROR("picture is smaller than its header.\n");
+        return false;
+    }
+
+    WadPictureHeader header = ReadValue<WadPictureHeader>(data);
+    if(header.width <= 0 || header.height <= 0 || sizeof(WadPictureHeader) + header.width * 4ull > size)
+    {
+        LERROR("picture has a bad size (" << header.width << "x" << header.height << ").\n");
+        return false;
+    }
+
+    for(i32 x = 0; x < header.width; x++)
+    {
+        i32 dstX = originX + x;
+        if(dstX < 0 || dstX >= (i32)image.width)
+            continue;
+
+        u32 offset = ReadValue<u32>(data + sizeof(WadPictureHeader) + x * 4);
+
+        // tall patches (over 254 rows) encode a topDelta <= the previous one as relative to it
+        i32 lastDelta = -1;
+        i32 top = 0;
+        while(true)
+        {
+            if(offset >= size)
+            {
+                LERROR("picture column " << x << " runs past the lump.\n");
+                return false;
+            }
+
+            u8 topDelta = data[offset];
+            if(topDelta == WAD_POST_END)
+                break;
+
+            if(offset + 3 > size || offset + 4 + data[offset + 1] > size)
+            {
+                LERROR("picture post in column " << x << " runs past the lump.\n");
+                return false;
+            }
+
+            top = (i32)topDelta <= lastDelta ? top + topDelta : topDelta;
+            lastDelta = topDelta;
+
+            u32 length = data[offset + 1];
+            const u8 *pixels = data + offset + 3;
+            for(u32 i = 0; i < length; i++)
+            {
+                i32 dstY = originY + top + (i32)i;
+                if(dstY < 0 || dstY >= (i32)image.height)
+                    continue;
+
+                usize texel = (usize)dstY * image.width + dstX;
+                image.pixels[texel] = pixels[i];
+                image.coverage[texel] = 1;
+            }
+
+            offset += length + 4;
+        }
+    }
+
+    return true;
+}
+
+bool DEUtil::DecodePicture(const u8 *data, u32 size, WadImage &out)
+{
+    if(size < sizeof(WadPictureHeader))
+    {
+        LERROR("picture is smaller than its header.\n");
+        return false;
+    }
+
+    WadPictureHeader header = ReadValue<WadPictureHeader>(data);
+    if(header.width <= 0 || header.height <= 0)
+    {
+        LERROR("picture has a bad size (" << header.width << "x" << header.height << ").\n");
+        return false;
+    }
+
+    out.width = header.width;
+    out.height = header.height;
+    out.leftOffset = header.leftOffset;
+    out.topOffset = header.topOffset;
+    out.pixels.assign((usize)out.width * out.height, 0);
+    out.coverage.assign((usize)out.width * out.height, 0);
+
+    return DrawPicture(data, size, out, 0, 0);
+}
+
+// one TEXTUREx lump, patches resolved through PNAMES
+static bool LoadTextureLump(const DEUtil::WadArchive &archive, DEUtil::LumpView lump, const std::vector<i32> &patches,
+                            std::vector<DEUtil::WadImage> &out, std::unordered_map<u64, u32> &names)
+{
+    if(lump.size < 4)
+    {
+        LERROR("TEXTURE lump is too small.\n");
+        return false;
+    }
+
+    i32 count = ReadValue<i32>(lump.data);
+    if(count < 0 || 4 + count * 4ull > lump.size)
+    {
+        LERROR("TEXTURE lump has a bad texture count (" << count << ").\n");
+        return false;
+    }
+
+    for(i32 i = 0; i < count; i++)
+    {
+        u32 offset = ReadValue<u32>(lump.data + 4 + i * 4);
+        if(offset + sizeof(WadTextureDef) + 2ull > lump.size)
+        {
+            LERROR("TEXTURE lump entry " << i << " runs past the lump.\n");
+            return false;
+        }
+
+        WadTextureDef def = ReadValue<WadTextureDef>(lump.data + offset);
+        i16 patchCount = ReadValue<i16>(lump.data + offset + sizeof(WadTextureDef));
+        const u8 *patchDefs = lump.data + offset + sizeof(WadTextureDef) + 2;
+        if(def.width <= 0 || def.height <= 0 || patchCount < 0 ||
+           offset + sizeof(WadTextureDef) + 2 + patchCount * sizeof(WadPatchDef) > lump.size)
+        {
+            LERROR("TEXTURE lump entry " << i << " is malformed.\n");
+            return false;
+        }
+
+        DEUtil::WadImage image;
+        image.name = DEUtil::PackLumpName(def.name);
+        image.width = def.width;
+        image.height = def.height;
+        image.leftOffset = 0;
+        image.topOffset = 0;
+        image.pixels.assign((usize)image.width * image.height, 0);
+        image.coverage.assign((usize)image.width * image.height, 0);
+
+        for(i16 p = 0; p < patchCount; p++)
+        {
+            WadPatchDef patchDef = ReadValue<WadPatchDef>(patchDefs + p * sizeof(WadPatchDef));
+            if(patchDef.patch < 0 || patchDef.patch >= (i32)patches.size() || patches[patchDef.patch] < 0)
+            {
+                LWARN(false, "texture " << std::string(def.name, strnlen(def.name, WAD_NAME_LENGTH))
+                                        << " uses a missing patch (" << patchDef.patch << ").\n");
+                continue;
+            }
+
+            DEUtil::LumpView patch = archive.GetLump(patches[patchDef.patch]);
+            DEUtil::DrawPicture(patch.data, patch.size, image, patchDef.originX, patchDef.originY);
+        }
+
+        AddImage(out, names, std::move(image));
+    }
+
+    return true;
+}
+
+bool DEUtil::LoadWallTextures(const WadArchive &archive, std::vector<WadImage> &out)
+{
+    LumpView pnames = archive.GetLump("PNAMES");
+    if(!pnames.data || pnames.size < 4)
+    {
+        LERROR("no PNAMES lump.\n");
+        return false;
+    }
+
+    i32 patchCount = ReadValue<i32>(pnames.data);
+    if(patchCount < 0 || 4 + (u64)patchCount * WAD_NAME_LENGTH > pnames.size)
+    {
+        LERROR("PNAMES has a bad patch count (" << patchCount << ").\n");
+        return false;
+    }
+
+    std::vector<i32> patches(patchCount);
+    for(i32 i = 0; i < patchCount; i++)
+    {
+        char name[WAD_NAME_LENGTH + 1] = {};
+        memcpy(name, pnames.data + 4 + i * WAD_NAME_LENGTH, WAD_NAME_LENGTH);
+        patches[i] = archive.FindLump(name);
+    }
+
+    std::unordered_map<u64, u32> names;
+    for(u32 i = 0; i < out.size(); i++)
+        names[out[i].name] = i;
+
+    bool found = false;
+    for(const char *lumpName : {"TEXTURE1", "TEXTURE2"})
+    {
+        LumpView lump = archive.GetLump(lumpName);
+        if(!lump.data)
+            continue;
+
+        found = true;
+        if(!LoadTextureLump(archive, lump, patches, out, names))
+            return false;
+    }
+
+    if(!found)
+    {
+        LERROR("no TEXTURE1 or TEXTURE2 lump.\n");
+        return false;
+    }
+
+    return true;
+}
+
+void DEUtil::LoadFlats(const WadArchive &archive, std::vector<WadImage> &out)
+{
+    std::unordered_map<u64, u32> names;
+    for(u32 i = 0; i < out.size(); i++)
+        names[out[i].name] = i;
+
+    for(i32 lumpIdx : FindMarkedLumps(archive, "F_START", "F_END", "FF_START", "FF_END"))
+    {
+        const WadLump &lump = archive.GetLumpInfo(lumpIdx);
+        if(lump.size < WAD_FLAT_SIZE * WAD_FLAT_SIZE)
+            continue;
+
+        WadImage image;
+        image.name = lump.name;
+        image.width = WAD_FLAT_SIZE;
+        image.height = WAD_FLAT_SIZE;
+        image.leftOffset = 0;
+        image.topOffset = 0;
+        image.pixels.assign(lump.data, lump.data + WAD_FLAT_SIZE * WAD_FLAT_SIZE);
+        image.coverage.assign(WAD_FLAT_SIZE * WAD_FLAT_SIZE, 1);
+        AddImage(out, names, std::move(image));
+    }
+}
+
+void DEUtil::LoadSprites(const WadArchive &archive, std::vector<WadImage> &out)
+{
+    std::unordered_map<u64, u32> names;
+    for(u32 i = 0; i < out.size(); i++)
+        names[out[i].name] = i;
+
+    for(i32 lumpIdx : FindMarkedLumps(archive, "S_START", "S_END", "SS_START", "SS_END"))
+    {
+        const WadLump &lump = archive.GetLumpInfo(lumpIdx);
+
+        WadImage image;
+        image.name = lump.name;
+        if(!DecodePicture(lump.data, lump.size, image))
+        {
+            LWARN(false, "skipping sprite lump " << lumpIdx << ".\n");
+            continue;
+        }
+
+        AddImage(out, names, std::move(image));
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../core/defines.h"
+#include "wad.h"
+
+#include <vector>
+
+// ---------------------- WAD GRAPHICS ----------------------
+//
+// pictures (patches, sprites): WadPictureHeader, u32 columnOffsets[width], then per column
+// posts of [u8 topDelta, u8 length, u8 unused, u8 pixels[length], u8 unused] ending with 0xff.
+//
+// TEXTURE1/TEXTURE2: i32 count, i32 offsets[count], then per texture a WadTextureDef,
+// an i16 patch count and that many WadPatchDefs. patch indices go into PNAMES
+// (i32 count, char names[count][8]).
+//
+// flats are raw 64x64 palette indices between F_START and F_END (FF_START/FF_END in pwads),
+// sprites are pictures between S_START and S_END (SS_START/SS_END).
+
+#define WAD_POST_END 0xff
+#define WAD_FLAT_SIZE 64
+
+struct WadPictureHeader
+{
+    i16 width, height;
+    i16 leftOffset, topOffset;
+};
+
+struct WadTextureDef
+{
+    char name[WAD_NAME_LENGTH];
+    i32 masked;
+    i16 width, height;
+    i32 columnDirectory; // unused
+};
+
+struct WadPatchDef
+{
+    i16 originX, originY;
+    i16 patch; // into PNAMES
+    i16 stepDir, colormap; // unused
+};
+
+ST_ASSERT(sizeof(WadPictureHeader) == 8, "expected WadPictureHeader to be 8 bytes.");
+ST_ASSERT(sizeof(WadTextureDef) == 20, "expected WadTextureDef to be 20 bytes.");
+ST_ASSERT(sizeof(WadPatchDef) == 10, "expected WadPatchDef to be 10 bytes.");
+
+namespace DEUtil {
+
+// 8 bit image, row major. coverage is 1 where a post (or a flat) wrote the texel, 0 where
+// it's see-through (gaps in sprites and masked midtextures).
+struct WadImage
+{
+    u64 name; // packed, see PackLumpName()
+    u32 width, height;
+    i16 leftOffset, topOffset;
+    std::vector<u8> pixels;
+    std::vector<u8> coverage;
+};
+
+// draws a picture into image at (originX, originY), clipped to the image. returns false
+// (and logs) if the picture is malformed.
+bool DrawPicture(const u8 *data, u32 size, WadImage &image, i32 originX, i32 originY);
+
+// a standalone picture, sized to its header.
+bool DecodePicture(const u8 *data, u32 size, WadImage &out);
+
+// composes every texture of TEXTURE1 and TEXTURE2 from its patches, later definitions
+// of a name replace earlier ones. missing patches are skipped with a warning.
+bool LoadWallTextures(const WadArchive &archive, std::vector<WadImage> &out);
+
+// every flat/sprite between the markers, later lumps of a name replace earlier ones.
+void LoadFlats(const WadArchive &archive, std::vector<WadImage> &out);
+void LoadSprites(const WadArchive &archive, std::vector<WadImage> &out);
+
+} // namespace DEUtil
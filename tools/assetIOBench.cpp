@@ -0,0 +1,246 @@
+// ---------------------- ASSET IO BENCH ----------------------
+// reads a synthetic asset pack (-files files of -size kb in -dir, written on the first run)
+// three ways: one file after another through an ifstream like the engine's ReadBinFile(),
+// through AssetIO on io_uring and through AssetIO's pread threads. every run is made cold
+// first (the pack is dropped from the page cache) and warm after, and all of them have to
+// come out with the same bytes. then a visible read is timed behind a queue full of
+// prefetches, to show it skips ahead of them.
+//
+// usage: DOOMAssetIOBench [-dir <path>] [-files <n>] [-size <kb>] [-depth <n>] [-threads <n>]
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <core/assetIO.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef IPLATFORM_WINDOWS
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMAssetIOBench [-dir <path>] [-files <n>] [-size <kb>] [-depth <n>] [-threads <n>]\n"
+                 "\t-dir      where the pack goes, DOOMAssetIOBench.pack by default\n"
+                 "\t-files    assets in the pack, 256 by default\n"
+                 "\t-size     kb per asset, 1024 by default\n"
+                 "\t-depth    io_uring reads in flight, 64 by default\n"
+                 "\t-threads  pread threads, 4 by default\n");
+}
+
+static u64 Fnv1a(const u8 *data, usize size)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    for(usize i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+// the pack's files exist and have the right size, or are written
+static bool PreparePack(const std::string &dir, u32 fileCount, u64 fileSize, std::vector<std::string> &paths)
+{
+#ifndef IPLATFORM_WINDOWS
+    mkdir(dir.c_str(), 0755);
+#endif
+
+    std::vector<u8> data(fileSize);
+    for(u32 i = 0; i < fileCount; i++)
+    {
+        std::string path = dir + "/asset" + std::to_string(i) + ".bin";
+        paths.push_back(path);
+
+        std::ifstream existing(path, std::ios::binary | std::ios::ate);
+        if(existing && (u64)existing.tellg() == fileSize)
+            continue;
+
+        u32 state = 0x9e3779b9u ^ i;
+        for(u64 b = 0; b < fileSize; b++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            data[b] = (u8)state;
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        file.write((const char *)data.data(), (std::streamsize)fileSize);
+        if(!file)
+        {
+            LERROR("couldn't write " << path << "\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// out of the page cache, so the next read comes from the disk
+static void DropFromCache(const std::vector<std::string> &paths)
+{
+#ifndef IPLATFORM_WINDOWS
+    for(const std::string &path : paths)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            continue;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+#endif
+}
+
+// the hashes are taken after the clock stops, so the runs time the reads alone
+static void HashAll(const std::vector<std::vector<u8>> &buffers, std::vector<u64> &hashes)
+{
+    for(usize i = 0; i < buffers.size(); i++)
+        hashes[i] = Fnv1a(buffers[i].data(), buffers[i].size());
+}
+
+// the engine's ReadBinFile(): open, tellg, read it all, one file at a time
+static f64 RunIfstream(const std::vector<std::string> &paths, std::vector<u64> &hashes)
+{
+    std::vector<std::vector<u8>> buffers(paths.size());
+    auto start = std::chrono::steady_clock::now();
+    for(usize i = 0; i < paths.size(); i++)
+    {
+        std::ifstream file(paths[i], std::ios::ate | std::ios::binary);
+        u64 size = (u64)file.tellg();
+        file.seekg(0);
+        buffers[i].resize(size);
+        file.read((char *)buffers[i].data(), (std::streamsize)size);
+    }
+    f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    HashAll(buffers, hashes);
+    return ms;
+}
+
+static f64 RunAssetIO(DEUtil::AssetIO &io, const std::vector<std::string> &paths, std::vector<u64> &hashes)
+{
+    std::vector<std::vector<u8>> buffers(paths.size());
+    std::atomic<u32> failed{0};
+    auto start = std::chrono::steady_clock::now();
+    for(usize i = 0; i < paths.size(); i++)
+    {
+        io.Read(paths[i].c_str(), 0, 0, DEUtil::AssetPriority::VISIBLE,
+                [i, &buffers, &failed](DEUtil::AssetReadResult &result) {
+                    if(result.status != DEUtil::AssetReadStatus::DONE)
+                        failed.fetch_add(1);
+                    buffers[i] = std::move(result.data);
+                });
+    }
+    io.WaitIdle();
+    f64 ms = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if(failed.load() > 0)
+        LERROR(failed.load() << " reads failed.\n");
+    HashAll(buffers, hashes);
+    return ms;
+}
+
+// ms from a read being asked for to its callback, with every asset queued as a prefetch first
+static f64 TimeBehindPrefetches(DEUtil::AssetIO &io, const std::vector<std::string> &paths,
+                                DEUtil::AssetPriority priority)
+{
+    for(const std::string &path : paths)
+        io.Read(path.c_str(), 0, 0, DEUtil::AssetPriority::PREFETCH, nullptr);
+
+    std::atomic<f64> latency{0.0};
+    auto start = std::chrono::steady_clock::now();
+    io.Read(paths[0].c_str(), 0, 0, priority, [&](DEUtil::AssetReadResult &) {
+        latency = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    });
+    io.WaitIdle();
+    return latency.load();
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = "DOOMAssetIOBench.pack";
+    u32 fileCount = 256;
+    u64 fileSize = 1024 * 1024;
+    u32 depth = 64;
+    u32 threads = 4;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-dir") == 0 && i + 1 < argc)
+            dir = argv[++i];
+        else if(strcmp(argv[i], "-files") == 0 && i + 1 < argc)
+            fileCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+            fileSize = std::strtoull(argv[++i], nullptr, 10) * 1024;
+        else if(strcmp(argv[i], "-depth") == 0 && i + 1 < argc)
+            depth = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if(fileCount == 0 || fileSize == 0 || depth == 0 || threads == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<std::string> paths;
+    if(!PreparePack(dir, fileCount, fileSize, paths))
+        return 1;
+
+    f64 totalMb = (f64)fileCount * fileSize / (1024.0 * 1024.0);
+    LINFO(false, fileCount << " assets of " << fileSize / 1024 << "kb, " << totalMb << "mb\n");
+
+    std::vector<u64> reference(fileCount), hashes(fileCount);
+    DropFromCache(paths);
+    f64 coldMs = RunIfstream(paths, reference);
+    f64 warmMs = RunIfstream(paths, reference);
+    printf("%-10s cold %9.2f ms %9.1f mb/s   warm %9.2f ms %9.1f mb/s\n", "ifstream", coldMs, totalMb / coldMs * 1000.0,
+           warmMs, totalMb / warmMs * 1000.0);
+
+    for(u32 mode = 0; mode < 2; mode++)
+    {
+        DEUtil::AssetIO io(depth, threads, mode == 0);
+        if(mode == 0 && !io.IsUsingUring())
+        {
+            printf("io_uring   not available here\n");
+            continue;
+        }
+
+        const char *name = io.IsUsingUring() ? "io_uring" : "pread";
+        DropFromCache(paths);
+        coldMs = RunAssetIO(io, paths, hashes);
+        bool same = hashes == reference;
+        warmMs = RunAssetIO(io, paths, hashes);
+        same = same && hashes == reference;
+        printf("%-10s cold %9.2f ms %9.1f mb/s   warm %9.2f ms %9.1f mb/s\n", name, coldMs, totalMb / coldMs * 1000.0,
+               warmMs, totalMb / warmMs * 1000.0);
+
+        if(!same)
+        {
+            LERROR(name << " read different bytes than the ifstream.\n");
+            return 1;
+        }
+
+        // warm, so it's the queueing and not the disk
+        f64 visibleMs = TimeBehindPrefetches(io, paths, DEUtil::AssetPriority::VISIBLE);
+        f64 prefetchMs = TimeBehindPrefetches(io, paths, DEUtil::AssetPriority::PREFETCH);
+        printf("%-10s behind %u prefetches: visible read %.2f ms, prefetch read %.2f ms\n", name, fileCount, visibleMs,
+               prefetchMs);
+    }
+
+    return 0;
+}
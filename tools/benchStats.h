@@ -0,0 +1,17 @@
+#pragma once
+
+#include <core/defines.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// ---------------------- BENCH STATS ----------------------
+// helpers the bench tools share for their timing reports
+
+// nearest rank, times has to be sorted
+inline f64 Percentile(const std::vector<f64> &times, f64 percent)
+{
+    usize rank = (usize)std::ceil(percent / 100.0 * times.size());
+    return times[std::clamp(rank, (usize)1, times.size()) - 1];
+}
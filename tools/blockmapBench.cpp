@@ -0,0 +1,440 @@
+// ---------------------- BLOCKMAP BENCH ----------------------
+// times the blockmap's queries on millions of random inputs: TraceLine() for line of sight
+// and movement rays, LinesInBox() and the things in a block, each next to a linear scan of
+// every linedef (or thing). the first -check queries of each kind are compared with the scan:
+// rays have to stop at the same fraction (on the same line, unless two lines meet there),
+// boxes have to list every line crossing them, once, and blocks exactly the things in them.
+//
+// without wads the map is a field of random one and two sided lines (some of them shut doors)
+// with a generated blockmap. with a map and wads it's that map, on its BLOCKMAP lump.
+//
+// usage: DOOMBlockmapBench [-lines <n>] [-queries <n>] [-check <n>] [-generate] [<map> <file.wad>...]
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <wad/blockmap.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define BENCH_FIELD_SIZE 8192.0f // the random map spans this many units on each side
+#define BENCH_RAY_LENGTH 2048.0f // vanilla's MISSILERANGE, the longest hitscan
+#define BENCH_THING_RADIUS 32.0f // half the box queries' size
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMBlockmapBench [-lines <n>] [-queries <n>] [-check <n>] [-generate] "
+                 "[<map> <file.wad>...]\n"
+                 "\t-lines     linedefs of the random map, 20000 by default\n"
+                 "\t-queries   queries of each kind timed, 2000000 by default\n"
+                 "\t-check     queries of each kind compared with the linear scan, 5000 by default\n"
+                 "\t-generate  generates the blockmap even if the map has a BLOCKMAP lump\n"
+                 "\twith a map and wads that map is used, later wads override earlier ones\n");
+}
+
+// xorshift32, the same map and queries every run
+static u32 NextRandom(u32 &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static f32 RandomUnit(u32 &state)
+{
+    return (NextRandom(state) >> 8) * (1.0f / (1 << 24));
+}
+
+// sector 0 is open, sector 1 a step up in it and sector 2 a shut door
+static void BuildRandomMap(DEUtil::MapData &map, u32 lineCount)
+{
+    u32 random = 0x2545f491;
+
+    MapSector open{}, step{}, door{};
+    open.ceilingHeight = 128;
+    step.floorHeight = 24;
+    step.ceilingHeight = 128;
+    map.sectors = {open, step, door};
+
+    for(u16 sector = 0; sector < 3; sector++)
+    {
+        MapSidedef side{};
+        side.sector = sector;
+        map.sidedefs.push_back(side);
+    }
+
+    for(u32 l = 0; l < lineCount; l++)
+    {
+        f32 x = (RandomUnit(random) - 0.5f) * BENCH_FIELD_SIZE;
+        f32 y = (RandomUnit(random) - 0.5f) * BENCH_FIELD_SIZE;
+        f32 angle = RandomUnit(random) * 2.0f * (f32)M_PI;
+        f32 length = 16.0f + RandomUnit(random) * RandomUnit(random) * 512.0f;
+
+        // every fourth line is axis aligned, so rays along block edges and lines come up
+        if(l % 4 == 0)
+            angle = (f32)(NextRandom(random) % 4) * 0.5f * (f32)M_PI;
+
+        u16 v = (u16)map.vertices.size();
+        map.vertices.push_back(MapVertex{(i16)std::lround(x), (i16)std::lround(y)});
+        map.vertices.push_back(MapVertex{(i16)std::lround(x + std::cos(angle) * length),
+                                         (i16)std::lround(y + std::sin(angle) * length)});
+
+        MapLinedef line{};
+        line.v1 = v;
+        line.v2 = (u16)(v + 1);
+        line.sides[0] = 0;
+        line.sides[1] = MAP_NO_SIDEDEF;
+
+        u32 kind = NextRandom(random) % 8;
+        if(kind < 4)
+        {
+            line.flags = ML_TWOSIDED | (kind == 0 ? ML_BLOCKING : 0);
+            line.sides[1] = (u16)(kind == 3 ? 2 : 1);
+        }
+        map.linedefs.push_back(line);
+    }
+}
+
+#pragma region Reference
+
+// the same rule and math as the blockmap's, so both come to the same fraction
+static bool ReferenceBlocks(const DEUtil::MapData &map, const MapLinedef &line, u16 blockFlags)
+{
+    if(line.sides[1] == MAP_NO_SIDEDEF || (line.flags & blockFlags))
+        return true;
+
+    const MapSector &front = map.sectors[map.sidedefs[line.sides[0]].sector];
+    const MapSector &back = map.sectors[map.sidedefs[line.sides[1]].sector];
+    return std::max(front.floorHeight, back.floorHeight) >= std::min(front.ceilingHeight, back.ceilingHeight);
+}
+
+static bool ReferenceTrace(const DEUtil::MapData &map, glm::ivec2 origin, glm::vec2 from, glm::vec2 to,
+                           u16 blockFlags, DEUtil::BlockmapHit &hit)
+{
+    glm::dvec2 p = glm::dvec2((f64)from.x - origin.x, (f64)from.y - origin.y);
+    glm::dvec2 d = glm::dvec2((f64)to.x - from.x, (f64)to.y - from.y);
+
+    f64 best = INFINITY;
+    for(u32 l = 0; l < map.linedefs.size(); l++)
+    {
+        const MapLinedef &line = map.linedefs[l];
+        if(!ReferenceBlocks(map, line, blockFlags))
+            continue;
+
+        glm::dvec2 a = glm::dvec2(map.vertices[line.v1].x - origin.x, map.vertices[line.v1].y - origin.y);
+        glm::dvec2 e = glm::dvec2(map.vertices[line.v2].x - origin.x, map.vertices[line.v2].y - origin.y) - a;
+
+        f64 denom = d.x * e.y - d.y * e.x;
+        if(denom == 0.0)
+            continue;
+
+        glm::dvec2 ap = a - p;
+        f64 t = (ap.x * e.y - ap.y * e.x) / denom;
+        f64 u = (ap.x * d.y - ap.y * d.x) / denom;
+        if(t < 0.0 || t > 1.0 || u < 0.0 || u > 1.0 || t >= best)
+            continue;
+
+        best = t;
+        hit.linedef = (u16)l;
+    }
+
+    hit.fraction = (f32)best;
+    return best <= 1.0;
+}
+
+// true if the line's segment touches the box
+static bool LineCrossesBox(const DEUtil::MapData &map, const MapLinedef &line, glm::vec2 boxMin, glm::vec2 boxMax)
+{
+    glm::dvec2 p = glm::dvec2(map.vertices[line.v1].x, map.vertices[line.v1].y);
+    glm::dvec2 d = glm::dvec2(map.vertices[line.v2].x, map.vertices[line.v2].y) - p;
+
+    f64 t0 = 0.0, t1 = 1.0;
+    for(i32 axis = 0; axis < 2; axis++)
+    {
+        f64 lo = axis == 0 ? boxMin.x : boxMin.y, hi = axis == 0 ? boxMax.x : boxMax.y;
+        if(d[axis] == 0.0)
+        {
+            if(p[axis] < lo || p[axis] > hi)
+                return false;
+            continue;
+        }
+
+        f64 ta = (lo - p[axis]) / d[axis], tb = (hi - p[axis]) / d[axis];
+        t0 = std::max(t0, std::min(ta, tb));
+        t1 = std::min(t1, std::max(ta, tb));
+        if(t0 > t1)
+            return false;
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+static f64 MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    u32 lineCount = 20000;
+    u32 queryCount = 2000000;
+    u32 checkCount = 5000;
+    bool generate = false;
+    std::vector<const char *> args;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-lines") == 0 && i + 1 < argc)
+            lineCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-queries") == 0 && i + 1 < argc)
+            queryCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-check") == 0 && i + 1 < argc)
+            checkCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-generate") == 0)
+            generate = true;
+        else
+            args.push_back(argv[i]);
+    }
+
+    // two vertices a line, and vertex indices are 16 bit
+    if(lineCount == 0 || lineCount > 0x7fff || queryCount == 0 || args.size() == 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+    checkCount = std::min(checkCount, queryCount);
+
+    DEUtil::MapData map;
+    DEUtil::WadArchive archive;
+    if(args.empty())
+    {
+        BuildRandomMap(map, lineCount);
+    }
+    else
+    {
+        for(usize i = 1; i < args.size(); i++)
+        {
+            if(!archive.AddFile(args[i]))
+                return 1;
+        }
+
+        if(!DEUtil::LoadMap(archive, args[0], map))
+            return 1;
+    }
+
+    if(map.vertices.empty())
+    {
+        LERROR("the map has no vertices.\n");
+        return 1;
+    }
+
+    DEUtil::Blockmap blockmap;
+    bool fromLump = !generate && !map.blockmap.empty();
+    auto start = std::chrono::steady_clock::now();
+    if(generate)
+        blockmap.Generate(map);
+    else
+        blockmap.Build(map);
+    f64 buildMs = MsSince(start);
+
+    // queries start anywhere in the map's bounds and a bit outside them
+    glm::vec2 boundsMin = glm::vec2(INFINITY), boundsMax = glm::vec2(-INFINITY);
+    for(const MapVertex &vertex : map.vertices)
+    {
+        boundsMin = glm::min(boundsMin, glm::vec2(vertex.x, vertex.y));
+        boundsMax = glm::max(boundsMax, glm::vec2(vertex.x, vertex.y));
+    }
+    boundsMin = boundsMin - glm::vec2(64.0f);
+    boundsMax = boundsMax + glm::vec2(64.0f);
+
+    u32 random = 0x6a09e667;
+    auto randomPoint = [&]() {
+        return glm::vec2(boundsMin.x + RandomUnit(random) * (boundsMax.x - boundsMin.x),
+                         boundsMin.y + RandomUnit(random) * (boundsMax.y - boundsMin.y));
+    };
+
+    // rays: from, to, and every other one is a movement ray that ML_BLOCKING lines stop too
+    std::vector<glm::vec4> rays(queryCount);
+    for(glm::vec4 &ray : rays)
+    {
+        glm::vec2 from = randomPoint();
+        f32 angle = RandomUnit(random) * 2.0f * (f32)M_PI;
+        f32 length = RandomUnit(random) * BENCH_RAY_LENGTH;
+        ray = glm::vec4(from.x, from.y, from.x + std::cos(angle) * length, from.y + std::sin(angle) * length);
+    }
+
+    DEUtil::BlockmapQuery query;
+    DEUtil::BlockmapHit hit;
+    u64 hits = 0;
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < queryCount; i++)
+    {
+        const glm::vec4 &ray = rays[i];
+        hits += blockmap.TraceLine(map, glm::vec2(ray.x, ray.y), glm::vec2(ray.z, ray.w), i & 1 ? ML_BLOCKING : 0,
+                                   query, hit);
+    }
+    f64 traceMs = MsSince(start);
+
+    std::vector<DEUtil::BlockmapHit> references(checkCount);
+    std::vector<u8> referenceHits(checkCount);
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < checkCount; i++)
+    {
+        const glm::vec4 &ray = rays[i];
+        referenceHits[i] = ReferenceTrace(map, blockmap.GetOrigin(), glm::vec2(ray.x, ray.y), glm::vec2(ray.z, ray.w),
+                                          i & 1 ? ML_BLOCKING : 0, references[i]);
+    }
+    f64 traceScanMs = MsSince(start);
+
+    for(u32 i = 0; i < checkCount; i++)
+    {
+        const glm::vec4 &ray = rays[i];
+        glm::vec2 from = glm::vec2(ray.x, ray.y), to = glm::vec2(ray.z, ray.w);
+        const DEUtil::BlockmapHit &reference = references[i];
+        bool referenceHit = referenceHits[i];
+        bool blockmapHit = blockmap.TraceLine(map, from, to, i & 1 ? ML_BLOCKING : 0, query, hit);
+
+        bool same = blockmapHit == referenceHit;
+        if(same && blockmapHit)
+        {
+            // two lines crossed at the same spot (a shared vertex) can come back in either order
+            same = hit.fraction == reference.fraction;
+        }
+
+        if(!same)
+        {
+            LERROR("ray " << i << " from (" << from.x << ", " << from.y << ") to (" << to.x << ", " << to.y
+                          << ") hit " << (blockmapHit ? (i32)hit.linedef : -1) << " at " << hit.fraction
+                          << ", the scan hit " << (referenceHit ? (i32)reference.linedef : -1) << " at "
+                          << reference.fraction << ".\n");
+            return 1;
+        }
+    }
+
+    // boxes: the lines a thing of BENCH_THING_RADIUS at a random spot could touch
+    u64 boxLines = 0;
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < queryCount; i++)
+    {
+        glm::vec2 center = glm::vec2(rays[i].x, rays[i].y);
+        blockmap.LinesInBox(map, center - glm::vec2(BENCH_THING_RADIUS), center + glm::vec2(BENCH_THING_RADIUS),
+                            query);
+        boxLines += query.lines.size();
+    }
+    f64 boxMs = MsSince(start);
+
+    u64 crossing = 0;
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < checkCount; i++)
+    {
+        glm::vec2 center = glm::vec2(rays[i].x, rays[i].y);
+        glm::vec2 boxMin = center - glm::vec2(BENCH_THING_RADIUS), boxMax = center + glm::vec2(BENCH_THING_RADIUS);
+        for(const MapLinedef &line : map.linedefs)
+            crossing += LineCrossesBox(map, line, boxMin, boxMax);
+    }
+    f64 boxScanMs = MsSince(start);
+
+    std::vector<u8> listed(map.linedefs.size());
+    for(u32 i = 0; i < checkCount; i++)
+    {
+        glm::vec2 center = glm::vec2(rays[i].x, rays[i].y);
+        glm::vec2 boxMin = center - glm::vec2(BENCH_THING_RADIUS), boxMax = center + glm::vec2(BENCH_THING_RADIUS);
+        blockmap.LinesInBox(map, boxMin, boxMax, query);
+
+        std::fill(listed.begin(), listed.end(), 0);
+        for(u16 line : query.lines)
+        {
+            if(listed[line]++)
+            {
+                LERROR("box " << i << " lists line " << line << " twice.\n");
+                return 1;
+            }
+        }
+
+        for(u32 l = 0; l < map.linedefs.size(); l++)
+        {
+            if(LineCrossesBox(map, map.linedefs[l], boxMin, boxMax) && !listed[l])
+            {
+                LERROR("box " << i << " around (" << center.x << ", " << center.y << ") misses line " << l << ".\n");
+                return 1;
+            }
+        }
+    }
+
+    // things: one for every 4 blocks, moved to a new spot after every look at a block
+    u32 thingCount = std::max<u32>(blockmap.GetColumns() * blockmap.GetRows() / 4, 64);
+    std::vector<glm::vec2> things(thingCount);
+    blockmap.ResetThings(thingCount);
+    for(u32 id = 0; id < thingCount; id++)
+    {
+        things[id] = randomPoint();
+        blockmap.LinkThing(id, things[id]);
+    }
+
+    u64 cellThings = 0;
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < queryCount; i++)
+    {
+        glm::ivec2 cell;
+        if(blockmap.GetCell(glm::vec2(rays[i].x, rays[i].y), cell))
+        {
+            for(i32 id = blockmap.FirstThing(cell); id != BLOCKMAP_NO_THING; id = blockmap.NextThing(id))
+                cellThings++;
+        }
+
+        u32 id = i % thingCount;
+        things[id] = glm::vec2(rays[i].z, rays[i].w);
+        blockmap.LinkThing(id, things[id]);
+    }
+    f64 cellMs = MsSince(start);
+
+    std::vector<u8> inCell(thingCount);
+    for(u32 i = 0; i < checkCount; i++)
+    {
+        glm::ivec2 cell;
+        if(!blockmap.GetCell(glm::vec2(rays[i].x, rays[i].y), cell))
+            continue;
+
+        std::fill(inCell.begin(), inCell.end(), 0);
+        for(i32 id = blockmap.FirstThing(cell); id != BLOCKMAP_NO_THING; id = blockmap.NextThing(id))
+            inCell[id]++;
+
+        for(u32 id = 0; id < thingCount; id++)
+        {
+            glm::ivec2 thingCell;
+            bool expected = blockmap.GetCell(things[id], thingCell) && thingCell.x == cell.x && thingCell.y == cell.y;
+            if(inCell[id] != (u8)expected)
+            {
+                LERROR("block (" << cell.x << ", " << cell.y << ") lists thing " << id << " " << (u32)inCell[id]
+                                 << " times, it's " << (expected ? "in" : "not in") << " the block.\n");
+                return 1;
+            }
+        }
+
+        u32 id = i % thingCount;
+        things[id] = randomPoint();
+        blockmap.LinkThing(id, things[id]);
+    }
+
+    printf("%u linedefs, %ux%u blocks (%s, %.2f ms), %u queries of each kind, %u checked against the scan\n",
+           (u32)map.linedefs.size(), blockmap.GetColumns(), blockmap.GetRows(),
+           fromLump ? "from the lump" : "generated", buildMs, queryCount, checkCount);
+    printf("trace line    %8.1f ns per ray, %.1f%% hit   scan %10.1f ns per ray\n", traceMs * 1e6 / queryCount,
+           100.0 * hits / queryCount, traceScanMs * 1e6 / checkCount);
+    printf("lines in box  %8.1f ns per box, %.1f lines listed   scan %10.1f ns per box, %.1f lines crossing\n",
+           boxMs * 1e6 / queryCount, (f64)boxLines / queryCount, boxScanMs * 1e6 / checkCount,
+           (f64)crossing / checkCount);
+    printf("block things  %8.1f ns per look and relink, %.2f things a block\n", cellMs * 1e6 / queryCount,
+           (f64)cellThings / queryCount);
+    return 0;
+}
@@ -0,0 +1,478 @@
+// ---------------------- BSP BENCH ----------------------
+// times TraverseBsp() from -views random view points and angles, with no renderer around it.
+// without wads it writes a procedural map first: a -grid by -grid field of square sectors
+// with random heights and a balanced bsp over them, put through LoadMap() like any other map.
+// prints the time per view next to a brute force box test of every subsector and checks
+// that every walk starts in the view's subsector, lists no subsector twice and keeps every
+// subsector whose own box is in the frustum.
+//
+// usage: DOOMBspBench [-grid <n>] [-views <n>] [-wad <path>] [<map> <file.wad>...]
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <wad/bsp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define BENCH_CELL_SIZE 64  // map units per sector of the procedural map
+#define BENCH_MAX_GRID  128 // subsectors' u16 first seg runs out past 128 * 128 cells of 4 segs
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMBspBench [-grid <n>] [-views <n>] [-wad <path>] [<map> <file.wad>...]\n"
+                 "\t-grid   sectors along each side of the procedural map, 128 (the most) by default\n"
+                 "\t-views  random view points walked, 100000 by default\n"
+                 "\t-wad    where the procedural map is written, DOOMBspBench.wad by default\n"
+                 "\twith a map and wads that map is walked instead, later wads override earlier ones\n");
+}
+
+// xorshift32, the same map and views every run
+static u32 NextRandom(u32 &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static f32 RandomUnit(u32 &state)
+{
+    return (NextRandom(state) >> 8) * (1.0f / (1 << 24));
+}
+
+#pragma region ProceduralMap
+
+struct GridMap
+{
+    u32 size;
+    std::vector<MapThing> things;
+    std::vector<MapLinedef> linedefs;
+    std::vector<MapSidedef> sidedefs;
+    std::vector<MapVertex> vertices;
+    std::vector<MapSeg> segs;
+    std::vector<MapSubsector> subsectors;
+    std::vector<MapNode> nodes;
+    std::vector<MapSector> sectors;
+
+    // linedef of each cell edge, by the cell below / left of it
+    std::vector<u16> horizontal, vertical;
+};
+
+static inline i16 GridCoord(const GridMap &map, u32 i)
+{
+    return (i16)(((i32)i - (i32)map.size / 2) * BENCH_CELL_SIZE);
+}
+
+static inline u16 GridVertex(const GridMap &map, u32 x, u32 y)
+{
+    return (u16)(y * (map.size + 1) + x);
+}
+
+// a line with cell `front` on its right. cells are -1 outside the grid, one sided lines are
+// turned around so the cell they have is in front
+static u16 AddGridLine(GridMap &map, u16 v1, u16 v2, i32 front, i32 back)
+{
+    if(front < 0)
+    {
+        std::swap(v1, v2);
+        std::swap(front, back);
+    }
+
+    MapLinedef line{};
+    line.v1 = v1;
+    line.v2 = v2;
+    line.flags = back < 0 ? ML_BLOCKING : ML_TWOSIDED;
+    // every side of a cell shares the cell's sidedef
+    line.sides[0] = (u16)front;
+    line.sides[1] = back < 0 ? MAP_NO_SIDEDEF : (u16)back;
+
+    map.linedefs.push_back(line);
+    return (u16)(map.linedefs.size() - 1);
+}
+
+// a seg along linedef `line` with `cell` on its right
+static void AddGridSeg(GridMap &map, u16 line, u32 cell)
+{
+    const MapLinedef &linedef = map.linedefs[line];
+    MapSeg seg{};
+    seg.linedef = line;
+    seg.side = linedef.sides[0] == cell ? 0 : 1;
+    seg.v1 = seg.side == 0 ? linedef.v1 : linedef.v2;
+    seg.v2 = seg.side == 0 ? linedef.v2 : linedef.v1;
+
+    const MapVertex &a = map.vertices[seg.v1], &b = map.vertices[seg.v2];
+    seg.angle = (i16)(i32)std::lround(std::atan2((f64)b.y - a.y, (f64)b.x - a.x) / (2.0 * M_PI) * 65536.0);
+    map.segs.push_back(seg);
+}
+
+// cells [x0, x1) x [y0, y1), split in half along the longer side. children are added before
+// their parent, so the root is the last node
+static u16 AddGridNodes(GridMap &map, u32 x0, u32 y0, u32 x1, u32 y1)
+{
+    if(x1 - x0 == 1 && y1 - y0 == 1)
+        return (u16)((y0 * map.size + x0) | NF_SUBSECTOR);
+
+    MapNode node{};
+    u32 rects[2][4]; // per child: x0, y0, x1, y1
+    if(x1 - x0 >= y1 - y0)
+    {
+        // pointing up, so the right (front) side is the one with the bigger x
+        u32 mid = (x0 + x1) / 2;
+        node.x = GridCoord(map, mid);
+        node.y = GridCoord(map, y0);
+        node.dy = (i16)((y1 - y0) * BENCH_CELL_SIZE);
+        u32 front[4] = {mid, y0, x1, y1}, back[4] = {x0, y0, mid, y1};
+        memcpy(rects[0], front, sizeof(front));
+        memcpy(rects[1], back, sizeof(back));
+    }
+    else
+    {
+        // pointing right, so the front side is the one below
+        u32 mid = (y0 + y1) / 2;
+        node.x = GridCoord(map, x0);
+        node.y = GridCoord(map, mid);
+        node.dx = (i16)((x1 - x0) * BENCH_CELL_SIZE);
+        u32 front[4] = {x0, y0, x1, mid}, back[4] = {x0, mid, x1, y1};
+        memcpy(rects[0], front, sizeof(front));
+        memcpy(rects[1], back, sizeof(back));
+    }
+
+    for(u32 child = 0; child < 2; child++)
+    {
+        const u32 *rect = rects[child];
+        node.bbox[child][(u32)BoxSide::LEFT] = GridCoord(map, rect[0]);
+        node.bbox[child][(u32)BoxSide::BOTTOM] = GridCoord(map, rect[1]);
+        node.bbox[child][(u32)BoxSide::RIGHT] = GridCoord(map, rect[2]);
+        node.bbox[child][(u32)BoxSide::TOP] = GridCoord(map, rect[3]);
+        node.children[child] = AddGridNodes(map, rect[0], rect[1], rect[2], rect[3]);
+    }
+
+    map.nodes.push_back(node);
+    return (u16)(map.nodes.size() - 1);
+}
+
+static void BuildGridMap(GridMap &map, u32 size)
+{
+    map.size = size;
+    u32 random = 0x2545f491;
+
+    for(u32 y = 0; y <= size; y++)
+    {
+        for(u32 x = 0; x <= size; x++)
+            map.vertices.push_back(MapVertex{GridCoord(map, x), GridCoord(map, y)});
+    }
+
+    for(u32 cell = 0; cell < size * size; cell++)
+    {
+        MapSector sector{};
+        sector.floorHeight = (i16)(NextRandom(random) % 8 * 8);
+        sector.ceilingHeight = (i16)(sector.floorHeight + 128 + NextRandom(random) % 8 * 16);
+        memcpy(sector.floorFlat, "FLOOR4_8", WAD_NAME_LENGTH);
+        memcpy(sector.ceilingFlat, "CEIL3_5", 7);
+        sector.light = 160;
+        map.sectors.push_back(sector);
+
+        MapSidedef side{};
+        memcpy(side.middleTexture, "STARTAN3", WAD_NAME_LENGTH);
+        side.upperTexture[0] = side.lowerTexture[0] = '-';
+        side.sector = (u16)cell;
+        map.sidedefs.push_back(side);
+    }
+
+    auto cellAt = [size](i32 x, i32 y) {
+        return x < 0 || y < 0 || x >= (i32)size || y >= (i32)size ? -1 : y * (i32)size + x;
+    };
+
+    // left to right along y, the cell below is on the right
+    map.horizontal.resize((size + 1) * size);
+    for(u32 y = 0; y <= size; y++)
+    {
+        for(u32 x = 0; x < size; x++)
+            map.horizontal[y * size + x] = AddGridLine(map, GridVertex(map, x, y), GridVertex(map, x + 1, y),
+                                                       cellAt(x, (i32)y - 1), cellAt(x, y));
+    }
+
+    // bottom to top along x, the cell to the right is on the right
+    map.vertical.resize((size + 1) * size);
+    for(u32 x = 0; x <= size; x++)
+    {
+        for(u32 y = 0; y < size; y++)
+            map.vertical[x * size + y] = AddGridLine(map, GridVertex(map, x, y), GridVertex(map, x, y + 1),
+                                                     cellAt(x, y), cellAt((i32)x - 1, y));
+    }
+
+    for(u32 y = 0; y < size; y++)
+    {
+        for(u32 x = 0; x < size; x++)
+        {
+            u32 cell = y * size + x;
+            map.subsectors.push_back(MapSubsector{4, (u16)map.segs.size()});
+            AddGridSeg(map, map.horizontal[y * size + x], cell);
+            AddGridSeg(map, map.vertical[(x + 1) * size + y], cell);
+            AddGridSeg(map, map.horizontal[(y + 1) * size + x], cell);
+            AddGridSeg(map, map.vertical[x * size + y], cell);
+        }
+    }
+
+    AddGridNodes(map, 0, 0, size, size);
+
+    MapThing start{};
+    start.x = (i16)(BENCH_CELL_SIZE / 2);
+    start.y = (i16)(BENCH_CELL_SIZE / 2);
+    start.type = 1;
+    start.flags = 7;
+    map.things.push_back(start);
+}
+
+template<typename T>
+static void AddLump(std::vector<u8> &out, std::vector<WadDirEntry> &directory, const char *name,
+                    const std::vector<T> &data)
+{
+    WadDirEntry entry{};
+    entry.offset = (i32)out.size();
+    entry.size = (i32)(data.size() * sizeof(T));
+    memcpy(entry.name, name, std::min<usize>(strlen(name), WAD_NAME_LENGTH));
+    directory.push_back(entry);
+
+    const u8 *bytes = (const u8 *)data.data();
+    out.insert(out.end(), bytes, bytes + entry.size);
+}
+
+// a pwad with MAP01 and its lumps in LoadMap()'s order
+static bool WriteGridWad(const GridMap &map, const std::string &path)
+{
+    std::vector<u8> out(sizeof(WadHeader));
+    std::vector<WadDirEntry> directory;
+    AddLump(out, directory, "MAP01", std::vector<u8>());
+    AddLump(out, directory, "THINGS", map.things);
+    AddLump(out, directory, "LINEDEFS", map.linedefs);
+    AddLump(out, directory, "SIDEDEFS", map.sidedefs);
+    AddLump(out, directory, "VERTEXES", map.vertices);
+    AddLump(out, directory, "SEGS", map.segs);
+    AddLump(out, directory, "SSECTORS", map.subsectors);
+    AddLump(out, directory, "NODES", map.nodes);
+    AddLump(out, directory, "SECTORS", map.sectors);
+    AddLump(out, directory, "REJECT", std::vector<u8>());
+
+    WadHeader header{WAD_PWAD_MAGIC, (i32)directory.size(), (i32)out.size()};
+    memcpy(out.data(), &header, sizeof(header));
+    const u8 *entries = (const u8 *)directory.data();
+    out.insert(out.end(), entries, entries + directory.size() * sizeof(WadDirEntry));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char *)out.data(), (std::streamsize)out.size());
+    if(!file)
+    {
+        LERROR("couldn't write " << path << "\n");
+        return false;
+    }
+
+    return true;
+}
+
+#pragma endregion
+
+// 90 degree fov, the left, right and near planes through the eye like the software renderer's
+static DEUtil::Frustum ViewFrustum(glm::vec2 pos, f32 angle)
+{
+    glm::vec2 forward = glm::vec2(std::cos(angle), std::sin(angle));
+    glm::vec2 right = glm::vec2(forward.y, -forward.x);
+    glm::vec2 leftNormal = forward + right;
+    glm::vec2 rightNormal = forward - right;
+
+    DEUtil::Frustum frustum;
+    frustum.planes[0] = glm::vec4(leftNormal.x, leftNormal.y, 0.0f, -glm::dot(leftNormal, pos));
+    frustum.planes[1] = glm::vec4(rightNormal.x, rightNormal.y, 0.0f, -glm::dot(rightNormal, pos));
+    frustum.planes[2] = glm::vec4(forward.x, forward.y, 0.0f, -glm::dot(forward, pos));
+    frustum.planes[3] = frustum.planes[4] = frustum.planes[5] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return frustum;
+}
+
+// xy boxes of every subsector's segs, what the node boxes above them have to contain
+static void SubsectorBoxes(const DEUtil::MapData &map, std::vector<glm::vec4> &boxes)
+{
+    boxes.assign(map.subsectors.size(), glm::vec4(INFINITY, INFINITY, -INFINITY, -INFINITY));
+    for(u32 i = 0; i < map.subsectors.size(); i++)
+    {
+        const MapSubsector &subsector = map.subsectors[i];
+        for(u32 s = subsector.firstSeg; s < (u32)subsector.firstSeg + subsector.segCount; s++)
+        {
+            for(u16 v : {map.segs[s].v1, map.segs[s].v2})
+            {
+                glm::vec2 p = glm::vec2(map.vertices[v].x, map.vertices[v].y);
+                glm::vec2 boxMin = glm::min(glm::vec2(boxes[i].x, boxes[i].y), p);
+                glm::vec2 boxMax = glm::max(glm::vec2(boxes[i].z, boxes[i].w), p);
+                boxes[i] = glm::vec4(boxMin, boxMax);
+            }
+        }
+    }
+}
+
+static bool VerifyWalk(const DEUtil::MapData &map, const std::vector<glm::vec4> &boxes, glm::vec2 pos,
+                       const DEUtil::Frustum &frustum, glm::vec2 heightRange, const DEUtil::BspVisibility &visibility,
+                       std::vector<u8> &seen)
+{
+    if(visibility.subsectors.empty() || visibility.subsectors[0] != DEUtil::PointInSubsector(map, pos))
+    {
+        LERROR("the walk from (" << pos.x << ", " << pos.y << ") doesn't start in the view's subsector.\n");
+        return false;
+    }
+
+    seen.assign(map.subsectors.size(), 0);
+    for(u16 subsector : visibility.subsectors)
+    {
+        if(seen[subsector]++)
+        {
+            LERROR("subsector " << subsector << " is listed twice.\n");
+            return false;
+        }
+    }
+
+    for(u32 i = 0; i < map.subsectors.size(); i++)
+    {
+        glm::vec3 boxMin = glm::vec3(boxes[i].x, boxes[i].y, heightRange.x);
+        glm::vec3 boxMax = glm::vec3(boxes[i].z, boxes[i].w, heightRange.y);
+        if(!seen[i] && DEUtil::BoxInFrustum(frustum, boxMin, boxMax))
+        {
+            LERROR("subsector " << i << " is in the frustum from (" << pos.x << ", " << pos.y
+                                << ") but the walk dropped it.\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    u32 gridSize = BENCH_MAX_GRID;
+    u32 viewCount = 100000;
+    std::string gridWad = "DOOMBspBench.wad";
+    std::vector<const char *> args;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-grid") == 0 && i + 1 < argc)
+            gridSize = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-views") == 0 && i + 1 < argc)
+            viewCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-wad") == 0 && i + 1 < argc)
+            gridWad = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+
+    if(gridSize < 2 || gridSize > BENCH_MAX_GRID || viewCount == 0 || args.size() == 1)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char *mapName = "MAP01";
+    std::vector<const char *> wads;
+    if(args.empty())
+    {
+        GridMap grid;
+        BuildGridMap(grid, gridSize);
+        if(!WriteGridWad(grid, gridWad))
+            return 1;
+        wads.push_back(gridWad.c_str());
+    }
+    else
+    {
+        mapName = args[0];
+        wads.assign(args.begin() + 1, args.end());
+    }
+
+    DEUtil::WadArchive archive;
+    for(const char *wad : wads)
+    {
+        if(!archive.AddFile(wad))
+            return 1;
+    }
+
+    DEUtil::MapData map;
+    if(!DEUtil::LoadMap(archive, mapName, map))
+        return 1;
+
+    glm::vec2 heightRange = DEUtil::GetMapHeightRange(map);
+    std::vector<glm::vec4> boxes;
+    SubsectorBoxes(map, boxes);
+
+    // views anywhere inside the map's bounds
+    glm::vec2 boundsMin = glm::vec2(INFINITY), boundsMax = glm::vec2(-INFINITY);
+    for(const MapVertex &vertex : map.vertices)
+    {
+        boundsMin = glm::min(boundsMin, glm::vec2(vertex.x, vertex.y));
+        boundsMax = glm::max(boundsMax, glm::vec2(vertex.x, vertex.y));
+    }
+
+    u32 random = 0x6a09e667;
+    std::vector<glm::vec3> views(viewCount); // x, y, angle
+    for(glm::vec3 &view : views)
+    {
+        view = glm::vec3(boundsMin.x + RandomUnit(random) * (boundsMax.x - boundsMin.x),
+                         boundsMin.y + RandomUnit(random) * (boundsMax.y - boundsMin.y),
+                         RandomUnit(random) * 2.0f * (f32)M_PI);
+    }
+
+    DEUtil::BspVisibility visibility;
+    std::vector<u32> visible(viewCount);
+    f64 worstMs = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < viewCount; i++)
+    {
+        auto viewStart = std::chrono::steady_clock::now();
+        glm::vec2 pos = glm::vec2(views[i].x, views[i].y);
+        DEUtil::TraverseBsp(map, pos, ViewFrustum(pos, views[i].z), heightRange, visibility);
+        f64 viewMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - viewStart).count();
+        worstMs = std::max(worstMs, viewMs);
+        visible[i] = (u32)visibility.subsectors.size();
+    }
+    f64 walkMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // the brute force test is linear in the subsectors, so a share of the views says enough
+    u32 bruteViews = std::min<u32>(viewCount, 2000);
+    u64 bruteVisible = 0, walkVisible = 0;
+    start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < bruteViews; i++)
+    {
+        walkVisible += visible[i];
+        DEUtil::Frustum frustum = ViewFrustum(glm::vec2(views[i].x, views[i].y), views[i].z);
+        for(const glm::vec4 &box : boxes)
+        {
+            bruteVisible += DEUtil::BoxInFrustum(frustum, glm::vec3(box.x, box.y, heightRange.x),
+                                                 glm::vec3(box.z, box.w, heightRange.y));
+        }
+    }
+    f64 bruteMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<u8> seen;
+    for(const glm::vec3 &view : views)
+    {
+        glm::vec2 pos = glm::vec2(view.x, view.y);
+        DEUtil::Frustum frustum = ViewFrustum(pos, view.z);
+        DEUtil::TraverseBsp(map, pos, frustum, heightRange, visibility);
+        if(!VerifyWalk(map, boxes, pos, frustum, heightRange, visibility, seen))
+            return 1;
+    }
+
+    printf("%s: %u nodes, %u subsectors, %u sectors, %u views\n", mapName, (u32)map.nodes.size(),
+           (u32)map.subsectors.size(), (u32)map.sectors.size(), viewCount);
+    printf("bsp walk     %8.2f us per view, worst %.2f us\n", walkMs * 1000.0 / viewCount, worstMs * 1000.0);
+    printf("brute force  %8.2f us per view, every subsector's box tested (for reference)\n",
+           bruteMs * 1000.0 / bruteViews);
+    printf("over the first %u views the walk kept %.1f subsectors a view, %.1f boxes are in the frustum\n", bruteViews,
+           (f64)walkVisible / bruteViews, (f64)bruteVisible / bruteViews);
+    return 0;
+}
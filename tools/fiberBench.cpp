@@ -0,0 +1,410 @@
+// ---------------------- FIBER BENCH ----------------------
+// what the job system's fiber mode costs and buys:
+//   switch:  ns per Fiber::Switch() between two fibers, next to posix swapcontext()
+//   fib:     the job bench's fibonacci fan-out with plain jobs and with fibers, where every
+//            Wait() parks its fiber instead of helping
+//   loads:   an asset load example. load jobs ask an io thread for a chunk of a file, wait on
+//            it and checksum what came back while compute jobs keep the workers busy. with
+//            fibers a waiting load parks and its thread runs compute jobs, with plain jobs it
+//            spins in Wait() whenever there's nothing to help with. -latency adds a sleep per
+//            read like a slow disk would.
+//
+// without files the loads read a temporary file of -loads x 256kb.
+//
+// usage: DOOMFiberBench [-threads <n>] [-switches <n>] [-fib <n>] [-loads <n>] [-latency <us>] [file]...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <core/fiber.h>
+#include <core/jobs.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef IPLATFORM_WINDOWS
+    #include <ucontext.h>
+#endif
+
+#define BENCH_CHUNK_SIZE    (256 * 1024)
+#define BENCH_COMPUTE_JOBS  512
+#define BENCH_COMPUTE_ITERS 200000
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMFiberBench [-threads <n>] [-switches <n>] [-fib <n>] [-loads <n>] [-latency <us>] "
+                 "[file]...\n"
+                 "\t-threads   job system threads, every hardware thread by default\n"
+                 "\t-switches  fiber switches timed, 1000000 by default\n"
+                 "\t-fib       fibonacci number the fan-out computes, 22 by default\n"
+                 "\t-loads     chunks loaded, 64 by default\n"
+                 "\t-latency   extra microseconds per read, 1000 by default\n"
+                 "\tfiles are read in 256kb chunks, a temporary file is used without any\n");
+}
+
+static f64 MillisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+#pragma region Switch
+
+struct PingPong
+{
+    DEUtil::Fiber main, other;
+    u32 switches;
+};
+
+static void PingPongMain(void *arg)
+{
+    PingPong *pingPong = (PingPong *)arg;
+    while(true)
+        DEUtil::Fiber::Switch(pingPong->other, pingPong->main);
+}
+
+// ns per switch, each round trip is two
+static f64 TimeFiberSwitch(u32 switches)
+{
+    PingPong pingPong;
+    pingPong.switches = switches;
+    if(!pingPong.other.Create(&PingPongMain, &pingPong, 64 * 1024))
+        return 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < switches / 2; i++)
+        DEUtil::Fiber::Switch(pingPong.main, pingPong.other);
+    return MillisecondsSince(start) * 1e6 / switches;
+}
+
+#ifndef IPLATFORM_WINDOWS
+
+static ucontext_t contextMain, contextOther;
+
+static void UContextPingPong()
+{
+    while(true)
+        swapcontext(&contextOther, &contextMain);
+}
+
+static f64 TimeUContextSwitch(u32 switches)
+{
+    std::vector<u8> stack(64 * 1024);
+    getcontext(&contextOther);
+    contextOther.uc_stack.ss_sp = stack.data();
+    contextOther.uc_stack.ss_size = stack.size();
+    contextOther.uc_link = nullptr;
+    makecontext(&contextOther, &UContextPingPong, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < switches / 2; i++)
+        swapcontext(&contextMain, &contextOther);
+    return MillisecondsSince(start) * 1e6 / switches;
+}
+
+#endif
+
+#pragma endregion
+
+#pragma region Fib
+
+static void Fib(DEUtil::JobSystem *jobs, u32 n, u64 *result)
+{
+    if(n < 2)
+    {
+        *result = n;
+        return;
+    }
+
+    u64 a, b;
+    DEUtil::JobCounter counter;
+    jobs->Run(&counter, [jobs, n, &a]() { Fib(jobs, n - 1, &a); });
+    Fib(jobs, n - 2, &b);
+    jobs->Wait(&counter);
+    *result = a + b;
+}
+
+#pragma endregion
+
+#pragma region Loads
+
+struct ReadRequest
+{
+    const std::string *path;
+    u64 offset;
+    u32 size;
+    u8 *out;
+    u32 *read;
+    DEUtil::JobCounter *done;
+};
+
+// a blocking reader thread, it stands in for the disk
+class IoThread
+{
+    private:
+    DEUtil::JobSystem *jobs;
+    u32 latencyUs;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<ReadRequest> requests;
+    bool quit;
+
+    void Loop()
+    {
+        while(true)
+        {
+            ReadRequest request;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || !requests.empty(); });
+                if(requests.empty())
+                    return;
+
+                request = requests.front();
+                requests.pop_front();
+            }
+
+            if(latencyUs > 0)
+                std::this_thread::sleep_for(std::chrono::microseconds(latencyUs));
+
+            std::ifstream file(*request.path, std::ios::binary);
+            file.seekg((std::streamoff)request.offset);
+            file.read((char *)request.out, request.size);
+            *request.read = file ? request.size : (u32)file.gcount();
+
+            // wakes the load that's waiting on it, on whichever worker is free
+            jobs->Signal(request.done);
+        }
+    }
+
+    public:
+    IoThread(DEUtil::JobSystem *jobs, u32 latencyUs) : jobs{jobs}, latencyUs{latencyUs}, quit{false}
+    {
+        thread = std::thread(&IoThread::Loop, this);
+    }
+
+    void Read(const ReadRequest &request)
+    {
+        jobs->Expect(request.done, 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.push_back(request);
+        }
+        wake.notify_one();
+    }
+
+    ~IoThread()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+};
+
+struct LoadChunk
+{
+    const std::string *path;
+    u64 offset;
+    u32 size;
+    u64 hash;
+};
+
+struct LoadContext
+{
+    DEUtil::JobSystem *jobs;
+    IoThread *io;
+    std::vector<LoadChunk> *chunks;
+    std::atomic<u64> computeSum;
+};
+
+// the asset load: read, wait for the io without holding the thread, then decode
+static void LoadChunkJob(LoadContext *context, u32 index)
+{
+    LoadChunk &chunk = (*context->chunks)[index];
+    std::vector<u8> buffer(chunk.size);
+    u32 read = 0;
+
+    DEUtil::JobCounter done;
+    context->io->Read({chunk.path, chunk.offset, chunk.size, buffer.data(), &read, &done});
+    context->jobs->Wait(&done);
+
+    // fnv-1a stands in for decoding
+    u64 hash = 0xcbf29ce484222325ull;
+    for(u32 i = 0; i < read; i++)
+        hash = (hash ^ buffer[i]) * 0x100000001b3ull;
+    chunk.hash = hash;
+}
+
+static void ComputeJob(LoadContext *context, u32 index)
+{
+    u64 x = index + 1;
+    for(u32 i = 0; i < BENCH_COMPUTE_ITERS; i++)
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+    context->computeSum.fetch_add(x >> 32, std::memory_order_relaxed);
+}
+
+// loads and compute jobs together, returns the ms until both are done
+static f64 RunLoads(DEUtil::JobSystem &jobs, std::vector<LoadChunk> &chunks, u32 latencyUs, u64 &hash)
+{
+    IoThread io(&jobs, latencyUs);
+    LoadContext context{&jobs, &io, &chunks, {0}};
+    LoadContext *contextPtr = &context;
+
+    auto start = std::chrono::steady_clock::now();
+    DEUtil::JobCounter counter;
+    for(u32 i = 0; i < (u32)chunks.size(); i++)
+        jobs.Run(&counter, [contextPtr, i]() { LoadChunkJob(contextPtr, i); });
+    for(u32 i = 0; i < BENCH_COMPUTE_JOBS; i++)
+        jobs.Run(&counter, [contextPtr, i]() { ComputeJob(contextPtr, i); });
+    jobs.Wait(&counter);
+    f64 ms = MillisecondsSince(start);
+
+    hash = 0;
+    for(const LoadChunk &chunk : chunks)
+        hash ^= chunk.hash;
+    return ms;
+}
+
+// a file of count chunks with bytes that depend on their offset
+static bool WriteTemporaryFile(const std::string &path, u32 count)
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+    {
+        LERROR("couldn't create " << path << "\n");
+        return false;
+    }
+
+    std::vector<u8> chunk(BENCH_CHUNK_SIZE);
+    for(u32 c = 0; c < count; c++)
+    {
+        for(u32 i = 0; i < BENCH_CHUNK_SIZE; i++)
+            chunk[i] = (u8)((c * 131 + i * 7) ^ (i >> 9));
+        file.write((const char *)chunk.data(), chunk.size());
+    }
+
+    return (bool)file;
+}
+
+#pragma endregion
+
+int main(int argc, char **argv)
+{
+    u32 threadCount = std::max(1u, std::thread::hardware_concurrency());
+    u32 switches = 1000000;
+    u32 fib = 22;
+    u32 loads = 64;
+    u32 latencyUs = 1000;
+    std::vector<std::string> files;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threadCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-switches") == 0 && i + 1 < argc)
+            switches = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-fib") == 0 && i + 1 < argc)
+            fib = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-loads") == 0 && i + 1 < argc)
+            loads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-latency") == 0 && i + 1 < argc)
+            latencyUs = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(argv[i][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    if(threadCount == 0 || switches < 2 || fib > 32 || loads == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // switch cost
+    f64 fiberNs = TimeFiberSwitch(switches);
+#ifndef IPLATFORM_WINDOWS
+    f64 ucontextNs = TimeUContextSwitch(switches);
+    LINFO(false, "switch: " << fiberNs << " ns per Fiber::Switch(), " << ucontextNs << " ns per swapcontext()\n");
+#else
+    LINFO(false, "switch: " << fiberNs << " ns per Fiber::Switch()\n");
+#endif
+
+    // the chunks to load, from the files or a temporary one
+    std::string temporary;
+    if(files.empty())
+    {
+        temporary = "DOOMFiberBench.tmp";
+        if(!WriteTemporaryFile(temporary, loads))
+            return 1;
+        files.push_back(temporary);
+    }
+
+    std::vector<LoadChunk> chunks;
+    for(u32 i = 0; i < loads; i++)
+    {
+        const std::string &path = files[i % files.size()];
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(!file)
+        {
+            LERROR("couldn't open " << path << "\n");
+            return 1;
+        }
+
+        u64 size = (u64)file.tellg();
+        u64 chunkCount = std::max<u64>(1, (size + BENCH_CHUNK_SIZE - 1) / BENCH_CHUNK_SIZE);
+        u64 offset = (i / files.size()) % chunkCount * BENCH_CHUNK_SIZE;
+        chunks.push_back({&path, offset, BENCH_CHUNK_SIZE, 0});
+    }
+
+    // plain jobs first, then fibers, both have to come out the same
+    u64 fibResults[2], loadHashes[2];
+    for(u32 mode = 0; mode < 2; mode++)
+    {
+        DEUtil::JobSystem jobs(threadCount, mode == 0 ? 0 : 256);
+        const char *name = jobs.IsFiberMode() ? "fibers" : "plain ";
+        if(mode == 1 && !jobs.IsFiberMode())
+        {
+            LERROR("couldn't make the fibers.\n");
+            break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        Fib(&jobs, fib, &fibResults[mode]);
+        f64 fibMs = MillisecondsSince(start);
+        u64 fibParks = jobs.GetParkCount();
+
+        f64 loadMs = RunLoads(jobs, chunks, latencyUs, loadHashes[mode]);
+
+        LINFO(false, name << " fib(" << fib << "): " << fibMs << " ms, " << fibParks << " parks | " << loads
+                          << " loads and " << BENCH_COMPUTE_JOBS << " compute jobs: " << loadMs << " ms, "
+                          << jobs.GetParkCount() - fibParks << " parks\n");
+    }
+
+    if(!temporary.empty())
+        std::remove(temporary.c_str());
+
+    if(fibResults[0] != fibResults[1] || loadHashes[0] != loadHashes[1])
+    {
+        LERROR("fibers and plain jobs came out different.\n");
+        return 1;
+    }
+
+    return 0;
+}
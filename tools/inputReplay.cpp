@@ -0,0 +1,306 @@
+// ---------------------- INPUT REPLAY ----------------------
+// plays an input recording (DOOMEngine -record <file>) back headless: every tic's events go
+// through the input queue into a snapshot like in the game, are turned into a TicCmd with
+// the default controls and run through the sim on -map, rendered with the software renderer
+// unless -norender. prints the frame times and the sim's state hash, which has to match
+// between runs of the same recording.
+//
+// -synthetic <tics> first writes a recording of that many tics of made up play (keys, taps
+// inside a tic, mouse movement, scrolling, a joystick) to the file, through the same recorder
+// the game uses, and checks that every replayed tic's snapshot matches the recorded one.
+//
+// usage: DOOMInputReplay [-size <w>x<h>] [-threads <n>] [-norender] [-map <name>] [-synthetic <tics>]
+//                        <input.dinp> <file.wad>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <io/input.h>
+#include <io/inputRecord.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <soft/softRenderer.h>
+#include <game/gameSim.h>
+#include <game/inputCmd.h>
+
+#include "benchStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMInputReplay [-size <w>x<h>] [-threads <n>] [-norender] [-map <name>] [-synthetic <tics>]\n"
+                 "                       <input.dinp> <file.wad>...\n"
+                 "\t-size       framebuffer size, 640x400 by default\n"
+                 "\t-threads    column strips drawn in parallel, 0 (default) uses every hardware thread\n"
+                 "\t-norender   only runs the sim, for timing it alone\n"
+                 "\t-map        the map to play on, MAP01 or E1M1 by default\n"
+                 "\t-synthetic  writes a made up recording of that many tics first and checks the replay\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+static u64 Fnv1a(u64 hash, const void *data, usize size)
+{
+    for(usize i = 0; i < size; i++)
+        hash = (hash ^ ((const u8 *)data)[i]) * 0x100000001b3ull;
+    return hash;
+}
+
+// what a tic's input looks like to the game, the replay has to come out the same
+static u64 HashTicInput(const InputSnapshot &input, const JoystickState &joystick)
+{
+    u64 hash = 0xcbf29ce484222325ull;
+    hash = Fnv1a(hash, input.keys, sizeof(input.keys));
+    hash = Fnv1a(hash, input.keysPressed, sizeof(input.keysPressed));
+    hash = Fnv1a(hash, input.keysReleased, sizeof(input.keysReleased));
+    hash = Fnv1a(hash, input.buttons, sizeof(input.buttons));
+    hash = Fnv1a(hash, input.buttonsPressed, sizeof(input.buttonsPressed));
+    hash = Fnv1a(hash, input.buttonsReleased, sizeof(input.buttonsReleased));
+
+    f64 motion[6] = {input.x, input.y, input.dx, input.dy, input.scrollDX, input.scrollDY};
+    hash = Fnv1a(hash, motion, sizeof(motion));
+
+    hash = Fnv1a(hash, &joystick.present, sizeof(joystick.present));
+    hash = Fnv1a(hash, joystick.axes, joystick.axisCount * sizeof(f32));
+    hash = Fnv1a(hash, joystick.buttons, joystick.buttonCount);
+    return hash;
+}
+
+// made up play through the game's own path: events into the queue, Input::Tick() records them
+static bool WriteSynthetic(const char *filepath, u32 tics, std::vector<u64> &hashes)
+{
+    DEUtil::InputRecorder recorder;
+    if(!recorder.Open(filepath, TICRATE))
+        return false;
+
+    Input::SetRecorder(&recorder);
+
+    // keys the default controls use, and one they don't
+    static const u16 keys[] = {87, 83, 65, 68, 263, 262, 340, 341, 32, 81};
+    bool held[sizeof(keys) / sizeof(keys[0])] = {};
+
+    JoystickState joystick{};
+    joystick.present = true;
+    joystick.axisCount = 6;
+    joystick.buttonCount = 18;
+
+    u32 state = 0x2545f491u;
+    auto random = [&state](u32 range) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state % range;
+    };
+
+    f64 x = 320.0, y = 200.0;
+    for(u32 tic = 0; tic < tics; tic++)
+    {
+        f64 ticStart = (f64)tic / TICRATE, ticEnd = (f64)(tic + 1) / TICRATE;
+
+        // about a third of the tics are idle, the rest get a few events
+        u32 events = random(3) == 0 ? 0 : 1 + random(6);
+        for(u32 e = 0; e < events; e++)
+        {
+            InputEvent event{ticStart + (ticEnd - ticStart) * (e + 1) / (events + 2), 0.0, 0.0,
+                             InputEventType::CURSOR, InputAction::PRESS, 0, 0};
+            u32 kind = random(10);
+            if(kind < 3)
+            {
+                u32 k = random(sizeof(keys) / sizeof(keys[0]));
+                held[k] = !held[k];
+                event.type = InputEventType::KEY;
+                event.action = held[k] ? InputAction::PRESS : InputAction::RELEASE;
+                event.code = keys[k];
+            }
+            else if(kind < 4)
+            {
+                // a tap that starts and ends inside the tic
+                event.type = InputEventType::MOUSE_BUTTON;
+                event.code = (u16)random(2);
+                Input::GetQueue().Push(event);
+                event.action = InputAction::RELEASE;
+            }
+            else if(kind < 9)
+            {
+                // mostly whole pixels, a scaled display gives fractions
+                x += (f64)((i32)random(41) - 20) + (random(8) == 0 ? 0.5 : 0.0);
+                y += (f64)((i32)random(21) - 10);
+                event.x = x;
+                event.y = y;
+            }
+            else
+            {
+                event.type = InputEventType::SCROLL;
+                event.y = random(2) ? 1.0 : -1.0;
+            }
+            Input::GetQueue().Push(event);
+        }
+
+        if(random(4) == 0)
+            joystick.axes[random(joystick.axisCount)] = (f32)((i32)random(2001) - 1000) / 1000.0f;
+        if(random(16) == 0)
+            joystick.buttons[random(joystick.buttonCount)] ^= 1;
+
+        Input::Tick(ticEnd);
+        recorder.RecordJoystick(joystick);
+        recorder.EndTic();
+        hashes.push_back(HashTicInput(Input::GetSnapshot(), joystick));
+    }
+
+    Input::SetRecorder(nullptr);
+    Input::Reset();
+    return recorder.Close();
+}
+
+int main(int argc, char **argv)
+{
+    u32 width = 640, height = 400;
+    u32 threads = 0;
+    bool render = true;
+    const char *mapName = nullptr;
+    u32 syntheticTics = 0;
+    const char *inputPath = nullptr;
+    std::vector<const char *> wads;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+            sscanf(argv[++i], "%ux%u", &width, &height);
+        else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-norender") == 0)
+            render = false;
+        else if(strcmp(argv[i], "-map") == 0 && i + 1 < argc)
+            mapName = argv[++i];
+        else if(strcmp(argv[i], "-synthetic") == 0 && i + 1 < argc)
+            syntheticTics = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(!inputPath)
+            inputPath = argv[i];
+        else
+            wads.push_back(argv[i]);
+    }
+
+    if(!inputPath || wads.empty() || width == 0 || height == 0 || height > 0x7fff)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<u64> recordedHashes;
+    if(syntheticTics > 0 && !WriteSynthetic(inputPath, syntheticTics, recordedHashes))
+        return 1;
+
+    DEUtil::InputPlayback playback;
+    if(!playback.Open(inputPath))
+        return 1;
+
+    if(playback.GetTicCount() == 0)
+    {
+        LERROR("recording " << inputPath << " has no tics.\n");
+        return 1;
+    }
+
+    std::ifstream recording(inputPath, std::ios::ate | std::ios::binary);
+    u64 recordingSize = (u64)recording.tellg();
+
+    DEUtil::WadArchive archive;
+    for(const char *wad : wads)
+    {
+        if(!archive.AddFile(wad))
+            return 1;
+    }
+
+    if(!mapName)
+        mapName = archive.FindLump("MAP01") >= 0 ? "MAP01" : "E1M1";
+
+    DEUtil::MapData map;
+    if(!DEUtil::LoadMap(archive, mapName, map))
+        return 1;
+
+    DEUtil::GameSim sim;
+    if(!sim.Start(map, 1))
+        return 1;
+
+    DEUtil::SoftRenderer renderer(width, height, threads);
+    if(render)
+    {
+        if(!renderer.LoadAssets(archive))
+            return 1;
+
+        // walls stay checkerboards if the wads have no textures
+        renderer.LoadWallTextures(archive);
+        renderer.SetMap(map);
+    }
+
+    u32 tics = playback.GetTicCount();
+    u32 mismatches = 0;
+    TicCmd cmds[SIM_MAX_PLAYERS] = {};
+    std::vector<f64> frameTimes;
+    frameTimes.reserve(tics);
+
+    auto start = std::chrono::steady_clock::now();
+    auto frameStart = start;
+    for(u32 tic = 0; tic < tics; tic++)
+    {
+        f64 ticEnd = (f64)(tic + 1) / TICRATE;
+        if(!playback.NextTic(Input::GetQueue(), ticEnd))
+            break;
+
+        Input::Tick(ticEnd);
+        if(!recordedHashes.empty() && HashTicInput(Input::GetSnapshot(), playback.GetJoystick()) != recordedHashes[tic])
+            mismatches++;
+
+        DEUtil::BuildTicCmd(Input::GetSnapshot(), playback.GetJoystick(), cmds[0]);
+        sim.Tick(cmds);
+
+        if(render)
+        {
+            const DEUtil::SimPlayer &player = sim.GetPlayer(0);
+            DEUtil::SoftView view;
+            view.pos = glm::vec2(DEUtil::FixedToFloat(player.x), DEUtil::FixedToFloat(player.y));
+            view.z = DEUtil::FixedToFloat(player.viewZ);
+            view.angle = DEUtil::AngleToRadians(player.angle);
+            renderer.Render(view);
+        }
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        frameTimes.push_back(std::chrono::duration<f64, std::milli>(frameEnd - frameStart).count());
+        frameStart = frameEnd;
+    }
+    f64 seconds = std::chrono::duration<f64>(frameStart - start).count();
+
+    if(frameTimes.size() != tics)
+        return 1;
+
+    u64 simHash = sim.Hash();
+    u64 frameHash = render ? renderer.HashFramebuffer() : 0;
+    std::sort(frameTimes.begin(), frameTimes.end());
+
+    LINFO(false, inputPath << " on " << mapName << ": " << tics << " tics (" << tics / (f64)TICRATE
+                           << "s of game time, " << recordingSize << " bytes, "
+                           << (f64)recordingSize / tics << " per tic) in " << seconds << "s, "
+                           << (seconds > 0.0 ? tics / seconds : 0.0) << " fps\n"
+                           << "frame ms: avg " << seconds * 1000.0 / tics << ", p50 " << Percentile(frameTimes, 50.0)
+                           << ", p95 " << Percentile(frameTimes, 95.0) << ", p99 " << Percentile(frameTimes, 99.0)
+                           << ", max " << frameTimes.back() << "\n"
+                           << "sim hash " << std::hex << simHash << ", last frame hash " << frameHash << std::dec
+                           << "\n");
+
+    if(!recordedHashes.empty())
+    {
+        if(mismatches > 0)
+        {
+            LERROR(mismatches << " of " << tics << " replayed tics don't match their recorded input.\n");
+            return 1;
+        }
+
+        LINFO(false, "every replayed tic matches its recorded input.\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,183 @@
+// ---------------------- JOB BENCH ----------------------
+// scaling of the job system from 1 thread up to -threads: a fibonacci fan-out where every
+// call above the cutoff spawns a job for one half and waits on it while helping (scheduler
+// overhead, millions of tiny jobs), and a parallel for over -items items (bulk throughput).
+// each thread count runs -runs times and the median is printed next to the speedup over 1
+// thread. the results are checked against a serial run, and a RunAfter() chain checks that
+// continuations only start once their dependency is done.
+//
+// usage: DOOMJobBench [-threads <n>] [-fib <n>] [-items <n>] [-runs <n>]
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <core/jobs.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// items per parallel for range
+#define BENCH_GRAIN 16384
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMJobBench [-threads <n>] [-fib <n>] [-items <n>] [-runs <n>]\n"
+                 "\t-threads  most threads to scale to, every hardware thread by default\n"
+                 "\t-fib      fibonacci number the fan-out computes, 27 by default\n"
+                 "\t-items    parallel for items, 10000000 by default\n"
+                 "\t-runs     runs per thread count, 5 by default\n");
+}
+
+static u64 FibSerial(u32 n)
+{
+    return n < 2 ? n : FibSerial(n - 1) + FibSerial(n - 2);
+}
+
+static void Fib(DEUtil::JobSystem *jobs, u32 n, u64 *result)
+{
+    if(n < 2)
+    {
+        *result = n;
+        return;
+    }
+
+    u64 a, b;
+    DEUtil::JobCounter counter;
+    jobs->Run(&counter, [jobs, n, &a]() { Fib(jobs, n - 1, &a); });
+    Fib(jobs, n - 2, &b);
+    jobs->Wait(&counter);
+    *result = a + b;
+}
+
+// a little math per item so the loop isn't only memory bound
+static inline f32 Item(f32 x)
+{
+    return std::sqrt(x * x * 0.5f + x + 1.0f) * 0.25f + x * 0.125f;
+}
+
+static f64 Median(std::vector<f64> times)
+{
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// n jobs bump a counter, a RunAfter() job has to see all n
+static bool CheckContinuations(DEUtil::JobSystem &jobs)
+{
+    const u32 count = 10000;
+    std::atomic<u32> done{0};
+    u32 seen = 0;
+
+    DEUtil::JobCounter first, second;
+    for(u32 i = 0; i < count; i++)
+        jobs.Run(&first, [&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    jobs.RunAfter(&first, &second, [&done, &seen]() { seen = done.load(std::memory_order_relaxed); });
+    jobs.Wait(&second);
+
+    if(seen != count)
+    {
+        LERROR("a continuation ran after " << seen << " of its " << count << " jobs.\n");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    u32 maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    u32 fib = 27;
+    u32 itemCount = 10000000;
+    u32 runs = 5;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            maxThreads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-fib") == 0 && i + 1 < argc)
+            fib = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-items") == 0 && i + 1 < argc)
+            itemCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+            runs = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if(maxThreads == 0 || runs == 0 || fib > 40)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    u64 fibExpected = FibSerial(fib);
+    u64 fibJobs = fib < 2 ? 0 : FibSerial(fib + 1) - 1; // one per call with n >= 2
+
+    std::vector<f32> input(itemCount), output(itemCount), expected(itemCount);
+    for(u32 i = 0; i < itemCount; i++)
+    {
+        input[i] = (f32)(i % 4096) * 0.5f;
+        expected[i] = Item(input[i]);
+    }
+
+    LINFO(false, "fib(" << fib << "): " << fibJobs << " jobs, parallel for: " << itemCount << " items in ranges of "
+                        << BENCH_GRAIN << ", median of " << runs << " runs\n");
+    printf("threads   fib ms   Mjobs/s  speedup   for ms  Mitems/s  speedup\n");
+
+    f64 fibBase = 0.0, forBase = 0.0;
+    for(u32 threads = 1; threads <= maxThreads; threads++)
+    {
+        DEUtil::JobSystem jobs(threads);
+        if(!CheckContinuations(jobs))
+            return 1;
+
+        std::vector<f64> fibTimes(runs), forTimes(runs);
+        for(u32 run = 0; run < runs; run++)
+        {
+            u64 result = 0;
+            auto start = std::chrono::steady_clock::now();
+            Fib(&jobs, fib, &result);
+            fibTimes[run] = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if(result != fibExpected)
+            {
+                LERROR("fib(" << fib << ") came out as " << result << " on " << threads << " threads.\n");
+                return 1;
+            }
+
+            std::fill(output.begin(), output.end(), 0.0f);
+            start = std::chrono::steady_clock::now();
+            jobs.ParallelFor(itemCount, BENCH_GRAIN, [&](u32 begin, u32 end) {
+                for(u32 i = begin; i < end; i++)
+                    output[i] = Item(input[i]);
+            });
+            forTimes[run] = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            if(memcmp(output.data(), expected.data(), (usize)itemCount * sizeof(f32)) != 0)
+            {
+                LERROR("the parallel for missed items on " << threads << " threads.\n");
+                return 1;
+            }
+        }
+
+        f64 fibMs = Median(fibTimes), forMs = Median(forTimes);
+        if(threads == 1)
+        {
+            fibBase = fibMs;
+            forBase = forMs;
+        }
+
+        printf("%7u %8.2f %9.2f %8.2f %8.2f %9.1f %8.2f\n", threads, fibMs, fibJobs / fibMs / 1000.0, fibBase / fibMs,
+               forMs, itemCount / forMs / 1000.0, forBase / forMs);
+    }
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+// ---------------------- LEVEL GEOMETRY ----------------------
+// builds a map's walls, floors and ceilings with BuildLevelGeometry() and prints what came out:
+// vertices, triangles, batches per type, surfaces and the sectors that couldn't be closed.
+// the build is timed over -runs runs and every run has to come out identical. then the
+// visible draws of every sector (from -pvs, or the map's REJECT lump) are gathered and timed.
+// -obj writes the geometry as a wavefront .obj, one group per batch, to look at it.
+//
+// usage: DOOMLevelGeometry [-runs <n>] [-pvs <file.pvs>] [-obj <out.obj>] <map> <file.wad>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <wad/pvs.h>
+#include <wad/wadTextures.h>
+#include <wad/levelGeometry.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMLevelGeometry [-runs <n>] [-pvs <file.pvs>] [-obj <out.obj>] <map> <file.wad>...\n"
+                 "\t-runs  builds timed (and compared against the first), 10 by default\n"
+                 "\t-pvs   sector visibility from DOOMPvsBuilder, the map's REJECT lump by default\n"
+                 "\t-obj   writes the geometry as a wavefront .obj\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+static f64 MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// a packed lump name back to text, see PackLumpName()
+static std::string TextureName(u64 packed)
+{
+    std::string name;
+    for(u32 i = 0; i < WAD_NAME_LENGTH && (packed >> (i * 8)) & 0xFF; i++)
+        name += (char)((packed >> (i * 8)) & 0xFF);
+    return name.empty() ? "-" : name;
+}
+
+static bool SameGeometry(const DEUtil::LevelGeometry &a, const DEUtil::LevelGeometry &b)
+{
+    if(a.vertices != b.vertices || a.indices != b.indices || a.untriangulatedSectors != b.untriangulatedSectors)
+        return false;
+    if(a.batches.size() != b.batches.size() || a.surfaces.size() != b.surfaces.size())
+        return false;
+
+    for(usize i = 0; i < a.batches.size(); i++)
+    {
+        const DEUtil::LevelBatch &x = a.batches[i], &y = b.batches[i];
+        if(x.type != y.type || x.texture != y.texture || x.firstVertex != y.firstVertex ||
+           x.vertexCount != y.vertexCount || x.firstIndex != y.firstIndex || x.indexCount != y.indexCount ||
+           x.firstSurface != y.firstSurface || x.surfaceCount != y.surfaceCount)
+            return false;
+    }
+
+    for(usize i = 0; i < a.surfaces.size(); i++)
+    {
+        const DEUtil::LevelSurface &x = a.surfaces[i], &y = b.surfaces[i];
+        if(x.sector != y.sector || x.firstIndex != y.firstIndex || x.indexCount != y.indexCount)
+            return false;
+    }
+
+    return true;
+}
+
+// every index has to stay inside its batch's vertices, every surface inside its batch's indices
+static bool VerifyGeometry(const DEUtil::LevelGeometry &level, u32 sectorCount)
+{
+    for(const DEUtil::LevelBatch &batch : level.batches)
+    {
+        if(batch.indexCount % 3 != 0 || batch.firstIndex + batch.indexCount > level.indices.size())
+        {
+            LERROR("batch " << TextureName(batch.texture) << ": index range out of bounds.\n");
+            return false;
+        }
+
+        for(u32 i = batch.firstIndex; i < batch.firstIndex + batch.indexCount; i++)
+        {
+            if(level.indices[i] >= batch.vertexCount)
+            {
+                LERROR("batch " << TextureName(batch.texture) << ": index " << level.indices[i]
+                                << " past its " << batch.vertexCount << " vertices.\n");
+                return false;
+            }
+        }
+
+        u32 next = batch.firstIndex;
+        for(u32 s = batch.firstSurface; s < batch.firstSurface + batch.surfaceCount; s++)
+        {
+            const DEUtil::LevelSurface &surface = level.surfaces[s];
+            if(surface.firstIndex != next || surface.sector >= sectorCount)
+            {
+                LERROR("batch " << TextureName(batch.texture) << ": surfaces don't cover its indices.\n");
+                return false;
+            }
+            next += surface.indexCount;
+        }
+
+        if(next != batch.firstIndex + batch.indexCount)
+        {
+            LERROR("batch " << TextureName(batch.texture) << ": surfaces don't cover its indices.\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool WriteObj(const DEUtil::LevelGeometry &level, const char *path)
+{
+    std::ofstream out(path);
+    if(!out)
+    {
+        LERROR("couldn't open " << path << " for writing.\n");
+        return false;
+    }
+
+    for(usize v = 0; v < level.vertices.size(); v += LEVEL_VERTEX_STRIDE)
+        out << "v " << level.vertices[v] << " " << level.vertices[v + 1] << " " << level.vertices[v + 2] << "\n";
+
+    for(const DEUtil::LevelBatch &batch : level.batches)
+    {
+        out << "g " << TextureName(batch.texture) << "_" << (u32)batch.type << "\n";
+
+        // obj indices are 1 based and global
+        u32 base = batch.firstVertex + 1;
+        for(u32 i = batch.firstIndex; i < batch.firstIndex + batch.indexCount; i += 3)
+        {
+            out << "f " << base + level.indices[i] << " " << base + level.indices[i + 1] << " "
+                << base + level.indices[i + 2] << "\n";
+        }
+    }
+
+    return (bool)out;
+}
+
+int main(int argc, char **argv)
+{
+    u32 runs = 10;
+    const char *pvsPath = nullptr;
+    const char *objPath = nullptr;
+    std::vector<const char *> args;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+            runs = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-pvs") == 0 && i + 1 < argc)
+            pvsPath = argv[++i];
+        else if(strcmp(argv[i], "-obj") == 0 && i + 1 < argc)
+            objPath = argv[++i];
+        else
+            args.push_back(argv[i]);
+    }
+
+    if(runs == 0 || args.size() < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char *mapName = args[0];
+    DEUtil::WadArchive archive;
+    for(usize i = 1; i < args.size(); i++)
+    {
+        if(!archive.AddFile(args[i]))
+            return 1;
+    }
+
+    DEUtil::MapData map;
+    if(!DEUtil::LoadMap(archive, mapName, map))
+        return 1;
+
+    // pegging needs texture heights, without TEXTURE1/2 every texture counts as the default height
+    std::vector<DEUtil::WadImage> textures;
+    std::unordered_map<u64, u32> textureHeights;
+    if(archive.FindLump("TEXTURE1") >= 0 && DEUtil::LoadWallTextures(archive, textures))
+    {
+        for(const DEUtil::WadImage &texture : textures)
+            textureHeights[texture.name] = texture.height;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    DEUtil::LevelGeometry level = DEUtil::BuildLevelGeometry(map, &textureHeights);
+    f64 firstMs = MsSince(start);
+
+    f64 bestMs = firstMs, totalMs = firstMs;
+    for(u32 run = 1; run < runs; run++)
+    {
+        start = std::chrono::steady_clock::now();
+        DEUtil::LevelGeometry again = DEUtil::BuildLevelGeometry(map, &textureHeights);
+        f64 ms = MsSince(start);
+        bestMs = std::min(bestMs, ms);
+        totalMs += ms;
+
+        if(!SameGeometry(level, again))
+        {
+            LERROR("run " << run << " built different geometry than the first.\n");
+            return 1;
+        }
+    }
+
+    u32 sectorCount = (u32)map.sectors.size();
+    if(!VerifyGeometry(level, sectorCount))
+        return 1;
+
+    u32 batchTypes[3] = {};
+    for(const DEUtil::LevelBatch &batch : level.batches)
+        batchTypes[(u32)batch.type]++;
+
+    printf("%s: %u sectors, %u linedefs, %u textures with heights\n", mapName, sectorCount,
+           (u32)map.linedefs.size(), (u32)textureHeights.size());
+    printf("geometry: %u vertices, %u triangles, %u batches (%u wall, %u masked, %u flat), %u surfaces\n",
+           (u32)(level.vertices.size() / LEVEL_VERTEX_STRIDE), (u32)(level.indices.size() / 3),
+           (u32)level.batches.size(), batchTypes[(u32)LevelBatchType::WALL], batchTypes[(u32)LevelBatchType::MASKED],
+           batchTypes[(u32)LevelBatchType::FLAT], (u32)level.surfaces.size());
+    printf("untriangulated sectors: %u\n", level.untriangulatedSectors);
+    printf("build: %.3f ms first, %.3f ms best, %.3f ms mean over %u runs (identical)\n", firstMs, bestMs,
+           totalMs / runs, runs);
+
+    DEUtil::SectorPVS pvs;
+    if(pvsPath)
+    {
+        if(!pvs.Load(pvsPath))
+            return 1;
+    }
+    else
+    {
+        pvs.BuildFromReject(map);
+    }
+
+    if(pvs.GetSectorCount() != sectorCount)
+    {
+        LERROR("the pvs has " << pvs.GetSectorCount() << " sectors, the map " << sectorCount << ".\n");
+        return 1;
+    }
+
+    // draws from every sector, against one draw per batch without visibility
+    std::vector<u64> visible(pvs.GetRowWords());
+    std::vector<DEUtil::LevelDraw> draws;
+    u64 drawCount = 0, drawnIndices = 0;
+    f64 gatherMs = 0.0;
+    for(u32 sector = 0; sector < sectorCount; sector++)
+    {
+        pvs.DecompressRow(sector, visible.data());
+
+        start = std::chrono::steady_clock::now();
+        DEUtil::GatherVisibleDraws(level, visible, draws);
+        gatherMs += MsSince(start);
+
+        drawCount += draws.size();
+        for(const DEUtil::LevelDraw &draw : draws)
+            drawnIndices += draw.indexCount;
+    }
+
+    if(sectorCount > 0)
+    {
+        printf("gather: %.2f draws and %.1f%% of the triangles per sector (%u batches), %.4f ms per sector\n",
+               (f64)drawCount / sectorCount,
+               level.indices.empty() ? 0.0 : 100.0 * drawnIndices / ((f64)sectorCount * level.indices.size()),
+               (u32)level.batches.size(), gatherMs / sectorCount);
+    }
+
+    if(objPath)
+    {
+        if(!WriteObj(level, objPath))
+            return 1;
+        printf("wrote %s\n", objPath);
+    }
+
+    return 0;
+}
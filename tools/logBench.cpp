@@ -0,0 +1,178 @@
+// ---------------------- LOG BENCH ----------------------
+// times a log call on the logging thread: synchronous, async, binary and filtered out by
+// the runtime level. the synchronous run writes to /dev/null so it measures the logger
+// and not the terminal, the async runs write to -out (/dev/null by default) from the
+// background thread, once waiting for room when the ring is full and once dropping, and
+// the binary run writes to -binary's files if it's given. prints ns per call, how long
+// the async writer took to catch up, how many messages were dropped and, if -out is a
+// file, how many of the waiting run's messages made it there.
+//
+// usage: DOOMLogBench [-threads <n>] [-messages <n>] [-out <file>] [-binary <prefix>]
+
+#include <core/defines.h>
+#include <core/logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMLogBench [-threads <n>] [-messages <n>] [-out <file>] [-binary <prefix>]\n"
+                 "\t-threads   logging threads, 4 by default\n"
+                 "\t-messages  messages per thread, 20000 by default\n"
+                 "\t-out       the async runs' log file, /dev/null by default\n"
+                 "\t-binary    runs binary mode too, writing <prefix><n>.blog files\n");
+}
+
+// a message with a few arguments, like the engine's
+#define BENCH_MESSAGE(i, thread) "frame " << (i) << " on thread " << (thread) << ": " << (i) * 0.25f << "ms\n"
+
+// every thread logs count messages, returns the average ns per call over all of them
+static f64 RunThreads(u32 threadCount, u32 count, bool viaMacro)
+{
+    std::vector<std::thread> threads;
+    std::vector<f64> nanoseconds(threadCount);
+    for(u32 t = 0; t < threadCount; t++)
+    {
+        threads.emplace_back([t, count, viaMacro, &nanoseconds]() {
+            std::ofstream null("/dev/null");
+            auto start = std::chrono::steady_clock::now();
+            for(u32 i = 0; i < count; i++)
+            {
+                if(viaMacro)
+                {
+                    LINFO(true, BENCH_MESSAGE(i, t));
+                }
+                else
+                {
+                    // LINFO's logger, pointed at /dev/null
+                    Logger Log(null);
+                    Log(LOG_INFO, FILE_INFO) << BENCH_MESSAGE(i, t);
+                }
+            }
+            nanoseconds[t] = std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count();
+        });
+    }
+
+    f64 total = 0.0;
+    for(u32 t = 0; t < threadCount; t++)
+    {
+        threads[t].join();
+        total += nanoseconds[t];
+    }
+
+    return total / ((f64)threadCount * count);
+}
+
+// async mode with the given full ring policy, returns ns per call
+static f64 RunAsync(const char *outPath, LogAsyncFull full, u32 threadCount, u32 count, u64 &dropped, f64 &drainMs)
+{
+    if(!Logger::StartAsync(outPath, false, full))
+        return -1.0;
+
+    f64 ns = RunThreads(threadCount, count, true);
+    dropped = Logger::GetAsyncDropped();
+
+    auto start = std::chrono::steady_clock::now();
+    Logger::StopAsync();
+    drainMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ns;
+}
+
+static u64 CountLines(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if(!file)
+        return 0;
+
+    u64 lines = 0;
+    char chunk[65536];
+    for(usize read; (read = fread(chunk, 1, sizeof(chunk), file)) > 0;)
+        lines += (u64)std::count(chunk, chunk + read, '\n');
+
+    fclose(file);
+    return lines;
+}
+
+int main(int argc, char **argv)
+{
+    u32 threadCount = 4;
+    u32 count = 20000;
+    const char *outPath = "/dev/null";
+    const char *binaryPrefix = nullptr;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threadCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-messages") == 0 && i + 1 < argc)
+            count = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if(strcmp(argv[i], "-binary") == 0 && i + 1 < argc)
+            binaryPrefix = argv[++i];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if(threadCount == 0 || count == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    f64 syncNs = RunThreads(threadCount, count, false);
+
+    // the level check comes before the arguments, so this is all a filtered call costs
+    LOG_SET_PRIORITY(LOG_WARN);
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < count; i++)
+        LINFO(true, BENCH_MESSAGE(i, 0));
+    f64 filteredNs = std::chrono::duration<f64, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+    LOG_SET_PRIORITY(LOG_INFO);
+
+    u64 waitDropped, dropDropped;
+    f64 waitDrainMs, dropDrainMs;
+    f64 waitNs = RunAsync(outPath, LogAsyncFull::WAIT, threadCount, count, waitDropped, waitDrainMs);
+    u64 written = strcmp(outPath, "/dev/null") != 0 ? CountLines(outPath) : 0;
+    f64 dropNs = RunAsync(outPath, LogAsyncFull::DROP, threadCount, count, dropDropped, dropDrainMs);
+    if(waitNs < 0.0 || dropNs < 0.0)
+        return 1;
+
+    f64 binaryNs = 0.0;
+    u64 binaryDropped = 0;
+    if(binaryPrefix)
+    {
+        if(!Logger::StartBinary(binaryPrefix))
+            return 1;
+
+        binaryNs = RunThreads(threadCount, count, true);
+        binaryDropped = Logger::GetBinaryDropped();
+        Logger::StopBinary();
+    }
+
+    LINFO(false, threadCount << " threads x " << count << " messages\n"
+                             << "sync:     " << syncNs << " ns per call\n"
+                             << "filtered: " << filteredNs << " ns per call\n"
+                             << "async:    " << waitNs << " ns per call waiting when full, the writer caught up "
+                             << waitDrainMs << "ms after the last one, " << waitDropped << " dropped\n"
+                             << "          " << dropNs << " ns per call dropping when full, the writer caught up "
+                             << dropDrainMs << "ms after the last one, " << dropDropped << " dropped (ring of "
+                             << LOG_ASYNC_SLOTS << ")\n");
+    if(written > 0)
+        LINFO(false, "          " << written << " of " << (u64)threadCount * count << " lines written waiting\n");
+
+    if(binaryPrefix)
+        LINFO(false, "binary:   " << binaryNs << " ns per call, " << 1000.0 / binaryNs << "M messages/s per thread, "
+                                  << binaryDropped << " dropped\n");
+    return 0;
+}
@@ -0,0 +1,341 @@
+// ---------------------- LOG DECODE ----------------------
+// turns binary log files (Logger::StartBinary()) back into the text the logger would have
+// written: "[LEVEL time file:line]\tmessage", with microseconds on the time. files are
+// decoded in the order they're given, each one on its own.
+//
+// usage: DOOMLogDecode [-color] <file.blog>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <core/binaryLog.h>
+#include <core/localTime.h>
+#include <core/mappedFile.h>
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMLogDecode [-color] <file.blog>...\n"
+                 "\t-color  colors the levels like the console\n");
+}
+
+struct DecodedSite
+{
+    u8 level;
+    u32 line;
+    std::string file;
+    std::vector<std::string> literals;
+};
+
+// reads the file front to back, false once a record runs past its end
+class RecordReader
+{
+    private:
+    const u8 *data;
+    usize size, offset;
+
+    public:
+    RecordReader(const u8 *data, usize size, usize offset) : data{data}, size{size}, offset{offset} {}
+
+    template<typename T>
+    bool Read(T &out)
+    {
+        if(offset + sizeof(T) > size)
+            return false;
+
+        memcpy(&out, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool ReadBytes(usize length, const u8 *&out)
+    {
+        if(offset + length > size)
+            return false;
+
+        out = data + offset;
+        offset += length;
+        return true;
+    }
+
+    inline bool AtEnd() const { return offset >= size; }
+    inline u8 Peek() const { return data[offset]; }
+    inline usize GetOffset() const { return offset; }
+};
+
+static const char *LevelName(u8 level)
+{
+    const char *names[] = {"", "FATAL", "ERROR", "WARN", "DEBUG", "TRACE", "INFO"};
+    return level < 7 ? names[level] : "?";
+}
+
+static const char *LevelColor(u8 level)
+{
+    const char *colors[] = {"", TEXT_RED, TEXT_RED, TEXT_YELLOW, TEXT_BLUE, TEXT_CYAN, TEXT_PURPLE};
+    return level < 7 ? colors[level] : "";
+}
+
+// the arguments back to text, false if they're malformed
+static bool DecodeArguments(const u8 *args, u32 size, const DecodedSite *site, std::string &out)
+{
+    RecordReader reader(args, size, 0);
+    char number[64];
+    while(!reader.AtEnd())
+    {
+        u8 tag = 0;
+        reader.Read(tag);
+        switch(tag)
+        {
+        case BINLOG_LITERAL:
+        {
+            u8 idx;
+            if(!reader.Read(idx))
+                return false;
+
+            if(site && idx < site->literals.size())
+                out += site->literals[idx];
+            else
+                out += "<literal?>";
+            break;
+        }
+        case BINLOG_STRING:
+        {
+            u16 length;
+            const u8 *str;
+            if(!reader.Read(length) || !reader.ReadBytes(length, str))
+                return false;
+
+            out.append((const char *)str, length);
+            break;
+        }
+        case BINLOG_CHAR:
+        {
+            char c;
+            if(!reader.Read(c))
+                return false;
+
+            out += c;
+            break;
+        }
+        case BINLOG_BOOL:
+        {
+            u8 value;
+            if(!reader.Read(value))
+                return false;
+
+            out += value ? '1' : '0';
+            break;
+        }
+        case BINLOG_I32:
+        case BINLOG_U32:
+        case BINLOG_I64:
+        case BINLOG_U64:
+        {
+            i32 i32Value;
+            u32 u32Value;
+            i64 i64Value;
+            u64 u64Value;
+            bool read = tag == BINLOG_I32   ? reader.Read(i32Value)
+                        : tag == BINLOG_U32 ? reader.Read(u32Value)
+                        : tag == BINLOG_I64 ? reader.Read(i64Value)
+                                            : reader.Read(u64Value);
+            if(!read)
+                return false;
+
+            out += tag == BINLOG_I32   ? std::to_string(i32Value)
+                   : tag == BINLOG_U32 ? std::to_string(u32Value)
+                   : tag == BINLOG_I64 ? std::to_string(i64Value)
+                                       : std::to_string(u64Value);
+            break;
+        }
+        case BINLOG_F32:
+        case BINLOG_F64:
+        {
+            // ostream's default float format
+            f64 value;
+            f32 value32;
+            if(tag == BINLOG_F32 ? !reader.Read(value32) : !reader.Read(value))
+                return false;
+            if(tag == BINLOG_F32)
+                value = value32;
+
+            snprintf(number, sizeof(number), "%g", value);
+            out += number;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void AppendHeader(std::string &out, u8 level, const char *file, usize fileLength, u32 line, i64 epochNs,
+                         u64 time, bool color)
+{
+    i64 ns = epochNs + (i64)time;
+    time_t seconds = (time_t)(ns / 1000000000);
+    std::tm local;
+    DEUtil::LocalTime(seconds, local);
+
+    char clock[48];
+    usize length = strftime(clock, sizeof(clock), "%X", &local);
+    snprintf(clock + length, sizeof(clock) - length, ".%06u", (u32)(ns % 1000000000 / 1000));
+
+    out += '[';
+    if(color)
+        out += LevelColor(level);
+    out += LevelName(level);
+    out += ' ';
+    out += clock;
+    if(fileLength > 0)
+    {
+        out += ' ';
+        out.append(file, fileLength);
+        out += ':';
+        out += std::to_string(line);
+    }
+    if(color)
+        out += TEXT_WHITE;
+    out += "]\t";
+}
+
+static bool DecodeFile(const char *filepath, bool color)
+{
+    DEUtil::MappedFile file;
+    if(!file.Open(filepath))
+        return false;
+
+    BinLogHeader header;
+    if(file.GetSize() < sizeof(header))
+    {
+        LERROR(filepath << " is too small for a binary log.\n");
+        return false;
+    }
+
+    memcpy(&header, file.GetData(), sizeof(header));
+    if(header.magic != BINLOG_MAGIC || header.version != BINLOG_VERSION)
+    {
+        LERROR(filepath << " isn't a version " << BINLOG_VERSION << " binary log.\n");
+        return false;
+    }
+
+    std::unordered_map<u32, DecodedSite> sites;
+    RecordReader reader(file.GetData(), file.GetSize(), sizeof(header));
+    std::string out;
+    while(!reader.AtEnd() && reader.Peek() != BINLOG_END)
+    {
+        usize recordOffset = reader.GetOffset();
+        bool complete = false;
+        switch(reader.Peek())
+        {
+        case BINLOG_SITE:
+        {
+            BinLogSiteHeader site;
+            const u8 *name;
+            if(!reader.Read(site) || !reader.ReadBytes(site.fileLength, name))
+                break;
+
+            DecodedSite &decoded = sites[site.id];
+            decoded = DecodedSite{site.level, site.line, std::string((const char *)name, site.fileLength), {}};
+
+            complete = true;
+            for(u32 i = 0; i < site.literalCount && complete; i++)
+            {
+                u16 length;
+                const u8 *literal;
+                complete = reader.Read(length) && reader.ReadBytes(length, literal);
+                if(complete)
+                    decoded.literals.emplace_back((const char *)literal, length);
+            }
+            break;
+        }
+        case BINLOG_MESSAGE:
+        {
+            BinLogMessageHeader message;
+            const u8 *args;
+            if(!reader.Read(message) || !reader.ReadBytes(message.size, args))
+                break;
+
+            auto site = sites.find(message.site);
+            if(site != sites.end())
+            {
+                const DecodedSite &decoded = site->second;
+                AppendHeader(out, decoded.level, decoded.file.data(), decoded.file.size(), decoded.line,
+                             header.epochNs, message.time, color);
+            }
+            else
+            {
+                out += "[site " + std::to_string(message.site) + "?]\t";
+            }
+
+            complete = DecodeArguments(args, message.size, site != sites.end() ? &site->second : nullptr, out);
+            break;
+        }
+        case BINLOG_INLINE:
+        {
+            BinLogInlineHeader message;
+            const u8 *args, *name;
+            if(!reader.Read(message) || !reader.ReadBytes(message.size, args) ||
+               !reader.ReadBytes(message.fileLength, name))
+                break;
+
+            AppendHeader(out, message.level, (const char *)name, message.fileLength, message.line, header.epochNs,
+                         message.time, color);
+            complete = DecodeArguments(args, message.size, nullptr, out);
+            break;
+        }
+        default:
+            break;
+        }
+
+        if(!complete)
+        {
+            fwrite(out.data(), 1, out.size(), stdout);
+            LERROR(filepath << " has a broken record at byte " << recordOffset << ", the rest is skipped.\n");
+            return false;
+        }
+
+        // 64kb at a time
+        if(out.size() > 1 << 16)
+        {
+            fwrite(out.data(), 1, out.size(), stdout);
+            out.clear();
+        }
+    }
+
+    fwrite(out.data(), 1, out.size(), stdout);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    bool color = false;
+    std::vector<const char *> files;
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-color") == 0)
+            color = true;
+        else
+            files.push_back(argv[i]);
+    }
+
+    if(files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    bool ok = true;
+    for(const char *filepath : files)
+        ok &= DecodeFile(filepath, color);
+
+    fflush(stdout);
+    return ok ? 0 : 1;
+}
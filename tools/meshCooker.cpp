@@ -0,0 +1,157 @@
+// ---------------------- MESH COOKER ----------------------
+// converts source meshes (wavefront .obj) into a .dmc mesh cache
+// that the engine maps and uploads without parsing.
+//
+// usage: DOOMMeshCooker [-meshlets] [-lods] [-3d] <out.dmc> <name=mesh.obj>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <meshes/meshBuild.h>
+#include <meshes/meshCache.h>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// obj indices are 1 based, negative ones count back from the last vertex
+static bool ResolveObjIndex(const std::string &token, usize vertexCount, u32 &out)
+{
+    i64 idx = std::atoll(token.c_str()); // stops at the first '/' (v/vt/vn)
+    if(idx < 0)
+        idx += (i64)vertexCount;
+    else
+        idx -= 1;
+
+    if(idx < 0 || idx >= (i64)vertexCount)
+        return false;
+
+    out = (u32)idx;
+    return true;
+}
+
+// positions (optionally followed by r g b) and faces, faces are fan triangulated
+static bool LoadObj(const char *filepath, bool keepZ, std::vector<f32> &vertices, std::vector<u32> &indices)
+{
+    std::ifstream file(filepath);
+    if(!file.is_open())
+    {
+        LERROR("couldn't open file with path: " << filepath << "\n");
+        return false;
+    }
+
+    usize vertexCount = 0;
+    std::string line;
+    for(u32 lineNum = 1; std::getline(file, line); lineNum++)
+    {
+        std::istringstream ss(line);
+        std::string type;
+        ss >> type;
+
+        if(type == "v")
+        {
+            f32 pos[3] = {0.0f, 0.0f, 0.0f};
+            f32 col[3] = {1.0f, 1.0f, 1.0f};
+            ss >> pos[0] >> pos[1] >> pos[2];
+            if(!(ss >> col[0] >> col[1] >> col[2]))
+                col[0] = col[1] = col[2] = 1.0f;
+
+            vertices.insert(vertices.end(), {pos[0], pos[1]});
+            if(keepZ)
+                vertices.push_back(pos[2]);
+            vertices.insert(vertices.end(), {col[0], col[1], col[2]});
+
+            vertexCount++;
+        }
+        else if(type == "f")
+        {
+            std::vector<u32> face;
+            std::string token;
+            while(ss >> token)
+            {
+                u32 idx;
+                if(!ResolveObjIndex(token, vertexCount, idx))
+                {
+                    LERROR(filepath << ":" << lineNum << ": face index " << token << " is out of range.\n");
+                    return false;
+                }
+                face.push_back(idx);
+            }
+
+            for(usize i = 2; i < face.size(); i++)
+                indices.insert(indices.end(), {face[0], face[i - 1], face[i]});
+        }
+    }
+
+    return true;
+}
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMMeshCooker [-meshlets] [-lods] [-3d] <out.dmc> <name=mesh.obj>...\n"
+                 "\t-meshlets  split meshes into meshlets for the cluster culling path\n"
+                 "\t-lods      build a simplified lod chain\n"
+                 "\t-3d        keep z (pos.xyz, color.rgb), default is the engine's pos.xy, color.rgb layout\n");
+}
+
+int main(int argc, char **argv)
+{
+    u32 flags = 0;
+    bool keepZ = false;
+    const char *outPath = nullptr;
+    std::vector<std::string> inputs;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-meshlets") == 0)
+            flags |= MESH_BUILD_MESHLETS;
+        else if(strcmp(argv[i], "-lods") == 0)
+            flags |= MESH_BUILD_LODS;
+        else if(strcmp(argv[i], "-3d") == 0)
+            keepZ = true;
+        else if(!outPath)
+            outPath = argv[i];
+        else
+            inputs.push_back(argv[i]);
+    }
+
+    if(!outPath || inputs.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    u32 posComponents = keepZ ? 3 : 2;
+    DEUtil::MeshCacheWriter writer(posComponents + 3, posComponents);
+
+    for(const std::string &input : inputs)
+    {
+        usize split = input.find('=');
+        if(split == std::string::npos || split == 0)
+        {
+            LERROR("expected name=path, got: " << input << "\n");
+            return 1;
+        }
+
+        std::string name = input.substr(0, split);
+        std::string path = input.substr(split + 1);
+
+        std::vector<f32> vertices;
+        std::vector<u32> indices;
+        if(!LoadObj(path.c_str(), keepZ, vertices, indices))
+            return 1;
+
+        if(!writer.AddMesh(name, vertices, indices, flags))
+            return 1;
+
+        LINFO(false, "cooked " << name << ": " << vertices.size() / (posComponents + 3) << " vertices, "
+                               << indices.size() / 3 << " triangles\n");
+    }
+
+    if(!writer.Write(outPath))
+        return 1;
+
+    LINFO(false, "wrote " << outPath << "\n");
+    return 0;
+}
@@ -0,0 +1,200 @@
+// ---------------------- PACKER ----------------------
+// packs every file under a directory (res/ by default) into one pak, named by their path
+// relative to it. files with a -store extension are never compressed, everything else is
+// compressed in -chunk kb chunks on -threads threads and stored anyway if it doesn't shrink.
+// -verify opens the pak again, checks every entry against its file and times loading them
+// all as loose files against loading them out of the pak, with and without the job system.
+//
+// usage: DOOMPacker [-chunk <kb>] [-store <ext>]... [-threads <n>] [-verify] <out.pak> [dir]
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <core/jobs.h>
+#include <pak/pak.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMPacker [-chunk <kb>] [-store <ext>]... [-threads <n>] [-verify] <out.pak> [dir]\n"
+                 "\t-chunk    kb per compressed chunk, 64 by default\n"
+                 "\t-store    an extension (\".ogg\") that's stored without trying to compress it\n"
+                 "\t-threads  threads to compress and decompress on, every hardware thread by default\n"
+                 "\t-verify   check the pak against the files and time loading from both\n"
+                 "\tdir       the directory to pack, res by default\n");
+}
+
+struct PackedFile
+{
+    std::string name;
+    std::string path;
+};
+
+static bool ReadLoose(const std::string &path, std::vector<u8> &data)
+{
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if(!file.is_open())
+        return false;
+
+    data.resize((usize)file.tellg());
+    file.seekg(0);
+    file.read((char *)data.data(), (std::streamsize)data.size());
+    return (bool)file;
+}
+
+static bool Verify(const char *pakPath, const std::vector<PackedFile> &files, DEUtil::JobSystem &jobs)
+{
+    DEUtil::PakArchive pak;
+    if(!pak.Open(pakPath))
+        return false;
+
+    // every entry has to read back as its file, whole, in parallel and in a range from the middle
+    std::vector<u8> loose, packed;
+    for(const PackedFile &file : files)
+    {
+        i32 entryIdx = pak.Find(file.name.c_str());
+        if(entryIdx < 0 || !ReadLoose(file.path, loose))
+        {
+            LERROR(file.name << " is missing.\n");
+            return false;
+        }
+
+        bool same = pak.Read(file.name.c_str(), packed, nullptr) && packed == loose;
+        same = same && pak.Read(file.name.c_str(), packed, &jobs) && packed == loose;
+
+        u64 offset = loose.size() / 3, size = loose.size() / 2;
+        same = same && pak.ReadRange(entryIdx, offset, size, packed.data()) &&
+               memcmp(packed.data(), loose.data() + offset, size) == 0;
+        if(!same)
+        {
+            LERROR(file.name << " doesn't read back the same.\n");
+            return false;
+        }
+    }
+
+    u64 totalSize = 0;
+    u32 compressedCount = 0;
+    for(u32 i = 0; i < pak.GetEntryCount(); i++)
+    {
+        totalSize += pak.GetEntry((i32)i).size;
+        if(pak.GetEntry((i32)i).flags & PAK_ENTRY_COMPRESSED)
+            compressedCount++;
+    }
+    f64 totalMb = (f64)totalSize / (1024.0 * 1024.0);
+    printf("verified %u entries, %u compressed and %u stored\n", pak.GetEntryCount(), compressedCount,
+           pak.GetEntryCount() - compressedCount);
+
+    // warm loads, the pak's time includes finding every name
+    std::vector<std::vector<u8>> buffers(files.size());
+    auto start = std::chrono::steady_clock::now();
+    for(usize i = 0; i < files.size(); i++)
+        ReadLoose(files[i].path, buffers[i]);
+    f64 looseMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    f64 pakMs[2];
+    for(u32 parallel = 0; parallel < 2; parallel++)
+    {
+        start = std::chrono::steady_clock::now();
+        for(usize i = 0; i < files.size(); i++)
+            pak.Read(files[i].name.c_str(), buffers[i], parallel ? &jobs : nullptr);
+        pakMs[parallel] = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    printf("%-14s %9.2f ms %9.1f mb/s\n", "loose files", looseMs, totalMb / looseMs * 1000.0);
+    printf("%-14s %9.2f ms %9.1f mb/s\n", "pak", pakMs[0], totalMb / pakMs[0] * 1000.0);
+    printf("%-14s %9.2f ms %9.1f mb/s (%u threads)\n", "pak parallel", pakMs[1], totalMb / pakMs[1] * 1000.0,
+           jobs.GetThreadCount());
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    u32 chunkSize = PAK_DEFAULT_CHUNK_SIZE;
+    u32 threads = 0;
+    bool verify = false;
+    std::vector<std::string> storeExtensions;
+    const char *pakPath = nullptr;
+    const char *dir = "res";
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-chunk") == 0 && i + 1 < argc)
+            chunkSize = (u32)std::strtoul(argv[++i], nullptr, 10) * 1024;
+        else if(strcmp(argv[i], "-store") == 0 && i + 1 < argc)
+            storeExtensions.push_back(DEUtil::NormalizePakName(argv[++i]));
+        else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-verify") == 0)
+            verify = true;
+        else if(argv[i][0] != '-' && !pakPath)
+            pakPath = argv[i];
+        else if(argv[i][0] != '-')
+            dir = argv[i];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if(!pakPath || chunkSize < PAK_MIN_CHUNK_SIZE || chunkSize > PAK_MAX_CHUNK_SIZE)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::error_code error;
+    std::vector<PackedFile> files;
+    for(fs::recursive_directory_iterator it(dir, error), end; !error && it != end; it.increment(error))
+    {
+        if(it->is_regular_file(error))
+            files.push_back(PackedFile{it->path().lexically_relative(dir).generic_string(), it->path().string()});
+    }
+
+    if(error)
+    {
+        LERROR("couldn't list " << dir << ": " << error.message() << "\n");
+        return 1;
+    }
+
+    // the same directory always makes the same pak
+    std::sort(files.begin(), files.end(), [](const PackedFile &a, const PackedFile &b) { return a.name < b.name; });
+
+    DEUtil::PakWriter writer(chunkSize);
+    u64 looseSize = 0;
+    for(const PackedFile &file : files)
+    {
+        std::string extension = DEUtil::NormalizePakName(fs::path(file.name).extension().string().c_str());
+        bool compress =
+            std::find(storeExtensions.begin(), storeExtensions.end(), extension) == storeExtensions.end();
+        if(!writer.AddFile(file.name.c_str(), file.path.c_str(), compress))
+            return 1;
+
+        looseSize += fs::file_size(file.path, error);
+    }
+
+    DEUtil::JobSystem jobs(threads);
+    auto start = std::chrono::steady_clock::now();
+    if(!writer.Write(pakPath, &jobs))
+        return 1;
+    f64 packMs = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    u64 pakSize = fs::file_size(pakPath, error);
+    printf("packed %u files from %s into %s: %llu -> %llu bytes (%.1f%%) in %.2f ms\n", writer.GetEntryCount(), dir,
+           pakPath, looseSize, pakSize, looseSize ? 100.0 * (f64)pakSize / (f64)looseSize : 0.0, packMs);
+
+    if(verify && !Verify(pakPath, files, jobs))
+        return 1;
+
+    return 0;
+}
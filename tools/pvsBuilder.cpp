@@ -0,0 +1,88 @@
+// ---------------------- PVS BUILDER ----------------------
+// builds a map's sector visibility (portal flow or its REJECT lump)
+// into a .pvs file that the engine loads next to the map.
+//
+// usage: DOOMPvsBuilder [-reject] [-budget <steps>] <out.pvs> <map> <file.wad>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <wad/pvs.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMPvsBuilder [-reject] [-budget <steps>] <out.pvs> <map> <file.wad>...\n"
+                 "\t-reject  use the map's REJECT lump instead of portal flow\n"
+                 "\t-budget  portal flow steps per sector before falling back to a flood fill\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+int main(int argc, char **argv)
+{
+    bool useReject = false;
+    u64 budget = 1 << 20;
+    const char *outPath = nullptr;
+    const char *mapName = nullptr;
+    std::vector<const char *> wads;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-reject") == 0)
+            useReject = true;
+        else if(strcmp(argv[i], "-budget") == 0 && i + 1 < argc)
+            budget = std::strtoull(argv[++i], nullptr, 10);
+        else if(!outPath)
+            outPath = argv[i];
+        else if(!mapName)
+            mapName = argv[i];
+        else
+            wads.push_back(argv[i]);
+    }
+
+    if(!outPath || !mapName || wads.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    DEUtil::WadArchive archive;
+    for(const char *wad : wads)
+    {
+        if(!archive.AddFile(wad))
+            return 1;
+    }
+
+    DEUtil::MapData map;
+    if(!DEUtil::LoadMap(archive, mapName, map))
+        return 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    DEUtil::SectorPVS pvs;
+    if(useReject)
+    {
+        pvs.BuildFromReject(map);
+    }
+    else
+    {
+        DEUtil::PvsBuildStats stats = pvs.BuildPortalFlow(map, budget);
+        LINFO(false, "portal flow: " << stats.portals << " portals, " << stats.flowSteps << " steps, "
+                                     << stats.floodedSectors << " sectors over budget\n");
+    }
+
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    if(!pvs.Save(outPath))
+        return 1;
+
+    usize rawSize = (usize)pvs.GetSectorCount() * pvs.GetRowWords() * sizeof(u64);
+    LINFO(false, "wrote " << outPath << ": " << pvs.GetSectorCount() << " sectors, " << pvs.GetCompressedSize()
+                          << " bytes (" << rawSize << " uncompressed) in " << seconds << "s\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+// ---------------------- SOFT RENDER ----------------------
+// renders a map with the software renderer from player 1's start, no gpu needed.
+// prints the first frame's hash (a reference to compare builds against) and the
+// frame rate of a full turn on the spot.
+//
+// usage: DOOMSoftRender [-size <w>x<h>] [-threads <n>] [-frames <n>] [-out <file.ppm>] <map> <file.wad>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <wad/bsp.h>
+#include <soft/softRenderer.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// vanilla's VIEWHEIGHT, eyes above the floor
+#define PLAYER_VIEW_HEIGHT 41.0f
+
+#define THING_PLAYER1_START 1
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMSoftRender [-size <w>x<h>] [-threads <n>] [-frames <n>] [-out <file.ppm>] <map> <file.wad>...\n"
+                 "\t-size     framebuffer size, 640x400 by default\n"
+                 "\t-threads  column strips drawn in parallel, 0 (default) uses every hardware thread\n"
+                 "\t-frames   frames timed while turning a full circle, 360 by default\n"
+                 "\t-out      writes the first frame as a binary ppm\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+static bool WritePPM(const char *filepath, const std::vector<u32> &rgba, u32 width, u32 height)
+{
+    FILE *file = fopen(filepath, "wb");
+    if(!file)
+    {
+        LERROR("couldn't open " << filepath << " for writing.\n");
+        return false;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+
+    std::vector<u8> row((usize)width * 3);
+    for(u32 y = 0; y < height; y++)
+    {
+        for(u32 x = 0; x < width; x++)
+        {
+            u32 pixel = rgba[(usize)y * width + x];
+            row[x * 3 + 0] = (u8)pixel;
+            row[x * 3 + 1] = (u8)(pixel >> 8);
+            row[x * 3 + 2] = (u8)(pixel >> 16);
+        }
+
+        fwrite(row.data(), 1, row.size(), file);
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    u32 width = 640, height = 400;
+    u32 threads = 0;
+    u32 frames = 360;
+    const char *outPath = nullptr;
+    const char *mapName = nullptr;
+    std::vector<const char *> wads;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+            sscanf(argv[++i], "%ux%u", &width, &height);
+        else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frames = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if(!mapName)
+            mapName = argv[i];
+        else
+            wads.push_back(argv[i]);
+    }
+
+    if(!mapName || wads.empty() || width == 0 || height == 0 || height > 0x7fff)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    DEUtil::WadArchive archive;
+    for(const char *wad : wads)
+    {
+        if(!archive.AddFile(wad))
+            return 1;
+    }
+
+    DEUtil::MapData map;
+    if(!DEUtil::LoadMap(archive, mapName, map))
+        return 1;
+
+    DEUtil::SoftRenderer renderer(width, height, threads);
+    if(!renderer.LoadAssets(archive))
+        return 1;
+
+    // walls stay checkerboards if the wads have no textures
+    renderer.LoadWallTextures(archive);
+
+    renderer.SetMap(map);
+
+    DEUtil::SoftView view = {glm::vec2(0.0f), 0.0f, 0.0f};
+    for(const MapThing &thing : map.things)
+    {
+        if(thing.type != THING_PLAYER1_START)
+            continue;
+
+        view.pos = glm::vec2(thing.x, thing.y);
+        view.angle = glm::radians((f32)thing.angle);
+        break;
+    }
+
+    u32 sector = DEUtil::GetSubsectorSector(map, DEUtil::PointInSubsector(map, view.pos));
+    view.z = map.sectors[sector].floorHeight + PLAYER_VIEW_HEIGHT;
+
+    renderer.Render(view);
+    u64 hash = renderer.HashFramebuffer();
+
+    if(outPath)
+    {
+        std::vector<u32> rgba((usize)width * height);
+        renderer.Resolve(rgba.data(), width);
+        if(!WritePPM(outPath, rgba, width, height))
+            return 1;
+    }
+
+    f32 startAngle = view.angle;
+    auto start = std::chrono::steady_clock::now();
+    for(u32 i = 0; i < frames; i++)
+    {
+        view.angle = startAngle + glm::radians(360.0f * i / std::max(frames, 1u));
+        renderer.Render(view);
+    }
+    f64 seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    LINFO(false, mapName << " at " << width << "x" << height << ", " << renderer.GetThreadCount()
+                         << " threads: frame hash " << std::hex << hash << std::dec << ", " << frames << " frames in "
+                         << seconds << "s (" << (seconds > 0.0 ? frames / seconds : 0.0) << " fps)\n");
+    return 0;
+}
@@ -0,0 +1,247 @@
+// ---------------------- SPRITE BENCH ----------------------
+// batches a field of random sprites around an eye that turns a little every frame, with no
+// gpu or window: the cull, depth sort and quad expansion a frame of sprites costs on the cpu.
+// prints the per phase frame times next to a std::sort of the same keys and checks that
+// every frame is back to front and every quad faces the eye.
+//
+// with wads the sprites get their sizes and atlas rects from the wads' sprite lumps,
+// otherwise they're 32..96 unit squares spread over -arrays texture arrays.
+//
+// usage: DOOMSpriteBench [-sprites <n>] [-frames <n>] [-arrays <n>] [file.wad]...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/wadTextures.h>
+#include <textures/textureAtlas.h>
+#include <sprites/spriteBatch.h>
+
+#include "benchStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// sprites are spread over a square this many units across, around the eye
+#define BENCH_FIELD_SIZE 8192.0f
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMSpriteBench [-sprites <n>] [-frames <n>] [-arrays <n>] [file.wad]...\n"
+                 "\t-sprites  sprites per frame, 50000 by default\n"
+                 "\t-frames   frames batched, 200 by default\n"
+                 "\t-arrays   texture arrays the sprites without wads are spread over, 1 by default\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+// xorshift32, the same field every run
+static u32 NextRandom(u32 &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static f32 RandomUnit(u32 &state)
+{
+    return (NextRandom(state) >> 8) * (1.0f / (1 << 24));
+}
+
+static f32 DepthOf(const DEUtil::Sprite &sprite, const glm::vec3 &eye, f32 angle)
+{
+    return (sprite.pos.x - eye.x) * std::cos(angle) + (sprite.pos.y - eye.y) * std::sin(angle);
+}
+
+// back to front, and each quad's bottom edge at right angles to the view direction
+static bool VerifyBatch(const DEUtil::SpriteBatcher &batcher, const glm::vec3 &eye, f32 angle)
+{
+    const std::vector<DEUtil::SpriteVertex> &vertices = batcher.GetVertices();
+    f32 lastDepth = INFINITY;
+    for(u32 quad = 0; quad < batcher.GetQuadCount(); quad++)
+    {
+        f32 depth = DepthOf(batcher.GetSprite(batcher.GetSortedSprite(quad)), eye, angle);
+        if(depth > lastDepth)
+        {
+            LERROR("quad " << quad << " is farther than the one before it.\n");
+            return false;
+        }
+        lastDepth = depth;
+
+        const DEUtil::SpriteVertex *v = vertices.data() + (usize)quad * 4;
+        f32 edgeX = v[1].x - v[0].x, edgeY = v[1].y - v[0].y;
+        f32 facing = edgeX * std::cos(angle) + edgeY * std::sin(angle);
+        if(std::abs(facing) > 1e-2f * (std::abs(edgeX) + std::abs(edgeY) + 1.0f) || v[3].z <= v[0].z)
+        {
+            LERROR("quad " << quad << " doesn't face the eye.\n");
+            return false;
+        }
+    }
+
+    u32 drawn = 0;
+    for(const DEUtil::SpriteDraw &draw : batcher.GetDraws())
+    {
+        if(draw.firstQuad != drawn)
+        {
+            LERROR("draws don't cover the quads back to back.\n");
+            return false;
+        }
+        drawn += draw.quadCount;
+    }
+
+    if(drawn != batcher.GetQuadCount())
+    {
+        LERROR("draws cover " << drawn << " of " << batcher.GetQuadCount() << " quads.\n");
+        return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    u32 spriteCount = 50000;
+    u32 frames = 200;
+    u32 arrays = 1;
+    std::vector<const char *> wads;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-sprites") == 0 && i + 1 < argc)
+            spriteCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+            frames = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-arrays") == 0 && i + 1 < argc)
+            arrays = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else
+            wads.push_back(argv[i]);
+    }
+
+    if(spriteCount == 0 || frames == 0 || arrays == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // the wads' sprites packed into one atlas, so they're a single texture array
+    std::vector<DEUtil::WadImage> images;
+    DEUtil::TextureAtlas atlas(1024, 64, 1);
+    if(!wads.empty())
+    {
+        DEUtil::WadArchive archive;
+        for(const char *wad : wads)
+        {
+            if(!archive.AddFile(wad))
+                return 1;
+        }
+
+        DEUtil::LumpView playpal = archive.GetLump("PLAYPAL");
+        if(!playpal.data || playpal.size < 256 * 3)
+        {
+            LERROR("no PLAYPAL lump.\n");
+            return 1;
+        }
+
+        DEUtil::LoadSprites(archive, images);
+        if(images.empty())
+        {
+            LERROR("the wads have no sprites.\n");
+            return 1;
+        }
+
+        if(!atlas.Build(images, playpal.data))
+            return 1;
+    }
+
+    u32 random = 0x2545f491;
+    std::vector<DEUtil::Sprite> field(spriteCount);
+    for(DEUtil::Sprite &sprite : field)
+    {
+        sprite.pos = glm::vec3((RandomUnit(random) - 0.5f) * BENCH_FIELD_SIZE,
+                               (RandomUnit(random) - 0.5f) * BENCH_FIELD_SIZE, RandomUnit(random) * 256.0f);
+        sprite.light = RandomUnit(random);
+
+        if(images.empty())
+        {
+            f32 size = 32.0f + RandomUnit(random) * 64.0f;
+            sprite.width = size;
+            sprite.height = size;
+            sprite.left = size * 0.5f;
+            sprite.top = size;
+            sprite.uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+            sprite.layer = 0;
+            sprite.textureArray = NextRandom(random) % arrays;
+            continue;
+        }
+
+        u32 handle = NextRandom(random) % (u32)images.size();
+        const DEUtil::WadImage &image = images[handle];
+        sprite.width = (f32)image.width;
+        sprite.height = (f32)image.height;
+        sprite.left = (f32)image.leftOffset;
+        sprite.top = (f32)image.topOffset;
+        sprite.uvRect = atlas.GetUVRect(handle);
+        sprite.layer = atlas.GetRegion(handle).layer;
+        sprite.textureArray = 0;
+    }
+
+    DEUtil::SpriteBatcher batcher(spriteCount);
+    std::vector<f64> addTimes(frames), endTimes(frames), stdSortTimes(frames);
+    std::vector<std::pair<f32, u32>> reference;
+    reference.reserve(spriteCount);
+    u64 quads = 0, draws = 0;
+
+    glm::vec3 eye = glm::vec3(0.0f, 0.0f, 41.0f);
+    for(u32 frame = 0; frame < frames; frame++)
+    {
+        f32 angle = frame * 0.05f;
+
+        auto start = std::chrono::steady_clock::now();
+        batcher.Begin(eye, angle);
+        for(const DEUtil::Sprite &sprite : field)
+            batcher.Add(sprite);
+        auto added = std::chrono::steady_clock::now();
+        batcher.End();
+        auto ended = std::chrono::steady_clock::now();
+
+        addTimes[frame] = std::chrono::duration<f64, std::milli>(added - start).count();
+        endTimes[frame] = std::chrono::duration<f64, std::milli>(ended - added).count();
+        quads += batcher.GetQuadCount();
+        draws += batcher.GetDraws().size();
+
+        if(!VerifyBatch(batcher, eye, angle))
+            return 1;
+
+        // the comparison sort on the same depths, what the radix sort replaces
+        start = std::chrono::steady_clock::now();
+        reference.clear();
+        for(u32 i = 0; i < spriteCount; i++)
+        {
+            f32 depth = DepthOf(field[i], eye, angle);
+            if(depth >= SPRITE_NEAR_DEPTH)
+                reference.push_back({depth, i});
+        }
+        std::sort(reference.begin(), reference.end(),
+                  [](const std::pair<f32, u32> &a, const std::pair<f32, u32> &b) { return a.first > b.first; });
+        stdSortTimes[frame] = std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::sort(addTimes.begin(), addTimes.end());
+    std::sort(endTimes.begin(), endTimes.end());
+    std::sort(stdSortTimes.begin(), stdSortTimes.end());
+
+    LINFO(false, spriteCount << " sprites (" << (images.empty() ? "synthetic" : "from the wads") << "), " << frames
+                             << " frames, " << quads / frames << " quads and " << (f64)draws / frames
+                             << " draws a frame on average\n"
+                             << "add ms:        p50 " << Percentile(addTimes, 50.0) << ", p95 "
+                             << Percentile(addTimes, 95.0) << "\n"
+                             << "sort+quads ms: p50 " << Percentile(endTimes, 50.0) << ", p95 "
+                             << Percentile(endTimes, 95.0) << "\n"
+                             << "std::sort ms:  p50 " << Percentile(stdSortTimes, 50.0) << ", p95 "
+                             << Percentile(stdSortTimes, 95.0) << " (depths and sort only, for reference)\n");
+    return 0;
+}
@@ -0,0 +1,216 @@
+// ---------------------- TEXTURE ATLAS ----------------------
+// composes a wad's wall textures, loads its flats and sprites and packs them into
+// texture array layers. prints the layer count, occupancy and build times, checks that
+// no two regions (borders included) overlap and can dump every layer's mip 0.
+//
+// usage: DOOMTextureAtlas [-size <n>] [-layers <n>] [-mips <n>] [-runs <n>] [-out <prefix>] <file.wad>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/wadTextures.h>
+#include <textures/textureAtlas.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMTextureAtlas [-size <n>] [-layers <n>] [-mips <n>] [-runs <n>] [-out <prefix>] <file.wad>...\n"
+                 "\t-size    layer width and height, 1024 by default\n"
+                 "\t-layers  most layers the atlas may use, 64 by default\n"
+                 "\t-mips    mip levels, 4 by default\n"
+                 "\t-runs    times the atlas is rebuilt for the timing, 10 by default\n"
+                 "\t-out     writes mip 0 of every layer as <prefix><layer>.ppm\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+// every region's allocation (padded to the alignment, plus border) has to stay
+// inside its layer and apart from the others
+static bool VerifyAtlas(const DEUtil::TextureAtlas &atlas)
+{
+    struct Rect
+    {
+        u32 layer, x0, y0, x1, y1;
+    };
+
+    u32 border = atlas.GetBorder();
+    std::vector<Rect> rects;
+    for(u32 i = 0; i < atlas.GetRegionCount(); i++)
+    {
+        const DEUtil::AtlasRegion &region = atlas.GetRegion(i);
+        u32 paddedWidth = (region.width + border - 1) / border * border;
+        u32 paddedHeight = (region.height + border - 1) / border * border;
+        Rect rect = {region.layer, region.x - border, region.y - border, region.x + paddedWidth + border,
+                     region.y + paddedHeight + border};
+
+        if(region.x < border || region.y < border || rect.x1 > atlas.GetLayerSize() ||
+           rect.y1 > atlas.GetLayerSize() || region.layer >= atlas.GetLayerCount())
+        {
+            LERROR("region " << i << " is outside its layer.\n");
+            return false;
+        }
+
+        if(region.x % border != 0 || region.y % border != 0)
+        {
+            LERROR("region " << i << " isn't aligned for its mips.\n");
+            return false;
+        }
+
+        rects.push_back(rect);
+    }
+
+    // sweep along x per layer
+    std::sort(rects.begin(), rects.end(), [](const Rect &a, const Rect &b) {
+        return a.layer != b.layer ? a.layer < b.layer : a.x0 < b.x0;
+    });
+
+    for(usize i = 0; i < rects.size(); i++)
+    {
+        for(usize j = i + 1; j < rects.size() && rects[j].layer == rects[i].layer && rects[j].x0 < rects[i].x1; j++)
+        {
+            if(rects[j].y0 < rects[i].y1 && rects[i].y0 < rects[j].y1)
+            {
+                LERROR("two regions overlap on layer " << rects[i].layer << ".\n");
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+static bool WriteLayer(const std::string &filepath, const DEUtil::TextureAtlas &atlas, u32 layer, const u8 *playpal)
+{
+    FILE *file = fopen(filepath.c_str(), "wb");
+    if(!file)
+    {
+        LERROR("couldn't open " << filepath << " for writing.\n");
+        return false;
+    }
+
+    u32 size = atlas.GetLayerSize();
+    fprintf(file, "P6\n%u %u\n255\n", size, size);
+
+    const u8 *texels = atlas.GetMip(0).data() + (usize)layer * size * size * ATLAS_TEXEL_SIZE;
+    std::vector<u8> row((usize)size * 3);
+    for(u32 y = 0; y < size; y++)
+    {
+        for(u32 x = 0; x < size; x++)
+        {
+            const u8 *texel = texels + ((usize)y * size + x) * ATLAS_TEXEL_SIZE;
+
+            // see-through texels in magenta
+            const u8 magenta[3] = {0xff, 0x00, 0xff};
+            const u8 *rgb = texel[1] ? playpal + texel[0] * 3 : magenta;
+            memcpy(row.data() + x * 3, rgb, 3);
+        }
+
+        fwrite(row.data(), 1, row.size(), file);
+    }
+
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    u32 layerSize = 1024;
+    u32 maxLayers = 64;
+    u32 mipLevels = 4;
+    u32 runs = 10;
+    const char *outPrefix = nullptr;
+    std::vector<const char *> wads;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+            layerSize = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-layers") == 0 && i + 1 < argc)
+            maxLayers = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-mips") == 0 && i + 1 < argc)
+            mipLevels = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+            runs = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-out") == 0 && i + 1 < argc)
+            outPrefix = argv[++i];
+        else
+            wads.push_back(argv[i]);
+    }
+
+    if(wads.empty() || layerSize == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    DEUtil::WadArchive archive;
+    for(const char *wad : wads)
+    {
+        if(!archive.AddFile(wad))
+            return 1;
+    }
+
+    DEUtil::LumpView playpal = archive.GetLump("PLAYPAL");
+    if(!playpal.data || playpal.size < 256 * 3)
+    {
+        LERROR("no PLAYPAL lump.\n");
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<DEUtil::WadImage> images;
+    if(!DEUtil::LoadWallTextures(archive, images))
+        return 1;
+    usize textureCount = images.size();
+
+    DEUtil::LoadFlats(archive, images);
+    usize flatCount = images.size() - textureCount;
+
+    DEUtil::LoadSprites(archive, images);
+    usize spriteCount = images.size() - textureCount - flatCount;
+
+    f64 loadSeconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+
+    DEUtil::TextureAtlas atlas(layerSize, maxLayers, mipLevels);
+    f64 buildSeconds = 0.0;
+    for(u32 run = 0; run < std::max(runs, 1u); run++)
+    {
+        start = std::chrono::steady_clock::now();
+        if(!atlas.Build(images, playpal.data))
+            return 1;
+        buildSeconds += std::chrono::duration<f64>(std::chrono::steady_clock::now() - start).count();
+    }
+    buildSeconds /= std::max(runs, 1u);
+
+    if(!VerifyAtlas(atlas))
+        return 1;
+
+    u64 texels = 0;
+    for(const DEUtil::WadImage &image : images)
+        texels += (u64)image.width * image.height;
+
+    LINFO(false, textureCount << " textures, " << flatCount << " flats, " << spriteCount << " sprites ("
+                              << texels << " texels) loaded in " << loadSeconds * 1000.0 << "ms\n"
+                              << atlas.GetLayerCount() << " layers of " << atlas.GetLayerSize() << "x"
+                              << atlas.GetLayerSize() << ", " << atlas.GetMipLevels() << " mips, "
+                              << atlas.GetOccupancy() * 100.0f << "% packed (borders included), built in "
+                              << buildSeconds * 1000.0 << "ms\n");
+
+    if(outPrefix)
+    {
+        for(u32 layer = 0; layer < atlas.GetLayerCount(); layer++)
+        {
+            if(!WriteLayer(std::string(outPrefix) + std::to_string(layer) + ".ppm", atlas, layer, playpal.data))
+                return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+// ---------------------- TIMEDEMO ----------------------
+// plays a demo back tic by tic and renders a frame per tic as fast as it can (vanilla's
+// -timedemo), with the software renderer so no gpu is needed. prints the total time,
+// average and percentile frame times and the sim's state hash at the end, which has to
+// match between runs and builds.
+//
+// the sim only moves players (no monsters or line specials), so vanilla demos play
+// their inputs back but drift from what vanilla did once something else matters.
+//
+// usage: DOOMTimedemo [-size <w>x<h>] [-threads <n>] [-norender] <demo.lmp | DEMOn> <file.wad>...
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+#include <wad/mapData.h>
+#include <soft/softRenderer.h>
+#include <game/demo.h>
+#include <game/gameSim.h>
+
+#include "benchStats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMTimedemo [-size <w>x<h>] [-threads <n>] [-norender] <demo.lmp | DEMOn> <file.wad>...\n"
+                 "\t-size      framebuffer size, 640x400 by default\n"
+                 "\t-threads   column strips drawn in parallel, 0 (default) uses every hardware thread\n"
+                 "\t-norender  only runs the sim, for timing it alone\n"
+                 "\tthe demo is a .lmp file or a lump of the wads\n"
+                 "\twads are loaded in order, later ones override earlier ones (iwad first)\n");
+}
+
+int main(int argc, char **argv)
+{
+    u32 width = 640, height = 400;
+    u32 threads = 0;
+    bool render = true;
+    const char *demoName = nullptr;
+    std::vector<const char *> wads;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-size") == 0 && i + 1 < argc)
+            sscanf(argv[++i], "%ux%u", &width, &height);
+        else if(strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+            threads = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-norender") == 0)
+            render = false;
+        else if(!demoName)
+            demoName = argv[i];
+        else
+            wads.push_back(argv[i]);
+    }
+
+    if(!demoName || wads.empty() || width == 0 || height == 0 || height > 0x7fff)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    DEUtil::WadArchive archive;
+    for(const char *wad : wads)
+    {
+        if(!archive.AddFile(wad))
+            return 1;
+    }
+
+    DEUtil::Demo demo;
+    if(!DEUtil::LoadDemo(demoName, archive, demo))
+        return 1;
+
+    if(demo.GetTicCount() == 0)
+    {
+        LERROR("demo " << demoName << " has no tics.\n");
+        return 1;
+    }
+
+    std::string mapName = DEUtil::GetDemoMapName(demo, archive);
+    DEUtil::MapData map;
+    if(!DEUtil::LoadMap(archive, mapName.c_str(), map))
+        return 1;
+
+    DEUtil::GameSim sim;
+    if(!sim.Start(map, DEUtil::GetDemoPlayerMask(demo)))
+        return 1;
+
+    DEUtil::SoftRenderer renderer(width, height, threads);
+    if(render)
+    {
+        if(!renderer.LoadAssets(archive))
+            return 1;
+
+        // walls stay checkerboards if the wads have no textures
+        renderer.LoadWallTextures(archive);
+        renderer.SetMap(map);
+    }
+
+    std::vector<f64> frameTimes(demo.GetTicCount());
+    auto start = std::chrono::steady_clock::now();
+    auto frameStart = start;
+    for(u32 tic = 0; tic < demo.GetTicCount(); tic++)
+    {
+        sim.Tick(demo.GetTic(tic));
+
+        if(render)
+        {
+            const DEUtil::SimPlayer &player = sim.GetPlayer(demo.consolePlayer);
+            DEUtil::SoftView view;
+            view.pos = glm::vec2(DEUtil::FixedToFloat(player.x), DEUtil::FixedToFloat(player.y));
+            view.z = DEUtil::FixedToFloat(player.viewZ);
+            view.angle = DEUtil::AngleToRadians(player.angle);
+            renderer.Render(view);
+        }
+
+        auto frameEnd = std::chrono::steady_clock::now();
+        frameTimes[tic] = std::chrono::duration<f64, std::milli>(frameEnd - frameStart).count();
+        frameStart = frameEnd;
+    }
+    f64 seconds = std::chrono::duration<f64>(frameStart - start).count();
+
+    u64 simHash = sim.Hash();
+    u64 frameHash = render ? renderer.HashFramebuffer() : 0;
+
+    std::sort(frameTimes.begin(), frameTimes.end());
+    u32 tics = demo.GetTicCount();
+
+    LINFO(false, demoName << " on " << mapName << ": " << tics << " tics (" << tics / (f64)TICRATE
+                          << "s of game time) in " << seconds << "s, " << (seconds > 0.0 ? tics / seconds : 0.0)
+                          << " fps\n"
+                          << "frame ms: avg " << seconds * 1000.0 / tics << ", p50 " << Percentile(frameTimes, 50.0)
+                          << ", p95 " << Percentile(frameTimes, 95.0) << ", p99 " << Percentile(frameTimes, 99.0)
+                          << ", max " << frameTimes.back() << "\n"
+                          << "sim hash " << std::hex << simHash << ", last frame hash " << frameHash << std::dec
+                          << "\n");
+    return 0;
+}
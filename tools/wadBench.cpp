@@ -0,0 +1,250 @@
+// ---------------------- WAD BENCH ----------------------
+// writes a synthetic iwad of -lumps lumps and a pwad that overrides every -override'th of
+// them and adds a few of its own, then times WadArchive::AddFile() on both and FindLump()
+// on every name in a random order, next to the backwards linear scan vanilla doom does.
+// every lookup has to land on the newest lump of its name, and the lump's bytes have to be
+// the ones that wad wrote for it. the lump data is an odd number of bytes, so the
+// directories start unaligned like they do in plenty of real pwads.
+//
+// usage: DOOMWadBench [-dir <path>] [-lumps <n>] [-override <n>] [-runs <n>]
+
+#include <core/defines.h>
+#include <core/logger.h>
+#include <wad/wad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef IPLATFORM_WINDOWS
+    #include <sys/stat.h>
+#endif
+
+static void PrintUsage()
+{
+    LINFO(false, "usage: DOOMWadBench [-dir <path>] [-lumps <n>] [-override <n>] [-runs <n>]\n"
+                 "\t-dir       where the wads go, DOOMWadBench.wads by default\n"
+                 "\t-lumps     lumps in the iwad, 4096 by default\n"
+                 "\t-override  the pwad overrides every n-th iwad lump, 4 by default\n"
+                 "\t-runs      times everything is timed, the best run is kept, 20 by default\n");
+}
+
+// xorshift32, the same wads and lookup order every run
+static u32 NextRandom(u32 &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static std::string LumpName(u32 i)
+{
+    char name[WAD_NAME_LENGTH + 1];
+    snprintf(name, sizeof(name), "L%07u", i);
+    return name;
+}
+
+// a lump's bytes name the wad and the lump they belong to
+static void FillLump(std::vector<u8> &data, u32 wad, u32 lump)
+{
+    data.resize(13 + (lump * 7 + wad) % 53);
+    u32 state = 0x9e3779b9u ^ (lump * 2 + wad);
+    for(u8 &byte : data)
+        byte = (u8)NextRandom(state);
+}
+
+static bool WriteWad(const std::string &path, u32 magic, const std::vector<u32> &lumps, u32 wad)
+{
+    std::vector<u8> out(sizeof(WadHeader));
+    std::vector<WadDirEntry> directory;
+    std::vector<u8> data;
+    for(u32 lump : lumps)
+    {
+        FillLump(data, wad, lump);
+
+        WadDirEntry entry{};
+        entry.offset = (i32)out.size();
+        entry.size = (i32)data.size();
+        std::string name = LumpName(lump);
+        memcpy(entry.name, name.data(), std::min<usize>(name.size(), WAD_NAME_LENGTH));
+        directory.push_back(entry);
+
+        out.insert(out.end(), data.begin(), data.end());
+    }
+
+    WadHeader header{magic, (i32)lumps.size(), (i32)out.size()};
+    memcpy(out.data(), &header, sizeof(header));
+    usize directoryOffset = out.size();
+    out.resize(directoryOffset + directory.size() * sizeof(WadDirEntry));
+    memcpy(out.data() + directoryOffset, directory.data(), directory.size() * sizeof(WadDirEntry));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write((const char *)out.data(), (std::streamsize)out.size());
+    if(!file)
+    {
+        LERROR("couldn't write " << path << "\n");
+        return false;
+    }
+
+    return true;
+}
+
+// W_CheckNumForName(): newest lump first, one name compare per lump
+static i32 LinearFind(const DEUtil::WadArchive &archive, const char *name)
+{
+    u64 packed = DEUtil::PackLumpName(name);
+    for(i32 i = (i32)archive.GetLumpCount() - 1; i >= 0; i--)
+    {
+        if(archive.GetLumpInfo(i).name == packed)
+            return i;
+    }
+
+    return -1;
+}
+
+static f64 MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<f64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = "DOOMWadBench.wads";
+    u32 lumpCount = 4096;
+    u32 overrideEvery = 4;
+    u32 runs = 20;
+
+    for(i32 i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "-dir") == 0 && i + 1 < argc)
+            dir = argv[++i];
+        else if(strcmp(argv[i], "-lumps") == 0 && i + 1 < argc)
+            lumpCount = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-override") == 0 && i + 1 < argc)
+            overrideEvery = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else if(strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+            runs = (u32)std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    // names are L and 7 digits, and the missing names come after the real ones
+    if(lumpCount == 0 || (u64)(lumpCount + lumpCount / 8) * 2 > 9999999 || overrideEvery == 0 || runs == 0)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+#ifndef IPLATFORM_WINDOWS
+    mkdir(dir.c_str(), 0755);
+#endif
+
+    // the pwad overrides a share of the iwad's lumps and adds an eighth as many new ones
+    u32 addedCount = lumpCount / 8;
+    std::vector<u32> iwadLumps, pwadLumps;
+    for(u32 i = 0; i < lumpCount; i++)
+    {
+        iwadLumps.push_back(i);
+        if(i % overrideEvery == 0)
+            pwadLumps.push_back(i);
+    }
+    for(u32 i = 0; i < addedCount; i++)
+        pwadLumps.push_back(lumpCount + i);
+
+    std::string iwadPath = dir + "/synthetic.wad", pwadPath = dir + "/override.wad";
+    if(!WriteWad(iwadPath, WAD_IWAD_MAGIC, iwadLumps, 0) || !WriteWad(pwadPath, WAD_PWAD_MAGIC, pwadLumps, 1))
+        return 1;
+
+    // every name once, in a random order, and as many names that aren't there
+    u32 nameCount = lumpCount + addedCount;
+    std::vector<std::string> names, missing;
+    for(u32 i = 0; i < nameCount; i++)
+    {
+        names.push_back(LumpName(i));
+        missing.push_back(LumpName(nameCount + i));
+    }
+    u32 random = 0x2545f491;
+    for(u32 i = nameCount - 1; i > 0; i--)
+        std::swap(names[i], names[NextRandom(random) % (i + 1)]);
+
+    LOG_SET_PRIORITY(LOG_WARN); // AddFile() logs every wad it adds
+
+    f64 openMs = 1e30, findMs = 1e30, missMs = 1e30, linearMs = 1e30;
+    std::vector<i32> found(nameCount);
+    for(u32 run = 0; run < runs; run++)
+    {
+        DEUtil::WadArchive archive;
+        auto start = std::chrono::steady_clock::now();
+        if(!archive.AddFile(iwadPath.c_str()) || !archive.AddFile(pwadPath.c_str()))
+            return 1;
+        openMs = std::min(openMs, MsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        for(u32 i = 0; i < nameCount; i++)
+            found[i] = archive.FindLump(names[i].c_str());
+        findMs = std::min(findMs, MsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        u32 misses = 0;
+        for(const std::string &name : missing)
+            misses += archive.FindLump(name.c_str()) < 0;
+        missMs = std::min(missMs, MsSince(start));
+        if(misses != nameCount)
+        {
+            LERROR(nameCount - misses << " names that aren't in the wads were found.\n");
+            return 1;
+        }
+
+        // the scan is slow enough that a share of the names says enough
+        u32 linearNames = std::min<u32>(nameCount, 1024);
+        start = std::chrono::steady_clock::now();
+        for(u32 i = 0; i < linearNames; i++)
+        {
+            if(LinearFind(archive, names[i].c_str()) != found[i])
+            {
+                LERROR("hashed and linear lookups disagree on " << names[i] << ".\n");
+                return 1;
+            }
+        }
+        linearMs = std::min(linearMs, MsSince(start) * nameCount / linearNames);
+
+        if(run > 0)
+            continue;
+
+        // the newest lump of every name, with that wad's bytes
+        std::vector<u8> expected;
+        for(u32 i = 0; i < nameCount; i++)
+        {
+            u32 lump = (u32)std::strtoul(names[i].c_str() + 1, nullptr, 10);
+            u32 wad = lump >= lumpCount || lump % overrideEvery == 0 ? 1 : 0;
+            FillLump(expected, wad, lump);
+
+            DEUtil::LumpView view = archive.GetLump(found[i]);
+            if(found[i] < 0 || archive.GetLumpInfo(found[i]).file != wad || view.size != expected.size() ||
+               memcmp(view.data, expected.data(), expected.size()) != 0)
+            {
+                LERROR(names[i] << " doesn't resolve to the lump in " << (wad ? pwadPath : iwadPath) << ".\n");
+                return 1;
+            }
+        }
+    }
+
+    printf("%u iwad lumps, %u pwad lumps (%u overrides), %u names, best of %u runs\n", lumpCount,
+           (u32)pwadLumps.size(), (u32)pwadLumps.size() - addedCount, nameCount, runs);
+    printf("open both wads  %9.3f ms  %7.1f ns per lump\n", openMs,
+           openMs * 1e6 / (lumpCount + pwadLumps.size()));
+    printf("hashed lookup   %9.3f ms  %7.1f ns per name\n", findMs, findMs * 1e6 / nameCount);
+    printf("hashed miss     %9.3f ms  %7.1f ns per name\n", missMs, missMs * 1e6 / nameCount);
+    printf("linear lookup   %9.3f ms  %7.1f ns per name (vanilla's scan, for reference)\n", linearMs,
+           linearMs * 1e6 / nameCount);
+    return 0;
+}